@@ -24,31 +24,28 @@
 //   THE SOFTWARE.
 
 #include "Plist.hpp"
-#include <boost/locale/encoding_utf.hpp>
+#include "PlistBase64.hpp"
+#include "PlistDictionary.hpp"
+#include "PlistEndian.hpp"
+#include "PlistDocument.hpp"
+#include "PlistHelpers.hpp"
+#include "PlistUnicode.hpp"
+#include "PlistValue.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
 #include <list>
 #include <sstream>
-#include "base64.hpp"
 #include "pugixml.hpp"
 
-namespace Plist {
-
-		struct PlistHelperData
-		{
-			public:
-
-				// binary helper data
-				std::vector<int32_t> _offsetTable;
-				std::vector<unsigned char> _objectTable;
-				int32_t _offsetByteSize;
-				int64_t _offsetTableOffset;
-
-				int32_t _objRefSize;
-				int32_t _refCount;
-		};
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
-		void writePlistBinary(
-				PlistHelperData& d,
-				const boost::any& message);
+namespace Plist {
 
 		void writePlistXML(
 				pugi::xml_document& doc,
@@ -58,8 +55,8 @@ namespace Plist {
 
 		// msvc <= 2005 doesn't have std::vector::data() method
 
-		template<typename T>
-		T* vecData(std::vector<T>& vec)
+		template<typename T, typename Allocator>
+		T* vecData(std::vector<T, Allocator>& vec)
 		{
 			return (vec.size() > 0) ? &vec[0] : 0;
 			// if(vec.size() > 0)
@@ -68,8 +65,8 @@ namespace Plist {
 			//		throw Error("vecData trying to get pointer to empty std::vector");
 		}
 
-		template<typename T>
-		const T* vecData(const std::vector<T>& vec)
+		template<typename T, typename Allocator>
+		const T* vecData(const std::vector<T, Allocator>& vec)
 		{
 			return (vec.size() > 0) ? &vec[0] : 0;
 			// if(vec.size() > 0)
@@ -87,11 +84,8 @@ namespace Plist {
 
 		// xml parsing
 
-		dictionary_type parseDictionary(pugi::xml_node& node);
-		array_type parseArray(pugi::xml_node& node);
 		std::vector<char> base64Decode(const char* data);
 		void base64Encode(std::string& dataEncoded, const std::vector<char>& data);
-		Date parseDate(pugi::xml_node& node);
 		boost::any parse(pugi::xml_node& doc);
 
 		// xml writing
@@ -100,57 +94,131 @@ namespace Plist {
 		void writeXMLDictionary(pugi::xml_node& node, const dictionary_type& message);
 		void writeXMLNode(pugi::xml_node& node, const boost::any& obj);
 
-		// binary helper functions
-
-		template <typename IntegerType>
-			IntegerType bytesToInt(const unsigned char* bytes, bool littleEndian);
-		double bytesToDouble(const unsigned char* bytes, bool littleEndian);
-		std::vector<unsigned char> doubleToBytes(double val, bool littleEndian);
-		template<typename IntegerType>
-			std::vector<unsigned char> intToBytes(IntegerType val, bool littleEndian);
-		std::vector<unsigned char> getRange(const unsigned char* origBytes, int64_t index, int64_t size);
-		std::vector<unsigned char> getRange(const std::vector<unsigned char>& origBytes, int64_t index, int64_t size);
-		std::vector<char> getRange(const char* origBytes, int64_t index, int64_t size);
-
-		// binary parsing
-
-		boost::any parseBinary(const PlistHelperData& d, int objRef);
-		dictionary_type  parseBinaryDictionary(const PlistHelperData& d, int objRef);
-		array_type  parseBinaryArray(const PlistHelperData& d, int objRef);
-		std::vector<int32_t> getRefsForContainers(const PlistHelperData& d, int objRef);
-		int64_t parseBinaryInt(const PlistHelperData& d, int headerPosition, int& intByteCount);
-		double parseBinaryReal(const PlistHelperData& d, int headerPosition);
-		Date parseBinaryDate(const PlistHelperData& d, int headerPosition);
-		bool parseBinaryBool(const PlistHelperData& d, int headerPosition);
-		std::string parseBinaryString(const PlistHelperData& d, int objRef);
-		std::string parseBinaryUnicode(const PlistHelperData& d, int headerPosition);
-		data_type parseBinaryByteArray(const PlistHelperData& d, int headerPosition);
-		std::vector<unsigned char> regulateNullBytes(const std::vector<unsigned char>& origBytes, unsigned int minBytes);
-		void parseTrailer(PlistHelperData& d, const std::vector<unsigned char>& trailer);
-		void parseOffsetTable(PlistHelperData& d, const std::vector<unsigned char>& offsetTableBytes);
-		int32_t getCount(const PlistHelperData& d, int bytePosition, unsigned char headerByte, int& startOffset);
+		// direct xml writing
+
+		size_t formatInteger(char* buffer, int64_t value);
+
+		// The writers take boost::any trees and Value trees, each with its
+		// own containers.
+
+		template<typename Node>
+		struct PlistContainers;
+
+		template<>
+		struct PlistContainers<boost::any>
+		{
+			typedef array_type array;
+			typedef dictionary_type dictionary;
+		};
+
+		template<>
+		struct PlistContainers<Value>
+		{
+			typedef Value::array_type array;
+			typedef Value::dictionary_type dictionary;
+		};
+
+		// What the binary writer needs to know about a node: the container
+		// it is, or when there is none, the scalar as it will be encoded.
+
+		template<typename Node>
+		struct BinaryNode
+		{
+			bool container() const { return array || dictionary; }
+
+			const typename PlistContainers<Node>::array* array;
+			const typename PlistContainers<Node>::dictionary* dictionary;
+			UniqueKey scalar;
+		};
+
+		// a boost::any dictionary can be any of the policy containers
+
+		template<>
+		struct BinaryNode<boost::any>
+		{
+			bool container() const { return array || dictionary || hashDictionary || orderedDictionary || flatDictionary; }
+
+			const array_type* array;
+			const dictionary_type* dictionary;
+			const HashDictionary<boost::any>* hashDictionary;
+			const OrderedDictionary<boost::any>* orderedDictionary;
+			const FlatDictionary<boost::any>* flatDictionary;
+			UniqueKey scalar;
+		};
 
 		// binary writing
 
-		int countAny(const boost::any& object);
-		int countDictionary(const dictionary_type& dictionary);
-		int countArray(const array_type& array);
-		std::vector<unsigned char> writeBinaryDictionary(PlistHelperData& d, const dictionary_type& dictionary);
-		std::vector<unsigned char> writeBinaryArray(PlistHelperData& d, const array_type& array);
-		std::vector<unsigned char> writeBinaryByteArray(PlistHelperData& d, const data_type& byteArray);
-		std::vector<unsigned char> writeBinaryInteger(PlistHelperData& d, int64_t value, bool write);
-		std::vector<unsigned char> writeBinaryBool(PlistHelperData& d, bool value);
-		std::vector<unsigned char> writeBinaryDate(PlistHelperData& d, const Date& date);
-		std::vector<unsigned char> writeBinaryDouble(PlistHelperData& d, double value);
-		std::vector<unsigned char> writeBinary(PlistHelperData& d, const boost::any& obj);
-		std::vector<unsigned char> writeBinaryString(PlistHelperData& d, const std::string& value, bool head);
-
-		inline bool hostLittleEndian()
+		void describeBinary(const boost::any& obj, BinaryNode<boost::any>& node);
+		void describeBinary(const Value& obj, BinaryNode<Value>& node);
+		template<typename Node>
+			void planBinaryContainer(PlistHelperData& d, const BinaryNode<Node>& node);
+		void planBinaryContainer(PlistHelperData& d, const BinaryNode<boost::any>& node);
+		template<typename Array>
+			void planBinaryArray(PlistHelperData& d, const Array& array);
+		template<typename Dictionary>
+			void planBinaryDictionary(PlistHelperData& d, const Dictionary& dictionary);
+		int64_t binaryIntegerSize(int64_t value);
+		unsigned char* reserveBinaryOutput(PlistHelperData& d, int64_t size);
+		void writeBinaryBytes(PlistHelperData& d, uint64_t value, int32_t byteCount);
+		void writeBinaryData(PlistHelperData& d, const void* bytes, size_t size);
+		template<typename Dictionary>
+			void writeBinaryDictionary(PlistHelperData& d, const Dictionary& dictionary);
+		template<typename Array>
+			void writeBinaryArray(PlistHelperData& d, const Array& array);
+		void writeBinaryInteger(PlistHelperData& d, int64_t value);
+		template<typename Node>
+			void writeBinaryContainer(PlistHelperData& d, const BinaryNode<Node>& node);
+		void writeBinaryContainer(PlistHelperData& d, const BinaryNode<boost::any>& node);
+		void writeBinaryString(PlistHelperData& d, const std::string& value);
+
+		// reading, into either tree
+
+		template<typename Message>
+			void readPlistFile(const char* filename, Message& message);
+		template<typename Message>
+			void readPlistStream(std::istream& stream, Message& message);
+		template<typename Message>
+			void readPlistBytes(const char* byteArrayTemp, int64_t size, Message& message);
+		template<typename Message>
+			memory_resource* scratchResource(const Message& message);
+		memory_resource* scratchResource(const DocumentMessage& message);
+		void parseBinaryPlist(const PlistHelperData& d, Value& message);
+		void parseXMLPlist(pugi::xml_node& rootNode, Value& message);
+		void parseBinaryPlist(const PlistHelperData& d, PlistDecoder& decoder);
+		void parseXMLPlist(pugi::xml_node& rootNode, PlistDecoder& decoder);
+
+		// reading into boost::any, dictionaries built by Policy
+
+		template<typename Policy>
+		struct PolicyMessage
 		{
-			union { uint32_t x; uint8_t c[4]; } u;
-			u.x = 0xab0000cd;
-			return u.c[0] == 0xcd;
-		}
+			PolicyMessage(boost::any& value, const DecodeLimits& decodeLimits = DecodeLimits())
+				: message(value), limits(decodeLimits) { }
+
+			boost::any& message;
+			DecodeLimits limits;
+		};
+
+		template<typename Policy>
+			void parseBinaryPlist(const PlistHelperData& d, PolicyMessage<Policy>& message);
+		template<typename Policy>
+			void parseXMLPlist(pugi::xml_node& rootNode, PolicyMessage<Policy>& message);
+		template<typename Policy>
+			void parseDictionary(pugi::xml_node& node, boost::any& value, DecodeBudget& budget);
+		template<typename Policy>
+			void parseArray(pugi::xml_node& node, boost::any& value, DecodeBudget& budget);
+		template<typename Policy>
+			void parseBinaryArray(const PlistHelperData& d, int objRef, boost::any& value, DecodeBudget& budget);
+		template<typename Policy>
+			void parseBinaryDictionary(const PlistHelperData& d, int objRef, boost::any& value, DecodeBudget& budget);
+
+		// reading into Value
+
+		void parseDictionary(pugi::xml_node& node, Value& value, DecodeBudget& budget);
+		void parseArray(pugi::xml_node& node, Value& value, DecodeBudget& budget);
+		void parseXMLValue(const char* nodeName, const char* text, Value& value);
+		void parseBinaryArray(const PlistHelperData& d, int objRef, Value& value, DecodeBudget& budget);
+		void parseBinaryDictionary(const PlistHelperData& d, int objRef, Value& value, DecodeBudget& budget);
 
 } // namespace Plist
 
@@ -255,66 +323,120 @@ void writePlistXML(
 	writeXMLNode(plistNode, message);
 }
 
+template<typename Node>
+void planBinaryPlist(
+		PlistHelperData& d,
+		const Node& message)
+{
+	// Gives every object its ref without writing anything.  A container
+	// hands out its children's refs before they are visited (the root is
+	// ref 0) and equal scalars share one ref.  The refs of each container's
+	// children are recorded in _plan in the order writePlistBinary needs
+	// them.
+
+	d._offsetTable.push_back(0);
+	planBinary(d, message);
+	finishBinaryPlan(d);
+}
+
+void finishBinaryPlan(PlistHelperData& d)
+{
+	d._refCount = (int32_t) d._offsetTable.size();
+	d._objRefSize = byteCount(d._refCount - 1);
+
+	// everything but the ref lists has a size known up front, so offsets
+	// follow once the ref size is known.  Objects are written in the order
+	// they were planned, so the last one planned has the largest offset.
+
+	int64_t lastOffset = 8 + d._lastObjectBytes + d._lastObjectRefs * d._objRefSize;
+	d._offsetByteSize = byteCount(lastOffset);
+	d._offsetTableOffset = 8 + d._plannedBytes + d._plannedRefs * d._objRefSize;
+	if(d._offsetTableOffset > std::numeric_limits<int32_t>::max())
+		throw Error("Plist: binary plists over 2GB are not supported");
+
+	d._outputSize = d._offsetTableOffset + (int64_t) d._refCount * d._offsetByteSize + 32;
+}
+
+template<typename Node>
 void writePlistBinary(
 		PlistHelperData& d,
-		const boost::any& message)
+		const Node& message)
+{
+	// Replays the plan front to back into _output, which holds exactly
+	// _outputSize bytes.  A container's ref list is written ahead of its
+	// children and the offset table is filled in as objects land.
+
+	beginBinaryOutput(d);
+	writeBinary(d, message, 0);
+	finishBinaryOutput(d);
+}
+
+void beginBinaryOutput(PlistHelperData& d)
+{
+	d._planPosition = 0;
+	d._nextRef = 1;
+	d._outputPosition = 0;
+
+	writeBinaryData(d, "bplist00", 8);
+}
+
+void finishBinaryOutput(PlistHelperData& d)
 {
 	using namespace std;
-	//int totalRefs =  countDictionary(message);
-	int totalRefs =  countAny(message) - 1;
-	d._refCount = totalRefs;
 
-	d._objRefSize = regulateNullBytes(intToBytes<int32_t>(d._refCount, hostLittleEndian()), 1).size();
+	// offset table
 
-	//writeBinaryDictionary(d, message);
-	writeBinary(d, message);
-	writeBinaryString(d, "bplist00", false);
-	d._offsetTableOffset = (int64_t) d._objectTable.size();
-	d._offsetTable.push_back(d._objectTable.size() - 8);
-	d._offsetByteSize = regulateNullBytes(intToBytes<int>(d._offsetTable.back(), hostLittleEndian()), 1).size();
+	for(ScratchVector<int32_t>::type::const_iterator it = d._offsetTable.begin();
+			it != d._offsetTable.end();
+			++it)
+		writeBinaryBytes(d, *it, d._offsetByteSize);
 
-	vector<unsigned char> offsetBytes;
+	// trailer
 
-	reverse(d._offsetTable.begin(), d._offsetTable.end());
+	writeBinaryBytes(d, 0, 6);
+	writeBinaryBytes(d, d._offsetByteSize, 1);
+	writeBinaryBytes(d, d._objRefSize, 1);
+	writeBinaryBytes(d, d._refCount, 8);
+	writeBinaryBytes(d, 0, 8);
+	writeBinaryBytes(d, d._offsetTableOffset, 8);
 
-	for(unsigned int i = 0; i < d._offsetTable.size(); ++i)
-	{
-		d._offsetTable[i] = d._objectTable.size() - d._offsetTable[i];
-		vector<unsigned char> buffer = regulateNullBytes(intToBytes<int>(d._offsetTable[i], hostLittleEndian()), d._offsetByteSize);
-		//reverse(buffer.begin(), buffer.end());
+	if(d._outputPosition != d._outputSize)
+		throw Error("Plist: binary plist size doesn't match its plan");
+}
 
-		offsetBytes.insert(offsetBytes.end(), buffer.rbegin(), buffer.rend());
-	}
+// writes into plist, a std::vector of char with any allocator, with the
+// writer's scratch from resource
 
-	d._objectTable.insert(d._objectTable.end(), offsetBytes.begin(), offsetBytes.end());
+template<typename Buffer, typename Node>
+void writePlistBinary(Buffer& plist, const Node& message, memory_resource* resource)
+{
+	PlistHelperData d(resource);
+	planBinaryPlist(d, message);
 
-	vector<unsigned char> dummy(6, 0);
-	d._objectTable.insert(d._objectTable.end(), dummy.begin(), dummy.end());
-	d._objectTable.push_back((unsigned char) (d._offsetByteSize));
-	d._objectTable.push_back((unsigned char) (d._objRefSize));
-	vector<unsigned char> temp = intToBytes<int64_t>((int64_t) totalRefs + 1, hostLittleEndian());
-	d._objectTable.insert(d._objectTable.end(), temp.rbegin(), temp.rend());
-	temp = intToBytes<int64_t>(0, hostLittleEndian());
-	d._objectTable.insert(d._objectTable.end(), temp.begin(), temp.end());
-	temp = intToBytes<int64_t>(d._offsetTableOffset, hostLittleEndian());
-	d._objectTable.insert(d._objectTable.end(), temp.rbegin(), temp.rend());
+	plist.resize((size_t) d._outputSize);
+	d._output = (unsigned char*) vecData(plist);
+	writePlistBinary(d, message);
 }
 
 void writePlistBinary(std::vector<char>& plist, const boost::any& message)
 {
-	PlistHelperData d;
-	writePlistBinary(d, message);
-	plist.resize(d._objectTable.size());
-	std::copy((const char*) vecData(d._objectTable), (const char*) vecData(d._objectTable) + d._objectTable.size(), plist.begin());
+	writePlistBinary(plist, message, defaultResource());
+}
+
+#if defined(PLIST_HAS_PMR)
+void writePlistBinary(pmr::data_type& plist, const boost::any& message)
+{
+	writePlistBinary(plist, message, plist.get_allocator().resource());
 }
+#endif
 
 void writePlistBinary(
 		std::ostream& stream,
 		const boost::any& message)
 {
-	PlistHelperData d;
-	writePlistBinary(d, message);
-	stream.write((const char*) vecData(d._objectTable), d._objectTable.size());
+	std::vector<char> plist;
+	writePlistBinary(plist, message);
+	stream.write(vecData(plist), plist.size());
 }
 
 void writePlistBinary(
@@ -337,431 +459,1641 @@ void writePlistBinary(
 }
 #endif
 
-void writePlistXML(std::vector<char>& plist, const boost::any& message)
+// The direct writer produces byte for byte what pugixml writes for the
+// document writePlistXML(pugi::xml_document&, ...) builds: one tab of
+// indent per level, "<name>text</name>" for values, "<name />" for empty
+// elements, and text escaped and cut at the first nul.
+
+template<typename Sink>
+void writeXMLIndent(Sink& sink, int depth)
 {
-	std::stringstream ss;
-	writePlistXML(ss, message);
+	static const char tabs[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+	const int tabCount = sizeof(tabs) - 1;
 
-	std::istreambuf_iterator<char> beg(ss);
-	std::istreambuf_iterator<char> end;
-	plist.clear();
-	plist.insert(plist.begin(), beg, end);
+	for(; depth > tabCount; depth -= tabCount)
+		sink.write(tabs, tabCount);
+	sink.write(tabs, depth);
 }
 
-void writePlistXML(
-		std::ostream& stream,
-		const boost::any& message)
+template<typename Sink>
+void writeXMLEscaped(Sink& sink, const char* text, size_t size)
 {
-	pugi::xml_document doc;
-	writePlistXML(doc, message);
-	doc.save(stream);
+	const char* end = text + size;
+	const char* run = text;
+	for(const char* c = text; ; ++c)
+	{
+		if(c == end)
+		{
+			sink.write(run, c - run);
+			return;
+		}
+
+		unsigned char ch = (unsigned char) *c;
+		if(ch >= 32 ? (ch != '&' && ch != '<' && ch != '>') : (ch == '\t' || ch == '\n' || ch == '\r'))
+			continue;
+
+		sink.write(run, c - run);
+		run = c + 1;
+
+		switch(ch)
+		{
+			case 0:
+				return;
+			case '&':
+				sink.write("&amp;", 5);
+				break;
+			case '<':
+				sink.write("&lt;", 4);
+				break;
+			case '>':
+				sink.write("&gt;", 4);
+				break;
+			default:
+				{
+					char escaped[5] = { '&', '#', (char) ('0' + ch / 10), (char) ('0' + ch % 10), ';' };
+					sink.write(escaped, 5);
+				}
+		}
+	}
 }
 
-void writePlistXML(
-		const char* filename,
-		const boost::any& message)
+template<typename Sink>
+void writeXMLOpenTag(Sink& sink, const char* name, size_t nameSize, int depth)
 {
+	writeXMLIndent(sink, depth);
+	sink.put('<');
+	sink.write(name, nameSize);
+	sink.put('>');
+}
 
-	std::ofstream stream(filename, std::ios::binary);
-	writePlistXML(stream, message);
-	stream.close();
+template<typename Sink>
+void writeXMLCloseTag(Sink& sink, const char* name, size_t nameSize)
+{
+	sink.write("</", 2);
+	sink.write(name, nameSize);
+	sink.write(">\n", 2);
 }
 
-#if defined(_MSC_VER)
-void writePlistXML(
-		const wchar_t* filename,
-		const boost::any& message)
+// "<name>text</name>", text needing no escaping
+
+template<typename Sink, size_t N>
+void writeXMLText(Sink& sink, const char (&name)[N], const char* text, size_t textSize, int depth)
 {
-	std::ofstream stream(filename, std::ios::binary);
-	writePlistXML(stream, message);
-	stream.close();
+	writeXMLOpenTag(sink, name, N - 1, depth);
+	sink.write(text, textSize);
+	writeXMLCloseTag(sink, name, N - 1);
 }
-#endif
 
-int countAny(const boost::any& object)
+// "<name>text</name>", text escaped
+
+template<typename Sink, size_t N>
+void writeXMLString(Sink& sink, const char (&name)[N], const char* text, size_t textSize, int depth)
 {
-	using namespace std;
-	static boost::any dict = dictionary_type();
-	static boost::any array = array_type();
-
-	int count = 0;
-	if(object.type() == dict.type())
-		count += countDictionary(boost::any_cast<dictionary_type >(object)) + 1;
-	else if (object.type() == array.type())
-		count += countArray(boost::any_cast<array_type >(object)) + 1;
-	else
-		++count;
+	writeXMLOpenTag(sink, name, N - 1, depth);
+	writeXMLEscaped(sink, text, textSize);
+	writeXMLCloseTag(sink, name, N - 1);
+}
 
-	return count;
+template<typename Sink>
+void writeXMLKey(Sink& sink, const char* key, size_t size, int depth)
+{
+	writeXMLString(sink, "key", key, size, depth);
 }
 
-std::vector<unsigned char> writeBinary(PlistHelperData& d, const boost::any& obj)
+template<typename Sink>
+void writeXMLStringValue(Sink& sink, const char* text, size_t size, int depth)
 {
-	using namespace std;
+	writeXMLString(sink, "string", text, size, depth);
+}
 
-	const std::type_info &objType = obj.type();
+template<typename Sink>
+void writeXMLInteger(Sink& sink, int64_t value, int depth)
+{
+	char text[24];
+	writeXMLText(sink, "integer", text, formatInteger(text, value), depth);
+}
 
-	std::vector<unsigned char> value;
-	if(objType == typeid(int32_t))
-		value = writeBinaryInteger(d, boost::any_cast<const int32_t&>(obj), true);
-	else if(objType == typeid(int64_t))
-		value = writeBinaryInteger(d, boost::any_cast<const int64_t&>(obj), true);
-	else if(objType == typeid(long))
-		value = writeBinaryInteger(d, boost::any_cast<const long&>(obj), true);
-	else if(objType == typeid(short))
-		value = writeBinaryInteger(d, boost::any_cast<const short&>(obj), true);
-	else if(objType == typeid(dictionary_type))
-		value = writeBinaryDictionary(d, boost::any_cast<const dictionary_type& >(obj));
-	else if(objType == typeid(string))
-		value = writeBinaryString(d, boost::any_cast<const string&>(obj), true);
-	else if(objType == typeid(array_type))
-		value = writeBinaryArray(d, boost::any_cast<const array_type& >(obj));
-	else if(objType == typeid(data_type))
-		value = writeBinaryByteArray(d, boost::any_cast<const data_type& >(obj));
-	else if(objType == typeid(double))
-		value = writeBinaryDouble(d, boost::any_cast<const double&>(obj));
-	else if(objType == typeid(float))
-		value = writeBinaryDouble(d, boost::any_cast<const float&>(obj));
-	else if(objType == typeid(Date))
-		value = writeBinaryDate(d, boost::any_cast<const Date&>(obj));
-	else if(objType == typeid(bool))
-		value = writeBinaryBool(d, boost::any_cast<const bool&>(obj));
-	else
-		throw Error((string("Plist Error: Can't serialize type ") + objType.name()).c_str());
+// reals go through a stream like they always have, so the text doesn't
+// change
 
-	return value;
+template<typename Sink, typename Real>
+void writeXMLReal(Sink& sink, Real value, int depth)
+{
+	std::string text = stringFromValue(value);
+	writeXMLText(sink, "real", text.data(), text.size(), depth);
 }
 
-static uint32_t nextpow2(uint32_t x)
+template<typename Sink>
+void writeXMLBoolean(Sink& sink, bool value, int depth)
 {
-    --x;
-    x |= x >> 1;
-    x |= x >> 2;
-    x |= x >> 4;
-    x |= x >> 8;
-    x |= x >> 16;
-    return x + 1;
+	writeXMLIndent(sink, depth);
+	if(value)
+		sink.write("<true />\n", 9);
+	else
+		sink.write("<false />\n", 10);
 }
 
-static uint32_t ilog2(uint32_t x)
+template<typename Sink>
+void writeXMLDate(Sink& sink, const Date& value, int depth)
 {
-	uint32_t r = 0;
-	while (x >>= 1)
-		++r;
-	return r;
+	char text[Date::XMLConventionBufferSize];
+	size_t textSize = value.timeAsXMLConvention(text);
+	writeXMLText(sink, "date", text, textSize, depth);
 }
 
-std::vector<unsigned char> writeBinaryByteArray(PlistHelperData& d, const data_type& byteArray)
+template<typename Sink>
+void writeXMLData(Sink& sink, const char* bytes, size_t size, int depth)
 {
-	using namespace std;
-	vector<unsigned char> header;
-	if(byteArray.size() < 15)
-		header.push_back(0x40 | ((unsigned char) byteArray.size()));
-	else
-	{
-		header.push_back(0x40 | 0xf);
-		vector<unsigned char> theSize = writeBinaryInteger(d, byteArray.size(), false);
-		header.insert(header.end(), theSize.begin(), theSize.end());
-	}
+	std::string dataEncoded(base64EncodedSize(size), '\0');
+	if(!dataEncoded.empty())
+		base64Encode(&dataEncoded[0], (const unsigned char*) bytes, size);
+	writeXMLText(sink, "data", dataEncoded.data(), dataEncoded.size(), depth);
+}
 
-	vector<unsigned char> buffer(header);
-	buffer.insert(buffer.end(), (unsigned char*) vecData(byteArray), (unsigned char*) vecData(byteArray) + byteArray.size());
-	d._objectTable.insert(d._objectTable.begin(), buffer.begin(), buffer.end());
+// sizing needs only the length of the encoding
 
-	return buffer;
+template<>
+void writeXMLData(XMLCountingSink& sink, const char*, size_t size, int depth)
+{
+	writeXMLText(sink, "data", 0, base64EncodedSize(size), depth);
 }
 
-std::vector<unsigned char> writeBinaryArray(PlistHelperData& d, const array_type& array)
+// a presized buffer is encoded into directly
+
+template<>
+void writeXMLData(XMLBufferSink& sink, const char* bytes, size_t size, int depth)
 {
-	using namespace std;
+	writeXMLOpenTag(sink, "data", 4, depth);
+	base64Encode(sink.reserve(base64EncodedSize(size)), (const unsigned char*) bytes, size);
+	writeXMLCloseTag(sink, "data", 4);
+}
 
-	vector<int32_t> refs;
-	for(array_type::const_reverse_iterator it = array.rbegin();
-			it != array.rend();
-			++it)
+template<typename Sink, typename Array>
+void emitXMLArray(Sink& sink, const Array& array, int depth)
+{
+	writeXMLIndent(sink, depth);
+	if(array.empty())
 	{
-		writeBinary(d, *it);
-		d._offsetTable.push_back(d._objectTable.size());
-		refs.push_back(d._refCount);
-		d._refCount--;
+		sink.write("<array />\n", 10);
+		return;
 	}
 
-	vector<unsigned char> header;
-	if (array.size() < 15)
-	{
-		header.push_back(0xA0 | ((unsigned char) array.size()));
-	}
-	else
+	sink.write("<array>\n", 8);
+	for(typename Array::const_iterator it = array.begin();
+			it != array.end();
+			++it)
+		emitXMLNode(sink, *it, depth + 1);
+	writeXMLIndent(sink, depth);
+	sink.write("</array>\n", 9);
+}
+
+template<typename Sink, typename Dictionary>
+void emitXMLDictionary(Sink& sink, const Dictionary& dictionary, int depth)
+{
+	writeXMLIndent(sink, depth);
+	if(dictionary.empty())
 	{
-		header.push_back(0xA0 | 0xf);
-		vector<unsigned char> theSize = writeBinaryInteger(d, array.size(), false);
-		header.insert(header.end(), theSize.begin(), theSize.end());
+		sink.write("<dict />\n", 9);
+		return;
 	}
 
-	// try to do this more efficiently.  Not good to insert at the begining of buffer.
-
-	vector<unsigned char> buffer;
-	for(vector<int32_t>::const_iterator it = refs.begin();
-			it != refs.end();
+	sink.write("<dict>\n", 7);
+	for(typename Dictionary::const_iterator it = dictionary.begin();
+			it != dictionary.end();
 			++it)
 	{
-		vector<unsigned char> refBuffer = regulateNullBytes(intToBytes<int32_t>(*it, hostLittleEndian()), d._objRefSize);
-//		reverse(refBuffer.begin(), refBuffer.end());
-		buffer.insert(buffer.begin(), refBuffer.rbegin(), refBuffer.rend());
+		writeXMLKey(sink, it->first.data(), it->first.size(), depth + 1);
+		emitXMLNode(sink, it->second, depth + 1);
 	}
-
-	buffer.insert(buffer.begin(), header.begin(), header.end());
-
-	d._objectTable.insert(d._objectTable.begin(), buffer.begin(), buffer.end());
-
-	return buffer;
+	writeXMLIndent(sink, depth);
+	sink.write("</dict>\n", 8);
 }
 
-std::vector<unsigned char> writeBinaryDictionary(PlistHelperData& d, const dictionary_type& dictionary)
+template<typename Sink>
+void emitXMLNode(Sink& sink, const boost::any& obj, int depth)
 {
 	using namespace std;
 
-	vector<int32_t> refs;
-	for(dictionary_type::const_reverse_iterator it = dictionary.rbegin();
-			it != dictionary.rend();
-			++it)
-	{
-		writeBinary(d, it->second);
-		d._offsetTable.push_back(d._objectTable.size());
-		refs.push_back(d._refCount);
-		d._refCount--;
-	}
+	const std::type_info &objType = obj.type();
 
-	for(dictionary_type::const_reverse_iterator it = dictionary.rbegin();
-			it != dictionary.rend();
-			++it)
+	if(objType == typeid(int32_t))
+		writeXMLInteger(sink, boost::any_cast<const int32_t&>(obj), depth);
+	else if(objType == typeid(int64_t))
+		writeXMLInteger(sink, boost::any_cast<const int64_t&>(obj), depth);
+	else if(objType == typeid(long))
+		writeXMLInteger(sink, boost::any_cast<const long&>(obj), depth);
+	else if(objType == typeid(short))
+		writeXMLInteger(sink, boost::any_cast<const short&>(obj), depth);
+	else if(objType == typeid(dictionary_type))
+		emitXMLDictionary(sink, boost::any_cast<const dictionary_type&>(obj), depth);
+	else if(objType == typeid(string_type))
 	{
-		writeBinary(d, it->first);
-		d._offsetTable.push_back(d._objectTable.size());
-		refs.push_back(d._refCount);
-		d._refCount--;
+		const string_type& text = boost::any_cast<const string_type&>(obj);
+		writeXMLStringValue(sink, text.data(), text.size(), depth);
 	}
-
-	vector<unsigned char> header;
-	if (dictionary.size() < 15)
+	else if(objType == typeid(array_type))
+		emitXMLArray(sink, boost::any_cast<const array_type&>(obj), depth);
+	else if(objType == typeid(data_type))
 	{
-		header.push_back(0xD0 | ((unsigned char) dictionary.size()));
+		const data_type& data = boost::any_cast<const data_type&>(obj);
+		writeXMLData(sink, vecData(data), data.size(), depth);
 	}
+	else if(objType == typeid(double))
+		writeXMLReal(sink, boost::any_cast<const double&>(obj), depth);
+	else if(objType == typeid(float))
+		writeXMLReal(sink, boost::any_cast<const float&>(obj), depth);
+	else if(objType == typeid(Date))
+		writeXMLDate(sink, boost::any_cast<const Date&>(obj), depth);
+	else if(objType == typeid(bool))
+		writeXMLBoolean(sink, boost::any_cast<const bool&>(obj), depth);
+	else if(objType == typeid(HashDictionary<boost::any>))
+		emitXMLDictionary(sink, boost::any_cast<const HashDictionary<boost::any>&>(obj), depth);
+	else if(objType == typeid(OrderedDictionary<boost::any>))
+		emitXMLDictionary(sink, boost::any_cast<const OrderedDictionary<boost::any>&>(obj), depth);
+	else if(objType == typeid(FlatDictionary<boost::any>))
+		emitXMLDictionary(sink, boost::any_cast<const FlatDictionary<boost::any>&>(obj), depth);
 	else
-	{
-		header.push_back(0xD0 | 0xf);
-		vector<unsigned char> theSize = writeBinaryInteger(d, dictionary.size(), false);
-		header.insert(header.end(), theSize.begin(), theSize.end());
-	}
-
-	// try to do this more efficiently.  Not good to insert at the begining of buffer.
+		throw Error((string("Plist Error: Can't serialize type ") + objType.name()).c_str());
+}
 
-	vector<unsigned char> buffer;
-	for(vector<int32_t>::const_iterator it = refs.begin();
-			it != refs.end();
-			++it)
+template<typename Sink>
+void emitXMLNode(Sink& sink, const Value& obj, int depth)
+{
+	switch(obj.type())
 	{
-		vector<unsigned char> refBuffer = regulateNullBytes(intToBytes<int32_t>(*it, hostLittleEndian()), d._objRefSize);
-//		reverse(refBuffer.begin(), refBuffer.end());
-		buffer.insert(buffer.begin(), refBuffer.rbegin(), refBuffer.rend());
+		case Value::BooleanType:
+			writeXMLBoolean(sink, obj.asBoolean(), depth);
+			break;
+		case Value::IntegerType:
+			writeXMLInteger(sink, obj.asInteger(), depth);
+			break;
+		case Value::RealType:
+			writeXMLReal(sink, obj.asReal(), depth);
+			break;
+		case Value::DateType:
+			writeXMLDate(sink, obj.asDate(), depth);
+			break;
+		case Value::DataType:
+			writeXMLData(sink, obj.bytes(), obj.byteCount(), depth);
+			break;
+		case Value::StringType:
+			writeXMLStringValue(sink, obj.bytes(), obj.byteCount(), depth);
+			break;
+		case Value::ArrayType:
+			emitXMLArray(sink, obj.asArray(), depth);
+			break;
+		case Value::DictionaryType:
+			emitXMLDictionary(sink, obj.asDictionary(), depth);
+			break;
 	}
+}
+
+template<typename Sink>
+void writeXMLPrologue(Sink& sink)
+{
+	static const char prologue[] =
+		"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+		"<!DOCTYPE plist PUBLIC \"-//Apple//DTD PLIST 1.0//EN\" \"http://www.apple.com/DTDs/PropertyList-1.0.dtd\">\n"
+		"<plist version=\"1.0\">\n";
 
-	buffer.insert(buffer.begin(), header.begin(), header.end());
+	sink.write(prologue, sizeof(prologue) - 1);
+}
 
-	d._objectTable.insert(d._objectTable.begin(), buffer.begin(), buffer.end());
+template<typename Sink>
+void writeXMLEpilogue(Sink& sink)
+{
+	static const char epilogue[] = "</plist>\n";
 
-	return buffer;
+	sink.write(epilogue, sizeof(epilogue) - 1);
 }
 
-std::vector<unsigned char> writeBinaryDouble(PlistHelperData& d, double value)
+template<typename Sink, typename Node>
+void emitXMLPlist(Sink& sink, const Node& message)
 {
-	using namespace std;
-	vector<unsigned char> buffer = regulateNullBytes(doubleToBytes(value, hostLittleEndian()), 4);
-	buffer.resize(nextpow2(buffer.size()), 0);
+	writeXMLPrologue(sink);
+	emitXMLNode(sink, message, 1);
+	writeXMLEpilogue(sink);
+}
 
-	unsigned char header = 0x20 | ilog2(buffer.size());
-	buffer.push_back(header);
-	reverse(buffer.begin(), buffer.end());
+// the pieces PlistFields.hpp writes structs with
+
+#define PLIST_INSTANTIATE_XML_SINK(Sink) \
+	template void writeXMLPrologue(Sink& sink); \
+	template void writeXMLEpilogue(Sink& sink); \
+	template void writeXMLIndent(Sink& sink, int depth); \
+	template void writeXMLKey(Sink& sink, const char* key, size_t size, int depth); \
+	template void writeXMLStringValue(Sink& sink, const char* text, size_t size, int depth); \
+	template void writeXMLInteger(Sink& sink, int64_t value, int depth); \
+	template void writeXMLReal(Sink& sink, double value, int depth); \
+	template void writeXMLReal(Sink& sink, float value, int depth); \
+	template void writeXMLBoolean(Sink& sink, bool value, int depth); \
+	template void writeXMLDate(Sink& sink, const Date& value, int depth); \
+	template void emitXMLNode(Sink& sink, const boost::any& obj, int depth); \
+	template void emitXMLNode(Sink& sink, const Value& obj, int depth);
+
+PLIST_INSTANTIATE_XML_SINK(XMLStreamSink)
+PLIST_INSTANTIATE_XML_SINK(XMLBufferSink)
+PLIST_INSTANTIATE_XML_SINK(XMLCountingSink)
+template void writeXMLData(XMLStreamSink& sink, const char* bytes, size_t size, int depth);
+
+#undef PLIST_INSTANTIATE_XML_SINK
+
+// writes into plist, a std::vector of char with any allocator
+
+template<typename Buffer, typename Node>
+void writePlistXMLBuffer(Buffer& plist, const Node& message)
+{
+	XMLCountingSink counter;
+	emitXMLPlist(counter, message);
 
-	d._objectTable.insert(d._objectTable.begin(), buffer.begin(), buffer.end());
+	plist.resize((size_t) counter.size());
+	XMLBufferSink sink(vecData(plist));
+	emitXMLPlist(sink, message);
 
-	return buffer;
+	if(sink.used() != plist.size())
+		throw Error("Plist: xml plist size doesn't match its count");
 }
 
-std::vector<unsigned char> writeBinaryBool(PlistHelperData& d, bool value)
+void writePlistXML(std::vector<char>& plist, const boost::any& message)
 {
-	std::vector<unsigned char> buffer;
-	if(value)
-		buffer.push_back(0x09);
-	else
-		buffer.push_back(0x08);
+	writePlistXMLBuffer(plist, message);
+}
 
-	d._objectTable.insert(d._objectTable.begin(), buffer.begin(), buffer.end());
-	return buffer;
+#if defined(PLIST_HAS_PMR)
+void writePlistXML(pmr::data_type& plist, const boost::any& message)
+{
+	writePlistXMLBuffer(plist, message);
 }
+#endif
 
-std::vector<unsigned char> writeBinaryDate(PlistHelperData& d, const Date& date)
+void writePlistXML(
+		std::ostream& stream,
+		const boost::any& message)
 {
-	std::vector<unsigned char> buffer;
+	XMLStreamSink sink(stream);
+	emitXMLPlist(sink, message);
+	sink.flush();
+}
 
-	// need to serialize as Apple epoch.
+void writePlistXMLDocument(
+		std::ostream& stream,
+		const boost::any& message)
+{
+	pugi::xml_document doc;
+	writePlistXML(doc, message);
+	doc.save(stream);
+}
 
-	double macTime = date.timeAsAppleEpoch();
+void writePlistXML(
+		const char* filename,
+		const boost::any& message)
+{
 
-	buffer = doubleToBytes(macTime, false);
-	buffer.insert(buffer.begin(), 0x33);
+	std::ofstream stream(filename, std::ios::binary);
+	writePlistXML(stream, message);
+	stream.close();
+}
 
-	d._objectTable.insert(d._objectTable.begin(), buffer.begin(), buffer.end());
-	return buffer;
+#if defined(_MSC_VER)
+void writePlistXML(
+		const wchar_t* filename,
+		const boost::any& message)
+{
+	std::ofstream stream(filename, std::ios::binary);
+	writePlistXML(stream, message);
+	stream.close();
 }
+#endif
+
+// Value counterparts of the writers above
 
-std::vector<unsigned char> writeBinaryInteger(PlistHelperData& d, int64_t value, bool write)
+void writePlistBinary(std::vector<char>& plist, const Value& message)
 {
-	using namespace std;
+	writePlistBinary(plist, message, defaultResource());
+}
 
-	// The integer is initially forced to be 64 bit because it must be serialized
-	// as 8 bytes if it is negative.   If it is not negative, the
-	// regulateNullBytes step will reduce the representation down to the min
-	// power base 2 bytes needed to store it.
+#if defined(PLIST_HAS_PMR)
+void writePlistBinary(pmr::data_type& plist, const Value& message)
+{
+	writePlistBinary(plist, message, plist.get_allocator().resource());
+}
+#endif
 
-	vector<unsigned char> buffer = intToBytes<int64_t>(value, hostLittleEndian());
-	buffer = regulateNullBytes(intToBytes<int64_t>(value, hostLittleEndian()), 1);
-	buffer.resize(nextpow2(buffer.size()), 0);
+void writePlistBinary(std::ostream& stream, const Value& message)
+{
+	std::vector<char> plist;
+	writePlistBinary(plist, message);
+	stream.write(vecData(plist), plist.size());
+}
 
-	unsigned char header = 0x10 | ilog2(buffer.size());
-	buffer.push_back(header);
-	reverse(buffer.begin(), buffer.end());
+void writePlistBinary(const char* filename, const Value& message)
+{
+	std::ofstream stream(filename, std::ios::binary);
+	writePlistBinary(stream, message);
+	stream.close();
+}
 
-	if(write)
-		d._objectTable.insert(d._objectTable.begin(), buffer.begin(), buffer.end());
+void writePlistXML(std::vector<char>& plist, const Value& message)
+{
+	writePlistXMLBuffer(plist, message);
+}
 
-	return buffer;
+#if defined(PLIST_HAS_PMR)
+void writePlistXML(pmr::data_type& plist, const Value& message)
+{
+	writePlistXMLBuffer(plist, message);
 }
+#endif
 
-std::vector<unsigned char> writeBinaryString(PlistHelperData& d, const std::string& value, bool head)
+void writePlistXML(std::ostream& stream, const Value& message)
 {
-	using namespace std;
-	vector<unsigned char> buffer;
-	buffer.reserve(value.size());
+	XMLStreamSink sink(stream);
+	emitXMLPlist(sink, message);
+	sink.flush();
+}
 
-	for(std::string::const_iterator it = value.begin();
-			it != value.end();
-			++it)
-		buffer.push_back((unsigned char) *it);
+void writePlistXML(const char* filename, const Value& message)
+{
+	std::ofstream stream(filename, std::ios::binary);
+	writePlistXML(stream, message);
+	stream.close();
+}
 
-	if(head)
+int64_t serializedSize(const Value& message, Format format)
+{
+	if(format == BinaryFormat)
 	{
-		vector<unsigned char> header;
-		if (value.length() < 15)
-			header.push_back(0x50 | ((unsigned char) value.length()));
-		else
-		{
-			header.push_back(0x50 | 0xf);
-			vector<unsigned char> theSize = writeBinaryInteger(d, buffer.size(), false);
-			header.insert(header.end(), theSize.begin(), theSize.end());
-		}
-		buffer.insert(buffer.begin(), header.begin(), header.end());
+		PlistHelperData d;
+		planBinaryPlist(d, message);
+		return d._outputSize;
 	}
 
-	d._objectTable.insert(d._objectTable.begin(), buffer.begin(), buffer.end());
-
-	return buffer;
+	XMLCountingSink counter;
+	emitXMLPlist(counter, message);
+	return counter.size();
 }
 
-int countDictionary(const dictionary_type& dictionary)
+template void planBinaryPlist(PlistHelperData& d, const boost::any& message);
+template void planBinaryPlist(PlistHelperData& d, const Value& message);
+template void writePlistBinary(PlistHelperData& d, const boost::any& message);
+template void writePlistBinary(PlistHelperData& d, const Value& message);
+template void planBinary(PlistHelperData& d, const boost::any& obj);
+template void planBinary(PlistHelperData& d, const Value& obj);
+template void writeBinary(PlistHelperData& d, const boost::any& obj, int32_t objRef);
+template void writeBinary(PlistHelperData& d, const Value& obj, int32_t objRef);
+template int32_t binaryRef(PlistHelperData& d, const boost::any& obj);
+template int32_t binaryRef(PlistHelperData& d, const Value& obj);
+
+int64_t serializedSize(const boost::any& message, Format format)
 {
-	using namespace std;
-
-	int count = 0;
-	for(dictionary_type::const_iterator it = dictionary.begin();
+	if(format == BinaryFormat)
+	{
+		PlistHelperData d;
+		planBinaryPlist(d, message);
+		return d._outputSize;
+	}
+
+	XMLCountingSink counter;
+	emitXMLPlist(counter, message);
+	return counter.size();
+}
+
+// decimal text of value as a stream writes it, returns its length
+
+size_t formatInteger(char* buffer, int64_t value)
+{
+	char digits[20];
+	size_t digitCount = 0;
+	uint64_t magnitude = (value < 0) ? (uint64_t) 0 - (uint64_t) value : (uint64_t) value;
+	do
+	{
+		digits[digitCount++] = (char) ('0' + magnitude % 10);
+		magnitude /= 10;
+	} while(magnitude);
+
+	size_t size = 0;
+	if(value < 0)
+		buffer[size++] = '-';
+	while(digitCount)
+		buffer[size++] = digits[--digitCount];
+	return size;
+}
+
+template<typename Node>
+void writeBinary(PlistHelperData& d, const Node& obj, int32_t objRef)
+{
+	BinaryNode<Node> node;
+	describeBinary(obj, node);
+
+	d._offsetTable[objRef] = (int32_t) d._outputPosition;
+
+	if(node.container())
+		writeBinaryContainer(d, node);
+	else
+		writeBinaryScalar(d, node.scalar);
+}
+
+template<typename Node>
+void writeBinaryContainer(PlistHelperData& d, const BinaryNode<Node>& node)
+{
+	if(node.dictionary)
+		writeBinaryDictionary(d, *node.dictionary);
+	else
+		writeBinaryArray(d, *node.array);
+}
+
+void writeBinaryContainer(PlistHelperData& d, const BinaryNode<boost::any>& node)
+{
+	if(node.dictionary)
+		writeBinaryDictionary(d, *node.dictionary);
+	else if(node.hashDictionary)
+		writeBinaryDictionary(d, *node.hashDictionary);
+	else if(node.orderedDictionary)
+		writeBinaryDictionary(d, *node.orderedDictionary);
+	else if(node.flatDictionary)
+		writeBinaryDictionary(d, *node.flatDictionary);
+	else
+		writeBinaryArray(d, *node.array);
+}
+
+static uint32_t ilog2(uint32_t x)
+{
+	uint32_t r = 0;
+	while (x >>= 1)
+		++r;
+	return r;
+}
+
+// Plans obj, whose ref has already been handed out.  Containers plan their
+// children, scalars only add their encoded size.
+
+template<typename Node>
+void planBinary(PlistHelperData& d, const Node& obj)
+{
+	BinaryNode<Node> node;
+	describeBinary(obj, node);
+
+	d._lastObjectBytes = d._plannedBytes;
+	d._lastObjectRefs = d._plannedRefs;
+
+	if(node.container())
+		planBinaryContainer(d, node);
+	else
+		d._plannedBytes += binaryScalarSize(node.scalar);
+}
+
+template<typename Node>
+void planBinaryContainer(PlistHelperData& d, const BinaryNode<Node>& node)
+{
+	if(node.dictionary)
+		planBinaryDictionary(d, *node.dictionary);
+	else
+		planBinaryArray(d, *node.array);
+}
+
+void planBinaryContainer(PlistHelperData& d, const BinaryNode<boost::any>& node)
+{
+	if(node.dictionary)
+		planBinaryDictionary(d, *node.dictionary);
+	else if(node.hashDictionary)
+		planBinaryDictionary(d, *node.hashDictionary);
+	else if(node.orderedDictionary)
+		planBinaryDictionary(d, *node.orderedDictionary);
+	else if(node.flatDictionary)
+		planBinaryDictionary(d, *node.flatDictionary);
+	else
+		planBinaryArray(d, *node.array);
+}
+
+// Children that get a fresh ref are handed consecutive refs starting at the
+// offset table size before the container's refs were assigned, so child i
+// is owned by this container iff its ref is the next of those.  Anything
+// else is a repeat of a value that already has an object.
+
+template<typename Array>
+void planBinaryArray(PlistHelperData& d, const Array& array)
+{
+	int32_t nextRef = (int32_t) d._offsetTable.size();
+	size_t first = d._plan.size();
+
+	for(typename Array::const_iterator it = array.begin();
+			it != array.end();
+			++it)
+		d._plan.push_back(binaryRef(d, *it));
+
+	d._plannedBytes += binaryHeaderSize(array.size());
+	d._plannedRefs += array.size();
+
+	for(size_t i = 0; i < array.size(); ++i)
+		if(d._plan[first + i] == nextRef)
+		{
+			++nextRef;
+			planBinary(d, array[i]);
+		}
+}
+
+template<typename Dictionary>
+void planBinaryDictionary(PlistHelperData& d, const Dictionary& dictionary)
+{
+	int32_t nextRef = (int32_t) d._offsetTable.size();
+	size_t first = d._plan.size();
+
+	// key refs come first, then value refs
+
+	for(typename Dictionary::const_iterator it = dictionary.begin();
+			it != dictionary.end();
+			++it)
+	{
+		UniqueKey key = { 0x50, 0, it->first.data(), it->first.size() };
+		d._plan.push_back(uniqueRef(d, key));
+	}
+
+	for(typename Dictionary::const_iterator it = dictionary.begin();
 			it != dictionary.end();
 			++it)
+		d._plan.push_back(binaryRef(d, it->second));
+
+	d._plannedBytes += binaryHeaderSize(dictionary.size());
+	d._plannedRefs += 2 * dictionary.size();
+
+	size_t i = first;
+	for(typename Dictionary::const_iterator it = dictionary.begin();
+			it != dictionary.end();
+			++it, ++i)
+	{
+		if(d._plan[i] == nextRef)
+		{
+			++nextRef;
+			d._lastObjectBytes = d._plannedBytes;
+			d._lastObjectRefs = d._plannedRefs;
+			d._plannedBytes += binaryHeaderSize(it->first.size()) + it->first.size();
+		}
+	}
+
+	for(typename Dictionary::const_iterator it = dictionary.begin();
+			it != dictionary.end();
+			++it, ++i)
+		if(d._plan[i] == nextRef)
+		{
+			++nextRef;
+			planBinary(d, it->second);
+		}
+}
+
+// encoded size of a scalar object, matching writeBinaryScalar
+
+int64_t binaryScalarSize(const UniqueKey& key)
+{
+	switch(key.marker)
+	{
+		case 0x10:
+			return binaryIntegerSize((int64_t) key.value);
+		case 0x23:
+		case 0x33:
+			return 9;
+		case 0x40:
+		case 0x50:
+			return binaryHeaderSize(key.size) + key.size;
+	}
+	return 1;
+}
+
+int64_t binaryHeaderSize(uint64_t count)
+{
+	return (count < 15) ? 1 : 1 + binaryIntegerSize((int64_t) count);
+}
+
+int64_t binaryIntegerSize(int64_t value)
+{
+	return 1 + ((value < 0) ? 8 : byteCount((uint64_t) value));
+}
+
+// smallest power of 2 byte count that holds value
+
+int32_t byteCount(uint64_t value)
+{
+	if(value <= 0xff)
+		return 1;
+	else if(value <= 0xffff)
+		return 2;
+	else if(value <= 0xffffffffULL)
+		return 4;
+	return 8;
+}
+
+// next size bytes of the output.  The output is sized by the plan, so
+// running past it means the plan and the writer disagree.
+
+unsigned char* reserveBinaryOutput(PlistHelperData& d, int64_t size)
+{
+	if(d._outputPosition + size > d._outputSize)
+		throw Error("Plist: binary plist size doesn't match its plan");
+
+	unsigned char* output = d._output + d._outputPosition;
+	d._outputPosition += size;
+	return output;
+}
+
+// append the low byteCount bytes of value, big endian
+
+void writeBinaryBytes(PlistHelperData& d, uint64_t value, int32_t byteCount)
+{
+	storeBigEndian(reserveBinaryOutput(d, byteCount), value, byteCount);
+}
+
+void writeBinaryData(PlistHelperData& d, const void* bytes, size_t size)
+{
+	if(size > 0)
+		memcpy(reserveBinaryOutput(d, size), bytes, size);
+}
+
+// object marker with the count in the low nibble, or followed by an integer
+// object when the count doesn't fit
+
+void writeBinaryHeader(PlistHelperData& d, unsigned char marker, uint64_t count)
+{
+	if(count < 15)
+		writeBinaryBytes(d, marker | ((unsigned char) count), 1);
+	else
+	{
+		writeBinaryBytes(d, marker | 0xf, 1);
+		writeBinaryInteger(d, (int64_t) count);
+	}
+}
+
+void writeBinaryScalar(PlistHelperData& d, const UniqueKey& key)
+{
+	switch(key.marker)
+	{
+		case 0x10:
+			writeBinaryInteger(d, (int64_t) key.value);
+			break;
+		case 0x23:
+		case 0x33:
+			// reals, and dates as Apple epoch, are 8 byte doubles
+			writeBinaryBytes(d, key.marker, 1);
+			writeBinaryBytes(d, key.value, 8);
+			break;
+		case 0x40:
+		case 0x50:
+			writeBinaryHeader(d, key.marker, key.size);
+			writeBinaryData(d, key.bytes, key.size);
+			break;
+		default:
+			writeBinaryBytes(d, key.marker, 1);
+	}
+}
+
+// Refs come from the plan.  A ref equal to _nextRef is one handed out
+// fresh while planning, which keeps _nextRef in step with the offset table
+// size the planner saw, so ownership is decided the same way as there.
+
+void writeBinaryRefs(PlistHelperData& d, size_t first, size_t count)
+{
+	for(size_t i = first; i < first + count; ++i)
+	{
+		int32_t ref = d._plan[i];
+		if(ref == d._nextRef)
+			++d._nextRef;
+		writeBinaryBytes(d, ref, d._objRefSize);
+	}
+}
+
+template<typename Array>
+void writeBinaryArray(PlistHelperData& d, const Array& array)
+{
+	int32_t nextRef = d._nextRef;
+	size_t first = d._planPosition;
+	d._planPosition += array.size();
+
+	writeBinaryHeader(d, 0xA0, array.size());
+	writeBinaryRefs(d, first, array.size());
+
+	for(size_t i = 0; i < array.size(); ++i)
+		if(d._plan[first + i] == nextRef)
+			writeBinary(d, array[i], nextRef++);
+}
+
+template<typename Dictionary>
+void writeBinaryDictionary(PlistHelperData& d, const Dictionary& dictionary)
+{
+	int32_t nextRef = d._nextRef;
+	size_t first = d._planPosition;
+	d._planPosition += 2 * dictionary.size();
+
+	writeBinaryHeader(d, 0xD0, dictionary.size());
+	writeBinaryRefs(d, first, 2 * dictionary.size());
+
+	size_t i = first;
+	for(typename Dictionary::const_iterator it = dictionary.begin();
+			it != dictionary.end();
+			++it, ++i)
+	{
+		if(d._plan[i] == nextRef)
+		{
+			d._offsetTable[nextRef++] = (int32_t) d._outputPosition;
+			writeBinaryString(d, it->first);
+		}
+	}
+
+	for(typename Dictionary::const_iterator it = dictionary.begin();
+			it != dictionary.end();
+			++it, ++i)
+		if(d._plan[i] == nextRef)
+			writeBinary(d, it->second, nextRef++);
+}
+
+// ref for a container child.  Scalars equal to one already given a ref share
+// it, everything else gets a new ref.
+
+template<typename Node>
+int32_t binaryRef(PlistHelperData& d, const Node& obj)
+{
+	BinaryNode<Node> node;
+	describeBinary(obj, node);
+	if(!node.container())
+		return uniqueRef(d, node.scalar);
+
+	d._offsetTable.push_back(0);
+	return (int32_t) d._offsetTable.size() - 1;
+}
+
+// Scalars are described as they will be encoded, so values that encode to
+// the same object compare equal (e.g. int32_t and int64_t, float and
+// double) and are uniqued.
+
+static void integerKey(UniqueKey& key, int64_t value)
+{
+	key.marker = 0x10;
+	key.value = (uint64_t) value;
+}
+
+static void realKey(UniqueKey& key, unsigned char marker, double value)
+{
+	key.marker = marker;
+	memcpy(&key.value, &value, sizeof(double));
+}
+
+static void bytesKey(UniqueKey& key, unsigned char marker, const char* bytes, size_t size)
+{
+	key.marker = marker;
+	key.bytes = bytes;
+	key.size = size;
+}
+
+void describeBinary(const boost::any& obj, BinaryNode<boost::any>& node)
+{
+	using namespace std;
+
+	const std::type_info &objType = obj.type();
+
+	node.array = 0;
+	node.dictionary = 0;
+	node.hashDictionary = 0;
+	node.orderedDictionary = 0;
+	node.flatDictionary = 0;
+	UniqueKey& key = node.scalar;
+	key.value = 0;
+	key.bytes = 0;
+	key.size = 0;
+
+	if(objType == typeid(int32_t))
+		integerKey(key, boost::any_cast<const int32_t&>(obj));
+	else if(objType == typeid(int64_t))
+		integerKey(key, boost::any_cast<const int64_t&>(obj));
+	else if(objType == typeid(long))
+		integerKey(key, boost::any_cast<const long&>(obj));
+	else if(objType == typeid(short))
+		integerKey(key, boost::any_cast<const short&>(obj));
+	else if(objType == typeid(dictionary_type))
+		node.dictionary = &boost::any_cast<const dictionary_type&>(obj);
+	else if(objType == typeid(string))
+	{
+		const string& value = boost::any_cast<const string&>(obj);
+		bytesKey(key, 0x50, value.data(), value.size());
+	}
+	else if(objType == typeid(array_type))
+		node.array = &boost::any_cast<const array_type&>(obj);
+	else if(objType == typeid(data_type))
+	{
+		const data_type& value = boost::any_cast<const data_type&>(obj);
+		bytesKey(key, 0x40, vecData(value), value.size());
+	}
+	else if(objType == typeid(double))
+		realKey(key, 0x23, boost::any_cast<const double&>(obj));
+	else if(objType == typeid(float))
+		realKey(key, 0x23, boost::any_cast<const float&>(obj));
+	else if(objType == typeid(Date))
+		realKey(key, 0x33, boost::any_cast<const Date&>(obj).timeAsAppleEpoch());
+	else if(objType == typeid(bool))
+		key.marker = boost::any_cast<const bool&>(obj) ? 0x09 : 0x08;
+	else if(objType == typeid(HashDictionary<boost::any>))
+		node.hashDictionary = &boost::any_cast<const HashDictionary<boost::any>&>(obj);
+	else if(objType == typeid(OrderedDictionary<boost::any>))
+		node.orderedDictionary = &boost::any_cast<const OrderedDictionary<boost::any>&>(obj);
+	else if(objType == typeid(FlatDictionary<boost::any>))
+		node.flatDictionary = &boost::any_cast<const FlatDictionary<boost::any>&>(obj);
+	else
+		throw Error((string("Plist Error: Can't serialize type ") + objType.name()).c_str());
+}
+
+void describeBinary(const Value& obj, BinaryNode<Value>& node)
+{
+	node.array = 0;
+	node.dictionary = 0;
+	UniqueKey& key = node.scalar;
+	key.value = 0;
+	key.bytes = 0;
+	key.size = 0;
+
+	switch(obj.type())
+	{
+		case Value::BooleanType:
+			key.marker = obj.asBoolean() ? 0x09 : 0x08;
+			break;
+		case Value::IntegerType:
+			integerKey(key, obj.asInteger());
+			break;
+		case Value::RealType:
+			realKey(key, 0x23, obj.asReal());
+			break;
+		case Value::DateType:
+			realKey(key, 0x33, obj.asDate().timeAsAppleEpoch());
+			break;
+		case Value::DataType:
+			bytesKey(key, 0x40, obj.bytes(), obj.byteCount());
+			break;
+		case Value::StringType:
+			bytesKey(key, 0x50, obj.bytes(), obj.byteCount());
+			break;
+		case Value::ArrayType:
+			node.array = &obj.asArray();
+			break;
+		case Value::DictionaryType:
+			node.dictionary = &obj.asDictionary();
+			break;
+	}
+}
+
+static uint64_t hashUniqueKey(const UniqueKey& key)
+{
+	// FNV-1a
+
+	uint64_t hash = 14695981039346656037ULL;
+	hash = (hash ^ key.marker) * 1099511628211ULL;
+	for(int n = 0; n < 8; ++n)
+		hash = (hash ^ ((key.value >> (8 * n)) & 0xff)) * 1099511628211ULL;
+	for(size_t i = 0; i < key.size; ++i)
+		hash = (hash ^ (unsigned char) key.bytes[i]) * 1099511628211ULL;
+	return hash;
+}
+
+static bool equalUniqueKeys(const UniqueKey& first, const UniqueKey& second)
+{
+	return (first.marker == second.marker) && (first.value == second.value) &&
+		(first.size == second.size) && ((first.size == 0) || (memcmp(first.bytes, second.bytes, first.size) == 0));
+}
+
+static void insertUniqueEntry(ScratchVector<UniqueEntry>::type& table, const UniqueEntry& entry)
+{
+	size_t mask = table.size() - 1;
+	size_t slot = (size_t) entry.hash & mask;
+	while(table[slot].ref >= 0)
+		slot = (slot + 1) & mask;
+	table[slot] = entry;
+}
+
+// ref of the object for key, allocating a new one the first time key is seen
+
+int32_t uniqueRef(PlistHelperData& d, const UniqueKey& key)
+{
+	using namespace std;
+
+	// keep the load factor at or under 1/2, capacity is a power of 2
+
+	if(2 * (d._uniqueCount + 1) > d._uniqueTable.size())
+	{
+		UniqueEntry empty;
+		empty.ref = -1;
+		ScratchVector<UniqueEntry>::type table(max((size_t) 64, 2 * d._uniqueTable.size()), empty, d._uniqueTable.get_allocator());
+		for(ScratchVector<UniqueEntry>::type::const_iterator it = d._uniqueTable.begin();
+				it != d._uniqueTable.end();
+				++it)
+			if(it->ref >= 0)
+				insertUniqueEntry(table, *it);
+		d._uniqueTable.swap(table);
+	}
+
+	uint64_t hash = hashUniqueKey(key);
+	size_t mask = d._uniqueTable.size() - 1;
+	for(size_t slot = (size_t) hash & mask; d._uniqueTable[slot].ref >= 0; slot = (slot + 1) & mask)
+	{
+		const UniqueEntry& entry = d._uniqueTable[slot];
+		if((entry.hash == hash) && equalUniqueKeys(entry.key, key))
+			return entry.ref;
+	}
+
+	d._offsetTable.push_back(0);
+
+	UniqueEntry entry;
+	entry.key = key;
+	entry.hash = hash;
+	entry.ref = (int32_t) d._offsetTable.size() - 1;
+	insertUniqueEntry(d._uniqueTable, entry);
+	++d._uniqueCount;
+
+	return entry.ref;
+}
+
+void writeBinaryInteger(PlistHelperData& d, int64_t value)
+{
+	// The integer must be serialized as 8 bytes if it is negative.  If it
+	// is not negative, it is reduced down to the min power base 2 bytes
+	// needed to store it.
+
+	int32_t size = (value < 0) ? 8 : byteCount((uint64_t) value);
+	writeBinaryBytes(d, 0x10 | ilog2(size), 1);
+	writeBinaryBytes(d, (uint64_t) value, size);
+}
+
+void writeBinaryString(PlistHelperData& d, const std::string& value)
+{
+	writeBinaryHeader(d, 0x50, value.size());
+	writeBinaryData(d, value.data(), value.size());
+}
+
+#if !defined(_WIN32) && !defined(_WIN64)
+
+// Read only mapping of a whole file, unmapped on destruction.  data() is 0
+// if the file can't be mapped (e.g. it's a pipe), callers then fall back to
+// reading through a stream.
+
+class MappedFile
+{
+	public:
+		MappedFile(const char* filename)
+			: _data(0), _size(0)
+		{
+			int fd = open(filename, O_RDONLY);
+			if(fd < 0)
+				throw Error("Can't open file.");
+
+			struct stat st;
+			bool regular = (fstat(fd, &st) == 0) && S_ISREG(st.st_mode);
+			if(regular && (st.st_size == 0))
+			{
+				close(fd);
+				throw Error("Can't read zero length data");
+			}
+
+			if(regular)
+			{
+				void* mapped = mmap(0, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if(mapped != MAP_FAILED)
+				{
+					_data = (const char*) mapped;
+					_size = (int64_t) st.st_size;
+				}
+			}
+			close(fd);
+		}
+
+		~MappedFile()
+		{
+			if(_data)
+				munmap((void*) _data, (size_t) _size);
+		}
+
+		const char* data() const { return _data; }
+		int64_t size() const { return _size; }
+
+		void advise(int advice) const
+		{
+			if(_data)
+				madvise((void*) _data, (size_t) _size, advice);
+		}
+
+	private:
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+
+		const char* _data;
+		int64_t _size;
+};
+
+#endif
+
+template<typename Message>
+void readPlistFile(const char* filename, Message& message)
+{
+#if !defined(_WIN32) && !defined(_WIN64)
+
+	// parse straight from the page cache instead of copying the file into
+	// a heap buffer first.
+
+	MappedFile file(filename);
+	if(file.data())
+	{
+		// XML is parsed front to back.  A binary plist is read starting
+		// from the trailer at the end and then every object is decoded in
+		// ref order, so ask for the whole file to be read ahead.
+
+		if((file.size() >= 8) && (std::string(file.data(), 8) == "bplist00"))
+			file.advise(MADV_WILLNEED);
+		else
+			file.advise(MADV_SEQUENTIAL);
+
+		readPlistBytes(file.data(), file.size(), message);
+		return;
+	}
+#endif
+
+	std::ifstream stream(filename, std::ios::binary);
+	if(!stream)
+		throw Error("Can't open file.");
+	readPlistStream(stream, message);
+}
+
+template<typename Message>
+void readPlistStream(std::istream& stream, Message& message)
+{
+	// read in chunks rather than seeking to the end for the size, so pipes
+	// and other streams that can't seek work.
+
+	const size_t chunkSize = 64 * 1024;
+	ScratchVector<char>::type buffer(scratchAllocator<char>(scratchResource(message)));
+	size_t size = 0;
+	for(;;)
+	{
+		buffer.resize(size + chunkSize);
+		stream.read(&buffer[size], chunkSize);
+		size_t count = (size_t) stream.gcount();
+		size += count;
+		if(count < chunkSize)
+			break;
+	}
+
+	if(size == 0)
+		throw Error("Can't read zero length data");
+	readPlistBytes(&buffer[0], size, message);
+}
+
+template<typename Message>
+void readPlistBytes(const char* byteArrayTemp, int64_t size, Message& message)
+{
+	using namespace std;
+	const unsigned char* byteArray = (const unsigned char*) byteArrayTemp;
+	if (!byteArray || (size == 0))
+		throw Error("Plist: Empty plist data");
+
+	// infer plist type from header.  If it has the bplist00 header as first 8
+	// bytes, then it's a binary plist.  Otherwise, assume it's XML
+
+	if((size >= 8) && (std::string((const char*) byteArray, 8) == "bplist00"))
+	{
+		// the object and offset tables are decoded in place from byteArray,
+		// so it must stay alive until parsing is done.
+
+		PlistHelperData d(scratchResource(message));
+		initBinaryPlist(d, byteArray, size);
+		parseOffsetTable(d, byteArray + d._offsetTableOffset, (int64_t) d._refCount * d._offsetByteSize);
+
+		parseBinaryPlist(d, message);
+	}
+	else
+	{
+		pugi::xml_document doc;
+		pugi::xml_parse_result result = doc.load_buffer(byteArray, (size_t)size);
+		if(!result)
+			throw Error((string("Plist: XML parsed with error ") + result.description()).c_str());
+
+		pugi::xml_node rootNode = doc.child("plist").first_child();
+		parseXMLPlist(rootNode, message);
+	}
+
+}
+
+template<typename Policy>
+void readPlist(const char* filename, boost::any& message)
+{
+	PolicyMessage<Policy> policyMessage(message);
+	readPlistFile(filename, policyMessage);
+}
+
+template<typename Policy>
+void readPlist(std::istream& stream, boost::any& message)
+{
+	PolicyMessage<Policy> policyMessage(message);
+	readPlistStream(stream, policyMessage);
+}
+
+template<typename Policy>
+void readPlist(const char* byteArray, int64_t size, boost::any& message)
+{
+	PolicyMessage<Policy> policyMessage(message);
+	readPlistBytes(byteArray, size, policyMessage);
+}
+
+template void readPlist<MapDictionaryPolicy>(const char* filename, boost::any& message);
+template void readPlist<MapDictionaryPolicy>(std::istream& stream, boost::any& message);
+template void readPlist<MapDictionaryPolicy>(const char* byteArray, int64_t size, boost::any& message);
+template void readPlist<HashDictionaryPolicy>(const char* filename, boost::any& message);
+template void readPlist<HashDictionaryPolicy>(std::istream& stream, boost::any& message);
+template void readPlist<HashDictionaryPolicy>(const char* byteArray, int64_t size, boost::any& message);
+template void readPlist<OrderedDictionaryPolicy>(const char* filename, boost::any& message);
+template void readPlist<OrderedDictionaryPolicy>(std::istream& stream, boost::any& message);
+template void readPlist<OrderedDictionaryPolicy>(const char* byteArray, int64_t size, boost::any& message);
+template void readPlist<FlatDictionaryPolicy>(const char* filename, boost::any& message);
+template void readPlist<FlatDictionaryPolicy>(std::istream& stream, boost::any& message);
+template void readPlist<FlatDictionaryPolicy>(const char* byteArray, int64_t size, boost::any& message);
+template void parse<MapDictionaryPolicy>(pugi::xml_node& node, boost::any& value);
+template void parseBinary<MapDictionaryPolicy>(const PlistHelperData& d, int objRef, boost::any& value);
+template void parse<MapDictionaryPolicy>(pugi::xml_node& node, boost::any& value, DecodeBudget& budget);
+template void parseBinary<MapDictionaryPolicy>(const PlistHelperData& d, int objRef, boost::any& value, DecodeBudget& budget);
+
+void readPlist(const char* filename, boost::any& message)
+{
+	readPlist<MapDictionaryPolicy>(filename, message);
+}
+
+void readPlist(std::istream& stream, boost::any& message)
+{
+	readPlist<MapDictionaryPolicy>(stream, message);
+}
+
+void readPlist(const char* byteArray, int64_t size, boost::any& message)
+{
+	readPlist<MapDictionaryPolicy>(byteArray, size, message);
+}
+
+void readPlist(const char* filename, boost::any& message, const DecodeLimits& limits)
+{
+	PolicyMessage<MapDictionaryPolicy> policyMessage(message, limits);
+	readPlistFile(filename, policyMessage);
+}
+
+void readPlist(std::istream& stream, boost::any& message, const DecodeLimits& limits)
+{
+	PolicyMessage<MapDictionaryPolicy> policyMessage(message, limits);
+	readPlistStream(stream, policyMessage);
+}
+
+void readPlist(const char* byteArray, int64_t size, boost::any& message, const DecodeLimits& limits)
+{
+	PolicyMessage<MapDictionaryPolicy> policyMessage(message, limits);
+	readPlistBytes(byteArray, size, policyMessage);
+}
+
+void readPlistParallel(const char* byteArray, int64_t size, boost::any& message, unsigned threadCount)
+{
+	ParallelMessage parallelMessage(message, threadCount);
+	readPlistBytes(byteArray, size, parallelMessage);
+}
+
+void readPlistParallel(std::istream& stream, boost::any& message, unsigned threadCount)
+{
+	ParallelMessage parallelMessage(message, threadCount);
+	readPlistStream(stream, parallelMessage);
+}
+
+void readPlistParallel(const char* filename, boost::any& message, unsigned threadCount)
+{
+	ParallelMessage parallelMessage(message, threadCount);
+	readPlistFile(filename, parallelMessage);
+}
+
+DecodeLimits::DecodeLimits()
+	: maxObjects(std::numeric_limits<int64_t>::max()),
+	maxBytes(std::numeric_limits<int64_t>::max()),
+	maxDepth(DefaultMaxDepth)
+{
+}
+
+void readPlist(const char* filename, Value& message)
+{
+	readPlistFile(filename, message);
+}
+
+void readPlist(std::istream& stream, Value& message)
+{
+	readPlistStream(stream, message);
+}
+
+void readPlist(const char* byteArray, int64_t size, Value& message)
+{
+	readPlistBytes(byteArray, size, message);
+}
+
+// where the scratch space for reading message comes from
+
+template<typename Message>
+memory_resource* scratchResource(const Message&)
+{
+	return defaultResource();
+}
+
+memory_resource* scratchResource(const DocumentMessage& message)
+{
+	return resourceOrDefault(message.resource);
+}
+
+void readPlist(const char* filename, Document& document)
+{
+	DocumentMessage message(document, 0);
+	readPlistFile(filename, message);
+}
+
+void readPlist(std::istream& stream, Document& document)
+{
+	DocumentMessage message(document, 0);
+	readPlistStream(stream, message);
+}
+
+void readPlist(const char* byteArray, int64_t size, Document& document)
+{
+	DocumentMessage message(document, 0);
+	readPlistBytes(byteArray, size, message);
+}
+
+void readPlist(const char* filename, Document& document, const DecodeLimits& limits)
+{
+	DocumentMessage message(document, 0, limits);
+	readPlistFile(filename, message);
+}
+
+void readPlist(std::istream& stream, Document& document, const DecodeLimits& limits)
+{
+	DocumentMessage message(document, 0, limits);
+	readPlistStream(stream, message);
+}
+
+void readPlist(const char* byteArray, int64_t size, Document& document, const DecodeLimits& limits)
+{
+	DocumentMessage message(document, 0, limits);
+	readPlistBytes(byteArray, size, message);
+}
+
+#if defined(PLIST_HAS_PMR)
+void readPlist(const char* filename, Document& document, memory_resource* resource)
+{
+	DocumentMessage message(document, resource);
+	readPlistFile(filename, message);
+}
+
+void readPlist(std::istream& stream, Document& document, memory_resource* resource)
+{
+	DocumentMessage message(document, resource);
+	readPlistStream(stream, message);
+}
+
+void readPlist(const char* byteArray, int64_t size, Document& document, memory_resource* resource)
+{
+	DocumentMessage message(document, resource);
+	readPlistBytes(byteArray, size, message);
+}
+#endif
+
+void decodePlist(const char* byteArray, int64_t size, PlistDecoder& decoder)
+{
+	readPlistBytes(byteArray, size, decoder);
+}
+
+void decodePlist(std::istream& stream, PlistDecoder& decoder)
+{
+	readPlistStream(stream, decoder);
+}
+
+void decodePlist(const char* filename, PlistDecoder& decoder)
+{
+	readPlistFile(filename, decoder);
+}
+
+void parseBinaryPlist(const PlistHelperData& d, PlistDecoder& decoder)
+{
+	decoder.decodeBinary(d);
+}
+
+void parseXMLPlist(pugi::xml_node& rootNode, PlistDecoder& decoder)
+{
+	decoder.decodeXML(rootNode);
+}
+
+template<typename Policy>
+void parseBinaryPlist(const PlistHelperData& d, PolicyMessage<Policy>& message)
+{
+	DecodeBudget budget(message.limits);
+	parseBinary<Policy>(d, 0, message.message, budget);
+}
+
+void parseBinaryPlist(const PlistHelperData& d, Value& message)
+{
+	DecodeBudget budget;
+	parseBinary(d, 0, message, budget);
+}
+
+template<typename Policy>
+void parseXMLPlist(pugi::xml_node& rootNode, PolicyMessage<Policy>& message)
+{
+	DecodeBudget budget(message.limits);
+	parse<Policy>(rootNode, message.message, budget);
+}
+
+void parseXMLPlist(pugi::xml_node& rootNode, Value& message)
+{
+	DecodeBudget budget;
+	parse(rootNode, message, budget);
+}
+
+// The boost::any readers decode each value straight into its place in the
+// tree, containers are created empty in place and filled.
+
+template<typename Policy>
+void parseDictionary(pugi::xml_node& node, boost::any& value, DecodeBudget& budget)
+{
+	using namespace std;
+
+	typedef typename Policy::dictionary_type dictionary;
+
+	value = dictionary();
+	dictionary& dict = *boost::any_cast<dictionary>(&value);
+	for(pugi::xml_node_iterator it = node.begin(); it != node.end(); ++it)
+	{
+		if(strcmp("key", it->name()) != 0)
+			throw Error("Plist: XML dictionary key expected but not found");
+
+		string buffer;
+		string key(xmlNodeText(*it, buffer));
+		++it;
+
+		if(it == node.end())
+			throw Error("Plist: XML dictionary value expected for key " + key + "but not found");
+		else if(strcmp("key", it->name()) == 0)
+			throw Error("Plist: XML dictionary value expected for key " + key + "but found another key node");
+
+		budget.addBytes(key.size());
+		parse<Policy>(*it, Policy::insert(dict, key), budget);
+	}
+
+	Policy::finish(dict);
+}
+
+template<typename Policy>
+void parseArray(pugi::xml_node& node, boost::any& value, DecodeBudget& budget)
+{
+	value = array_type();
+	array_type& array = *boost::any_cast<array_type>(&value);
+	for(pugi::xml_node_iterator it = node.begin(); it != node.end(); ++it)
 	{
-		++count;
-		count += countAny(it->second);
+		array.push_back(boost::any());
+		parse<Policy>(*it, array.back(), budget);
 	}
+}
 
-	return count;
+std::vector<char> base64Decode(const char* encodedData)
+{
+	size_t size = strlen(encodedData);
+	std::vector<char> data(base64DecodeCapacity(size));
+	data.resize(base64Decode((unsigned char*) vecData(data), encodedData, size));
+	return data;
 }
 
-int countArray(const array_type& array)
+void base64Encode(std::string& dataEncoded, const std::vector<char>& data)
 {
-	using namespace std;
-	int count = 0;
-	for(array_type::const_iterator it = array.begin();
-			it != array.end();
-			++it)
-		count += countAny(*it);
+	dataEncoded.resize(base64EncodedSize(data.size()));
+	if(!dataEncoded.empty())
+		base64Encode(&dataEncoded[0], (const unsigned char*) vecData(data), data.size());
+}
 
-	return count;
+template<typename Policy>
+void parse(pugi::xml_node& node, boost::any& value)
+{
+	DecodeBudget budget;
+	parse<Policy>(node, value, budget);
 }
 
-void readPlist(std::istream& stream, boost::any& message)
+template<typename Policy>
+void parse(pugi::xml_node& node, boost::any& value, DecodeBudget& budget)
 {
-	int start = stream.tellg();
-	stream.seekg(0, std::ifstream::end);
-	int size = ((int) stream.tellg()) - start;
-	if(size > 0)
-	{
-		stream.seekg(0, std::ifstream::beg);
-		std::vector<char> buffer(size);
-		stream.read( (char *)&buffer[0], size );
+	const char* nodeName = node.name();
 
-		readPlist(&buffer[0], size, message);
+	budget.addObject();
+	if(strcmp("dict", nodeName) == 0)
+	{
+		budget.enter();
+		parseDictionary<Policy>(node, value, budget);
+		budget.leave();
+	}
+	else if(strcmp("array", nodeName) == 0)
+	{
+		budget.enter();
+		parseArray<Policy>(node, value, budget);
+		budget.leave();
 	}
 	else
 	{
-		throw Error("Can't read zero length data");
+		std::string buffer;
+		std::string text(xmlNodeText(node, buffer));
+		budget.addBytes(text.size());
+		parseXMLValue(nodeName, text, value);
 	}
 }
 
-void readPlist(const char* byteArrayTemp, int64_t size, boost::any& message)
+boost::any parse(pugi::xml_node& node)
+{
+	boost::any value;
+	parse<MapDictionaryPolicy>(node, value);
+	return value;
+}
+
+const char* xmlNodeText(const pugi::xml_node& node, std::string& buffer)
 {
-	using namespace std;
-	const unsigned char* byteArray = (const unsigned char*) byteArrayTemp;
-	if (!byteArray || (size == 0))
-		throw Error("Plist: Empty plist data");
+	pugi::xml_node child = node.first_child();
+	if(!child.next_sibling())
+		return child.value();
+
+	buffer.clear();
+	for(; child; child = child.next_sibling())
+		buffer += child.value();
+	return buffer.c_str();
+}
 
-	// infer plist type from header.  If it has the bplist00 header as first 8
-	// bytes, then it's a binary plist.  Otherwise, assume it's XML
+void parseXMLValue(const char* nodeName, std::string& text, boost::any& result)
+{
+	using namespace std;
 
-	std::string magicHeader((const char*) byteArray, 8);
-	if(magicHeader == "bplist00")
+	if(strcmp("string", nodeName) == 0)
+		moveIntoAny(text, result);
+	else if(strcmp("integer", nodeName) == 0)
+		result = (int64_t) atoll(text.c_str());
+	else if(strcmp("real", nodeName) == 0)
+		result = atof(text.c_str());
+	else if(strcmp("false", nodeName) == 0)
+		result = bool(false);
+	else if(strcmp("true", nodeName) == 0)
+		result = bool(true);
+	else if(strcmp("data", nodeName) == 0)
 	{
-		PlistHelperData d;
-		parseTrailer(d, getRange(byteArray, size - 32, 32));
+		data_type data = base64Decode(text.c_str());
+		moveIntoAny(data, result);
+	}
+	else if(strcmp("date", nodeName) == 0)
+	{
+		Date date(Date::uninitialized);
+		date.setTimeFromXMLConvention(text);
+		result = date;
+	}
+	else
+		throw Error(string("Plist: XML unknown node type ") + nodeName);
+}
+
+// The Value readers decode each value straight into its place in the tree,
+// strings and data inline when they fit.
 
-		d._objectTable = getRange(byteArray, 0, d._offsetTableOffset);
-		std::vector<unsigned char> offsetTableBytes = getRange(byteArray, d._offsetTableOffset, size - d._offsetTableOffset - 32);
+void parse(pugi::xml_node& node, Value& value)
+{
+	DecodeBudget budget;
+	parse(node, value, budget);
+}
 
-		parseOffsetTable(d, offsetTableBytes);
+void parse(pugi::xml_node& node, Value& value, DecodeBudget& budget)
+{
+	const char* nodeName = node.name();
 
-		message = parseBinary(d, 0);
+	budget.addObject();
+	if(strcmp("dict", nodeName) == 0)
+	{
+		budget.enter();
+		parseDictionary(node, value, budget);
+		budget.leave();
+	}
+	else if(strcmp("array", nodeName) == 0)
+	{
+		budget.enter();
+		parseArray(node, value, budget);
+		budget.leave();
 	}
 	else
 	{
-		pugi::xml_document doc;
-		pugi::xml_parse_result result = doc.load_buffer(byteArray, (size_t)size);
-		if(!result)
-			throw Error((string("Plist: XML parsed with error ") + result.description()).c_str());
-
-		pugi::xml_node rootNode = doc.child("plist").first_child();
-		message = parse(rootNode);
+		std::string buffer;
+		const char* text = xmlNodeText(node, buffer);
+		budget.addBytes(strlen(text));
+		parseXMLValue(nodeName, text, value);
 	}
-
 }
 
-dictionary_type parseDictionary(pugi::xml_node& node)
+void parseDictionary(pugi::xml_node& node, Value& value, DecodeBudget& budget)
 {
 	using namespace std;
 
-	dictionary_type dict;
+	Value(Value::DictionaryType).swap(value);
+	Value::dictionary_type& dict = value.asDictionary();
 	for(pugi::xml_node_iterator it = node.begin(); it != node.end(); ++it)
 	{
 		if(string("key") != it->name())
 			throw Error("Plist: XML dictionary key expected but not found");
 
-		string key(it->first_child().value());
+		string buffer;
+		string key(xmlNodeText(*it, buffer));
 		++it;
 
 		if(it == node.end())
@@ -769,293 +2101,615 @@ dictionary_type parseDictionary(pugi::xml_node& node)
 		else if(string("key") == it->name())
 			throw Error("Plist: XML dictionary value expected for key " + key + "but found another key node");
 
-		dict[key] = parse(*it);
+		budget.addBytes(key.size());
+		parse(*it, dict[key], budget);
 	}
-
-	return dict;
 }
 
-array_type parseArray(pugi::xml_node& node)
+void parseArray(pugi::xml_node& node, Value& value, DecodeBudget& budget)
 {
-	using namespace std;
-
-	array_type array;
+	Value(Value::ArrayType).swap(value);
+	Value::array_type& array = value.asArray();
 	for(pugi::xml_node_iterator it = node.begin(); it != node.end(); ++it)
-		array.push_back(parse(*it));
-
-	return array;
+	{
+		array.push_back(Value());
+		parse(*it, array.back(), budget);
+	}
 }
 
-Date parseDate(pugi::xml_node& node)
+void parseXMLValue(const char* nodeName, const char* text, Value& value)
 {
-	Date date;
-	date.setTimeFromXMLConvention(node.first_child().value());
+	using namespace std;
 
-	return date;
+	if(strcmp("string", nodeName) == 0)
+		value.setString(text, strlen(text));
+	else if(strcmp("integer", nodeName) == 0)
+		Value((long long) atoll(text)).swap(value);
+	else if(strcmp("real", nodeName) == 0)
+		Value(atof(text)).swap(value);
+	else if(strcmp("false", nodeName) == 0)
+		Value(false).swap(value);
+	else if(strcmp("true", nodeName) == 0)
+		Value(true).swap(value);
+	else if(strcmp("data", nodeName) == 0)
+	{
+		size_t size = strlen(text);
+		vector<char> data(base64DecodeCapacity(size));
+		value.setData(vecData(data), base64Decode((unsigned char*) vecData(data), text, size));
+	}
+	else if(strcmp("date", nodeName) == 0)
+	{
+		Date date(Date::uninitialized);
+		date.setTimeFromXMLConvention(text);
+		Value(date).swap(value);
+	}
+	else
+		throw Error(string("Plist: XML unknown node type ") + nodeName);
 }
 
-std::vector<char> base64Decode(const char* encodedData)
+void initBinaryPlist(PlistHelperData& d, const unsigned char* byteArray, int64_t size)
 {
-	using namespace std;
+	d._data = byteArray;
+	d._dataSize = size;
 
-	vector<char> data;
-	insert_iterator<vector<char> > ii(data, data.begin());
-	base64<char> b64;
-	int state = 0;
-	b64.get(encodedData, encodedData + strlen(encodedData), ii, state);
+	if(size < 8 + 32)
+		throw Error("Plist: binary plist too short to hold a trailer");
+	parseTrailer(d, byteArray + size - 32);
+	checkBinaryTrailer(d, size);
+}
 
-	return data;
+// the trailer's offset table lies within the size bytes of the plist
+
+void checkBinaryTrailer(const PlistHelperData& d, int64_t size)
+{
+	if((d._offsetTableOffset < 8) || (d._offsetTableOffset > size - 32))
+		throw Error("Plist: binary plist offset table out of bounds");
+
+	// object offsets are held as int32_t
+	if(d._offsetTableOffset > std::numeric_limits<int32_t>::max())
+		throw Error("Plist: binary plist object table larger than 2GB not supported");
+	if((d._refCount < 1) || ((int64_t) d._refCount * d._offsetByteSize > size - 32 - d._offsetTableOffset))
+		throw Error("Plist: binary plist object count doesn't fit the offset table");
 }
 
-void base64Encode(std::string& dataEncoded, const std::vector<char>& data)
+void parseOffsetTable(PlistHelperData& d, const unsigned char* offsetTableBytes, int64_t size)
 {
-	using namespace std;
-	dataEncoded.clear();
-	insert_iterator<string> ii(dataEncoded, dataEncoded.begin());
-	base64<char> b64;
-	int state = 0;
-
-#if defined(_WIN32) || defined(_WIN64)
-	b64.put(data.begin(), data.end(), ii, state , base64<>::crlf());
-#else
-	b64.put(data.begin(), data.end(), ii, state , base64<>::lf());
-#endif
+	size_t count = (size_t) (size / d._offsetByteSize);
+	d._offsetTable.resize(count);
+
+	uint32_t* offsets = (uint32_t*) vecData(d._offsetTable);
+	if(!loadBigEndianArray(offsets, offsetTableBytes, count, d._offsetByteSize))
+		throw Error("Plist: binary plist object offset out of bounds");
 
+	for(size_t i = 0; i < count; ++i)
+		if((offsets[i] < 8) || (offsets[i] >= (uint64_t) d._offsetTableOffset))
+			throw Error("Plist: binary plist object offset out of bounds");
 }
 
-boost::any parse(pugi::xml_node& node)
+void parseTrailer(PlistHelperData& d, const unsigned char* trailer)
 {
-	using namespace std;
+	d._offsetByteSize = trailer[6];
+	d._objRefSize = trailer[7];
 
-	string nodeName = node.name();
-
-	boost::any result;
-	if("dict" == nodeName)
-		result = parseDictionary(node);
-	else if("array" == nodeName)
-		result = parseArray(node);
-	else if("string" == nodeName)
-		result = string(node.first_child().value());
-	else if("integer" == nodeName)
-		result = (int64_t) atoll(node.first_child().value());
-	else if("real" == nodeName)
-		result = atof(node.first_child().value());
-	else if("false" == nodeName)
-		result = bool(false);
-	else if("true" == nodeName)
-		result = bool(true);
-	else if("data" == nodeName)
-		result = base64Decode(node.first_child().value());
-	else if("date" == nodeName)
-		result = parseDate(node);
-	else
-		throw Error(string("Plist: XML unknown node type " + nodeName));
+	if((d._offsetByteSize < 1) || (d._offsetByteSize > 8) || (d._objRefSize < 1) || (d._objRefSize > 8))
+		throw Error("Plist: binary plist trailer has unsupported offset or ref size");
 
-	return result;
+	uint64_t objectCount = loadBigEndian64(trailer + 8);
+	uint64_t offsetTableOffset = loadBigEndian64(trailer + 24);
+	if((objectCount > (uint64_t) std::numeric_limits<int32_t>::max()) || (offsetTableOffset > (uint64_t) std::numeric_limits<int64_t>::max()))
+		throw Error("Plist: binary plist trailer out of bounds");
+
+	d._refCount = (int32_t) objectCount;
+	d._offsetTableOffset = (int64_t) offsetTableOffset;
 }
 
-void parseOffsetTable(PlistHelperData& d, const std::vector<unsigned char>& offsetTableBytes)
+int32_t getOffset(const PlistHelperData& d, int objRef)
 {
-	for (unsigned int i = 0; i < offsetTableBytes.size(); i += d._offsetByteSize)
+	if(!d._offsetTable.empty())
 	{
-		std::vector<unsigned char> temp = getRange(offsetTableBytes, i, d._offsetByteSize);
-		std::reverse(temp.begin(), temp.end());
-		d._offsetTable.push_back(
-				bytesToInt<int32_t>(
-					vecData(regulateNullBytes(temp, 4)), hostLittleEndian()));
+		if((objRef < 0) || (objRef >= (int64_t) d._offsetTable.size()))
+			throw Error("Plist: binary plist object ref out of bounds");
+		return d._offsetTable[objRef];
 	}
-}
 
-void parseTrailer(PlistHelperData& d, const std::vector<unsigned char>& trailer)
-{
-	d._offsetByteSize = bytesToInt<int32_t>(vecData(regulateNullBytes(getRange(trailer, 6, 1), 4)), hostLittleEndian());
-	d._objRefSize = bytesToInt<int32_t>(vecData(regulateNullBytes(getRange(trailer, 7, 1), 4)), hostLittleEndian());
+	// offset table wasn't decoded up front, read this entry in place.
+
+	if((objRef < 0) || (objRef >= d._refCount))
+		throw Error("Plist: binary plist object ref out of bounds");
 
-	std::vector<unsigned char> refCountBytes = getRange(trailer, 12, 4);
-//	std::reverse(refCountBytes.begin(), refCountBytes.end());
-	d._refCount = bytesToInt<int32_t>(vecData(refCountBytes), false);
+	uint64_t offset = loadBigEndian(d._data + d._offsetTableOffset + (int64_t) objRef * d._offsetByteSize, d._offsetByteSize);
 
-	std::vector<unsigned char> offsetTableOffsetBytes = getRange(trailer, 24, 8);
-//	std::reverse(offsetTableOffsetBytes.begin(), offsetTableOffsetBytes.end());
-	d._offsetTableOffset = bytesToInt<int64_t>(vecData(offsetTableOffsetBytes), false);
+	if((offset < 8) || (offset >= (uint64_t) d._offsetTableOffset))
+		throw Error("Plist: binary plist object offset out of bounds");
+	return (int32_t) offset;
 }
 
+// returns a pointer to size bytes of the object table starting at index,
+// read in place from the caller's buffer.
 
-std::vector<unsigned char> regulateNullBytes(const std::vector<unsigned char>& origBytes, unsigned int minBytes)
+const unsigned char* getObjectBytes(const PlistHelperData& d, int64_t index, int64_t size)
 {
+	if((index < 0) || (size < 0) || (index + size > d._offsetTableOffset))
+		throw Error("Plist: binary plist object out of bounds");
+	return d._data + index;
+}
 
-	std::vector<unsigned char> bytes(origBytes);
-	while((bytes.back() == 0) && (bytes.size() > minBytes))
-		bytes.pop_back();
-
-	while(bytes.size() < minBytes)
-		bytes.push_back(0);
-
-	return bytes;
+template<typename Policy>
+void parseBinary(const PlistHelperData& d, int objRef, boost::any& value)
+{
+	DecodeBudget budget;
+	parseBinary<Policy>(d, objRef, value, budget);
 }
 
-boost::any parseBinary(const PlistHelperData& d, int objRef)
+template<typename Policy>
+void parseBinary(const PlistHelperData& d, int objRef, boost::any& value, DecodeBudget& budget)
 {
-	unsigned char header = d._objectTable[d._offsetTable[objRef]];
+	int32_t offset = getOffset(d, objRef);
+	unsigned char header = *getObjectBytes(d, offset, 1);
+	budget.addObject();
 	switch (header & 0xF0)
 	{
 		case 0x00:
 			{
-				return parseBinaryBool(d, d._offsetTable[objRef]);
+				value = parseBinaryBool(d, offset);
+				return;
 			}
 		case 0x10:
 			{
 				int intByteCount;
-				return parseBinaryInt(d, d._offsetTable[objRef], intByteCount);
+				value = parseBinaryInt(d, offset, intByteCount);
+				return;
 			}
 		case 0x20:
 			{
-				return parseBinaryReal(d, d._offsetTable[objRef]);
+				value = parseBinaryReal(d, offset);
+				return;
 			}
 		case 0x30:
 			{
-				return parseBinaryDate(d, d._offsetTable[objRef]);
+				value = parseBinaryDate(d, offset);
+				return;
 			}
 		case 0x40:
 			{
-				return parseBinaryByteArray(d, d._offsetTable[objRef]);
+				data_type data = parseBinaryByteArray(d, offset);
+				budget.addBytes(data.size());
+				moveIntoAny(data, value);
+				return;
 			}
 		case 0x50:
 			{
-				return parseBinaryString(d, d._offsetTable[objRef]);
+				std::string text = parseBinaryString(d, offset);
+				budget.addBytes(text.size());
+				moveIntoAny(text, value);
+				return;
 			}
 		case 0x60:
 			{
-				return parseBinaryUnicode(d, d._offsetTable[objRef]);
+				std::string text = parseBinaryUnicode(d, offset);
+				budget.addBytes(text.size());
+				moveIntoAny(text, value);
+				return;
 			}
 		case 0xD0:
 			{
-				return parseBinaryDictionary(d, objRef);
+				budget.enter();
+				parseBinaryDictionary<Policy>(d, objRef, value, budget);
+				budget.leave();
+				return;
 			}
 		case 0xA0:
 			{
-				return parseBinaryArray(d, objRef);
+				budget.enter();
+				parseBinaryArray<Policy>(d, objRef, value, budget);
+				budget.leave();
+				return;
 			}
 	}
 	throw Error("This type is not supported");
 }
 
+boost::any parseBinary(const PlistHelperData& d, int objRef)
+{
+	boost::any value;
+	parseBinary<MapDictionaryPolicy>(d, objRef, value);
+	return value;
+}
+
+// returns the number of objects a container refers to (twice the entry count
+// for dictionaries, keys come first) and the position of its first ref.
+
+int32_t getContainerRefs(const PlistHelperData& d, int objRef, int64_t& refStartPosition)
+{
+	int32_t offset = getOffset(d, objRef);
+	unsigned char header = *getObjectBytes(d, offset, 1);
+
+	int startOffset;
+	int32_t refCount = getCount(d, offset, header, startOffset);
+	refStartPosition = (int64_t) offset + startOffset;
+
+	if((header & 0xF0) == 0xD0)
+		refCount *= 2;
+
+	// make sure all the refs lie within the object table.
+	getObjectBytes(d, refStartPosition, (int64_t) refCount * d._objRefSize);
+
+	return refCount;
+}
+
+int32_t getRef(const PlistHelperData& d, int64_t refStartPosition, int32_t index)
+{
+	uint64_t ref = loadBigEndian(getObjectBytes(d, refStartPosition + (int64_t) index * d._objRefSize, d._objRefSize), d._objRefSize);
+
+	if(ref > (uint64_t) std::numeric_limits<int32_t>::max())
+		throw Error("Plist: binary plist object ref out of bounds");
+	return (int32_t) ref;
+}
+
 std::vector<int32_t> getRefsForContainers(const PlistHelperData& d, int objRef)
 {
 	using namespace std;
-	int32_t refCount = 0;
-	int refStartPosition;
-	refCount = getCount(d, d._offsetTable[objRef], d._objectTable[d._offsetTable[objRef]], refStartPosition);
-	refStartPosition += d._offsetTable[objRef];
-
-	vector<int32_t> refs;
-	int mult = 1;
-	if((((unsigned char) d._objectTable[d._offsetTable[objRef]]) & 0xF0) == 0xD0)
-		mult = 2;
-	for (int i = refStartPosition; i < refStartPosition + refCount * mult * d._objRefSize; i += d._objRefSize)
-	{
-		std::vector<unsigned char> refBuffer = getRange(d._objectTable, i, d._objRefSize);
-		reverse(refBuffer.begin(), refBuffer.end());
-		refs.push_back(bytesToInt<int32_t>(vecData(regulateNullBytes(refBuffer, 4)), hostLittleEndian()));
-	}
+	int64_t refStartPosition;
+	int32_t refCount = getContainerRefs(d, objRef, refStartPosition);
+
+	vector<int32_t> refs(refCount);
+	uint32_t* values = (uint32_t*) vecData(refs);
+	if(!loadBigEndianArray(values, d._data + refStartPosition, refCount, d._objRefSize))
+		throw Error("Plist: binary plist object ref out of bounds");
+
+	for (int32_t i = 0; i < refCount; ++i)
+		if(values[i] > (uint32_t) std::numeric_limits<int32_t>::max())
+			throw Error("Plist: binary plist object ref out of bounds");
 
 	return refs;
 }
 
-array_type  parseBinaryArray(const PlistHelperData& d, int objRef)
+template<typename Policy>
+void parseBinaryArray(const PlistHelperData& d, int objRef, boost::any& value, DecodeBudget& budget)
 {
 	using namespace std;
 	vector<int32_t> refs = getRefsForContainers(d, objRef);
 	int32_t refCount = refs.size();
 
-	array_type array;
+	value = array_type();
+	array_type& array = *boost::any_cast<array_type>(&value);
+	array.resize(refCount);
 	for(int i = 0; i < refCount; ++i)
-		array.push_back(parseBinary(d, refs[i]));
-
-	return array;
+		parseBinary<Policy>(d, refs[i], array[i], budget);
 }
 
-dictionary_type parseBinaryDictionary(const PlistHelperData& d, int objRef)
+template<typename Policy>
+void parseBinaryDictionary(const PlistHelperData& d, int objRef, boost::any& value, DecodeBudget& budget)
 {
 	using namespace std;
 	vector<int32_t> refs = getRefsForContainers(d, objRef);
 	int32_t refCount = refs.size() / 2;
 
-	dictionary_type dict;
+	typedef typename Policy::dictionary_type dictionary;
+
+	value = dictionary();
+	dictionary& dict = *boost::any_cast<dictionary>(&value);
+	Policy::reserve(dict, refCount);
+
 	for (int i = 0; i < refCount; i++)
 	{
-		boost::any keyAny = parseBinary(d, refs[i]);
+		std::string key = parseBinaryKey(d, refs[i]);
+		budget.addBytes(key.size());
+		parseBinary<Policy>(d, refs[i + refCount], Policy::insert(dict, key), budget);
+	}
+
+	Policy::finish(dict);
+}
+
+void parseBinary(const PlistHelperData& d, int objRef, Value& value)
+{
+	DecodeBudget budget;
+	parseBinary(d, objRef, value, budget);
+}
+
+void parseBinary(const PlistHelperData& d, int objRef, Value& value, DecodeBudget& budget)
+{
+	int32_t offset = getOffset(d, objRef);
+	unsigned char header = *getObjectBytes(d, offset, 1);
+	budget.addObject();
+	switch (header & 0xF0)
+	{
+		case 0x00:
+			Value(parseBinaryBool(d, offset)).swap(value);
+			return;
+		case 0x10:
+			{
+				int intByteCount;
+				Value((long long) parseBinaryInt(d, offset, intByteCount)).swap(value);
+				return;
+			}
+		case 0x20:
+			Value(parseBinaryReal(d, offset)).swap(value);
+			return;
+		case 0x30:
+			Value(parseBinaryDate(d, offset)).swap(value);
+			return;
+		case 0x40:
+		case 0x50:
+			{
+				// bytes are copied once, from the plist into the value
+				int startOffset;
+				int32_t count = getCount(d, offset, header, startOffset);
+				const char* bytes = (const char*) getObjectBytes(d, (int64_t) offset + startOffset, count);
+				budget.addBytes(count);
+				if((header & 0xF0) == 0x40)
+					value.setData(bytes, count);
+				else
+					value.setString(bytes, count);
+				return;
+			}
+		case 0x60:
+			{
+				std::string text = parseBinaryUnicode(d, offset);
+				budget.addBytes(text.size());
+				Value(text).swap(value);
+				return;
+			}
+		case 0xD0:
+			budget.enter();
+			parseBinaryDictionary(d, objRef, value, budget);
+			budget.leave();
+			return;
+		case 0xA0:
+			budget.enter();
+			parseBinaryArray(d, objRef, value, budget);
+			budget.leave();
+			return;
+	}
+	throw Error("This type is not supported");
+}
+
+void parseBinaryArray(const PlistHelperData& d, int objRef, Value& value, DecodeBudget& budget)
+{
+	std::vector<int32_t> refs = getRefsForContainers(d, objRef);
+
+	Value(Value::ArrayType).swap(value);
+	Value::array_type& array = value.asArray();
+	array.resize(refs.size());
+	for(size_t i = 0; i < refs.size(); ++i)
+		parseBinary(d, refs[i], array[i], budget);
+}
+
+void parseBinaryDictionary(const PlistHelperData& d, int objRef, Value& value, DecodeBudget& budget)
+{
+	std::vector<int32_t> refs = getRefsForContainers(d, objRef);
+	size_t count = refs.size() / 2;
+
+	Value(Value::DictionaryType).swap(value);
+	Value::dictionary_type& dict = value.asDictionary();
+	for(size_t i = 0; i < count; ++i)
+	{
+		std::string key = parseBinaryKey(d, refs[i]);
+		budget.addBytes(key.size());
+		parseBinary(d, refs[i + count], dict[key], budget);
+	}
+}
 
-		try
+std::string parseBinaryKey(const PlistHelperData& d, int objRef)
+{
+	int32_t keyOffset = getOffset(d, objRef);
+	unsigned char keyHeader = *getObjectBytes(d, keyOffset, 1);
+
+	if((keyHeader & 0xF0) == 0x50)
+		return parseBinaryString(d, keyOffset);
+	else if((keyHeader & 0xF0) == 0x60)
+		return parseBinaryUnicode(d, keyOffset);
+
+	throw Error("Error parsing dictionary.  Key can't be parsed as a string");
+}
+
+// utf-16 code units against utf-8 bytes, by code point, which orders them
+// as their utf-8 bytes would
+
+static int compareUnicodeKey(const unsigned char* units, int32_t count, const unsigned char* key, size_t size)
+{
+	int32_t i = 0;
+	size_t j = 0;
+	while((i < count) && (j < size))
+	{
+		uint32_t unit = loadBigEndian16(units + 2 * i++);
+		if((unit >= 0xD800) && (unit < 0xDC00) && (i < count))
 		{
-			std::string& key = boost::any_cast<std::string&>(keyAny);
-			dict[key] =  parseBinary(d, refs[i + refCount]);
+			uint32_t low = loadBigEndian16(units + 2 * i);
+			if((low >= 0xDC00) && (low < 0xE000))
+			{
+				unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+				++i;
+			}
 		}
-		catch(boost::bad_any_cast& )
+
+		uint32_t character = key[j++];
+		if(character >= 0xC0)
 		{
-			throw Error("Error parsing dictionary.  Key can't be parsed as a string");
+			int extra = (character >= 0xF0) ? 3 : ((character >= 0xE0) ? 2 : 1);
+			character &= 0x3F >> extra;
+			for(; extra && (j < size); --extra)
+				character = (character << 6) | (key[j++] & 0x3F);
+		}
+
+		if(unit != character)
+			return (unit < character) ? -1 : 1;
+	}
+
+	if(i < count)
+		return 1;
+	return (j < size) ? -1 : 0;
+}
+
+int compareBinaryKey(const PlistHelperData& d, int32_t keyRef, const char* key, size_t size)
+{
+	int32_t offset = getOffset(d, keyRef);
+	unsigned char marker = *getObjectBytes(d, offset, 1);
+
+	int startOffset;
+	int32_t length = getCount(d, offset, marker, startOffset);
+
+	if((marker & 0xF0) == 0x50)
+	{
+		const unsigned char* keyBytes = getObjectBytes(d, (int64_t) offset + startOffset, length);
+		size_t common = std::min((size_t) length, size);
+		int result = common ? std::memcmp(keyBytes, key, common) : 0;
+		if(result != 0)
+			return result;
+		if((size_t) length == size)
+			return 0;
+		return ((size_t) length < size) ? -1 : 1;
+	}
+	else if((marker & 0xF0) == 0x60)
+	{
+		const unsigned char* units = getObjectBytes(d, (int64_t) offset + startOffset, (int64_t) length * 2);
+		return compareUnicodeKey(units, length, (const unsigned char*) key, size);
+	}
+
+	throw Error("Error parsing dictionary.  Key can't be parsed as a string");
+}
+
+// true if every key sorts after the one before it.  Each key is compared
+// in place against the text of the previous one, utf-16 keys are
+// transcoded once.
+
+static bool binaryKeysSorted(const PlistHelperData& d, int64_t refStartPosition, int32_t entryCount)
+{
+	std::string buffer;
+	const char* previous = 0;
+	size_t previousSize = 0;
+	for(int32_t i = 0; i < entryCount; ++i)
+	{
+		int32_t keyRef = getRef(d, refStartPosition, i);
+		if(previous && (compareBinaryKey(d, keyRef, previous, previousSize) <= 0))
+			return false;
+
+		int32_t offset = getOffset(d, keyRef);
+		unsigned char marker = *getObjectBytes(d, offset, 1);
+		int startOffset;
+		int32_t length = getCount(d, offset, marker, startOffset);
+		if((marker & 0xF0) == 0x50)
+		{
+			previous = (const char*) getObjectBytes(d, (int64_t) offset + startOffset, length);
+			previousSize = length;
 		}
+		else if((marker & 0xF0) == 0x60)
+		{
+			const unsigned char* units = getObjectBytes(d, (int64_t) offset + startOffset, (int64_t) length * 2);
+			buffer.resize(utf16ToUTF8Capacity(length) + 1);
+			if(!utf16ToUTF8(&buffer[0], units, length, previousSize))
+				return false;
+			previous = buffer.data();
+		}
+		else
+			throw Error("Error parsing dictionary.  Key can't be parsed as a string");
+	}
+	return true;
+}
+
+int32_t findBinaryKey(const PlistHelperData& d, int64_t refStartPosition, int32_t entryCount,
+		const char* key, size_t size, BinaryKeyOrder& order)
+{
+	int32_t low = 0;
+	int32_t high = entryCount - 1;
+	while(low <= high)
+	{
+		int32_t middle = low + (high - low) / 2;
+		int result = compareBinaryKey(d, getRef(d, refStartPosition, middle), key, size);
+		if(result == 0)
+			return middle;
+		else if(result < 0)
+			low = middle + 1;
+		else
+			high = middle - 1;
 	}
 
-	return dict;
+	// keys in plists from other writers (e.g. CoreFoundation) needn't be
+	// sorted, only those get a linear scan before giving up.
+
+	if(order == BinaryKeysUnchecked)
+		order = binaryKeysSorted(d, refStartPosition, entryCount) ? BinaryKeysSorted : BinaryKeysUnsorted;
+	if(order == BinaryKeysSorted)
+		return -1;
+
+	for(int32_t i = 0; i < entryCount; ++i)
+		if(compareBinaryKey(d, getRef(d, refStartPosition, i), key, size) == 0)
+			return i;
+
+	return -1;
+}
+
+void splitPath(const std::string& path, std::vector<std::string>& components)
+{
+	components.clear();
+	if(path.empty())
+		return;
+
+	size_t start = 0;
+	for(size_t slash = path.find('/'); slash != std::string::npos; slash = path.find('/', start))
+	{
+		components.push_back(path.substr(start, slash - start));
+		start = slash + 1;
+	}
+	components.push_back(path.substr(start));
 }
 
 std::string parseBinaryString(const PlistHelperData& d, int headerPosition)
 {
-	unsigned char headerByte = d._objectTable[headerPosition];
+	unsigned char headerByte = *getObjectBytes(d, headerPosition, 1);
 	int charStartPosition;
 	int32_t charCount = getCount(d, headerPosition, headerByte, charStartPosition);
 	charStartPosition += headerPosition;
 
-	std::vector<unsigned char> characterBytes = getRange(d._objectTable, charStartPosition, charCount);
-	std::string buffer = std::string((char*) vecData(characterBytes), characterBytes.size());
-	return buffer;
+	const unsigned char* characterBytes = getObjectBytes(d, charStartPosition, charCount);
+	return std::string((const char*) characterBytes, charCount);
 }
 
 std::string parseBinaryUnicode(const PlistHelperData& d, int headerPosition)
 {
-	unsigned char headerByte = d._objectTable[headerPosition];
+	unsigned char headerByte = *getObjectBytes(d, headerPosition, 1);
 	int charStartPosition;
 	int32_t charCount = getCount(d, headerPosition, headerByte, charStartPosition);
 	charStartPosition += headerPosition;
 
-	std::vector<unsigned char> characterBytes = getRange(d._objectTable, charStartPosition, charCount * 2);
-	if (hostLittleEndian()) {
-		if (! characterBytes.empty()) {
-			for (std::size_t i = 0, n = characterBytes.size(); i < n - 1; i += 2)
-				std::swap(characterBytes[i], characterBytes[i + 1]);
-		}
-	}
+	const unsigned char* unicodeBytes = getObjectBytes(d, charStartPosition, (int64_t) charCount * 2);
+	if(charCount == 0)
+		return std::string();
 
-	int16_t *u16chars = (int16_t*) vecData(characterBytes);
-	std::size_t u16len = characterBytes.size() / 2;
-	std::string result = boost::locale::conv::utf_to_utf<char, int16_t>(u16chars, u16chars + u16len, boost::locale::conv::stop);
+	// transcoded straight from the object table into the result
+	std::string result(utf16ToUTF8Capacity(charCount), '\0');
+	size_t size;
+	if(!utf16ToUTF8(&result[0], unicodeBytes, charCount, size))
+		throw Error("Plist: binary plist string holds an unpaired UTF-16 surrogate");
+	result.resize(size);
 	return result;
 }
 
 int64_t parseBinaryInt(const PlistHelperData& d, int headerPosition, int& intByteCount)
 {
-	unsigned char header = d._objectTable[headerPosition];
+	unsigned char header = *getObjectBytes(d, headerPosition, 1);
 	intByteCount = 1 << (header & 0xf);
-	std::vector<unsigned char> buffer = getRange(d._objectTable, headerPosition + 1, intByteCount);
-	reverse(buffer.begin(), buffer.end());
+	if(intByteCount > 8)
+		throw Error("Plist: binary plist integer wider than 8 bytes");
 
-	return bytesToInt<int64_t>(vecData(regulateNullBytes(buffer, 8)), hostLittleEndian());
+	// 1, 2 and 4 byte integers are unsigned, 8 byte ones signed
+	return (int64_t) loadBigEndian(getObjectBytes(d, headerPosition + 1, intByteCount), intByteCount);
 }
 
 double parseBinaryReal(const PlistHelperData& d, int headerPosition)
 {
-	unsigned char header = d._objectTable[headerPosition];
+	unsigned char header = *getObjectBytes(d, headerPosition, 1);
 	int byteCount = 1 << (header & 0xf);
-	std::vector<unsigned char> buffer = getRange(d._objectTable, headerPosition + 1, byteCount);
-	reverse(buffer.begin(), buffer.end());
-
-	return bytesToDouble(vecData(regulateNullBytes(buffer, 8)), hostLittleEndian());
+	if(byteCount == 4)
+		return loadBigEndianFloat(getObjectBytes(d, headerPosition + 1, 4));
+	else if(byteCount == 8)
+		return loadBigEndianDouble(getObjectBytes(d, headerPosition + 1, 8));
+	throw Error("Plist: binary plist real must be 4 or 8 bytes");
 }
 
 bool parseBinaryBool(const PlistHelperData& d, int headerPosition)
 {
-	unsigned char header = d._objectTable[headerPosition];
+	unsigned char header = *getObjectBytes(d, headerPosition, 1);
 	bool value;
 	if(header == 0x09)
 		value = true;
@@ -1088,24 +2742,25 @@ bool parseBinaryBool(const PlistHelperData& d, int headerPosition)
 Date parseBinaryDate(const PlistHelperData& d, int headerPosition)
 {
 	// date always an 8 byte float starting after full byte header
-	std::vector<unsigned char> buffer = getRange(d._objectTable, headerPosition + 1, 8);
+	const unsigned char* buffer = getObjectBytes(d, headerPosition + 1, 8);
 
-	Date date;
+	Date date(Date::uninitialized);
 
 	// Date is stored as Apple Epoch and big endian.
-	date.setTimeFromAppleEpoch(bytesToDouble(vecData(buffer), false));
+	date.setTimeFromAppleEpoch(loadBigEndianDouble(buffer));
 
 	return date;
 }
 
 data_type parseBinaryByteArray(const PlistHelperData& d, int headerPosition)
 {
-	unsigned char headerByte = d._objectTable[headerPosition];
+	unsigned char headerByte = *getObjectBytes(d, headerPosition, 1);
 	int byteStartPosition;
 	int32_t byteCount = getCount(d, headerPosition, headerByte, byteStartPosition);
 	byteStartPosition += headerPosition;
 
-	return getRange((const char*) vecData(d._objectTable), byteStartPosition, byteCount);
+	const char* bytes = (const char*) getObjectBytes(d, byteStartPosition, byteCount);
+	return data_type(bytes, bytes + byteCount);
 }
 
 int32_t getCount(const PlistHelperData& d, int bytePosition, unsigned char headerByte, int& startOffset)
@@ -1118,9 +2773,11 @@ int32_t getCount(const PlistHelperData& d, int bytePosition, unsigned char heade
 	}
 	else
 	{
-		int32_t count = (int32_t)parseBinaryInt(d, bytePosition + 1, startOffset);
+		int64_t count = parseBinaryInt(d, bytePosition + 1, startOffset);
+		if((count < 0) || (count > d._offsetTableOffset))
+			throw Error("Plist: binary plist object count out of bounds");
 		startOffset += 2;
-		return count;
+		return (int32_t) count;
 	}
 }
 
@@ -1132,78 +2789,4 @@ std::string stringFromValue(const T& value)
 	return ss.str();
 }
 
-template <typename IntegerType>
-IntegerType bytesToInt(const unsigned char* bytes, bool littleEndian)
-{
-	IntegerType result = 0;
-	if (littleEndian)
-		for (int n = sizeof( result ) - 1; n >= 0; n--)
-			result = (result << 8) + bytes[n];
-	else
-		for (unsigned n = 0; n < sizeof( result ); n++)
-			result = (result << 8) + bytes[n];
-	return result;
-}
-
-double bytesToDouble(const unsigned char* bytes, bool littleEndian)
-{
-	double result;
-	int numBytes = sizeof(double);
-	if(littleEndian)
-		memcpy( &result, bytes, numBytes);
-	else
-	{
-		std::vector<unsigned char> bytesReverse(numBytes);
-		std::reverse_copy(bytes, bytes + numBytes, bytesReverse.begin());
-		memcpy( &result, vecData(bytesReverse), numBytes);
-	}
-	return result;
-}
-
-std::vector<unsigned char> doubleToBytes(double val, bool littleEndian)
-{
-	std::vector<unsigned char> result(sizeof(double));
-	memcpy(vecData(result), &val, sizeof(double));
-	if(!littleEndian)
-		std::reverse(result.begin(), result.end());
-
-	return result;
-}
-
-template<typename IntegerType>
-std::vector<unsigned char> intToBytes(IntegerType val, bool littleEndian)
-{
-	unsigned int numBytes = sizeof(val);
-	std::vector<unsigned char> bytes(numBytes);
-
-	for(unsigned n = 0; n < numBytes; ++n)
-		if(littleEndian)
-			bytes[n] = (val >> 8 * n) & 0xff;
-		else
-			bytes[numBytes - 1 - n] = (val >> 8 * n) & 0xff;
-
-	return bytes;
-}
-
-std::vector<unsigned char> getRange(const unsigned char* origBytes, int64_t index, int64_t size)
-{
-	std::vector<unsigned char> result((std::vector<unsigned char>::size_type)size);
-	std::copy(origBytes + index, origBytes + index + size, result.begin());
-	return result;
-}
-
-std::vector<char> getRange(const char* origBytes, int64_t index, int64_t size)
-{
-	std::vector<char> result((std::vector<char>::size_type)size);
-	std::copy(origBytes + index, origBytes + index + size, result.begin());
-	return result;
-}
-
-std::vector<unsigned char> getRange(const std::vector<unsigned char>& origBytes, int64_t index, int64_t size)
-{
-	if((index + size) > (int64_t) origBytes.size())
-		throw Error("Out of bounds getRange");
-	return getRange(vecData(origBytes), index, size);
-}
-
 } // namespace Plist
@@ -36,6 +36,14 @@
 #include <stdexcept>
 #include "PlistDate.hpp"
 
+// std::pmr is used where the standard library has it
+#if defined(__has_include)
+#if (__cplusplus >= 201703L) && __has_include(<memory_resource>)
+#include <memory_resource>
+#define PLIST_HAS_PMR 1
+#endif
+#endif
+
 namespace Plist
 {
 		// Plist value types and their corresponding c++ types
@@ -49,10 +57,123 @@ namespace Plist
 		typedef std::vector<char>                    data_type;
 		typedef bool                                 boolean_type;
 
+		// How the readers build dictionaries.  dictionary_type is the
+		// container, reserve() is called with the entry count when it is
+		// known up front, insert() returns the value for key, overwriting
+		// one read earlier, and finish() is called once every entry is in.
+		// PlistDictionary.hpp has policies for a hash map, an insertion
+		// ordered map and a sorted vector.
+
+		struct MapDictionaryPolicy
+		{
+			typedef std::map<std::string, boost::any> dictionary_type;
+
+			static void reserve(dictionary_type&, size_t) { }
+
+			// keys mostly arrive in order, so try the end first
+			static boost::any& insert(dictionary_type& dictionary, const std::string& key)
+			{
+				return dictionary.insert(dictionary.end(), dictionary_type::value_type(key, boost::any()))->second;
+			}
+
+			static void finish(dictionary_type&) { }
+		};
+
+		// policy used when reading into a T
+		template<typename T>
+		struct DictionaryPolicyFor
+		{
+			typedef MapDictionaryPolicy type;
+		};
+
+		// true for structs listed with PLIST_FIELDS, and vectors and string
+		// keyed maps of them, see PlistFields.hpp
+		template<typename T>
+		struct HasFields
+		{
+			static const bool value = false;
+		};
+
+		// How readPlist reads into a T.  By default the plist is read into
+		// a boost::any tree, dictionaries built by DictionaryPolicyFor<T>,
+		// and the tree is moved into message.  PlistFields.hpp specializes
+		// it to decode straight into PLIST_FIELDS structs.
+		template<typename T, bool Fields = HasFields<T>::value>
+		struct TypedReader
+		{
+			static void read(const char* filename, T& message);
+			static void read(const char* byteArray, int64_t size, T& message);
+			static void read(std::istream& stream, T& message);
+		};
+
 		// Public read methods.  Plist type (binary or xml) automatically detected.
 
 		void readPlist(const char* byteArrayTemp, int64_t size, boost::any& message);
 		void readPlist(std::istream& stream, boost::any& message);
+		void readPlist(const char* filename, boost::any& message);
+
+		// Read with every dictionary built by Policy, e.g.
+		// readPlist<Plist::HashDictionaryPolicy>(filename, message)
+		template<typename Policy>
+		void readPlist(const char* byteArrayTemp, int64_t size, boost::any& message);
+		template<typename Policy>
+		void readPlist(std::istream& stream, boost::any& message);
+		template<typename Policy>
+		void readPlist(const char* filename, boost::any& message);
+
+		// Limits on what reading a plist builds, checked as it is decoded
+		// so a hostile plist fails fast with Plist::Error.  Objects in a
+		// binary plist can be referred to from many places and a tree
+		// holds a copy at each, so a few hundred bytes can decode into an
+		// exponentially large tree.  maxObjects counts every value built,
+		// maxBytes the string, key and data bytes, and maxDepth the
+		// nesting of arrays and dictionaries.  Reading into a Document
+		// (PlistDocument.hpp) builds a shared object only once.
+
+		struct DecodeLimits
+		{
+			enum { DefaultMaxDepth = 512 };
+
+			// no limit on objects or bytes, nesting up to DefaultMaxDepth,
+			// the limits every read is made with
+			DecodeLimits();
+
+			int64_t maxObjects;
+			int64_t maxBytes;
+			int32_t maxDepth;
+		};
+
+		void readPlist(const char* byteArray, int64_t size, boost::any& message, const DecodeLimits& limits);
+		void readPlist(std::istream& stream, boost::any& message, const DecodeLimits& limits);
+		void readPlist(const char* filename, boost::any& message, const DecodeLimits& limits);
+
+		// Reads a binary plist with its large arrays and dictionaries
+		// decoded on threadCount threads, one per core when 0.  The tree
+		// is the one readPlist builds, read with the default limits.  XML
+		// plists, and binary ones built without C++11, are read on the
+		// calling thread.
+
+		void readPlistParallel(const char* byteArray, int64_t size, boost::any& message, unsigned threadCount = 0);
+		void readPlistParallel(std::istream& stream, boost::any& message, unsigned threadCount = 0);
+		void readPlistParallel(const char* filename, boost::any& message, unsigned threadCount = 0);
+
+		// Checks that a plist in either format can be read by readPlist
+		// with the default limits, without decoding it.  Binary plists are
+		// checked in one pass over the offset table and a walk of the
+		// containers reachable from the root: bounds, types, ref cycles,
+		// nesting and string keys.  XML plists are parsed with pugixml but
+		// no boost::any tree is built, and integer, real, date and data
+		// text must be well formed.
+		// On failure problem says what is wrong.
+
+		bool validatePlist(const char* byteArray, int64_t size);
+		bool validatePlist(const char* byteArray, int64_t size, std::string& problem);
+
+
+		// Read straight into a T, e.g. a dictionary_type.  The parsed tree is
+		// moved into message, not copied.  Throws boost::bad_any_cast if the
+		// plist's root isn't a T.  A struct listed with PLIST_FIELDS (see
+		// PlistFields.hpp) is decoded member by member instead.
 		template<typename T>
 		void readPlist(const char* byteArray, int64_t size, T& message);
 		template<typename T>
@@ -64,6 +185,20 @@ namespace Plist
 		void readPlist(const wchar_t* filename, T& message);
 #endif
 
+		// The same, returning the T, e.g.
+		// readPlist<Plist::dictionary_type>(filename)
+		template<typename T>
+		T readPlist(const char* byteArray, int64_t size);
+		template<typename T>
+		T readPlist(std::istream& stream);
+		template<typename T>
+		T readPlist(const char* filename);
+
+		// Moves the T held by value into message, leaving value holding an
+		// empty T.  Throws boost::bad_any_cast if value doesn't hold a T.
+		template<typename T>
+		void moveFromAny(boost::any& value, T& message);
+
 		// Public binary write methods.
 
 		void writePlistBinary(std::ostream& stream, const boost::any& message);
@@ -82,6 +217,80 @@ namespace Plist
 		void writePlistXML(const wchar_t* filename, const boost::any& message);
 #endif
 
+		// Exact size in bytes of message as written by writePlistBinary or
+		// writePlistXML, computed without writing it.
+
+		enum Format
+		{
+			XMLFormat,
+			BinaryFormat
+		};
+
+		int64_t serializedSize(const boost::any& message, Format format);
+
+		// What probePlist learns about a plist without parsing it: the
+		// header and trailer of a binary plist and its root object's
+		// header, or the prologue and root tag of an XML plist.
+
+		struct PlistInfo
+		{
+			enum Type
+			{
+				BooleanType,
+				IntegerType,
+				RealType,
+				DateType,
+				DataType,
+				StringType,
+				ArrayType,
+				DictionaryType
+			};
+
+			PlistInfo();
+
+			Format format;
+			Type rootType;
+
+			// Elements of a root array, entries of a root dictionary, or
+			// bytes, ASCII or UTF-16 characters of a root data or string.
+			// -1 for xml or other types.
+			int64_t rootCount;
+
+			// from the binary trailer, -1 for xml
+			int64_t objectCount;
+			int32_t offsetByteSize;
+			int32_t objRefSize;
+
+			// Rough bytes of the boost::any tree readPlist builds, for
+			// routing: the object table plus a node per object for binary
+			// plists, the size of the text for xml.
+			int64_t approximateSize;
+		};
+
+		PlistInfo probePlist(const char* byteArray, int64_t size);
+
+		// reads only the byte ranges it needs from the file
+		PlistInfo probePlist(const char* filename);
+
+		// Writing into memory from a std::pmr::memory_resource, e.g. a
+		// monotonic buffer per request.  The output and the writer's scratch
+		// tables all come from plist's resource.
+
+#if defined(PLIST_HAS_PMR)
+		typedef std::pmr::memory_resource memory_resource;
+
+		namespace pmr
+		{
+			typedef std::pmr::vector<char> data_type;
+		}
+
+		void writePlistBinary(pmr::data_type& plist, const boost::any& message);
+		void writePlistXML(pmr::data_type& plist, const boost::any& message);
+#else
+		// stands in for std::pmr::memory_resource, nothing is allocated from it
+		class memory_resource;
+#endif
+
 		class Error: public std::runtime_error {
 			public:
 #if __cplusplus >= 201103L
@@ -104,29 +313,81 @@ void Plist::readPlist(const wchar_t* filename, T& message)
 }
 #endif
 
+template <typename T>
+void Plist::moveFromAny(boost::any& value, T& message)
+{
+	T* content = boost::any_cast<T>(&value);
+	if(!content)
+		throw boost::bad_any_cast();
+
+	using std::swap;
+	swap(*content, message);
+}
+
+template <typename T, bool Fields>
+void Plist::TypedReader<T, Fields>::read(const char* filename, T& message)
+{
+	boost::any tmp_message;
+	readPlist<typename DictionaryPolicyFor<T>::type>(filename, tmp_message);
+	moveFromAny(tmp_message, message);
+}
+
+template <typename T, bool Fields>
+void Plist::TypedReader<T, Fields>::read(const char* byteArrayTemp, int64_t size, T& message)
+{
+	boost::any tmp_message;
+	readPlist<typename DictionaryPolicyFor<T>::type>(byteArrayTemp, size, tmp_message);
+	moveFromAny(tmp_message, message);
+}
+
+template <typename T, bool Fields>
+void Plist::TypedReader<T, Fields>::read(std::istream& stream, T& message)
+{
+	boost::any tmp_message;
+	readPlist<typename DictionaryPolicyFor<T>::type>(stream, tmp_message);
+	moveFromAny(tmp_message, message);
+}
+
 template <typename T>
 void Plist::readPlist(const char* filename, T& message)
 {
-	std::ifstream stream(filename, std::ios::binary);
-	if(!stream)
-		throw Error("Can't open file.");
-	readPlist(stream, message);
+	TypedReader<T>::read(filename, message);
 }
 
 template <typename T>
 void Plist::readPlist(const char* byteArrayTemp, int64_t size, T& message)
 {
-	boost::any tmp_message;
-	readPlist(byteArrayTemp, size, tmp_message);
-	message = boost::any_cast<T>(tmp_message);
+	TypedReader<T>::read(byteArrayTemp, size, message);
 }
 
 template <typename T>
 void Plist::readPlist(std::istream& stream, T& message)
 {
-	boost::any tmp_message;
-	readPlist(stream, tmp_message);
-	message = boost::any_cast<T>(tmp_message);
+	TypedReader<T>::read(stream, message);
+}
+
+template <typename T>
+T Plist::readPlist(const char* filename)
+{
+	T message;
+	readPlist(filename, message);
+	return message;
+}
+
+template <typename T>
+T Plist::readPlist(const char* byteArrayTemp, int64_t size)
+{
+	T message;
+	readPlist(byteArrayTemp, size, message);
+	return message;
+}
+
+template <typename T>
+T Plist::readPlist(std::istream& stream)
+{
+	T message;
+	readPlist(stream, message);
+	return message;
 }
 
 #endif
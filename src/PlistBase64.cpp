@@ -0,0 +1,426 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+
+#include "PlistBase64.hpp"
+#include <boost/cstdint.hpp>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PLIST_BASE64_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#endif
+
+// the simd codecs are compiled for their instruction set whatever the rest
+// of the build targets, and only called once the cpu is known to have it
+
+#if defined(__GNUC__)
+#define PLIST_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PLIST_TARGET(isa)
+#endif
+
+namespace Plist
+{
+
+static const char base64Alphabet[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// value of each character, -1 for characters that are skipped and -2 for
+// the padding character
+
+static const signed char base64Values[256] =
+{
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+	52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -2, -1, -1,
+	-1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+	15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+	-1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+	41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+};
+
+static const int base64Padding = -2;
+
+// a line holds 18 groups of 3 bytes, 72 characters
+
+static const size_t base64LineBytes = 54;
+
+#if defined(_WIN32) || defined(_WIN64)
+static const char base64Newline[] = "\r\n";
+#else
+static const char base64Newline[] = "\n";
+#endif
+
+static const size_t base64NewlineSize = sizeof(base64Newline) - 1;
+
+// Block codecs encode or decode as much of their input as whole vectors
+// allow and return how much they consumed, leaving the rest to the scalar
+// code.  Decoding stops at the first vector holding anything outside the
+// alphabet.
+
+typedef size_t (*Base64EncodeBlocks)(char* output, const unsigned char* data, size_t size);
+typedef size_t (*Base64DecodeBlocks)(unsigned char* output, const char* text, size_t size);
+
+static char* encodeGroups(char* output, const unsigned char* data, size_t size)
+{
+	for(; size >= 3; size -= 3, data += 3)
+	{
+		uint32_t bits = (data[0] << 16) | (data[1] << 8) | data[2];
+		output[0] = base64Alphabet[bits >> 18];
+		output[1] = base64Alphabet[(bits >> 12) & 0x3f];
+		output[2] = base64Alphabet[(bits >> 6) & 0x3f];
+		output[3] = base64Alphabet[bits & 0x3f];
+		output += 4;
+	}
+
+	if(size > 0)
+	{
+		uint32_t bits = (data[0] << 16) | ((size == 2) ? (data[1] << 8) : 0);
+		output[0] = base64Alphabet[bits >> 18];
+		output[1] = base64Alphabet[(bits >> 12) & 0x3f];
+		output[2] = (size == 2) ? base64Alphabet[(bits >> 6) & 0x3f] : '=';
+		output[3] = '=';
+		output += 4;
+	}
+	return output;
+}
+
+#if defined(PLIST_BASE64_X86)
+
+// Vector codecs after Wojciech Muła and Daniel Lemire, "Faster Base64
+// Encoding and Decoding using AVX2 Instructions".  Encoding spreads each 3
+// bytes over 4 lanes, cuts out the 6 bit indices with two multiplies and
+// maps them to characters with a 16 entry shift table.  Decoding checks
+// and translates characters with nibble lookups, then packs the 6 bit
+// values back together with two multiply-adds.
+
+PLIST_TARGET("ssse3")
+static size_t encodeBlocksSSSE3(char* output, const unsigned char* data, size_t size)
+{
+	const __m128i spread = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+	const __m128i shifts = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+
+	size_t consumed = 0;
+
+	// 12 bytes are encoded from each 16 byte load
+	for(; consumed + 16 <= size; consumed += 12, output += 16)
+	{
+		__m128i in = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (data + consumed)), spread);
+		__m128i high = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+		__m128i low = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+		__m128i indices = _mm_or_si128(high, low);
+
+		__m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+		__m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+		range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+		__m128i chars = _mm_add_epi8(indices, _mm_shuffle_epi8(shifts, range));
+		_mm_storeu_si128((__m128i*) output, chars);
+	}
+	return consumed;
+}
+
+PLIST_TARGET("ssse3")
+static size_t decodeBlocksSSSE3(unsigned char* output, const char* text, size_t size)
+{
+	const __m128i lowValid = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+			0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+	const __m128i highValid = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+			0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m128i rolls = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	const __m128i nibble = _mm_set1_epi8(0x0f);
+
+	size_t consumed = 0;
+
+	// 16 characters decode to 12 bytes, stored with 4 bytes to spare
+	for(; consumed + 16 <= size; consumed += 16, output += 12)
+	{
+		__m128i in = _mm_loadu_si128((const __m128i*) (text + consumed));
+		__m128i high = _mm_and_si128(_mm_srli_epi32(in, 4), nibble);
+		__m128i invalid = _mm_and_si128(_mm_shuffle_epi8(lowValid, _mm_and_si128(in, nibble)),
+				_mm_shuffle_epi8(highValid, high));
+		if(_mm_movemask_epi8(_mm_cmpeq_epi8(invalid, _mm_setzero_si128())) != 0xffff)
+			break;
+
+		__m128i slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+		__m128i values = _mm_add_epi8(in, _mm_shuffle_epi8(rolls, _mm_add_epi8(slash, high)));
+
+		__m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+		merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+		_mm_storeu_si128((__m128i*) output, _mm_shuffle_epi8(merged, pack));
+	}
+	return consumed;
+}
+
+PLIST_TARGET("avx2")
+static size_t encodeBlocksAVX2(char* output, const unsigned char* data, size_t size)
+{
+	const __m256i spread = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+			10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+	const __m256i shifts = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+			'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+
+	size_t consumed = 0;
+
+	// 12 bytes into each 128 bit lane, the second load ends 28 bytes in
+	for(; consumed + 28 <= size; consumed += 24, output += 32)
+	{
+		__m256i in = _mm256_inserti128_si256(
+				_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*) (data + consumed))),
+				_mm_loadu_si128((const __m128i*) (data + consumed + 12)), 1);
+		in = _mm256_shuffle_epi8(in, spread);
+		__m256i high = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+		__m256i low = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+		__m256i indices = _mm256_or_si256(high, low);
+
+		__m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+		__m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+		range = _mm256_or_si256(range, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+		__m256i chars = _mm256_add_epi8(indices, _mm256_shuffle_epi8(shifts, range));
+		_mm256_storeu_si256((__m256i*) output, chars);
+	}
+	return consumed;
+}
+
+PLIST_TARGET("avx2")
+static size_t decodeBlocksAVX2(unsigned char* output, const char* text, size_t size)
+{
+	const __m256i lowValid = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+			0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+			0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+			0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+	const __m256i highValid = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+			0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+			0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+			0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m256i rolls = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+			0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+			2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+	const __m256i nibble = _mm256_set1_epi8(0x0f);
+
+	size_t consumed = 0;
+
+	// 32 characters decode to 24 bytes, stored with 8 bytes to spare
+	for(; consumed + 32 <= size; consumed += 32, output += 24)
+	{
+		__m256i in = _mm256_loadu_si256((const __m256i*) (text + consumed));
+		__m256i high = _mm256_and_si256(_mm256_srli_epi32(in, 4), nibble);
+		__m256i invalid = _mm256_and_si256(_mm256_shuffle_epi8(lowValid, _mm256_and_si256(in, nibble)),
+				_mm256_shuffle_epi8(highValid, high));
+		if(!_mm256_testz_si256(invalid, invalid))
+			break;
+
+		__m256i slash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+		__m256i values = _mm256_add_epi8(in, _mm256_shuffle_epi8(rolls, _mm256_add_epi8(slash, high)));
+
+		__m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+		merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+		merged = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(merged, pack), lanes);
+		_mm256_storeu_si256((__m256i*) output, merged);
+	}
+	return consumed;
+}
+
+static Base64Codec detectBase64Codec()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+	__cpuid(info, 1);
+	bool ssse3 = (info[2] & (1 << 9)) != 0;
+
+	// avx2 also needs the os to save ymm registers
+	bool avx2 = false;
+	if((maxLeaf >= 7) && (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6))
+	{
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+#else
+	__builtin_cpu_init();
+	bool ssse3 = __builtin_cpu_supports("ssse3") != 0;
+	bool avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+
+	if(avx2)
+		return Base64AVX2;
+	if(ssse3)
+		return Base64SSSE3;
+	return Base64Scalar;
+}
+
+#endif // PLIST_BASE64_X86
+
+Base64Codec base64BestCodec()
+{
+#if defined(PLIST_BASE64_X86)
+	static const Base64Codec codec = detectBase64Codec();
+	return codec;
+#else
+	return Base64Scalar;
+#endif
+}
+
+// codec clamped to what the cpu supports
+
+static Base64Codec supportedCodec(Base64Codec codec)
+{
+	Base64Codec best = base64BestCodec();
+	return (codec > best) ? best : codec;
+}
+
+size_t base64EncodedSize(size_t size)
+{
+	// every whole line is followed by a break, including a last one
+	size_t groups = size / 3;
+	return 4 * (groups + ((size % 3) ? 1 : 0)) + (size / base64LineBytes) * base64NewlineSize;
+}
+
+void base64Encode(char* output, const unsigned char* data, size_t size, Base64Codec codec)
+{
+	Base64EncodeBlocks blocks = 0;
+#if defined(PLIST_BASE64_X86)
+	switch(supportedCodec(codec))
+	{
+		case Base64AVX2:
+			blocks = encodeBlocksAVX2;
+			break;
+		case Base64SSSE3:
+			blocks = encodeBlocksSSSE3;
+			break;
+		default:
+			break;
+	}
+#endif
+
+	while(size > 0)
+	{
+		size_t lineSize = (size < base64LineBytes) ? size : base64LineBytes;
+
+		size_t encoded = blocks ? blocks(output, data, lineSize) : 0;
+		output = encodeGroups(output + encoded / 3 * 4, data + encoded, lineSize - encoded);
+
+		if(lineSize == base64LineBytes)
+		{
+			for(size_t i = 0; i < base64NewlineSize; ++i)
+				*output++ = base64Newline[i];
+		}
+
+		data += lineSize;
+		size -= lineSize;
+	}
+}
+
+size_t base64DecodeCapacity(size_t size)
+{
+	return size / 4 * 3 + 32;
+}
+
+size_t base64Decode(unsigned char* output, const char* text, size_t size, Base64Codec codec)
+{
+	Base64DecodeBlocks blocks = 0;
+#if defined(PLIST_BASE64_X86)
+	switch(supportedCodec(codec))
+	{
+		case Base64AVX2:
+			blocks = decodeBlocksAVX2;
+			break;
+		case Base64SSSE3:
+			blocks = decodeBlocksSSSE3;
+			break;
+		default:
+			break;
+	}
+#endif
+
+	unsigned char* out = output;
+	uint32_t bits = 0;
+	int pending = 0;
+	size_t position = 0;
+
+	while(position < size)
+	{
+		// vectors only start on a group boundary, which after a line break
+		// is right where the next line begins
+		if(blocks && (pending == 0))
+		{
+			size_t decoded = blocks(out, text + position, size - position);
+			out += decoded / 4 * 3;
+			position += decoded;
+			if(position == size)
+				break;
+		}
+
+		int value = base64Values[(unsigned char) text[position++]];
+		if(value >= 0)
+		{
+			bits = (bits << 6) | value;
+			if(++pending == 4)
+			{
+				out[0] = (unsigned char) (bits >> 16);
+				out[1] = (unsigned char) (bits >> 8);
+				out[2] = (unsigned char) bits;
+				out += 3;
+				bits = 0;
+				pending = 0;
+			}
+		}
+		else if(value == base64Padding)
+		{
+			// padding ends the data, completing a group of 2 or 3
+			if(pending == 2)
+				*out++ = (unsigned char) (bits >> 4);
+			else if(pending == 3)
+			{
+				*out++ = (unsigned char) (bits >> 10);
+				*out++ = (unsigned char) (bits >> 2);
+			}
+			break;
+		}
+	}
+
+	// an unfinished group at the end is dropped
+	return out - output;
+}
+
+} // namespace Plist
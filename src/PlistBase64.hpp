@@ -0,0 +1,71 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+// Base64 for xml <data> elements.  Internal, not part of the public
+// interface.
+//
+// Encoding writes 72 character lines like Apple's writer does; decoding
+// skips whitespace and anything else outside the alphabet, and stops at
+// the first padding character.  Both work on caller supplied memory.  On
+// x86 the bulk of the work is done 16 or 32 characters at a time with
+// SSSE3 or AVX2, picked at runtime, with a scalar codec everywhere else.
+
+#ifndef __PLIST_BASE64_H__
+#define __PLIST_BASE64_H__
+
+#include <cstddef>
+
+namespace Plist
+{
+		enum Base64Codec
+		{
+			Base64Scalar,
+			Base64SSSE3,
+			Base64AVX2
+		};
+
+		// fastest codec the cpu running this supports
+		Base64Codec base64BestCodec();
+
+		// encoded length of size bytes, line breaks included
+		size_t base64EncodedSize(size_t size);
+
+		// encodes size bytes into output, which must hold
+		// base64EncodedSize(size) chars
+		void base64Encode(char* output, const unsigned char* data, size_t size,
+				Base64Codec codec = base64BestCodec());
+
+		// room base64Decode needs for size chars of text, a little more
+		// than the decoded length since blocks are stored whole
+		size_t base64DecodeCapacity(size_t size);
+
+		// decodes size chars of text into output, which must hold
+		// base64DecodeCapacity(size) bytes.  Returns the decoded length.
+		size_t base64Decode(unsigned char* output, const char* text, size_t size,
+				Base64Codec codec = base64BestCodec());
+
+} // namespace Plist
+
+#endif
@@ -0,0 +1,300 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+#include "PlistBinaryView.hpp"
+#include "PlistHelpers.hpp"
+
+namespace Plist {
+
+BinaryPlistView::BinaryPlistView(const char* byteArray, int64_t size)
+{
+	const unsigned char* bytes = (const unsigned char*) byteArray;
+	if(!bytes || (size < 8) || (std::string((const char*) bytes, 8) != "bplist00"))
+		throw Error("Plist: BinaryPlistView requires a binary plist");
+
+	// only the trailer is read here, the offset table is read lazily.
+
+	PlistHelperData d;
+	initBinaryPlist(d, bytes, size);
+
+	_data = bytes;
+	_size = size;
+	_offsetTableOffset = d._offsetTableOffset;
+	_offsetByteSize = d._offsetByteSize;
+	_objRefSize = d._objRefSize;
+	_objectCount = d._refCount;
+	_objRef = 0;
+	_keyOrder = BinaryKeysUnchecked;
+}
+
+BinaryPlistView::BinaryPlistView(const BinaryPlistView& parent, int32_t objRef)
+	: _data(parent._data),
+	_size(parent._size),
+	_offsetTableOffset(parent._offsetTableOffset),
+	_offsetByteSize(parent._offsetByteSize),
+	_objRefSize(parent._objRefSize),
+	_objectCount(parent._objectCount),
+	_objRef(objRef),
+	_keyOrder(BinaryKeysUnchecked)
+{
+}
+
+BinaryPlistView::BinaryPlistView(const BinaryPlistView& other)
+	: _data(other._data),
+	_size(other._size),
+	_offsetTableOffset(other._offsetTableOffset),
+	_offsetByteSize(other._offsetByteSize),
+	_objRefSize(other._objRefSize),
+	_objectCount(other._objectCount),
+	_objRef(other._objRef),
+	_keyOrder(other.keyOrder())
+{
+}
+
+BinaryPlistView& BinaryPlistView::operator=(const BinaryPlistView& other)
+{
+	_data = other._data;
+	_size = other._size;
+	_offsetTableOffset = other._offsetTableOffset;
+	_offsetByteSize = other._offsetByteSize;
+	_objRefSize = other._objRefSize;
+	_objectCount = other._objectCount;
+	_objRef = other._objRef;
+	setKeyOrder(other.keyOrder());
+	return *this;
+}
+
+// the key order is only a cache, so relaxed accesses are enough: threads
+// racing to fill it store the same value
+
+int32_t BinaryPlistView::keyOrder() const
+{
+#if __cplusplus >= 201103L
+	return _keyOrder.load(std::memory_order_relaxed);
+#else
+	return _keyOrder;
+#endif
+}
+
+void BinaryPlistView::setKeyOrder(int32_t order) const
+{
+#if __cplusplus >= 201103L
+	_keyOrder.store(order, std::memory_order_relaxed);
+#else
+	_keyOrder = order;
+#endif
+}
+
+void BinaryPlistView::helperData(PlistHelperData& d) const
+{
+	d._data = _data;
+	d._dataSize = _size;
+	d._offsetTableOffset = _offsetTableOffset;
+	d._offsetByteSize = _offsetByteSize;
+	d._objRefSize = _objRefSize;
+	d._refCount = _objectCount;
+}
+
+unsigned char BinaryPlistView::header(const PlistHelperData& d) const
+{
+	return *getObjectBytes(d, getOffset(d, _objRef), 1);
+}
+
+int32_t BinaryPlistView::containerRefs(const PlistHelperData& d, unsigned char marker, int64_t& refStartPosition) const
+{
+	if((header(d) & 0xF0) != marker)
+		throw Error(marker == 0xD0 ? "Plist: BinaryPlistView object is not a dictionary" : "Plist: BinaryPlistView object is not an array");
+	return getContainerRefs(d, _objRef, refStartPosition);
+}
+
+BinaryPlistView::Type BinaryPlistView::type() const
+{
+	PlistHelperData d;
+	helperData(d);
+	unsigned char marker = header(d);
+	switch (marker & 0xF0)
+	{
+		case 0x00:
+			if((marker == 0x08) || (marker == 0x09))
+				return BooleanType;
+			break;
+		case 0x10:
+			return IntegerType;
+		case 0x20:
+			return RealType;
+		case 0x30:
+			return DateType;
+		case 0x40:
+			return DataType;
+		case 0x50:
+		case 0x60:
+			return StringType;
+		case 0xA0:
+			return ArrayType;
+		case 0xD0:
+			return DictionaryType;
+	}
+	throw Error("This type is not supported");
+}
+
+int32_t BinaryPlistView::count() const
+{
+	PlistHelperData d;
+	helperData(d);
+	unsigned char marker = header(d) & 0xF0;
+	int64_t refStartPosition;
+	if(marker == 0xA0)
+		return containerRefs(d, 0xA0, refStartPosition);
+	return containerRefs(d, 0xD0, refStartPosition) / 2;
+}
+
+BinaryPlistView BinaryPlistView::operator[](int32_t index) const
+{
+	PlistHelperData d;
+	helperData(d);
+	int64_t refStartPosition;
+	int32_t refCount = containerRefs(d, 0xA0, refStartPosition);
+	if((index < 0) || (index >= refCount))
+		throw Error("Plist: BinaryPlistView array index out of bounds");
+
+	return BinaryPlistView(*this, getRef(d, refStartPosition, index));
+}
+
+BinaryPlistView BinaryPlistView::operator[](const std::string& key) const
+{
+	BinaryPlistView value(*this);
+	if(!find(key, value))
+		throw Error("Plist: BinaryPlistView dictionary has no key " + key);
+	return value;
+}
+
+bool BinaryPlistView::find(const std::string& key, BinaryPlistView& value) const
+{
+	PlistHelperData d;
+	helperData(d);
+	int64_t refStartPosition;
+	int32_t entryCount = containerRefs(d, 0xD0, refStartPosition) / 2;
+
+	// keys are compared in place, no string is built.  The order of the
+	// keys is kept so only the first miss has to check it.
+
+	BinaryKeyOrder order = (BinaryKeyOrder) keyOrder();
+	int32_t index = findBinaryKey(d, refStartPosition, entryCount, key.data(), key.size(), order);
+	setKeyOrder(order);
+	if(index < 0)
+		return false;
+
+	value = BinaryPlistView(*this, getRef(d, refStartPosition, index + entryCount));
+	return true;
+}
+
+std::string BinaryPlistView::keyAt(int32_t index) const
+{
+	PlistHelperData d;
+	helperData(d);
+	int64_t refStartPosition;
+	int32_t entryCount = containerRefs(d, 0xD0, refStartPosition) / 2;
+	if((index < 0) || (index >= entryCount))
+		throw Error("Plist: BinaryPlistView dictionary index out of bounds");
+
+	return BinaryPlistView(*this, getRef(d, refStartPosition, index)).asString();
+}
+
+BinaryPlistView BinaryPlistView::valueAt(int32_t index) const
+{
+	PlistHelperData d;
+	helperData(d);
+	int64_t refStartPosition;
+	int32_t entryCount = containerRefs(d, 0xD0, refStartPosition) / 2;
+	if((index < 0) || (index >= entryCount))
+		throw Error("Plist: BinaryPlistView dictionary index out of bounds");
+
+	return BinaryPlistView(*this, getRef(d, refStartPosition, index + entryCount));
+}
+
+boost::any BinaryPlistView::decode() const
+{
+	PlistHelperData d;
+	helperData(d);
+	return parseBinary(d, _objRef);
+}
+
+string_type BinaryPlistView::asString() const
+{
+	PlistHelperData d;
+	helperData(d);
+	unsigned char marker = header(d) & 0xF0;
+	if(marker == 0x50)
+		return parseBinaryString(d, getOffset(d, _objRef));
+	else if(marker == 0x60)
+		return parseBinaryUnicode(d, getOffset(d, _objRef));
+	throw Error("Plist: BinaryPlistView object is not a string");
+}
+
+integer_type BinaryPlistView::asInteger() const
+{
+	PlistHelperData d;
+	helperData(d);
+	if((header(d) & 0xF0) != 0x10)
+		throw Error("Plist: BinaryPlistView object is not an integer");
+	int intByteCount;
+	return parseBinaryInt(d, getOffset(d, _objRef), intByteCount);
+}
+
+real_type BinaryPlistView::asReal() const
+{
+	PlistHelperData d;
+	helperData(d);
+	if((header(d) & 0xF0) != 0x20)
+		throw Error("Plist: BinaryPlistView object is not a real");
+	return parseBinaryReal(d, getOffset(d, _objRef));
+}
+
+boolean_type BinaryPlistView::asBoolean() const
+{
+	PlistHelperData d;
+	helperData(d);
+	return parseBinaryBool(d, getOffset(d, _objRef));
+}
+
+date_type BinaryPlistView::asDate() const
+{
+	PlistHelperData d;
+	helperData(d);
+	if((header(d) & 0xF0) != 0x30)
+		throw Error("Plist: BinaryPlistView object is not a date");
+	return parseBinaryDate(d, getOffset(d, _objRef));
+}
+
+data_type BinaryPlistView::asData() const
+{
+	PlistHelperData d;
+	helperData(d);
+	if((header(d) & 0xF0) != 0x40)
+		throw Error("Plist: BinaryPlistView object is not data");
+	return parseBinaryByteArray(d, getOffset(d, _objRef));
+}
+
+} // namespace Plist
@@ -0,0 +1,131 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+#ifndef __PLIST_BINARY_VIEW_H__
+#define __PLIST_BINARY_VIEW_H__
+
+#include "Plist.hpp"
+#if __cplusplus >= 201103L
+#include <atomic>
+#endif
+
+namespace Plist
+{
+		struct PlistHelperData;
+
+		// Read only, random access view of one object in a binary plist.
+		// Nothing is decoded up front; each access reads only the objects it
+		// touches, so pulling a few values out of a large plist costs
+		// O(path) instead of O(file).
+		//
+		// The view doesn't own the plist bytes, they must outlive the view and
+		// every view obtained from it.
+		//
+		// A const view may be shared between threads.  find() remembers
+		// whether a dictionary's keys are sorted; from C++11 on that is kept
+		// in an atomic, before it, calling find() on the same view from
+		// several threads at once isn't safe.
+
+		class BinaryPlistView
+		{
+			public:
+
+				enum Type
+				{
+					BooleanType,
+					IntegerType,
+					RealType,
+					DateType,
+					DataType,
+					StringType,
+					ArrayType,
+					DictionaryType
+				};
+
+				// view of the root object
+				BinaryPlistView(const char* byteArray, int64_t size);
+
+				BinaryPlistView(const BinaryPlistView& other);
+				BinaryPlistView& operator=(const BinaryPlistView& other);
+
+				Type type() const;
+
+				// number of elements in an array or dictionary
+				int32_t count() const;
+
+				// array element at index
+				BinaryPlistView operator[](int32_t index) const;
+
+				// dictionary value for key, throws Plist::Error if key is missing
+				BinaryPlistView operator[](const std::string& key) const;
+
+				// dictionary lookup.  Uses binary search since dictionaries
+				// written by this library are in key order.  The first miss
+				// checks that the keys really are sorted and remembers it;
+				// only plists whose keys aren't get a linear scan.
+				bool find(const std::string& key, BinaryPlistView& value) const;
+
+				// dictionary entries by position
+				std::string keyAt(int32_t index) const;
+				BinaryPlistView valueAt(int32_t index) const;
+
+				// decode this object and everything below it
+				boost::any decode() const;
+
+				string_type asString() const;
+				integer_type asInteger() const;
+				real_type asReal() const;
+				boolean_type asBoolean() const;
+				date_type asDate() const;
+				data_type asData() const;
+
+			private:
+
+				BinaryPlistView(const BinaryPlistView& parent, int32_t objRef);
+
+				int32_t keyOrder() const;
+				void setKeyOrder(int32_t order) const;
+				void helperData(PlistHelperData& d) const;
+				unsigned char header(const PlistHelperData& d) const;
+				int32_t containerRefs(const PlistHelperData& d, unsigned char marker, int64_t& refStartPosition) const;
+
+				const unsigned char* _data;
+				int64_t _size;
+				int64_t _offsetTableOffset;
+				int32_t _offsetByteSize;
+				int32_t _objRefSize;
+				int32_t _objectCount;
+				int32_t _objRef;
+
+				// BinaryKeyOrder of a dictionary, once find() has missed
+#if __cplusplus >= 201103L
+				mutable std::atomic<int32_t> _keyOrder;
+#else
+				mutable int32_t _keyOrder;
+#endif
+		};
+};
+
+#endif
@@ -29,14 +29,70 @@
 #include "Plist.hpp" // Plist::Error
 #include <stdexcept>
 #include <stdio.h>
+#include <string.h>
 
 namespace Plist {
 
+// Days since 01-01-1970 of a proleptic gregorian date and back, by plain
+// arithmetic (see Howard Hinnant's chrono-compatible date algorithms).
+// Converting utc dates this way needs no libc time calls, which take the
+// timezone lock and so serialize date-heavy plists across threads.
+
+static int64_t daysFromCivil(int64_t year, int month, int day)
+{
+	year -= (month <= 2);
+	int64_t era = (year >= 0 ? year : year - 399) / 400;
+	int64_t yearOfEra = year - era * 400;
+	int64_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+	return era * 146097 + dayOfEra - 719468;
+}
+
+static void civilFromDays(int64_t days, int64_t& year, int& month, int& day)
+{
+	days += 719468;
+	int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+	int64_t dayOfEra = days - era * 146097;
+	int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+	int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+	int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+	day = (int) (dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+	month = (int) (monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+	year = yearOfEra + era * 400 + (month <= 2);
+}
+
+// count decimal digits at text, false if any isn't a digit
+
+static bool parseDigits(const char* text, int count, int& value)
+{
+	value = 0;
+	for(int i = 0; i < count; ++i)
+	{
+		if(text[i] < '0' || text[i] > '9')
+			return false;
+		value = value * 10 + (text[i] - '0');
+	}
+	return true;
+}
+
+static void formatDigits(char* text, int count, int value)
+{
+	for(int i = count - 1; i >= 0; --i)
+	{
+		text[i] = (char) ('0' + value % 10);
+		value /= 10;
+	}
+}
+
 Date::Date()
 {
 	setToCurrentTime();
 }
 
+Date::Date(Uninitialized)
+{
+}
+
 Date::Date(int month, int day, int year, int hour24, int minute, int second, bool UTC)
 {
 	set(month, day, year, hour24, minute, second, UTC);
@@ -44,46 +100,33 @@ Date::Date(int month, int day, int year, int hour24, int minute, int second, boo
 
 void Date::set(int month, int day, int year, int hour24, int minute, int second, bool UTC)
 {
-	struct tm tmTime;
-	tmTime.tm_hour = hour24;
-	tmTime.tm_mday = day;
-	tmTime.tm_year = year - 1900;
-	tmTime.tm_sec = second;
-	tmTime.tm_mon = month - 1;
-	tmTime.tm_min = minute;
-
-	//get proper day light savings.
-
-	time_t loc = time(NULL);
-	struct tm tmLoc = *localtime(&loc);
-	//std::cout<<"tmLoc.tm_isdst = "<<tmLoc.tm_isdst<<std::endl;
-	tmTime.tm_isdst = tmLoc.tm_isdst;
-
 	if(UTC)
 	{
-		//_time = timegm(&tmTime);
-
-		tmTime.tm_isdst = 0;
-		_time = mktime(&tmTime);
-		if(_time < -1)
-			throw Error("Plist::Date::set() date invalid");
-
-		// don't have timegm for all systems so here's a portable way to do it.
+		// months outside 1 to 12 carry into the year and days outside the
+		// month carry into the next, as mktime would normalize them
 
-		struct tm tmTimeTemp;
-#if defined(_WIN32) || defined(_WIN64)
-		gmtime_s(&tmTimeTemp, &_time);
-#else
-		gmtime_r(&_time, &tmTimeTemp);
-#endif
-
-		time_t timeTemp = mktime(&tmTimeTemp);
-
-		time_t diff = _time - timeTemp;
-		_time += diff;
+		int64_t monthIndex = month - 1;
+		int64_t yearCarry = (monthIndex >= 0 ? monthIndex : monthIndex - 11) / 12;
+		int64_t days = daysFromCivil(year + yearCarry, (int) (monthIndex - yearCarry * 12) + 1, 1) + day - 1;
+		_time = (time_t) (days * 86400 + (int64_t) hour24 * 3600 + (int64_t) minute * 60 + second);
 	}
 	else
 	{
+		struct tm tmTime;
+		tmTime.tm_hour = hour24;
+		tmTime.tm_mday = day;
+		tmTime.tm_year = year - 1900;
+		tmTime.tm_sec = second;
+		tmTime.tm_mon = month - 1;
+		tmTime.tm_min = minute;
+
+		//get proper day light savings.
+
+		time_t loc = time(NULL);
+		struct tm tmLoc = *localtime(&loc);
+		//std::cout<<"tmLoc.tm_isdst = "<<tmLoc.tm_isdst<<std::endl;
+		tmTime.tm_isdst = tmLoc.tm_isdst;
+
 		_time = mktime(&tmTime);
 		if(_time < -1)
 			throw Error("Plist::Date::set() date invalid");
@@ -141,19 +184,49 @@ bool Date::operator == (const Date& rhs) const
 		// iso 8601 date string convention
 std::string Date::timeAsXMLConvention() const
 {
-	char result[21];
-	struct tm tmTime;
+	char result[XMLConventionBufferSize];
+	size_t size = timeAsXMLConvention(result);
+	return std::string(result, size);
+}
 
-	// use thread safe versions here.  Notice that arguments
-	// are reversed for windows version
+size_t Date::timeAsXMLConvention(char* buffer) const
+{
+	int64_t days = (int64_t) _time / 86400;
+	int64_t secondOfDay = (int64_t) _time - days * 86400;
+	if(secondOfDay < 0)
+	{
+		--days;
+		secondOfDay += 86400;
+	}
+
+	int64_t year;
+	int month, day;
+	civilFromDays(days, year, month, day);
+
+	if(year < 1000 || year > 9999)
+	{
+		struct tm tmTime;
+
+		// use thread safe versions here.  Notice that arguments
+		// are reversed for windows version
 #if defined(_WIN32) || defined(_WIN64)
-	gmtime_s(&tmTime, &_time);
+		gmtime_s(&tmTime, &_time);
 #else
-	gmtime_r(&_time, &tmTime);
+		gmtime_r(&_time, &tmTime);
 #endif
-	// %F and %T not portable so using %Y-%m-%d and %H:%M:%S instead
-	strftime(&result[0], 21, "%Y-%m-%dT%H:%M:%SZ", &tmTime);
-	return std::string(&result[0]);
+		// %F and %T not portable so using %Y-%m-%d and %H:%M:%S instead
+		return strftime(buffer, XMLConventionBufferSize, "%Y-%m-%dT%H:%M:%SZ", &tmTime);
+	}
+
+	// e.g. 2011-09-25T02:31:04Z
+	memcpy(buffer, "0000-00-00T00:00:00Z", 20);
+	formatDigits(buffer, 4, (int) year);
+	formatDigits(buffer + 5, 2, month);
+	formatDigits(buffer + 8, 2, day);
+	formatDigits(buffer + 11, 2, (int) (secondOfDay / 3600));
+	formatDigits(buffer + 14, 2, (int) (secondOfDay / 60 % 60));
+	formatDigits(buffer + 17, 2, (int) (secondOfDay % 60));
+	return 20;
 }
 
 // iso 8601 date string convention
@@ -162,7 +235,23 @@ void Date::setTimeFromXMLConvention(const std::string& timeString)
 	int month, day, year, hour24, minute, second;
 
 	// parse date string.  E.g.  2011-09-25T02:31:04Z
-	sscanf(timeString.c_str(), "%4d-%2d-%2dT%2d:%2d:%2dZ", &year, &month, &day, &hour24, &minute, &second);
+	const char* text = timeString.c_str();
+	if(timeString.size() == 20
+			&& text[4] == '-' && text[7] == '-' && text[10] == 'T'
+			&& text[13] == ':' && text[16] == ':' && text[19] == 'Z'
+			&& parseDigits(text, 4, year)
+			&& parseDigits(text + 5, 2, month)
+			&& parseDigits(text + 8, 2, day)
+			&& parseDigits(text + 11, 2, hour24)
+			&& parseDigits(text + 14, 2, minute)
+			&& parseDigits(text + 17, 2, second))
+	{
+		set(month, day, year, hour24, minute, second, true);
+		return;
+	}
+
+	// anything looser goes through sscanf as it always has
+	sscanf(text, "%4d-%2d-%2dT%2d:%2d:%2dZ", &year, &month, &day, &hour24, &minute, &second);
 	set(month, day, year, hour24, minute, second, true);
 
 }
@@ -37,6 +37,11 @@ class Date
 	public:
 		Date();
 
+		// leaves the time unset, for callers about to set it.  Skips the
+		// clock read the default constructor does.
+		enum Uninitialized { uninitialized };
+		explicit Date(Uninitialized);
+
 		Date(int month, int day, int year, int hour24, int minute, int second, bool UTC);
 
 		void set(int month, int day, int year, int hour24, int minute, int second, bool UTC);
@@ -60,6 +65,11 @@ class Date
 		// iso 8601 date string convention
 		std::string timeAsXMLConvention() const;
 
+		// as above into buffer, which must hold XMLConventionBufferSize
+		// chars.  Returns the length, 20 for years 1000 to 9999.
+		enum { XMLConventionBufferSize = 32 };
+		size_t timeAsXMLConvention(char* buffer) const;
+
 		// iso 8601 date string convention
 		void setTimeFromXMLConvention(const std::string& timeString);
 
@@ -0,0 +1,733 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+
+#ifndef __PLIST_DICTIONARY_H__
+#define __PLIST_DICTIONARY_H__
+
+#include "Plist.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+namespace Plist
+{
+		// Dictionary containers to read plists into instead of std::map,
+		// picked with a policy:
+		//
+		//		HashDictionaryPolicy       HashDictionary, open addressing,
+		//		                           O(1) lookup, no order
+		//		OrderedDictionaryPolicy    OrderedDictionary, keeps the
+		//		                           order keys were inserted (the
+		//		                           order found in the file)
+		//		FlatDictionaryPolicy       FlatDictionary, a vector sorted by
+		//		                           key, binary search lookup
+		//
+		//		Plist::HashDictionary<boost::any> dict;
+		//		Plist::readPlist("binaryExample1.plist", dict);
+		//
+		//		boost::any message;
+		//		Plist::readPlist<Plist::OrderedDictionaryPolicy>("binaryExample1.plist", message);
+		//
+		// Every dictionary in the plist is read into the policy's container.
+		// The writers accept any of them; dictionaries are written in their
+		// iteration order.
+		//
+		// The containers have the parts of the std::map interface plists
+		// need.  Entries are std::pair<std::string, T>; changing a key
+		// through an iterator isn't allowed.
+
+		// FNV-1a
+		inline uint64_t hashDictionaryKey(const char* bytes, size_t size)
+		{
+			uint64_t hash = 14695981039346656037ULL;
+			for(size_t i = 0; i < size; ++i)
+				hash = (hash ^ (unsigned char) bytes[i]) * 1099511628211ULL;
+			return hash;
+		}
+
+		// values are swapped into place rather than copied, copying a
+		// boost::any copies everything under it
+		inline void swapDictionaryValue(boost::any& first, boost::any& second)
+		{
+			first.swap(second);
+		}
+
+		template<typename T>
+		void swapDictionaryValue(T& first, T& second)
+		{
+			std::swap(first, second);
+		}
+
+		template<typename T>
+		void swapDictionaryEntry(std::pair<std::string, T>& first, std::pair<std::string, T>& second)
+		{
+			first.first.swap(second.first);
+			swapDictionaryValue(first.second, second.second);
+		}
+
+		// Open addressing hash map with linear probing.  Entries live in the
+		// slots, so iteration order is the slot order.
+
+		template<typename T>
+		class HashDictionary
+		{
+			private:
+
+				struct Slot
+				{
+					Slot()
+						: used(false), hash(0) { }
+
+					bool used;
+					uint64_t hash;
+					std::pair<std::string, T> entry;
+				};
+
+				template<typename SlotType, typename Entry>
+				class SlotIterator
+				{
+					public:
+
+						typedef std::forward_iterator_tag iterator_category;
+						typedef Entry value_type;
+						typedef std::ptrdiff_t difference_type;
+						typedef Entry* pointer;
+						typedef Entry& reference;
+
+						SlotIterator()
+							: _slot(0), _end(0) { }
+
+						SlotIterator(SlotType* slot, SlotType* end)
+							: _slot(slot), _end(end)
+						{
+							skipUnused();
+						}
+
+						// iterator to const_iterator
+						template<typename OtherSlot, typename OtherEntry>
+						SlotIterator(const SlotIterator<OtherSlot, OtherEntry>& other)
+							: _slot(other.slot()), _end(other.end()) { }
+
+						reference operator*() const { return _slot->entry; }
+						pointer operator->() const { return &_slot->entry; }
+
+						SlotIterator& operator++()
+						{
+							++_slot;
+							skipUnused();
+							return *this;
+						}
+
+						SlotIterator operator++(int)
+						{
+							SlotIterator previous = *this;
+							++*this;
+							return previous;
+						}
+
+						bool operator==(const SlotIterator& other) const { return _slot == other._slot; }
+						bool operator!=(const SlotIterator& other) const { return _slot != other._slot; }
+
+						SlotType* slot() const { return _slot; }
+						SlotType* end() const { return _end; }
+
+					private:
+
+						void skipUnused()
+						{
+							while((_slot != _end) && !_slot->used)
+								++_slot;
+						}
+
+						SlotType* _slot;
+						SlotType* _end;
+				};
+
+			public:
+
+				typedef std::string key_type;
+				typedef T mapped_type;
+				typedef std::pair<std::string, T> value_type;
+				typedef SlotIterator<Slot, value_type> iterator;
+				typedef SlotIterator<const Slot, const value_type> const_iterator;
+
+				HashDictionary()
+					: _size(0) { }
+
+				size_t size() const { return _size; }
+				bool empty() const { return _size == 0; }
+
+				void clear()
+				{
+					_slots.clear();
+					_size = 0;
+				}
+
+				// room for count entries without rehashing
+				void reserve(size_t count)
+				{
+					size_t capacity = 8;
+					while(4 * count > 3 * capacity)
+						capacity *= 2;
+					if(capacity > _slots.size())
+						rehash(capacity);
+				}
+
+				iterator begin() { return iterator(slots(), slots() + _slots.size()); }
+				iterator end() { return iterator(slots() + _slots.size(), slots() + _slots.size()); }
+				const_iterator begin() const { return const_iterator(slots(), slots() + _slots.size()); }
+				const_iterator end() const { return const_iterator(slots() + _slots.size(), slots() + _slots.size()); }
+
+				iterator find(const std::string& key)
+				{
+					size_t slot = findSlot(key);
+					return (slot == _slots.size()) ? end() : iterator(slots() + slot, slots() + _slots.size());
+				}
+
+				const_iterator find(const std::string& key) const
+				{
+					size_t slot = findSlot(key);
+					return (slot == _slots.size()) ? end() : const_iterator(slots() + slot, slots() + _slots.size());
+				}
+
+				size_t count(const std::string& key) const
+				{
+					return (findSlot(key) == _slots.size()) ? 0 : 1;
+				}
+
+				T& operator[](const std::string& key)
+				{
+					return insertSlot(key)->entry.second;
+				}
+
+				std::pair<iterator, bool> insert(const value_type& value)
+				{
+					size_t size = _size;
+					Slot* slot = insertSlot(value.first);
+					bool inserted = (_size != size);
+					if(inserted)
+						slot->entry.second = value.second;
+					return std::make_pair(iterator(slot, slots() + _slots.size()), inserted);
+				}
+
+				// removes key, returns the number of entries removed
+				size_t erase(const std::string& key)
+				{
+					size_t slot = findSlot(key);
+					if(slot == _slots.size())
+						return 0;
+
+					// backward shift, so no tombstones are left behind
+					size_t mask = _slots.size() - 1;
+					for(;;)
+					{
+						_slots[slot] = Slot();
+						size_t next = slot;
+						for(;;)
+						{
+							next = (next + 1) & mask;
+							if(!_slots[next].used)
+							{
+								--_size;
+								return 1;
+							}
+
+							size_t home = (size_t) _slots[next].hash & mask;
+							bool stays = (slot < next) ? ((home > slot) && (home <= next)) : ((home > slot) || (home <= next));
+							if(!stays)
+								break;
+						}
+
+						_slots[slot].used = true;
+						_slots[slot].hash = _slots[next].hash;
+						swapDictionaryEntry(_slots[slot].entry, _slots[next].entry);
+						slot = next;
+					}
+				}
+
+				void swap(HashDictionary& other)
+				{
+					_slots.swap(other._slots);
+					std::swap(_size, other._size);
+				}
+
+			private:
+
+				Slot* slots() { return _slots.empty() ? 0 : &_slots[0]; }
+				const Slot* slots() const { return _slots.empty() ? 0 : &_slots[0]; }
+
+				// slot holding key, _slots.size() if there is none
+				size_t findSlot(const std::string& key) const
+				{
+					if(_size == 0)
+						return _slots.size();
+
+					uint64_t hash = hashDictionaryKey(key.data(), key.size());
+					size_t mask = _slots.size() - 1;
+					for(size_t slot = (size_t) hash & mask; _slots[slot].used; slot = (slot + 1) & mask)
+						if((_slots[slot].hash == hash) && (_slots[slot].entry.first == key))
+							return slot;
+					return _slots.size();
+				}
+
+				Slot* insertSlot(const std::string& key)
+				{
+					// keep the load factor at or under 3/4
+					if(4 * (_size + 1) > 3 * _slots.size())
+						rehash(std::max((size_t) 8, 2 * _slots.size()));
+
+					uint64_t hash = hashDictionaryKey(key.data(), key.size());
+					size_t mask = _slots.size() - 1;
+					size_t slot = (size_t) hash & mask;
+					for(; _slots[slot].used; slot = (slot + 1) & mask)
+						if((_slots[slot].hash == hash) && (_slots[slot].entry.first == key))
+							return &_slots[slot];
+
+					_slots[slot].used = true;
+					_slots[slot].hash = hash;
+					_slots[slot].entry.first = key;
+					++_size;
+					return &_slots[slot];
+				}
+
+				void rehash(size_t capacity)
+				{
+					std::vector<Slot> old(capacity);
+					old.swap(_slots);
+
+					size_t mask = capacity - 1;
+					for(size_t i = 0; i < old.size(); ++i)
+					{
+						if(!old[i].used)
+							continue;
+
+						size_t slot = (size_t) old[i].hash & mask;
+						while(_slots[slot].used)
+							slot = (slot + 1) & mask;
+						_slots[slot].used = true;
+						_slots[slot].hash = old[i].hash;
+						swapDictionaryEntry(_slots[slot].entry, old[i].entry);
+					}
+				}
+
+				std::vector<Slot> _slots;
+				size_t _size;
+		};
+
+		// Entries in a vector in insertion order, found through an open
+		// addressing index.  Reading keeps the order keys have in the file.
+		// erase is linear.
+
+		template<typename T>
+		class OrderedDictionary
+		{
+			public:
+
+				typedef std::string key_type;
+				typedef T mapped_type;
+				typedef std::pair<std::string, T> value_type;
+				typedef typename std::vector<value_type>::iterator iterator;
+				typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+				size_t size() const { return _entries.size(); }
+				bool empty() const { return _entries.empty(); }
+
+				void clear()
+				{
+					_entries.clear();
+					_index.clear();
+				}
+
+				void reserve(size_t count)
+				{
+					_entries.reserve(count);
+					size_t capacity = 8;
+					while(capacity < 2 * count)
+						capacity *= 2;
+					if(capacity > _index.size())
+						reindex(capacity);
+				}
+
+				iterator begin() { return _entries.begin(); }
+				iterator end() { return _entries.end(); }
+				const_iterator begin() const { return _entries.begin(); }
+				const_iterator end() const { return _entries.end(); }
+
+				iterator find(const std::string& key)
+				{
+					size_t entry = findEntry(key);
+					return (entry == _entries.size()) ? end() : begin() + entry;
+				}
+
+				const_iterator find(const std::string& key) const
+				{
+					size_t entry = findEntry(key);
+					return (entry == _entries.size()) ? end() : begin() + entry;
+				}
+
+				size_t count(const std::string& key) const
+				{
+					return (findEntry(key) == _entries.size()) ? 0 : 1;
+				}
+
+				T& operator[](const std::string& key)
+				{
+					return _entries[insertEntry(key)].second;
+				}
+
+				std::pair<iterator, bool> insert(const value_type& value)
+				{
+					size_t size = _entries.size();
+					size_t entry = insertEntry(value.first);
+					bool inserted = (_entries.size() != size);
+					if(inserted)
+						_entries[entry].second = value.second;
+					return std::make_pair(begin() + entry, inserted);
+				}
+
+				size_t erase(const std::string& key)
+				{
+					size_t entry = findEntry(key);
+					if(entry == _entries.size())
+						return 0;
+
+					for(size_t i = entry; i + 1 < _entries.size(); ++i)
+						swapDictionaryEntry(_entries[i], _entries[i + 1]);
+					_entries.pop_back();
+					reindex(_index.size());
+					return 1;
+				}
+
+				void swap(OrderedDictionary& other)
+				{
+					_entries.swap(other._entries);
+					_index.swap(other._index);
+				}
+
+			private:
+
+				// index slot, entry is the entry's position + 1, 0 when the
+				// slot is empty
+				struct Slot
+				{
+					uint32_t entry;
+					uint32_t hash;
+				};
+
+				size_t findEntry(const std::string& key) const
+				{
+					if(_entries.empty())
+						return _entries.size();
+
+					uint64_t hash = hashDictionaryKey(key.data(), key.size());
+					size_t mask = _index.size() - 1;
+					for(size_t slot = (size_t) hash & mask; _index[slot].entry; slot = (slot + 1) & mask)
+						if((_index[slot].hash == (uint32_t) hash) && (_entries[_index[slot].entry - 1].first == key))
+							return _index[slot].entry - 1;
+					return _entries.size();
+				}
+
+				size_t insertEntry(const std::string& key)
+				{
+					if(2 * (_entries.size() + 1) > _index.size())
+						reindex(std::max((size_t) 8, 2 * _index.size()));
+
+					uint64_t hash = hashDictionaryKey(key.data(), key.size());
+					size_t mask = _index.size() - 1;
+					size_t slot = (size_t) hash & mask;
+					for(; _index[slot].entry; slot = (slot + 1) & mask)
+						if((_index[slot].hash == (uint32_t) hash) && (_entries[_index[slot].entry - 1].first == key))
+							return _index[slot].entry - 1;
+
+					_entries.push_back(value_type(key, T()));
+					_index[slot].entry = (uint32_t) _entries.size();
+					_index[slot].hash = (uint32_t) hash;
+					return _entries.size() - 1;
+				}
+
+				void reindex(size_t capacity)
+				{
+					Slot empty = { 0, 0 };
+					_index.assign(capacity, empty);
+
+					size_t mask = capacity - 1;
+					for(size_t i = 0; i < _entries.size(); ++i)
+					{
+						uint64_t hash = hashDictionaryKey(_entries[i].first.data(), _entries[i].first.size());
+						size_t slot = (size_t) hash & mask;
+						while(_index[slot].entry)
+							slot = (slot + 1) & mask;
+						_index[slot].entry = (uint32_t) i + 1;
+						_index[slot].hash = (uint32_t) hash;
+					}
+				}
+
+				std::vector<value_type> _entries;
+				std::vector<Slot> _index;
+		};
+
+		// Entries in a vector sorted by key.  Lookup is a binary search and
+		// iteration is in key order, like std::map, without a node per
+		// entry.  Inserting anywhere but the end is linear; to load many
+		// entries append() them and sort() once.
+
+		template<typename T>
+		class FlatDictionary
+		{
+			public:
+
+				typedef std::string key_type;
+				typedef T mapped_type;
+				typedef std::pair<std::string, T> value_type;
+				typedef typename std::vector<value_type>::iterator iterator;
+				typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+				size_t size() const { return _entries.size(); }
+				bool empty() const { return _entries.empty(); }
+				void clear() { _entries.clear(); }
+				void reserve(size_t count) { _entries.reserve(count); }
+
+				iterator begin() { return _entries.begin(); }
+				iterator end() { return _entries.end(); }
+				const_iterator begin() const { return _entries.begin(); }
+				const_iterator end() const { return _entries.end(); }
+
+				iterator find(const std::string& key)
+				{
+					iterator it = lowerBound(key);
+					return ((it != end()) && (it->first == key)) ? it : end();
+				}
+
+				const_iterator find(const std::string& key) const
+				{
+					const_iterator it = std::lower_bound(begin(), end(), key, KeyLess());
+					return ((it != end()) && (it->first == key)) ? it : end();
+				}
+
+				size_t count(const std::string& key) const
+				{
+					return (find(key) == end()) ? 0 : 1;
+				}
+
+				T& operator[](const std::string& key)
+				{
+					return insert(value_type(key, T())).first->second;
+				}
+
+				std::pair<iterator, bool> insert(const value_type& value)
+				{
+					iterator it = lowerBound(value.first);
+					if((it != end()) && (it->first == value.first))
+						return std::make_pair(it, false);
+					return std::make_pair(_entries.insert(it, value), true);
+				}
+
+				size_t erase(const std::string& key)
+				{
+					iterator it = find(key);
+					if(it == end())
+						return 0;
+					_entries.erase(it);
+					return 1;
+				}
+
+				// adds key at the end without keeping the order, call sort()
+				// once done
+				T& append(const std::string& key)
+				{
+					_entries.push_back(value_type(key, T()));
+					return _entries.back().second;
+				}
+
+				// restores key order after append(), a repeated key keeps its
+				// last value
+				void sort()
+				{
+					bool sorted = true;
+					for(size_t i = 1; sorted && (i < _entries.size()); ++i)
+						sorted = _entries[i - 1].first < _entries[i].first;
+					if(sorted)
+						return;
+
+					// sort positions and swap the entries over, rather than
+					// copying values around
+					std::vector<size_t> order(_entries.size());
+					for(size_t i = 0; i < order.size(); ++i)
+						order[i] = i;
+					std::stable_sort(order.begin(), order.end(), PositionLess(_entries));
+
+					std::vector<value_type> entries(_entries.size());
+					size_t count = 0;
+					for(size_t i = 0; i < order.size(); ++i)
+					{
+						if((i + 1 < order.size()) && (_entries[order[i]].first == _entries[order[i + 1]].first))
+							continue;
+						swapDictionaryEntry(entries[count++], _entries[order[i]]);
+					}
+					entries.resize(count);
+					_entries.swap(entries);
+				}
+
+				void swap(FlatDictionary& other)
+				{
+					_entries.swap(other._entries);
+				}
+
+			private:
+
+				struct KeyLess
+				{
+					bool operator()(const value_type& entry, const std::string& key) const
+					{
+						return entry.first < key;
+					}
+				};
+
+				struct PositionLess
+				{
+					PositionLess(const std::vector<value_type>& entries)
+						: _entries(entries) { }
+
+					bool operator()(size_t first, size_t second) const
+					{
+						return _entries[first].first < _entries[second].first;
+					}
+
+					const std::vector<value_type>& _entries;
+				};
+
+				iterator lowerBound(const std::string& key)
+				{
+					// appending in key order is the common case
+					if(_entries.empty() || (_entries.back().first < key))
+						return end();
+					return std::lower_bound(begin(), end(), key, KeyLess());
+				}
+
+				std::vector<value_type> _entries;
+		};
+
+		// found by swap() through argument dependent lookup, so moving a
+		// dictionary out of a boost::any doesn't copy it
+
+		template<typename T>
+		void swap(HashDictionary<T>& first, HashDictionary<T>& second)
+		{
+			first.swap(second);
+		}
+
+		template<typename T>
+		void swap(OrderedDictionary<T>& first, OrderedDictionary<T>& second)
+		{
+			first.swap(second);
+		}
+
+		template<typename T>
+		void swap(FlatDictionary<T>& first, FlatDictionary<T>& second)
+		{
+			first.swap(second);
+		}
+
+		// policies, see MapDictionaryPolicy in Plist.hpp
+
+		struct HashDictionaryPolicy
+		{
+			typedef HashDictionary<boost::any> dictionary_type;
+
+			static void reserve(dictionary_type& dictionary, size_t count)
+			{
+				dictionary.reserve(count);
+			}
+
+			static boost::any& insert(dictionary_type& dictionary, const std::string& key)
+			{
+				return dictionary[key];
+			}
+
+			static void finish(dictionary_type&) { }
+		};
+
+		struct OrderedDictionaryPolicy
+		{
+			typedef OrderedDictionary<boost::any> dictionary_type;
+
+			static void reserve(dictionary_type& dictionary, size_t count)
+			{
+				dictionary.reserve(count);
+			}
+
+			static boost::any& insert(dictionary_type& dictionary, const std::string& key)
+			{
+				return dictionary[key];
+			}
+
+			static void finish(dictionary_type&) { }
+		};
+
+		struct FlatDictionaryPolicy
+		{
+			typedef FlatDictionary<boost::any> dictionary_type;
+
+			static void reserve(dictionary_type& dictionary, size_t count)
+			{
+				dictionary.reserve(count);
+			}
+
+			// keys are appended as read and sorted once at the end
+			static boost::any& insert(dictionary_type& dictionary, const std::string& key)
+			{
+				return dictionary.append(key);
+			}
+
+			static void finish(dictionary_type& dictionary)
+			{
+				dictionary.sort();
+			}
+		};
+
+		// reading into one of these picks its policy
+
+		template<>
+		struct DictionaryPolicyFor<HashDictionary<boost::any> >
+		{
+			typedef HashDictionaryPolicy type;
+		};
+
+		template<>
+		struct DictionaryPolicyFor<OrderedDictionary<boost::any> >
+		{
+			typedef OrderedDictionaryPolicy type;
+		};
+
+		template<>
+		struct DictionaryPolicyFor<FlatDictionary<boost::any> >
+		{
+			typedef FlatDictionaryPolicy type;
+		};
+};
+
+#endif
@@ -0,0 +1,806 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+
+#include "PlistDocument.hpp"
+#include "PlistBase64.hpp"
+#include "PlistHelpers.hpp"
+#include "pugixml.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace Plist {
+
+// One node of a Document.  Strings and data keep their pool offset in
+// first, containers the index of their first child.  A dictionary of count
+// entries has its keys, as string nodes in key order, at first and the
+// matching values at first + count.
+
+struct DocumentNode
+{
+	uint32_t type;
+	uint32_t count;
+	union
+	{
+		int64_t integer;
+		double real;
+		int64_t date;				// seconds since 01-01-1970
+		uint64_t first;
+	};
+};
+
+// dictionary key copied into the pool, waiting to be sorted.  source is
+// where its value comes from: an object ref, or an index into the pending
+// xml values.
+
+struct DocumentKey
+{
+	uint64_t offset;
+	uint32_t size;
+	size_t source;
+};
+
+// Builds a document in growable tables, then copies them into the single
+// block the document keeps.  Keys and pending xml values are stacks shared
+// by every dictionary, so parsing doesn't allocate per container.
+//
+// A binary object is built once however many containers refer to it.
+// Later refs copy its node, so a shared string keeps one copy of its bytes
+// in the pool and a shared container's node points at the same children.
+// The document grows by one node per ref in the plist rather than by the
+// size of the tree it stands for.
+
+class DocumentBuilder
+{
+	public:
+
+		// starts with the root node at index 0.  The document's block and
+		// the builder's tables come from resource, new when it is 0.
+		DocumentBuilder(size_t nodeEstimate, memory_resource* resource, const DecodeLimits& limits);
+
+		// binary objects are remembered by ref, call before buildBinary
+		void beginBinary(const PlistHelperData& d);
+
+		void buildBinary(const PlistHelperData& d, int objRef, uint32_t index);
+		void buildXML(pugi::xml_node& node, uint32_t index);
+		void finish(Document& document);
+
+		bool keyLess(const DocumentKey& first, const DocumentKey& second) const;
+
+	private:
+
+		uint32_t addNodes(size_t count);
+		void setInteger(uint32_t index, Document::Type type, int64_t value);
+		void setReal(uint32_t index, double value);
+		void setBytes(uint32_t index, Document::Type type, const char* bytes, size_t size);
+		void setContainer(uint32_t index, Document::Type type, size_t count, uint32_t first);
+		uint64_t appendBytes(const char* bytes, size_t size);
+		void addKey(const char* bytes, size_t size, size_t source);
+		size_t sortKeys(size_t base);
+		uint32_t addKeyNodes(uint32_t index, size_t base);
+
+		// _built values for objects not built yet, and for containers
+		// whose children are being built
+		enum
+		{
+			NotBuilt = 0xFFFFFFFF,
+			Building = 0xFFFFFFFE
+		};
+
+		memory_resource* _resource;
+		DecodeBudget _budget;
+		ScratchVector<DocumentNode>::type _nodes;
+		ScratchVector<char>::type _strings;
+		ScratchVector<DocumentKey>::type _keys;
+		ScratchVector<pugi::xml_node>::type _xmlValues;
+
+		// node each binary object was first built at, by ref
+		ScratchVector<uint32_t>::type _built;
+};
+
+// orders keys the way std::string does
+struct DocumentKeyLess
+{
+	const DocumentBuilder* builder;
+	bool operator()(const DocumentKey& first, const DocumentKey& second) const;
+};
+
+DocumentBuilder::DocumentBuilder(size_t nodeEstimate, memory_resource* resource, const DecodeLimits& limits)
+	: _resource(resource),
+	_budget(limits),
+	_nodes(scratchAllocator<DocumentNode>(resourceOrDefault(resource))),
+	_strings(scratchAllocator<char>(resourceOrDefault(resource))),
+	_keys(scratchAllocator<DocumentKey>(resourceOrDefault(resource))),
+	_xmlValues(scratchAllocator<pugi::xml_node>(resourceOrDefault(resource))),
+	_built(scratchAllocator<uint32_t>(resourceOrDefault(resource)))
+{
+	_nodes.reserve(nodeEstimate);
+	addNodes(1);
+}
+
+void DocumentBuilder::beginBinary(const PlistHelperData& d)
+{
+	_built.assign(d._refCount, (uint32_t) NotBuilt);
+}
+
+uint32_t DocumentBuilder::addNodes(size_t count)
+{
+	size_t first = _nodes.size();
+	if(count > std::numeric_limits<uint32_t>::max() - first)
+		throw Error("Plist: Document has too many nodes");
+
+	DocumentNode empty;
+	empty.type = Document::BooleanType;
+	empty.count = 0;
+	empty.integer = 0;
+	_nodes.resize(first + count, empty);
+	return (uint32_t) first;
+}
+
+void DocumentBuilder::setInteger(uint32_t index, Document::Type type, int64_t value)
+{
+	DocumentNode& node = _nodes[index];
+	node.type = type;
+	node.integer = value;
+}
+
+void DocumentBuilder::setReal(uint32_t index, double value)
+{
+	DocumentNode& node = _nodes[index];
+	node.type = Document::RealType;
+	node.real = value;
+}
+
+uint64_t DocumentBuilder::appendBytes(const char* bytes, size_t size)
+{
+	if(size > std::numeric_limits<uint32_t>::max())
+		throw Error("Plist: Document string or data larger than 4GB not supported");
+	_budget.addBytes(size);
+
+	uint64_t offset = _strings.size();
+	_strings.insert(_strings.end(), bytes, bytes + size);
+	return offset;
+}
+
+void DocumentBuilder::setBytes(uint32_t index, Document::Type type, const char* bytes, size_t size)
+{
+	uint64_t offset = appendBytes(bytes, size);
+
+	DocumentNode& node = _nodes[index];
+	node.type = type;
+	node.count = (uint32_t) size;
+	node.first = offset;
+}
+
+void DocumentBuilder::setContainer(uint32_t index, Document::Type type, size_t count, uint32_t first)
+{
+	DocumentNode& node = _nodes[index];
+	node.type = type;
+	node.count = (uint32_t) count;
+	node.first = first;
+}
+
+void DocumentBuilder::addKey(const char* bytes, size_t size, size_t source)
+{
+	DocumentKey key;
+	key.offset = appendBytes(bytes, size);
+	key.size = (uint32_t) size;
+	key.source = source;
+	_keys.push_back(key);
+}
+
+bool DocumentBuilder::keyLess(const DocumentKey& first, const DocumentKey& second) const
+{
+	const char* strings = _strings.empty() ? 0 : &_strings[0];
+	int result = memcmp(strings + first.offset, strings + second.offset, std::min(first.size, second.size));
+	return (result < 0) || ((result == 0) && (first.size < second.size));
+}
+
+bool DocumentKeyLess::operator()(const DocumentKey& first, const DocumentKey& second) const
+{
+	return builder->keyLess(first, second);
+}
+
+// Sorts the keys pushed since base and drops repeats, a repeated key keeps
+// its last value as reading into a map does.  Returns the number left.
+
+size_t DocumentBuilder::sortKeys(size_t base)
+{
+	ScratchVector<DocumentKey>::type::iterator begin = _keys.begin() + base;
+
+	// plists written by this library, and by CoreFoundation, are already
+	// in key order
+	bool sorted = true;
+	for(size_t i = base + 1; sorted && (i < _keys.size()); ++i)
+		sorted = keyLess(_keys[i - 1], _keys[i]);
+
+	if(!sorted)
+	{
+		DocumentKeyLess less = { this };
+		std::stable_sort(begin, _keys.end(), less);
+
+		size_t count = base;
+		for(size_t i = base; i < _keys.size(); ++i)
+			if((i + 1 == _keys.size()) || keyLess(_keys[i], _keys[i + 1]))
+				_keys[count++] = _keys[i];
+		_keys.resize(count);
+	}
+
+	return _keys.size() - base;
+}
+
+// lays out the dictionary at index from the keys pushed since base,
+// returns the index of its first value
+
+uint32_t DocumentBuilder::addKeyNodes(uint32_t index, size_t base)
+{
+	size_t count = sortKeys(base);
+	uint32_t first = addNodes(2 * count);
+	setContainer(index, Document::DictionaryType, count, first);
+
+	for(size_t i = 0; i < count; ++i)
+	{
+		DocumentNode& node = _nodes[first + i];
+		node.type = Document::StringType;
+		node.count = _keys[base + i].size;
+		node.first = _keys[base + i].offset;
+	}
+
+	return first + (uint32_t) count;
+}
+
+void DocumentBuilder::buildBinary(const PlistHelperData& d, int objRef, uint32_t index)
+{
+	int32_t offset = getOffset(d, objRef);
+	unsigned char header = *getObjectBytes(d, offset, 1);
+
+	_budget.addObject();
+	uint32_t& built = _built[objRef];
+	if(built == Building)
+		throw Error("Plist: binary plist object contains itself");
+	if(built != NotBuilt)
+	{
+		_nodes[index] = _nodes[built];
+		return;
+	}
+
+	switch (header & 0xF0)
+	{
+		case 0x00:
+			setInteger(index, Document::BooleanType, parseBinaryBool(d, offset));
+			break;
+		case 0x10:
+			{
+				int intByteCount;
+				setInteger(index, Document::IntegerType, parseBinaryInt(d, offset, intByteCount));
+				break;
+			}
+		case 0x20:
+			setReal(index, parseBinaryReal(d, offset));
+			break;
+		case 0x30:
+			setInteger(index, Document::DateType, parseBinaryDate(d, offset).timeAsEpoch());
+			break;
+		case 0x40:
+		case 0x50:
+			{
+				int startOffset;
+				int32_t count = getCount(d, offset, header, startOffset);
+				const char* bytes = (const char*) getObjectBytes(d, (int64_t) offset + startOffset, count);
+				setBytes(index, ((header & 0xF0) == 0x40) ? Document::DataType : Document::StringType, bytes, count);
+				break;
+			}
+		case 0x60:
+			{
+				std::string text = parseBinaryUnicode(d, offset);
+				setBytes(index, Document::StringType, text.data(), text.size());
+				break;
+			}
+		case 0xA0:
+			{
+				int64_t refStartPosition;
+				int32_t count = getContainerRefs(d, objRef, refStartPosition);
+				uint32_t first = addNodes(count);
+				setContainer(index, Document::ArrayType, count, first);
+
+				_built[objRef] = Building;
+				_budget.enter();
+				for(int32_t i = 0; i < count; ++i)
+					buildBinary(d, getRef(d, refStartPosition, i), first + i);
+				_budget.leave();
+				break;
+			}
+		case 0xD0:
+			{
+				int64_t refStartPosition;
+				int32_t count = getContainerRefs(d, objRef, refStartPosition) / 2;
+
+				size_t base = _keys.size();
+				for(int32_t i = 0; i < count; ++i)
+				{
+					int32_t keyOffset = getOffset(d, getRef(d, refStartPosition, i));
+					unsigned char keyHeader = *getObjectBytes(d, keyOffset, 1);
+					size_t valueRef = getRef(d, refStartPosition, i + count);
+
+					if((keyHeader & 0xF0) == 0x50)
+					{
+						int startOffset;
+						int32_t size = getCount(d, keyOffset, keyHeader, startOffset);
+						addKey((const char*) getObjectBytes(d, (int64_t) keyOffset + startOffset, size), size, valueRef);
+					}
+					else if((keyHeader & 0xF0) == 0x60)
+					{
+						std::string key = parseBinaryUnicode(d, keyOffset);
+						addKey(key.data(), key.size(), valueRef);
+					}
+					else
+						throw Error("Error parsing dictionary.  Key can't be parsed as a string");
+				}
+
+				uint32_t firstValue = addKeyNodes(index, base);
+
+				_built[objRef] = Building;
+				_budget.enter();
+				for(size_t i = 0; base + i < _keys.size(); ++i)
+					buildBinary(d, (int) _keys[base + i].source, firstValue + (uint32_t) i);
+				_budget.leave();
+				_keys.resize(base);
+				break;
+			}
+		default:
+			throw Error("This type is not supported");
+	}
+
+	_built[objRef] = index;
+}
+
+void DocumentBuilder::buildXML(pugi::xml_node& node, uint32_t index)
+{
+	using namespace std;
+
+	const char* nodeName = node.name();
+
+	_budget.addObject();
+	if(strcmp("dict", nodeName) == 0)
+	{
+		_budget.enter();
+		size_t base = _keys.size();
+		size_t valueBase = _xmlValues.size();
+		for(pugi::xml_node_iterator it = node.begin(); it != node.end(); ++it)
+		{
+			if(string("key") != it->name())
+				throw Error("Plist: XML dictionary key expected but not found");
+
+			string buffer;
+			const char* key = xmlNodeText(*it, buffer);
+			++it;
+
+			if(it == node.end())
+				throw Error("Plist: XML dictionary value expected for key " + string(key) + "but not found");
+			else if(string("key") == it->name())
+				throw Error("Plist: XML dictionary value expected for key " + string(key) + "but found another key node");
+
+			addKey(key, strlen(key), _xmlValues.size());
+			_xmlValues.push_back(*it);
+		}
+
+		uint32_t firstValue = addKeyNodes(index, base);
+		for(size_t i = 0; base + i < _keys.size(); ++i)
+		{
+			pugi::xml_node value = _xmlValues[_keys[base + i].source];
+			buildXML(value, firstValue + (uint32_t) i);
+		}
+		_keys.resize(base);
+		_xmlValues.resize(valueBase);
+		_budget.leave();
+	}
+	else if(strcmp("array", nodeName) == 0)
+	{
+		size_t count = 0;
+		for(pugi::xml_node_iterator it = node.begin(); it != node.end(); ++it)
+			++count;
+
+		uint32_t first = addNodes(count);
+		setContainer(index, Document::ArrayType, count, first);
+		_budget.enter();
+		for(pugi::xml_node_iterator it = node.begin(); it != node.end(); ++it)
+			buildXML(*it, first++);
+		_budget.leave();
+	}
+	else
+	{
+		string buffer;
+		const char* text = xmlNodeText(node, buffer);
+
+		if(strcmp("string", nodeName) == 0)
+			setBytes(index, Document::StringType, text, strlen(text));
+		else if(strcmp("integer", nodeName) == 0)
+			setInteger(index, Document::IntegerType, atoll(text));
+		else if(strcmp("real", nodeName) == 0)
+			setReal(index, atof(text));
+		else if(strcmp("false", nodeName) == 0)
+			setInteger(index, Document::BooleanType, 0);
+		else if(strcmp("true", nodeName) == 0)
+			setInteger(index, Document::BooleanType, 1);
+		else if(strcmp("data", nodeName) == 0)
+		{
+			// decoded straight into the pool
+			size_t size = strlen(text);
+			size_t offset = _strings.size();
+			_strings.resize(offset + base64DecodeCapacity(size));
+			size_t dataSize = base64Decode((unsigned char*) &_strings[offset], text, size);
+			_strings.resize(offset + dataSize);
+			if(dataSize > std::numeric_limits<uint32_t>::max())
+				throw Error("Plist: Document string or data larger than 4GB not supported");
+			_budget.addBytes(dataSize);
+
+			DocumentNode& data = _nodes[index];
+			data.type = Document::DataType;
+			data.count = (uint32_t) dataSize;
+			data.first = offset;
+		}
+		else if(strcmp("date", nodeName) == 0)
+		{
+			Date date(Date::uninitialized);
+			date.setTimeFromXMLConvention(text);
+			setInteger(index, Document::DateType, date.timeAsEpoch());
+		}
+		else
+			throw Error(string("Plist: XML unknown node type ") + nodeName);
+	}
+}
+
+// a document's block, from resource or new
+
+static char* allocateBlock(size_t size, memory_resource* resource)
+{
+#if defined(PLIST_HAS_PMR)
+	if(resource)
+		return (char*) resource->allocate(size, alignof(DocumentNode));
+#endif
+	return new char[size];
+}
+
+static void releaseBlock(char* block, size_t size, memory_resource* resource)
+{
+#if defined(PLIST_HAS_PMR)
+	if(resource)
+	{
+		resource->deallocate(block, size, alignof(DocumentNode));
+		return;
+	}
+#endif
+	delete[] block;
+}
+
+void DocumentBuilder::finish(Document& document)
+{
+	size_t nodesSize = _nodes.size() * sizeof(DocumentNode);
+	char* block = allocateBlock(nodesSize + _strings.size(), _resource);
+	memcpy(block, &_nodes[0], nodesSize);
+	if(!_strings.empty())
+		memcpy(block + nodesSize, &_strings[0], _strings.size());
+	document.adopt(block, _nodes.size(), _strings.size(), _resource);
+}
+
+void parseBinaryPlist(const PlistHelperData& d, DocumentMessage& message)
+{
+	DocumentBuilder builder(d._refCount, message.resource, message.limits);
+	builder.beginBinary(d);
+	builder.buildBinary(d, 0, 0);
+	builder.finish(message.document);
+}
+
+void parseXMLPlist(pugi::xml_node& rootNode, DocumentMessage& message)
+{
+	DocumentBuilder builder(1, message.resource, message.limits);
+	builder.buildXML(rootNode, 0);
+	builder.finish(message.document);
+}
+
+Document::Document()
+	: _resource(0), _block(0), _nodes(0), _strings(0), _nodeCount(0), _stringsSize(0)
+{
+}
+
+Document::Document(const char* byteArray, int64_t size)
+	: _resource(0), _block(0), _nodes(0), _strings(0), _nodeCount(0), _stringsSize(0)
+{
+	readPlist(byteArray, size, *this);
+}
+
+// a copy's block comes from new, as a std::pmr container's copy would
+// come from the default resource
+
+Document::Document(const Document& other)
+	: _resource(0), _block(0), _nodes(0), _strings(0), _nodeCount(0), _stringsSize(0)
+{
+	if(other._block)
+	{
+		char* block = new char[other.memoryUsed()];
+		memcpy(block, other._block, other.memoryUsed());
+		adopt(block, other._nodeCount, other._stringsSize, 0);
+	}
+}
+
+Document& Document::operator=(const Document& other)
+{
+	Document copy(other);
+	swap(copy);
+	return *this;
+}
+
+Document::~Document()
+{
+	if(_block)
+		releaseBlock(_block, memoryUsed(), _resource);
+}
+
+void Document::swap(Document& other)
+{
+	std::swap(_resource, other._resource);
+	std::swap(_block, other._block);
+	std::swap(_nodes, other._nodes);
+	std::swap(_strings, other._strings);
+	std::swap(_nodeCount, other._nodeCount);
+	std::swap(_stringsSize, other._stringsSize);
+}
+
+void Document::adopt(char* block, size_t nodeCount, size_t stringsSize, memory_resource* resource)
+{
+	if(_block)
+		releaseBlock(_block, memoryUsed(), _resource);
+	_resource = resource;
+	_block = block;
+	_nodes = (const DocumentNode*) block;
+	_strings = block + nodeCount * sizeof(DocumentNode);
+	_nodeCount = nodeCount;
+	_stringsSize = stringsSize;
+}
+
+bool Document::empty() const
+{
+	return _nodeCount == 0;
+}
+
+Document::Node Document::root() const
+{
+	if(empty())
+		throw Error("Plist: Document is empty");
+	return Node(this, 0);
+}
+
+size_t Document::memoryUsed() const
+{
+	return _nodeCount * sizeof(DocumentNode) + _stringsSize;
+}
+
+Document::Node::Node(const Document* document, uint32_t index)
+	: _document(document), _index(index)
+{
+}
+
+const DocumentNode& Document::Node::node() const
+{
+	return _document->_nodes[_index];
+}
+
+const DocumentNode& Document::Node::container(Type type) const
+{
+	const DocumentNode& current = node();
+	if(current.type != (uint32_t) type)
+		throw Error(type == DictionaryType ? "Plist: Document node is not a dictionary" : "Plist: Document node is not an array");
+	return current;
+}
+
+Document::Type Document::Node::type() const
+{
+	return (Type) node().type;
+}
+
+int32_t Document::Node::count() const
+{
+	if(node().type == ArrayType)
+		return node().count;
+	return container(DictionaryType).count;
+}
+
+Document::Node Document::Node::operator[](int32_t index) const
+{
+	const DocumentNode& array = container(ArrayType);
+	if((index < 0) || ((uint32_t) index >= array.count))
+		throw Error("Plist: Document array index out of bounds");
+	return Node(_document, (uint32_t) array.first + index);
+}
+
+Document::Node Document::Node::operator[](const std::string& key) const
+{
+	Node value(*this);
+	if(!find(key, value))
+		throw Error("Plist: Document dictionary has no key " + key);
+	return value;
+}
+
+bool Document::Node::find(const std::string& key, Node& value) const
+{
+	const DocumentNode& dictionary = container(DictionaryType);
+	const DocumentNode* keys = _document->_nodes + dictionary.first;
+
+	uint32_t low = 0;
+	uint32_t high = dictionary.count;
+	while(low < high)
+	{
+		uint32_t middle = low + (high - low) / 2;
+		const DocumentNode& candidate = keys[middle];
+		size_t size = std::min((size_t) candidate.count, key.size());
+		int result = memcmp(_document->_strings + candidate.first, key.data(), size);
+		if(result == 0)
+			result = (candidate.count < key.size()) ? -1 : ((candidate.count > key.size()) ? 1 : 0);
+
+		if(result == 0)
+		{
+			value = Node(_document, (uint32_t) dictionary.first + dictionary.count + middle);
+			return true;
+		}
+		else if(result < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return false;
+}
+
+std::string Document::Node::keyAt(int32_t index) const
+{
+	const DocumentNode& dictionary = container(DictionaryType);
+	if((index < 0) || ((uint32_t) index >= dictionary.count))
+		throw Error("Plist: Document dictionary index out of bounds");
+	return Node(_document, (uint32_t) dictionary.first + index).asString();
+}
+
+Document::Node Document::Node::valueAt(int32_t index) const
+{
+	const DocumentNode& dictionary = container(DictionaryType);
+	if((index < 0) || ((uint32_t) index >= dictionary.count))
+		throw Error("Plist: Document dictionary index out of bounds");
+	return Node(_document, (uint32_t) dictionary.first + dictionary.count + index);
+}
+
+const char* Document::Node::bytes() const
+{
+	const DocumentNode& current = node();
+	if((current.type != StringType) && (current.type != DataType))
+		throw Error("Plist: Document node is not a string or data");
+	return _document->_strings + current.first;
+}
+
+size_t Document::Node::byteCount() const
+{
+	bytes();
+	return node().count;
+}
+
+// Date has no unix epoch setter, go through the Apple epoch one
+static Date dateFromEpoch(int64_t seconds)
+{
+	Date date(Date::uninitialized);
+	date.setTimeFromAppleEpoch((double) (seconds - 978307200));
+	return date;
+}
+
+boost::any Document::Node::decode() const
+{
+	const DocumentNode& current = node();
+	switch(current.type)
+	{
+		case BooleanType:
+			return bool(current.integer != 0);
+		case IntegerType:
+			return current.integer;
+		case RealType:
+			return current.real;
+		case DateType:
+			return dateFromEpoch(current.date);
+		case DataType:
+			return asData();
+		case StringType:
+			return asString();
+		case ArrayType:
+			{
+				array_type array(current.count);
+				for(uint32_t i = 0; i < current.count; ++i)
+					array[i] = Node(_document, (uint32_t) current.first + i).decode();
+				return array;
+			}
+		case DictionaryType:
+			{
+				// keys are in order, so each insert goes at the end
+				dictionary_type dictionary;
+				for(uint32_t i = 0; i < current.count; ++i)
+				{
+					boost::any value = Node(_document, (uint32_t) current.first + current.count + i).decode();
+					dictionary_type::iterator it = dictionary.insert(dictionary.end(),
+							std::make_pair(Node(_document, (uint32_t) current.first + i).asString(), boost::any()));
+					it->second.swap(value);
+				}
+				return dictionary;
+			}
+	}
+	throw Error("This type is not supported");
+}
+
+string_type Document::Node::asString() const
+{
+	const DocumentNode& current = node();
+	if(current.type != StringType)
+		throw Error("Plist: Document node is not a string");
+	return std::string(_document->_strings + current.first, current.count);
+}
+
+integer_type Document::Node::asInteger() const
+{
+	const DocumentNode& current = node();
+	if(current.type != IntegerType)
+		throw Error("Plist: Document node is not an integer");
+	return current.integer;
+}
+
+real_type Document::Node::asReal() const
+{
+	const DocumentNode& current = node();
+	if(current.type != RealType)
+		throw Error("Plist: Document node is not a real");
+	return current.real;
+}
+
+boolean_type Document::Node::asBoolean() const
+{
+	const DocumentNode& current = node();
+	if(current.type != BooleanType)
+		throw Error("Plist: Document node is not a boolean");
+	return current.integer != 0;
+}
+
+date_type Document::Node::asDate() const
+{
+	const DocumentNode& current = node();
+	if(current.type != DateType)
+		throw Error("Plist: Document node is not a date");
+	return dateFromEpoch(current.date);
+}
+
+data_type Document::Node::asData() const
+{
+	const DocumentNode& current = node();
+	if(current.type != DataType)
+		throw Error("Plist: Document node is not data");
+	const char* bytes = _document->_strings + current.first;
+	return data_type(bytes, bytes + current.count);
+}
+
+} // namespace Plist
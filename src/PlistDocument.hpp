@@ -0,0 +1,184 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+
+#ifndef __PLIST_DOCUMENT_H__
+#define __PLIST_DOCUMENT_H__
+
+#include "Plist.hpp"
+
+namespace Plist
+{
+		struct DocumentNode;
+
+		// A parsed plist held in one contiguous block instead of a tree of
+		// individually allocated strings, maps, vectors and boost::any
+		// holders.  Nodes sit in a flat array with each container's children
+		// next to each other, a dictionary's keys sorted ahead of its values,
+		// and string and data bytes are (offset, length) into a string pool
+		// at the end of the block.  Freeing a document is one deallocation.
+		//
+		//		Plist::Document document;
+		//		Plist::readPlist("binaryExample1.plist", document);
+		//		std::string name = document.root()["testString"].asString();
+		//
+		// Nodes refer into their document and are invalidated when it is
+		// destroyed or reassigned.
+		//
+		// An object a binary plist refers to from several places is built
+		// once and shared by every node that refers to it, so a document
+		// takes space in proportion to the plist, not to the tree it
+		// decodes to.  Node::decode() expands shared objects into copies.
+
+		class Document
+		{
+			public:
+
+				enum Type
+				{
+					BooleanType,
+					IntegerType,
+					RealType,
+					DateType,
+					DataType,
+					StringType,
+					ArrayType,
+					DictionaryType
+				};
+
+				class Node
+				{
+					public:
+
+						Type type() const;
+
+						// number of elements in an array or dictionary
+						int32_t count() const;
+
+						// array element at index
+						Node operator[](int32_t index) const;
+
+						// dictionary value for key, throws Plist::Error if key
+						// is missing
+						Node operator[](const std::string& key) const;
+
+						// dictionary lookup by binary search, keys are sorted
+						bool find(const std::string& key, Node& value) const;
+
+						// dictionary entries by position, in key order
+						std::string keyAt(int32_t index) const;
+						Node valueAt(int32_t index) const;
+
+						// string or data bytes in the string pool, not nul
+						// terminated
+						const char* bytes() const;
+						size_t byteCount() const;
+
+						// decode this node and everything below it
+						boost::any decode() const;
+
+						string_type asString() const;
+						integer_type asInteger() const;
+						real_type asReal() const;
+						boolean_type asBoolean() const;
+						date_type asDate() const;
+						data_type asData() const;
+
+					private:
+
+						friend class Document;
+
+						Node(const Document* document, uint32_t index);
+
+						const DocumentNode& node() const;
+						const DocumentNode& container(Type type) const;
+
+						const Document* _document;
+						uint32_t _index;
+				};
+
+				// empty document, see readPlist
+				Document();
+
+				// parses a plist in either format
+				Document(const char* byteArray, int64_t size);
+
+				// copying copies the block, there is nothing else to copy
+				Document(const Document& other);
+				Document& operator=(const Document& other);
+				~Document();
+
+				void swap(Document& other);
+
+				bool empty() const;
+
+				// throws Plist::Error if the document is empty
+				Node root() const;
+
+				// size of the block holding the document
+				size_t memoryUsed() const;
+
+			private:
+
+				friend class DocumentBuilder;
+
+				void adopt(char* block, size_t nodeCount, size_t stringsSize, memory_resource* resource);
+
+				// resource _block came from, 0 when it came from new
+				memory_resource* _resource;
+				char* _block;
+				const DocumentNode* _nodes;
+				const char* _strings;
+				size_t _nodeCount;
+				size_t _stringsSize;
+		};
+
+		// Read methods for Document, the same as their boost::any
+		// counterparts in Plist.hpp.
+
+		void readPlist(const char* byteArray, int64_t size, Document& document);
+		void readPlist(std::istream& stream, Document& document);
+		void readPlist(const char* filename, Document& document);
+
+		// with limits on what is built, see DecodeLimits in Plist.hpp.  A
+		// shared object counts once for its bytes and once per ref for
+		// objects.
+
+		void readPlist(const char* byteArray, int64_t size, Document& document, const DecodeLimits& limits);
+		void readPlist(std::istream& stream, Document& document, const DecodeLimits& limits);
+		void readPlist(const char* filename, Document& document, const DecodeLimits& limits);
+
+#if defined(PLIST_HAS_PMR)
+		// The document's block, and the scratch space used while reading a
+		// binary plist, come from resource, which must outlive the document.
+		// XML is parsed with pugixml, which allocates its tree with new.
+
+		void readPlist(const char* byteArray, int64_t size, Document& document, memory_resource* resource);
+		void readPlist(std::istream& stream, Document& document, memory_resource* resource);
+		void readPlist(const char* filename, Document& document, memory_resource* resource);
+#endif
+};
+
+#endif
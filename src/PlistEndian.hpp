@@ -0,0 +1,259 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+// Big endian loads and stores for the binary plist format.  Internal, not
+// part of the public interface.
+//
+// Everything works on raw pointers into the plist bytes, nothing allocates.
+// Host byte order is decided at compile time; loads go through memcpy so
+// unaligned data is fine.
+
+#ifndef __PLIST_ENDIAN_H__
+#define __PLIST_ENDIAN_H__
+
+#include <boost/cstdint.hpp>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define PLIST_SSE2 1
+#endif
+
+// host byte order.  Targets that don't say are assumed little endian, which
+// covers x86 and ARM under msvc.
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__)
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define PLIST_BIG_ENDIAN_HOST 1
+#endif
+#elif defined(__BIG_ENDIAN__) || defined(__ARMEB__) || defined(__MIPSEB__) || defined(__ppc__) || defined(__POWERPC__)
+#define PLIST_BIG_ENDIAN_HOST 1
+#endif
+
+namespace Plist
+{
+		inline uint16_t byteSwap16(uint16_t value)
+		{
+			return (uint16_t) ((value << 8) | (value >> 8));
+		}
+
+		inline uint32_t byteSwap32(uint32_t value)
+		{
+#if defined(_MSC_VER)
+			return _byteswap_ulong(value);
+#elif defined(__GNUC__)
+			return __builtin_bswap32(value);
+#else
+			return (value << 24) | ((value << 8) & 0xff0000) | ((value >> 8) & 0xff00) | (value >> 24);
+#endif
+		}
+
+		inline uint64_t byteSwap64(uint64_t value)
+		{
+#if defined(_MSC_VER)
+			return _byteswap_uint64(value);
+#elif defined(__GNUC__)
+			return __builtin_bswap64(value);
+#else
+			return ((uint64_t) byteSwap32((uint32_t) value) << 32) | byteSwap32((uint32_t) (value >> 32));
+#endif
+		}
+
+#if defined(PLIST_BIG_ENDIAN_HOST)
+		inline uint16_t fromBigEndian16(uint16_t value) { return value; }
+		inline uint32_t fromBigEndian32(uint32_t value) { return value; }
+		inline uint64_t fromBigEndian64(uint64_t value) { return value; }
+#else
+		inline uint16_t fromBigEndian16(uint16_t value) { return byteSwap16(value); }
+		inline uint32_t fromBigEndian32(uint32_t value) { return byteSwap32(value); }
+		inline uint64_t fromBigEndian64(uint64_t value) { return byteSwap64(value); }
+#endif
+
+		inline uint16_t loadBigEndian16(const unsigned char* bytes)
+		{
+			uint16_t value;
+			memcpy(&value, bytes, sizeof(value));
+			return fromBigEndian16(value);
+		}
+
+		inline uint32_t loadBigEndian32(const unsigned char* bytes)
+		{
+			uint32_t value;
+			memcpy(&value, bytes, sizeof(value));
+			return fromBigEndian32(value);
+		}
+
+		inline uint64_t loadBigEndian64(const unsigned char* bytes)
+		{
+			uint64_t value;
+			memcpy(&value, bytes, sizeof(value));
+			return fromBigEndian64(value);
+		}
+
+		// unsigned big endian integer of width bytes, 1 to 8
+
+		inline uint64_t loadBigEndian(const unsigned char* bytes, int32_t width)
+		{
+			switch(width)
+			{
+				case 1:
+					return bytes[0];
+				case 2:
+					return loadBigEndian16(bytes);
+				case 4:
+					return loadBigEndian32(bytes);
+				case 8:
+					return loadBigEndian64(bytes);
+			}
+
+			uint64_t value = 0;
+			for(int32_t n = 0; n < width; ++n)
+				value = (value << 8) | bytes[n];
+			return value;
+		}
+
+		inline float loadBigEndianFloat(const unsigned char* bytes)
+		{
+			uint32_t bits = loadBigEndian32(bytes);
+			float value;
+			memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		inline double loadBigEndianDouble(const unsigned char* bytes)
+		{
+			uint64_t bits = loadBigEndian64(bytes);
+			double value;
+			memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		// store the low width bytes of value big endian, width 1 to 8
+
+		inline void storeBigEndian(unsigned char* bytes, uint64_t value, int32_t width)
+		{
+			switch(width)
+			{
+				case 1:
+					bytes[0] = (unsigned char) value;
+					return;
+				case 2:
+					{
+						uint16_t swapped = fromBigEndian16((uint16_t) value);
+						memcpy(bytes, &swapped, sizeof(swapped));
+						return;
+					}
+				case 4:
+					{
+						uint32_t swapped = fromBigEndian32((uint32_t) value);
+						memcpy(bytes, &swapped, sizeof(swapped));
+						return;
+					}
+				case 8:
+					{
+						uint64_t swapped = fromBigEndian64(value);
+						memcpy(bytes, &swapped, sizeof(swapped));
+						return;
+					}
+			}
+
+			for(int32_t n = width - 1; n >= 0; --n)
+			{
+				bytes[n] = (unsigned char) (value & 0xff);
+				value >>= 8;
+			}
+		}
+
+		// Decodes count consecutive big endian integers of width bytes into
+		// values, as used by offset tables and container ref lists.  Widths
+		// 1, 2 and 4 are swapped 16 bytes at a time where SSE2 is available.
+		// Returns false if a value doesn't fit in 32 bits.
+
+		inline bool loadBigEndianArray(uint32_t* values, const unsigned char* bytes, size_t count, int32_t width)
+		{
+			size_t i = 0;
+
+#if defined(PLIST_SSE2) && !defined(PLIST_BIG_ENDIAN_HOST)
+			const __m128i zero = _mm_setzero_si128();
+			if(width == 1)
+			{
+				for(; i + 16 <= count; i += 16)
+				{
+					__m128i in = _mm_loadu_si128((const __m128i*) (bytes + i));
+					__m128i low = _mm_unpacklo_epi8(in, zero);
+					__m128i high = _mm_unpackhi_epi8(in, zero);
+					_mm_storeu_si128((__m128i*) (values + i), _mm_unpacklo_epi16(low, zero));
+					_mm_storeu_si128((__m128i*) (values + i + 4), _mm_unpackhi_epi16(low, zero));
+					_mm_storeu_si128((__m128i*) (values + i + 8), _mm_unpacklo_epi16(high, zero));
+					_mm_storeu_si128((__m128i*) (values + i + 12), _mm_unpackhi_epi16(high, zero));
+				}
+			}
+			else if(width == 2)
+			{
+				for(; i + 8 <= count; i += 8)
+				{
+					__m128i in = _mm_loadu_si128((const __m128i*) (bytes + 2 * i));
+					__m128i swapped = _mm_or_si128(_mm_slli_epi16(in, 8), _mm_srli_epi16(in, 8));
+					_mm_storeu_si128((__m128i*) (values + i), _mm_unpacklo_epi16(swapped, zero));
+					_mm_storeu_si128((__m128i*) (values + i + 4), _mm_unpackhi_epi16(swapped, zero));
+				}
+			}
+			else if(width == 4)
+			{
+				for(; i + 4 <= count; i += 4)
+				{
+					// swap the bytes in each 16 bit half, then the halves
+					__m128i in = _mm_loadu_si128((const __m128i*) (bytes + 4 * i));
+					__m128i swapped = _mm_or_si128(_mm_slli_epi16(in, 8), _mm_srli_epi16(in, 8));
+					swapped = _mm_shufflehi_epi16(_mm_shufflelo_epi16(swapped, 0xb1), 0xb1);
+					_mm_storeu_si128((__m128i*) (values + i), swapped);
+				}
+			}
+#endif
+
+			if(width <= 4)
+			{
+				for(; i < count; ++i)
+					values[i] = (uint32_t) loadBigEndian(bytes + i * width, width);
+				return true;
+			}
+
+			for(; i < count; ++i)
+			{
+				uint64_t value = loadBigEndian(bytes + i * width, width);
+				if(value > 0xffffffffULL)
+					return false;
+				values[i] = (uint32_t) value;
+			}
+			return true;
+		}
+
+} // namespace Plist
+
+#endif
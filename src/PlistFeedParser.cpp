@@ -0,0 +1,124 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+
+#include "PlistFeedParser.hpp"
+#include "PlistHelpers.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace Plist {
+
+PlistFeedParser::PlistFeedParser()
+	: _format(UnknownFormat),
+	_builder(new XMLPlistTreeBuilder()),
+	_done(false)
+{
+}
+
+PlistFeedParser::~PlistFeedParser()
+{
+	delete _builder;
+}
+
+void PlistFeedParser::reserve(size_t size)
+{
+	if(_format != XMLFormat)
+		_buffer.reserve(size);
+}
+
+void PlistFeedParser::feed(const char* bytes, size_t size)
+{
+	if(_format == XMLFormat)
+	{
+		_reader.feed(bytes, size);
+		parseXML();
+		return;
+	}
+
+	_buffer.insert(_buffer.end(), bytes, bytes + size);
+	if((_format == BinaryFormat) || _buffer.empty())
+		return;
+
+	// the first bytes tell binary from XML.  A binary header is checked as
+	// soon as it has arrived, anything else is parsed as XML from here on.
+
+	size_t compared = std::min(_buffer.size(), (size_t) 8);
+	if(memcmp(&_buffer[0], "bplist00", compared) == 0)
+	{
+		if(compared == 8)
+			_format = BinaryFormat;
+		return;
+	}
+
+	_format = XMLFormat;
+	_reader.feed(&_buffer[0], _buffer.size());
+	std::vector<char>().swap(_buffer);
+	parseXML();
+}
+
+void PlistFeedParser::parseXML()
+{
+	while(!_done)
+	{
+		XMLPlistReader::Event event = _reader.next();
+		if(event == XMLPlistReader::NeedMoreData)
+			return;
+		else if(event == XMLPlistReader::EndDocument)
+			_done = true;
+		else
+			_builder->add(event, _reader);
+	}
+}
+
+void PlistFeedParser::finish(boost::any& message)
+{
+	if(_format == UnknownFormat)
+	{
+		if(_buffer.empty())
+			throw Error("Plist: Empty plist data");
+
+		// too short to be a binary plist
+		_format = XMLFormat;
+		_reader.feed(&_buffer[0], _buffer.size());
+		std::vector<char>().swap(_buffer);
+	}
+
+	if(_format == BinaryFormat)
+	{
+		// the trailer is validated before anything is decoded, and objects
+		// are decoded in place from the accumulated buffer.
+		readPlist(&_buffer[0], _buffer.size(), message);
+		return;
+	}
+
+	_reader.finish();
+	parseXML();
+	if(!_done)
+		throw Error("Plist: XML ended before the plist was complete");
+	message.swap(_builder->result());
+}
+
+} // namespace Plist
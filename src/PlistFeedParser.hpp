@@ -0,0 +1,96 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+
+#ifndef __PLIST_FEED_PARSER_H__
+#define __PLIST_FEED_PARSER_H__
+
+#include "Plist.hpp"
+#include "PlistXMLReader.hpp"
+
+namespace Plist
+{
+		class XMLPlistTreeBuilder;
+
+		// Push parser for plists that arrive in pieces, e.g. from a socket or
+		// a pipe.  Hand each chunk to feed() as it arrives and call finish()
+		// after the last one.
+		//
+		// XML plists are parsed as they are fed, so parsing overlaps with
+		// reading and only the unparsed tail of the input is buffered.  Binary
+		// plists can't be decoded until the trailer at the end has arrived;
+		// they are accumulated in one buffer and decoded in place from it.
+
+		class PlistFeedParser
+		{
+			public:
+
+				PlistFeedParser();
+				~PlistFeedParser();
+
+				// expected total size, if known, so a binary plist is
+				// buffered without regrowing
+				void reserve(size_t size);
+
+				void feed(const char* bytes, size_t size);
+
+				// parses what remains and returns the plist.  Throws
+				// Plist::Error if the input is incomplete or malformed.
+				void finish(boost::any& message);
+				template<typename T>
+				void finish(T& message);
+
+			private:
+
+				enum Format
+				{
+					UnknownFormat,
+					XMLFormat,
+					BinaryFormat
+				};
+
+				PlistFeedParser(const PlistFeedParser&);
+				PlistFeedParser& operator=(const PlistFeedParser&);
+
+				void parseXML();
+
+				Format _format;
+				std::vector<char> _buffer;
+
+				XMLPlistReader _reader;
+				XMLPlistTreeBuilder* _builder;
+				bool _done;
+		};
+};
+
+template <typename T>
+void Plist::PlistFeedParser::finish(T& message)
+{
+	boost::any tmp_message;
+	finish(tmp_message);
+	moveFromAny(tmp_message, message);
+}
+
+#endif
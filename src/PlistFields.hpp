@@ -0,0 +1,1145 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+#ifndef __PLIST_FIELDS_H__
+#define __PLIST_FIELDS_H__
+
+#include "Plist.hpp"
+#include "PlistBase64.hpp"
+#include "PlistHelpers.hpp"
+#include "PlistValue.hpp"
+#include "pugixml.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+// Reading and writing structs a member at a time, with no boost::any tree
+// in between.  List a struct's members once, at global scope and with the
+// struct's name qualified by its namespace:
+//
+//		struct Track
+//		{
+//			std::string name;
+//			int64_t count;
+//			std::vector<std::string> tags;
+//		};
+//		PLIST_FIELDS(Track, name, count, tags)
+//
+//		Track track;
+//		Plist::readPlist("track.plist", track);
+//		Plist::writePlistBinary("copy.plist", track);
+//
+// A struct is a dictionary with an entry per member, keyed by the member's
+// name and written in the order listed.  Members can be bool, integers,
+// float, double, std::string, data_type, Date, boost::any, Value, other
+// PLIST_FIELDS structs, and std::vector and std::string keyed std::map of
+// those.  Up to 32 members can be listed.
+//
+// How each member is read and written is picked at compile time.  Keys are
+// matched against the member names starting after the last match, so
+// dictionaries in member order match each key first time.  Entries with no
+// member are skipped, members with no entry are left as they are, and a
+// value of the wrong type, or an integer the member can't hold, throws
+// Plist::Error.
+
+#define PLIST_FIELDS(Type, ...) \
+	namespace Plist \
+	{ \
+		template<> \
+		struct Fields<Type> \
+		{ \
+			static const size_t count = PLIST_FIELDS_COUNT(__VA_ARGS__); \
+			static const char* name(size_t index) \
+			{ \
+				static const char* const names[] = { PLIST_FIELDS_EACH(PLIST_FIELDS_NAME, __VA_ARGS__) }; \
+				return names[index]; \
+			} \
+			static size_t nameSize(size_t index) \
+			{ \
+				static const size_t sizes[] = { PLIST_FIELDS_EACH(PLIST_FIELDS_NAME_SIZE, __VA_ARGS__) }; \
+				return sizes[index]; \
+			} \
+			template<typename Visitor> \
+			static void visit(Type& object, Visitor& visitor) \
+			{ \
+				PLIST_FIELDS_EACH(PLIST_FIELDS_VISIT, __VA_ARGS__) \
+			} \
+			template<typename Visitor> \
+			static void visit(const Type& object, Visitor& visitor) \
+			{ \
+				PLIST_FIELDS_EACH(PLIST_FIELDS_VISIT, __VA_ARGS__) \
+			} \
+			template<typename Visitor> \
+			static void visitField(size_t index, Type& object, Visitor& visitor) \
+			{ \
+				switch(index) \
+				{ \
+					PLIST_FIELDS_EACH(PLIST_FIELDS_CASE, __VA_ARGS__) \
+				} \
+			} \
+		}; \
+		template<> \
+		struct HasFields<Type> \
+		{ \
+			static const bool value = true; \
+		}; \
+	}
+
+// PLIST_FIELDS_EACH(m, a, b, c) is m(3, a) m(2, b) m(1, c), each member
+// with the number of members from it to the end
+
+#define PLIST_FIELDS_NAME(n, f) #f,
+#define PLIST_FIELDS_NAME_SIZE(n, f) sizeof(#f) - 1,
+#define PLIST_FIELDS_VISIT(n, f) visitor(#f, sizeof(#f) - 1, object.f);
+#define PLIST_FIELDS_CASE(n, f) case count - n: visitor(#f, sizeof(#f) - 1, object.f); break;
+
+#define PLIST_FIELDS_EXPAND(x) x
+#define PLIST_FIELDS_CAT(a, b) PLIST_FIELDS_CAT_(a, b)
+#define PLIST_FIELDS_CAT_(a, b) a##b
+#define PLIST_FIELDS_COUNT(...) PLIST_FIELDS_EXPAND(PLIST_FIELDS_COUNT_(__VA_ARGS__, 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0))
+#define PLIST_FIELDS_COUNT_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, n, ...) n
+#define PLIST_FIELDS_EACH(m, ...) PLIST_FIELDS_EXPAND(PLIST_FIELDS_CAT(PLIST_FIELDS_EACH_, PLIST_FIELDS_COUNT(__VA_ARGS__))(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_1(m, f) m(1, f)
+#define PLIST_FIELDS_EACH_2(m, f, ...) m(2, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_1(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_3(m, f, ...) m(3, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_2(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_4(m, f, ...) m(4, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_3(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_5(m, f, ...) m(5, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_4(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_6(m, f, ...) m(6, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_5(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_7(m, f, ...) m(7, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_6(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_8(m, f, ...) m(8, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_7(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_9(m, f, ...) m(9, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_8(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_10(m, f, ...) m(10, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_9(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_11(m, f, ...) m(11, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_10(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_12(m, f, ...) m(12, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_11(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_13(m, f, ...) m(13, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_12(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_14(m, f, ...) m(14, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_13(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_15(m, f, ...) m(15, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_14(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_16(m, f, ...) m(16, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_15(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_17(m, f, ...) m(17, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_16(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_18(m, f, ...) m(18, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_17(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_19(m, f, ...) m(19, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_18(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_20(m, f, ...) m(20, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_19(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_21(m, f, ...) m(21, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_20(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_22(m, f, ...) m(22, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_21(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_23(m, f, ...) m(23, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_22(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_24(m, f, ...) m(24, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_23(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_25(m, f, ...) m(25, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_24(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_26(m, f, ...) m(26, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_25(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_27(m, f, ...) m(27, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_26(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_28(m, f, ...) m(28, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_27(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_29(m, f, ...) m(29, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_28(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_30(m, f, ...) m(30, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_29(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_31(m, f, ...) m(31, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_30(m, __VA_ARGS__))
+#define PLIST_FIELDS_EACH_32(m, f, ...) m(32, f) PLIST_FIELDS_EXPAND(PLIST_FIELDS_EACH_31(m, __VA_ARGS__))
+
+namespace Plist
+{
+		// Specialized by PLIST_FIELDS.  count is the number of members,
+		// name() and nameSize() give the key of each.  visit() calls
+		// visitor(name, nameSize, member) for every member in order,
+		// visitField() for the one at index.
+		template<typename T>
+		struct Fields;
+
+		template<typename T>
+		struct HasFields<std::vector<T> >
+		{
+			static const bool value = HasFields<T>::value;
+		};
+
+		template<typename T>
+		struct HasFields<std::map<std::string, T> >
+		{
+			static const bool value = HasFields<T>::value;
+		};
+
+		// How a T is read and written.  The primary template is for
+		// PLIST_FIELDS structs, the specializations below for members.
+		//
+		//		readBinary    decodes object objRef into value
+		//		readXML       decodes node into value
+		//		binaryRef     ref of value's object, planned by the container
+		//		              holding it, equal scalars share one
+		//		planBinary    plans value's object once it has a ref
+		//		writeBinary   writes value's object, as planned
+		//		writeXML      writes value at depth
+		//
+		// The binary steps are those of planBinaryPlist and
+		// writePlistBinary in Plist.cpp, so a struct is written byte for
+		// byte as a boost::any tree holding the same values in an
+		// OrderedDictionary.
+		template<typename T>
+		struct FieldCodec;
+
+		// objRef's offset, throws if the object's marker isn't marker
+		inline int32_t binaryObjectOffset(const PlistHelperData& d, int objRef, unsigned char marker, const char* typeName)
+		{
+			int32_t offset = getOffset(d, objRef);
+			if((*getObjectBytes(d, offset, 1) & 0xF0) != marker)
+				throw Error(std::string("Plist: binary plist object isn't ") + typeName);
+			return offset;
+		}
+
+		inline void checkXMLNode(const pugi::xml_node& node, const char* nodeName)
+		{
+			if(strcmp(node.name(), nodeName) != 0)
+				throw Error(std::string("Plist: XML expected ") + nodeName + " but found " + node.name());
+		}
+
+		// the whole text as a decimal integer, as validatePlist accepts it
+		inline int64_t parseXMLInteger(const char* text)
+		{
+			char* end;
+			errno = 0;
+			long long value = strtoll(text, &end, 10);
+			if((end == text) || (*end != 0) || (errno == ERANGE))
+				throw Error(std::string("Plist: XML integer isn't a decimal integer: ") + text);
+			return value;
+		}
+
+		// an integer read into a member, which must be able to hold it
+		template<typename T>
+		T narrowInteger(int64_t value)
+		{
+			bool fits = std::numeric_limits<T>::is_signed
+				? ((value >= (int64_t) std::numeric_limits<T>::min()) && (value <= (int64_t) std::numeric_limits<T>::max()))
+				: ((value >= 0) && ((uint64_t) value <= (uint64_t) std::numeric_limits<T>::max()));
+			if(!fits)
+				throw Error("Plist: integer out of range for its member");
+			return (T) value;
+		}
+
+		// key of a dictionary entry, pointing into the plist when it is
+		// ascii, otherwise decoded into unicode
+		inline void readBinaryKey(const PlistHelperData& d, int objRef, std::string& unicode, const char*& key, size_t& keySize)
+		{
+			int32_t offset = getOffset(d, objRef);
+			unsigned char header = *getObjectBytes(d, offset, 1);
+			if((header & 0xF0) == 0x50)
+			{
+				int startOffset;
+				int32_t count = getCount(d, offset, header, startOffset);
+				key = (const char*) getObjectBytes(d, (int64_t) offset + startOffset, count);
+				keySize = count;
+				return;
+			}
+
+			unicode = parseBinaryKey(d, objRef);
+			key = unicode.data();
+			keySize = unicode.size();
+		}
+
+		// index of the member named key, searching from start, or count
+		// when there is none
+		template<typename T>
+		size_t findField(const char* key, size_t keySize, size_t start)
+		{
+			for(size_t n = 0; n < Fields<T>::count; ++n)
+			{
+				size_t index = (start + n) % Fields<T>::count;
+				if((Fields<T>::nameSize(index) == keySize) && (memcmp(Fields<T>::name(index), key, keySize) == 0))
+					return index;
+			}
+			return Fields<T>::count;
+		}
+
+		// a container's ref, its children are planned when it is
+		inline int32_t containerRef(PlistHelperData& d)
+		{
+			d._offsetTable.push_back(0);
+			return (int32_t) d._offsetTable.size() - 1;
+		}
+
+		inline void markBinaryObject(PlistHelperData& d)
+		{
+			d._lastObjectBytes = d._plannedBytes;
+			d._lastObjectRefs = d._plannedRefs;
+		}
+
+		// Scalars describe themselves with binaryKey(), the binary steps
+		// all follow from it.
+
+		template<typename T>
+		struct ScalarCodec
+		{
+			static int32_t binaryRef(PlistHelperData& d, const T& value)
+			{
+				return uniqueRef(d, FieldCodec<T>::binaryKey(value));
+			}
+
+			static void planBinary(PlistHelperData& d, const T& value)
+			{
+				markBinaryObject(d);
+				d._plannedBytes += binaryScalarSize(FieldCodec<T>::binaryKey(value));
+			}
+
+			static void writeBinary(PlistHelperData& d, const T& value, int32_t objRef)
+			{
+				d._offsetTable[objRef] = (int32_t) d._outputPosition;
+				writeBinaryScalar(d, FieldCodec<T>::binaryKey(value));
+			}
+		};
+
+		template<typename T>
+		struct IntegerCodec : ScalarCodec<T>
+		{
+			static UniqueKey binaryKey(const T& value)
+			{
+				UniqueKey key = { 0x10, (uint64_t) (int64_t) value, 0, 0 };
+				return key;
+			}
+
+			static void readBinary(const PlistHelperData& d, int objRef, T& value)
+			{
+				int intByteCount;
+				value = narrowInteger<T>(parseBinaryInt(d, binaryObjectOffset(d, objRef, 0x10, "an integer"), intByteCount));
+			}
+
+			static void readXML(pugi::xml_node& node, T& value)
+			{
+				checkXMLNode(node, "integer");
+				std::string buffer;
+				value = narrowInteger<T>(parseXMLInteger(xmlNodeText(node, buffer)));
+			}
+
+			template<typename Sink>
+			static void writeXML(Sink& sink, const T& value, int depth)
+			{
+				writeXMLInteger(sink, (int64_t) value, depth);
+			}
+		};
+
+		template<> struct FieldCodec<short> : IntegerCodec<short> { };
+		template<> struct FieldCodec<unsigned short> : IntegerCodec<unsigned short> { };
+		template<> struct FieldCodec<int> : IntegerCodec<int> { };
+		template<> struct FieldCodec<unsigned int> : IntegerCodec<unsigned int> { };
+		template<> struct FieldCodec<long> : IntegerCodec<long> { };
+		template<> struct FieldCodec<unsigned long> : IntegerCodec<unsigned long> { };
+		template<> struct FieldCodec<long long> : IntegerCodec<long long> { };
+		template<> struct FieldCodec<unsigned long long> : IntegerCodec<unsigned long long> { };
+
+		// floats are written as doubles, the way the tree writers do
+		template<typename T>
+		struct RealCodec : ScalarCodec<T>
+		{
+			static UniqueKey binaryKey(const T& value)
+			{
+				double real = value;
+				UniqueKey key = { 0x23, 0, 0, 0 };
+				memcpy(&key.value, &real, sizeof(double));
+				return key;
+			}
+
+			static void readBinary(const PlistHelperData& d, int objRef, T& value)
+			{
+				value = (T) parseBinaryReal(d, binaryObjectOffset(d, objRef, 0x20, "a real"));
+			}
+
+			static void readXML(pugi::xml_node& node, T& value)
+			{
+				checkXMLNode(node, "real");
+				std::string buffer;
+				value = (T) atof(xmlNodeText(node, buffer));
+			}
+
+			template<typename Sink>
+			static void writeXML(Sink& sink, const T& value, int depth)
+			{
+				writeXMLReal(sink, value, depth);
+			}
+		};
+
+		template<> struct FieldCodec<float> : RealCodec<float> { };
+		template<> struct FieldCodec<double> : RealCodec<double> { };
+
+		template<>
+		struct FieldCodec<bool> : ScalarCodec<bool>
+		{
+			static UniqueKey binaryKey(const bool& value)
+			{
+				UniqueKey key = { (unsigned char) (value ? 0x09 : 0x08), 0, 0, 0 };
+				return key;
+			}
+
+			static void readBinary(const PlistHelperData& d, int objRef, bool& value)
+			{
+				value = parseBinaryBool(d, binaryObjectOffset(d, objRef, 0x00, "a boolean"));
+			}
+
+			static void readXML(pugi::xml_node& node, bool& value)
+			{
+				if(strcmp(node.name(), "true") == 0)
+					value = true;
+				else
+				{
+					checkXMLNode(node, "false");
+					value = false;
+				}
+			}
+
+			template<typename Sink>
+			static void writeXML(Sink& sink, const bool& value, int depth)
+			{
+				writeXMLBoolean(sink, value, depth);
+			}
+		};
+
+		template<>
+		struct FieldCodec<std::string> : ScalarCodec<std::string>
+		{
+			static UniqueKey binaryKey(const std::string& value)
+			{
+				UniqueKey key = { 0x50, 0, value.data(), value.size() };
+				return key;
+			}
+
+			static void readBinary(const PlistHelperData& d, int objRef, std::string& value)
+			{
+				int32_t offset = getOffset(d, objRef);
+				unsigned char header = *getObjectBytes(d, offset, 1) & 0xF0;
+				std::string text;
+				if(header == 0x50)
+					text = parseBinaryString(d, offset);
+				else if(header == 0x60)
+					text = parseBinaryUnicode(d, offset);
+				else
+					throw Error("Plist: binary plist object isn't a string");
+				value.swap(text);
+			}
+
+			static void readXML(pugi::xml_node& node, std::string& value)
+			{
+				checkXMLNode(node, "string");
+				std::string buffer;
+				value = xmlNodeText(node, buffer);
+			}
+
+			template<typename Sink>
+			static void writeXML(Sink& sink, const std::string& value, int depth)
+			{
+				writeXMLStringValue(sink, value.data(), value.size(), depth);
+			}
+		};
+
+		template<>
+		struct FieldCodec<data_type> : ScalarCodec<data_type>
+		{
+			static UniqueKey binaryKey(const data_type& value)
+			{
+				UniqueKey key = { 0x40, 0, value.empty() ? 0 : &value[0], value.size() };
+				return key;
+			}
+
+			static void readBinary(const PlistHelperData& d, int objRef, data_type& value)
+			{
+				data_type data = parseBinaryByteArray(d, binaryObjectOffset(d, objRef, 0x40, "data"));
+				value.swap(data);
+			}
+
+			static void readXML(pugi::xml_node& node, data_type& value)
+			{
+				checkXMLNode(node, "data");
+				std::string buffer;
+				const char* text = xmlNodeText(node, buffer);
+				size_t size = strlen(text);
+				value.resize(base64DecodeCapacity(size));
+				value.resize(base64Decode((unsigned char*) (value.empty() ? 0 : &value[0]), text, size));
+			}
+
+			template<typename Sink>
+			static void writeXML(Sink& sink, const data_type& value, int depth)
+			{
+				writeXMLData(sink, value.empty() ? 0 : &value[0], value.size(), depth);
+			}
+		};
+
+		template<>
+		struct FieldCodec<Date> : ScalarCodec<Date>
+		{
+			static UniqueKey binaryKey(const Date& value)
+			{
+				double time = value.timeAsAppleEpoch();
+				UniqueKey key = { 0x33, 0, 0, 0 };
+				memcpy(&key.value, &time, sizeof(double));
+				return key;
+			}
+
+			static void readBinary(const PlistHelperData& d, int objRef, Date& value)
+			{
+				value = parseBinaryDate(d, binaryObjectOffset(d, objRef, 0x30, "a date"));
+			}
+
+			static void readXML(pugi::xml_node& node, Date& value)
+			{
+				checkXMLNode(node, "date");
+				std::string buffer;
+				value.setTimeFromXMLConvention(xmlNodeText(node, buffer));
+			}
+
+			template<typename Sink>
+			static void writeXML(Sink& sink, const Date& value, int depth)
+			{
+				writeXMLDate(sink, value, depth);
+			}
+		};
+
+		// boost::any and Value members hold a whole tree, read and written
+		// by the tree readers and writers
+
+		template<typename Node>
+		struct TreeCodec
+		{
+			static int32_t binaryRef(PlistHelperData& d, const Node& value)
+			{
+				return Plist::binaryRef(d, value);
+			}
+
+			static void planBinary(PlistHelperData& d, const Node& value)
+			{
+				Plist::planBinary(d, value);
+			}
+
+			static void writeBinary(PlistHelperData& d, const Node& value, int32_t objRef)
+			{
+				Plist::writeBinary(d, value, objRef);
+			}
+
+			template<typename Sink>
+			static void writeXML(Sink& sink, const Node& value, int depth)
+			{
+				emitXMLNode(sink, value, depth);
+			}
+		};
+
+		template<>
+		struct FieldCodec<boost::any> : TreeCodec<boost::any>
+		{
+			static void readBinary(const PlistHelperData& d, int objRef, boost::any& value)
+			{
+				parseBinary<MapDictionaryPolicy>(d, objRef, value);
+			}
+
+			static void readXML(pugi::xml_node& node, boost::any& value)
+			{
+				parse<MapDictionaryPolicy>(node, value);
+			}
+		};
+
+		template<>
+		struct FieldCodec<Value> : TreeCodec<Value>
+		{
+			static void readBinary(const PlistHelperData& d, int objRef, Value& value)
+			{
+				parseBinary(d, objRef, value);
+			}
+
+			static void readXML(pugi::xml_node& node, Value& value)
+			{
+				parse(node, value);
+			}
+		};
+
+		// arrays
+
+		template<typename T>
+		struct FieldCodec<std::vector<T> >
+		{
+			static void readBinary(const PlistHelperData& d, int objRef, std::vector<T>& value)
+			{
+				binaryObjectOffset(d, objRef, 0xA0, "an array");
+				int64_t refStartPosition;
+				int32_t count = getContainerRefs(d, objRef, refStartPosition);
+
+				value.clear();
+				value.resize(count);
+				for(int32_t i = 0; i < count; ++i)
+					FieldCodec<T>::readBinary(d, getRef(d, refStartPosition, i), value[i]);
+			}
+
+			static void readXML(pugi::xml_node& node, std::vector<T>& value)
+			{
+				checkXMLNode(node, "array");
+
+				value.clear();
+				for(pugi::xml_node_iterator it = node.begin(); it != node.end(); ++it)
+				{
+					value.push_back(T());
+					FieldCodec<T>::readXML(*it, value.back());
+				}
+			}
+
+			static int32_t binaryRef(PlistHelperData& d, const std::vector<T>&)
+			{
+				return containerRef(d);
+			}
+
+			static void planBinary(PlistHelperData& d, const std::vector<T>& value)
+			{
+				markBinaryObject(d);
+
+				int32_t nextRef = (int32_t) d._offsetTable.size();
+				size_t first = d._plan.size();
+
+				for(size_t i = 0; i < value.size(); ++i)
+					d._plan.push_back(FieldCodec<T>::binaryRef(d, value[i]));
+
+				d._plannedBytes += binaryHeaderSize(value.size());
+				d._plannedRefs += value.size();
+
+				for(size_t i = 0; i < value.size(); ++i)
+					if(d._plan[first + i] == nextRef)
+					{
+						++nextRef;
+						FieldCodec<T>::planBinary(d, value[i]);
+					}
+			}
+
+			static void writeBinary(PlistHelperData& d, const std::vector<T>& value, int32_t objRef)
+			{
+				d._offsetTable[objRef] = (int32_t) d._outputPosition;
+
+				int32_t nextRef = d._nextRef;
+				size_t first = d._planPosition;
+				d._planPosition += value.size();
+
+				writeBinaryHeader(d, 0xA0, value.size());
+				writeBinaryRefs(d, first, value.size());
+
+				for(size_t i = 0; i < value.size(); ++i)
+					if(d._plan[first + i] == nextRef)
+						FieldCodec<T>::writeBinary(d, value[i], nextRef++);
+			}
+
+			template<typename Sink>
+			static void writeXML(Sink& sink, const std::vector<T>& value, int depth)
+			{
+				writeXMLIndent(sink, depth);
+				if(value.empty())
+				{
+					sink.write("<array />\n", 10);
+					return;
+				}
+
+				sink.write("<array>\n", 8);
+				for(size_t i = 0; i < value.size(); ++i)
+					FieldCodec<T>::writeXML(sink, value[i], depth + 1);
+				writeXMLIndent(sink, depth);
+				sink.write("</array>\n", 9);
+			}
+		};
+
+		// dictionaries with arbitrary keys
+
+		template<typename T>
+		struct FieldCodec<std::map<std::string, T> >
+		{
+			typedef std::map<std::string, T> map_type;
+
+			static void readBinary(const PlistHelperData& d, int objRef, map_type& value)
+			{
+				binaryObjectOffset(d, objRef, 0xD0, "a dictionary");
+				int64_t refStartPosition;
+				int32_t count = getContainerRefs(d, objRef, refStartPosition) / 2;
+
+				value.clear();
+				for(int32_t i = 0; i < count; ++i)
+				{
+					std::string key = parseBinaryKey(d, getRef(d, refStartPosition, i));
+					T& entry = value.insert(value.end(), typename map_type::value_type(key, T()))->second;
+					FieldCodec<T>::readBinary(d, getRef(d, refStartPosition, i + count), entry);
+				}
+			}
+
+			static void readXML(pugi::xml_node& node, map_type& value)
+			{
+				checkXMLNode(node, "dict");
+
+				value.clear();
+				for(pugi::xml_node_iterator it = node.begin(); it != node.end(); ++it)
+				{
+					if(strcmp("key", it->name()) != 0)
+						throw Error("Plist: XML dictionary key expected but not found");
+
+					std::string buffer;
+					std::string key(xmlNodeText(*it, buffer));
+					++it;
+
+					if(it == node.end())
+						throw Error("Plist: XML dictionary value expected for key " + key + "but not found");
+
+					T& entry = value.insert(value.end(), typename map_type::value_type(key, T()))->second;
+					FieldCodec<T>::readXML(*it, entry);
+				}
+			}
+
+			static int32_t binaryRef(PlistHelperData& d, const map_type&)
+			{
+				return containerRef(d);
+			}
+
+			static void planBinary(PlistHelperData& d, const map_type& value)
+			{
+				markBinaryObject(d);
+
+				int32_t nextRef = (int32_t) d._offsetTable.size();
+				size_t first = d._plan.size();
+
+				// key refs come first, then value refs
+
+				for(typename map_type::const_iterator it = value.begin(); it != value.end(); ++it)
+					d._plan.push_back(uniqueRef(d, FieldCodec<std::string>::binaryKey(it->first)));
+				for(typename map_type::const_iterator it = value.begin(); it != value.end(); ++it)
+					d._plan.push_back(FieldCodec<T>::binaryRef(d, it->second));
+
+				d._plannedBytes += binaryHeaderSize(value.size());
+				d._plannedRefs += 2 * value.size();
+
+				size_t i = first;
+				for(typename map_type::const_iterator it = value.begin(); it != value.end(); ++it, ++i)
+					if(d._plan[i] == nextRef)
+					{
+						++nextRef;
+						FieldCodec<std::string>::planBinary(d, it->first);
+					}
+
+				for(typename map_type::const_iterator it = value.begin(); it != value.end(); ++it, ++i)
+					if(d._plan[i] == nextRef)
+					{
+						++nextRef;
+						FieldCodec<T>::planBinary(d, it->second);
+					}
+			}
+
+			static void writeBinary(PlistHelperData& d, const map_type& value, int32_t objRef)
+			{
+				d._offsetTable[objRef] = (int32_t) d._outputPosition;
+
+				int32_t nextRef = d._nextRef;
+				size_t first = d._planPosition;
+				d._planPosition += 2 * value.size();
+
+				writeBinaryHeader(d, 0xD0, value.size());
+				writeBinaryRefs(d, first, 2 * value.size());
+
+				size_t i = first;
+				for(typename map_type::const_iterator it = value.begin(); it != value.end(); ++it, ++i)
+					if(d._plan[i] == nextRef)
+						FieldCodec<std::string>::writeBinary(d, it->first, nextRef++);
+
+				for(typename map_type::const_iterator it = value.begin(); it != value.end(); ++it, ++i)
+					if(d._plan[i] == nextRef)
+						FieldCodec<T>::writeBinary(d, it->second, nextRef++);
+			}
+
+			template<typename Sink>
+			static void writeXML(Sink& sink, const map_type& value, int depth)
+			{
+				writeXMLIndent(sink, depth);
+				if(value.empty())
+				{
+					sink.write("<dict />\n", 9);
+					return;
+				}
+
+				sink.write("<dict>\n", 7);
+				for(typename map_type::const_iterator it = value.begin(); it != value.end(); ++it)
+				{
+					writeXMLKey(sink, it->first.data(), it->first.size(), depth + 1);
+					FieldCodec<T>::writeXML(sink, it->second, depth + 1);
+				}
+				writeXMLIndent(sink, depth);
+				sink.write("</dict>\n", 8);
+			}
+		};
+
+		// Member visitors for the struct codec.  Each is handed every
+		// member, or one picked by key, with its type known.
+
+		struct BinaryFieldReader
+		{
+			BinaryFieldReader(const PlistHelperData& data, int ref)
+				: d(data), objRef(ref) { }
+
+			template<typename Field>
+			void operator()(const char*, size_t, Field& field)
+			{
+				FieldCodec<Field>::readBinary(d, objRef, field);
+			}
+
+			const PlistHelperData& d;
+			int objRef;
+		};
+
+		struct XMLFieldReader
+		{
+			XMLFieldReader(pugi::xml_node& valueNode)
+				: node(valueNode) { }
+
+			template<typename Field>
+			void operator()(const char*, size_t, Field& field)
+			{
+				FieldCodec<Field>::readXML(node, field);
+			}
+
+			pugi::xml_node& node;
+		};
+
+		// appends each member's ref to the plan
+		struct BinaryFieldRefs
+		{
+			BinaryFieldRefs(PlistHelperData& data)
+				: d(data) { }
+
+			template<typename Field>
+			void operator()(const char*, size_t, const Field& field)
+			{
+				d._plan.push_back(FieldCodec<Field>::binaryRef(d, field));
+			}
+
+			PlistHelperData& d;
+		};
+
+		// plans or writes the members given a fresh ref, whose refs are in
+		// the plan from planIndex
+		struct BinaryFieldPlanner
+		{
+			BinaryFieldPlanner(PlistHelperData& data, size_t index, int32_t ref)
+				: d(data), planIndex(index), nextRef(ref) { }
+
+			template<typename Field>
+			void operator()(const char*, size_t, const Field& field)
+			{
+				if(d._plan[planIndex++] == nextRef)
+				{
+					++nextRef;
+					FieldCodec<Field>::planBinary(d, field);
+				}
+			}
+
+			PlistHelperData& d;
+			size_t planIndex;
+			int32_t nextRef;
+		};
+
+		struct BinaryFieldWriter
+		{
+			BinaryFieldWriter(PlistHelperData& data, size_t index, int32_t ref)
+				: d(data), planIndex(index), nextRef(ref) { }
+
+			template<typename Field>
+			void operator()(const char*, size_t, const Field& field)
+			{
+				if(d._plan[planIndex++] == nextRef)
+					FieldCodec<Field>::writeBinary(d, field, nextRef++);
+			}
+
+			PlistHelperData& d;
+			size_t planIndex;
+			int32_t nextRef;
+		};
+
+		template<typename Sink>
+		struct XMLFieldWriter
+		{
+			XMLFieldWriter(Sink& output, int fieldDepth)
+				: sink(output), depth(fieldDepth) { }
+
+			template<typename Field>
+			void operator()(const char* name, size_t nameSize, const Field& field)
+			{
+				writeXMLKey(sink, name, nameSize, depth);
+				FieldCodec<Field>::writeXML(sink, field, depth);
+			}
+
+			Sink& sink;
+			int depth;
+		};
+
+		// PLIST_FIELDS structs
+
+		template<typename T>
+		struct FieldCodec
+		{
+			static void readBinary(const PlistHelperData& d, int objRef, T& value)
+			{
+				binaryObjectOffset(d, objRef, 0xD0, "a dictionary");
+				int64_t refStartPosition;
+				int32_t count = getContainerRefs(d, objRef, refStartPosition) / 2;
+
+				std::string unicode;
+				size_t next = 0;
+				for(int32_t i = 0; i < count; ++i)
+				{
+					const char* key;
+					size_t keySize;
+					readBinaryKey(d, getRef(d, refStartPosition, i), unicode, key, keySize);
+
+					size_t index = findField<T>(key, keySize, next);
+					if(index == Fields<T>::count)
+						continue;
+
+					BinaryFieldReader reader(d, getRef(d, refStartPosition, i + count));
+					Fields<T>::visitField(index, value, reader);
+					next = index + 1;
+				}
+			}
+
+			static void readXML(pugi::xml_node& node, T& value)
+			{
+				checkXMLNode(node, "dict");
+
+				size_t next = 0;
+				for(pugi::xml_node_iterator it = node.begin(); it != node.end(); ++it)
+				{
+					if(strcmp("key", it->name()) != 0)
+						throw Error("Plist: XML dictionary key expected but not found");
+
+					std::string buffer;
+					const char* key = xmlNodeText(*it, buffer);
+					++it;
+
+					if(it == node.end())
+						throw Error(std::string("Plist: XML dictionary value expected for key ") + key + "but not found");
+					else if(strcmp("key", it->name()) == 0)
+						throw Error(std::string("Plist: XML dictionary value expected for key ") + key + "but found another key node");
+
+					size_t index = findField<T>(key, strlen(key), next);
+					if(index == Fields<T>::count)
+						continue;
+
+					XMLFieldReader reader(*it);
+					Fields<T>::visitField(index, value, reader);
+					next = index + 1;
+				}
+			}
+
+			static int32_t binaryRef(PlistHelperData& d, const T&)
+			{
+				return containerRef(d);
+			}
+
+			static void planBinary(PlistHelperData& d, const T& value)
+			{
+				markBinaryObject(d);
+
+				const size_t count = Fields<T>::count;
+				int32_t nextRef = (int32_t) d._offsetTable.size();
+				size_t first = d._plan.size();
+
+				// key refs come first, then value refs
+
+				for(size_t i = 0; i < count; ++i)
+				{
+					UniqueKey key = { 0x50, 0, Fields<T>::name(i), Fields<T>::nameSize(i) };
+					d._plan.push_back(uniqueRef(d, key));
+				}
+				BinaryFieldRefs refs(d);
+				Fields<T>::visit(value, refs);
+
+				d._plannedBytes += binaryHeaderSize(count);
+				d._plannedRefs += 2 * count;
+
+				for(size_t i = 0; i < count; ++i)
+					if(d._plan[first + i] == nextRef)
+					{
+						++nextRef;
+						markBinaryObject(d);
+						d._plannedBytes += binaryHeaderSize(Fields<T>::nameSize(i)) + Fields<T>::nameSize(i);
+					}
+
+				BinaryFieldPlanner planner(d, first + count, nextRef);
+				Fields<T>::visit(value, planner);
+			}
+
+			static void writeBinary(PlistHelperData& d, const T& value, int32_t objRef)
+			{
+				d._offsetTable[objRef] = (int32_t) d._outputPosition;
+
+				const size_t count = Fields<T>::count;
+				int32_t nextRef = d._nextRef;
+				size_t first = d._planPosition;
+				d._planPosition += 2 * count;
+
+				writeBinaryHeader(d, 0xD0, count);
+				writeBinaryRefs(d, first, 2 * count);
+
+				for(size_t i = 0; i < count; ++i)
+					if(d._plan[first + i] == nextRef)
+					{
+						d._offsetTable[nextRef++] = (int32_t) d._outputPosition;
+						UniqueKey key = { 0x50, 0, Fields<T>::name(i), Fields<T>::nameSize(i) };
+						writeBinaryScalar(d, key);
+					}
+
+				BinaryFieldWriter writer(d, first + count, nextRef);
+				Fields<T>::visit(value, writer);
+			}
+
+			template<typename Sink>
+			static void writeXML(Sink& sink, const T& value, int depth)
+			{
+				writeXMLIndent(sink, depth);
+				sink.write("<dict>\n", 7);
+				XMLFieldWriter<Sink> writer(sink, depth + 1);
+				Fields<T>::visit(value, writer);
+				writeXMLIndent(sink, depth);
+				sink.write("</dict>\n", 8);
+			}
+		};
+
+		// readPlist into a T with fields decodes straight into it
+
+		template<typename T>
+		class FieldsDecoder : public PlistDecoder
+		{
+			public:
+
+				explicit FieldsDecoder(T& message)
+					: _message(message) { }
+
+				void decodeBinary(const PlistHelperData& d)
+				{
+					FieldCodec<T>::readBinary(d, 0, _message);
+				}
+
+				void decodeXML(pugi::xml_node& rootNode)
+				{
+					FieldCodec<T>::readXML(rootNode, _message);
+				}
+
+			private:
+
+				T& _message;
+		};
+
+		template<typename T>
+		struct TypedReader<T, true>
+		{
+			static void read(const char* filename, T& message)
+			{
+				FieldsDecoder<T> decoder(message);
+				decodePlist(filename, decoder);
+			}
+
+			static void read(const char* byteArray, int64_t size, T& message)
+			{
+				FieldsDecoder<T> decoder(message);
+				decodePlist(byteArray, size, decoder);
+			}
+
+			static void read(std::istream& stream, T& message)
+			{
+				FieldsDecoder<T> decoder(message);
+				decodePlist(stream, decoder);
+			}
+		};
+
+		// Writers for T with fields.  They take part in overload resolution
+		// only for those, everything else still converts to boost::any.
+
+		template<bool Condition>
+		struct EnableIfFields
+		{
+		};
+
+		template<>
+		struct EnableIfFields<true>
+		{
+			typedef void type;
+		};
+
+		template<typename T>
+		typename EnableIfFields<HasFields<T>::value>::type writePlistBinary(std::vector<char>& plist, const T& message)
+		{
+			PlistHelperData d;
+			d._offsetTable.push_back(0);
+			FieldCodec<T>::planBinary(d, message);
+			finishBinaryPlan(d);
+
+			plist.resize((size_t) d._outputSize);
+			d._output = (unsigned char*) &plist[0];
+			beginBinaryOutput(d);
+			FieldCodec<T>::writeBinary(d, message, 0);
+			finishBinaryOutput(d);
+		}
+
+		template<typename T>
+		typename EnableIfFields<HasFields<T>::value>::type writePlistBinary(std::ostream& stream, const T& message)
+		{
+			std::vector<char> plist;
+			writePlistBinary(plist, message);
+			stream.write(&plist[0], plist.size());
+		}
+
+		template<typename T>
+		typename EnableIfFields<HasFields<T>::value>::type writePlistBinary(const char* filename, const T& message)
+		{
+			std::ofstream stream(filename, std::ios::binary);
+			writePlistBinary(stream, message);
+			stream.close();
+		}
+
+		template<typename Sink, typename T>
+		void emitXMLFields(Sink& sink, const T& message)
+		{
+			writeXMLPrologue(sink);
+			FieldCodec<T>::writeXML(sink, message, 1);
+			writeXMLEpilogue(sink);
+		}
+
+		template<typename T>
+		typename EnableIfFields<HasFields<T>::value>::type writePlistXML(std::vector<char>& plist, const T& message)
+		{
+			XMLCountingSink counter;
+			emitXMLFields(counter, message);
+
+			plist.resize((size_t) counter.size());
+			XMLBufferSink sink(&plist[0]);
+			emitXMLFields(sink, message);
+
+			if(sink.used() != plist.size())
+				throw Error("Plist: xml plist size doesn't match its count");
+		}
+
+		template<typename T>
+		typename EnableIfFields<HasFields<T>::value>::type writePlistXML(std::ostream& stream, const T& message)
+		{
+			XMLStreamSink sink(stream);
+			emitXMLFields(sink, message);
+			sink.flush();
+		}
+
+		template<typename T>
+		typename EnableIfFields<HasFields<T>::value>::type writePlistXML(const char* filename, const T& message)
+		{
+			std::ofstream stream(filename, std::ios::binary);
+			writePlistXML(stream, message);
+			stream.close();
+		}
+}
+
+#endif
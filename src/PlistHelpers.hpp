@@ -0,0 +1,579 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+// Internal helpers shared between the Plist translation units.  Not part of
+// the public interface.
+
+#ifndef __PLIST_HELPERS_H__
+#define __PLIST_HELPERS_H__
+
+#include "Plist.hpp"
+#include "PlistXMLReader.hpp"
+#include <cstring>
+#include <deque>
+#include <ostream>
+
+namespace pugi
+{
+		class xml_node;
+}
+
+namespace Plist
+{
+		class Document;
+		class Value;
+
+		// Scratch vectors of the readers and writers, allocated from a
+		// memory_resource where std::pmr is available.
+
+#if defined(PLIST_HAS_PMR)
+		template<typename T>
+		struct ScratchVector
+		{
+			typedef std::pmr::vector<T> type;
+		};
+
+		inline memory_resource* defaultResource()
+		{
+			return std::pmr::get_default_resource();
+		}
+
+		template<typename T>
+		std::pmr::polymorphic_allocator<T> scratchAllocator(memory_resource* resource)
+		{
+			return std::pmr::polymorphic_allocator<T>(resource);
+		}
+#else
+		template<typename T>
+		struct ScratchVector
+		{
+			typedef std::vector<T> type;
+		};
+
+		inline memory_resource* defaultResource()
+		{
+			return 0;
+		}
+
+		template<typename T>
+		std::allocator<T> scratchAllocator(memory_resource*)
+		{
+			return std::allocator<T>();
+		}
+#endif
+
+		inline memory_resource* resourceOrDefault(memory_resource* resource)
+		{
+			return resource ? resource : defaultResource();
+		}
+
+		// A scalar value as the binary writer encodes it, used to unique
+		// repeated values so they share one object.  String and data
+		// contents aren't copied, they point into the message being written.
+
+		struct UniqueKey
+		{
+			unsigned char marker;
+			uint64_t value;
+			const char* bytes;
+			size_t size;
+		};
+
+		struct UniqueEntry
+		{
+			UniqueKey key;
+			uint64_t hash;
+			int32_t ref;
+		};
+
+		struct PlistHelperData
+		{
+			public:
+
+				// scratch tables are allocated from resource
+				explicit PlistHelperData(memory_resource* resource = defaultResource())
+					: _offsetTable(scratchAllocator<int32_t>(resource)),
+					_offsetByteSize(0), _offsetTableOffset(0), _objRefSize(0),
+					_refCount(0), _data(0), _dataSize(0),
+					_uniqueTable(scratchAllocator<UniqueEntry>(resource)), _uniqueCount(0),
+					_plan(scratchAllocator<int32_t>(resource)),
+					_planPosition(0), _nextRef(0), _plannedBytes(0), _plannedRefs(0),
+					_lastObjectBytes(0), _lastObjectRefs(0), _output(0),
+					_outputSize(0), _outputPosition(0) { }
+
+				// binary helper data
+				ScratchVector<int32_t>::type _offsetTable;
+				int32_t _offsetByteSize;
+				int64_t _offsetTableOffset;
+
+				int32_t _objRefSize;
+				int32_t _refCount;
+
+				// non-owning view over the binary plist being parsed.  The reader
+				// decodes objects in place from here.  When _offsetTable is
+				// empty, offsets are read lazily from the offset table in _data.
+				const unsigned char* _data;
+				int64_t _dataSize;
+
+				// binary writer table of values already given a ref, open
+				// addressing with linear probing.
+				ScratchVector<UniqueEntry>::type _uniqueTable;
+				size_t _uniqueCount;
+
+				// binary writer plan.  planBinaryPlist gives every object its ref
+				// and records the refs of each container's children in _plan,
+				// along with the sizes needed to size the output exactly.
+				// writePlistBinary replays the plan into _output.
+				ScratchVector<int32_t>::type _plan;
+				size_t _planPosition;
+				int32_t _nextRef;
+				int64_t _plannedBytes;
+				int64_t _plannedRefs;
+				int64_t _lastObjectBytes;
+				int64_t _lastObjectRefs;
+
+				// binary writer output, not owned
+				unsigned char* _output;
+				int64_t _outputSize;
+				int64_t _outputPosition;
+		};
+
+		// Counts what a read builds against its DecodeLimits and throws
+		// Plist::Error as soon as one is passed.  The readers call
+		// addObject() for every value, addBytes() for its string, key or
+		// data bytes, and enter() and leave() around each container.
+		// depth is where the value being read sits, for reads that start
+		// below the root.
+
+		class DecodeBudget
+		{
+			public:
+
+				explicit DecodeBudget(const DecodeLimits& limits = DecodeLimits(), int32_t depth = 0)
+					: _limits(limits), _objects(0), _bytes(0), _depth(depth) { }
+
+				void addObject()
+				{
+					if(++_objects > _limits.maxObjects)
+						throw Error("Plist: plist decodes into more objects than allowed");
+				}
+
+				void addBytes(size_t size)
+				{
+					_bytes += (int64_t) size;
+					if(_bytes > _limits.maxBytes)
+						throw Error("Plist: plist decodes into more bytes than allowed");
+				}
+
+				// a binary plist that contains itself is caught here too
+				void enter()
+				{
+					if(++_depth > _limits.maxDepth)
+						throw Error("Plist: plist nested deeper than allowed");
+				}
+
+				void leave()
+				{
+					--_depth;
+				}
+
+				int32_t depth() const
+				{
+					return _depth;
+				}
+
+			private:
+
+				DecodeLimits _limits;
+				int64_t _objects;
+				int64_t _bytes;
+				int32_t _depth;
+		};
+
+		// Assembles reader events into a boost::any tree.  Containers are built in
+		// place on a stack and swapped into their parent when they end, so nothing
+		// is copied.
+
+		class XMLPlistTreeBuilder
+		{
+			public:
+
+				XMLPlistTreeBuilder()
+					: _complete(false) { }
+
+				// returns true once the value begun by the first event is complete
+				bool add(XMLPlistReader::Event event, XMLPlistReader& reader);
+
+				boost::any& result() { return _result; }
+
+			private:
+
+				struct Frame
+				{
+					boost::any container;
+					std::string key;
+				};
+
+				void insert(boost::any& value);
+
+				std::deque<Frame> _frames;
+				boost::any _result;
+				bool _complete;
+		};
+
+		// xml parsing
+
+		// Puts content in value without copying it, content is left empty.
+		// Assigning a container to a boost::any copies it (before c++11).
+
+		template<typename T>
+		void moveIntoAny(T& content, boost::any& value)
+		{
+			value = T();
+			using std::swap;
+			swap(*boost::any_cast<T>(&value), content);
+		}
+
+		// scalar value of the xml element nodeName with text content, a
+		// string's text is moved into result
+		void parseXMLValue(const char* nodeName, std::string& text, boost::any& result);
+
+		// Text of an xml key or scalar, its pcdata and cdata children joined
+		// the way XMLPlistReader reads them.  Points into the node when it
+		// has at most one child, otherwise into buffer.
+		const char* xmlNodeText(const pugi::xml_node& node, std::string& buffer);
+
+		// binary parsing
+
+		void initBinaryPlist(PlistHelperData& d, const unsigned char* byteArray, int64_t size);
+		boost::any parseBinary(const PlistHelperData& d, int objRef);
+		std::string parseBinaryKey(const PlistHelperData& d, int objRef);
+
+		// Compares the dictionary key at keyRef with the utf-8 key, in the
+		// order std::string sorts them, without decoding it.
+		int compareBinaryKey(const PlistHelperData& d, int32_t keyRef, const char* key, size_t size);
+
+		// whether a dictionary's keys are in order, worked out on its first
+		// failed binary search and kept by the caller for later lookups
+		enum BinaryKeyOrder
+		{
+			BinaryKeysUnchecked,
+			BinaryKeysSorted,
+			BinaryKeysUnsorted
+		};
+
+		// index of key among the entryCount keys of a dictionary whose refs
+		// start at refStartPosition, or -1.  Binary search; a miss is only
+		// followed by a linear scan when the keys turn out not to be sorted,
+		// as in plists from other writers (e.g. CoreFoundation).
+		int32_t findBinaryKey(const PlistHelperData& d, int64_t refStartPosition, int32_t entryCount,
+				const char* key, size_t size, BinaryKeyOrder& order);
+		std::vector<int32_t> getRefsForContainers(const PlistHelperData& d, int objRef);
+		int32_t getContainerRefs(const PlistHelperData& d, int objRef, int64_t& refStartPosition);
+		int32_t getRef(const PlistHelperData& d, int64_t refStartPosition, int32_t index);
+		int64_t parseBinaryInt(const PlistHelperData& d, int headerPosition, int& intByteCount);
+		double parseBinaryReal(const PlistHelperData& d, int headerPosition);
+		Date parseBinaryDate(const PlistHelperData& d, int headerPosition);
+		bool parseBinaryBool(const PlistHelperData& d, int headerPosition);
+		std::string parseBinaryString(const PlistHelperData& d, int objRef);
+		std::string parseBinaryUnicode(const PlistHelperData& d, int headerPosition);
+		data_type parseBinaryByteArray(const PlistHelperData& d, int headerPosition);
+		void parseTrailer(PlistHelperData& d, const unsigned char* trailer);
+		void checkBinaryTrailer(const PlistHelperData& d, int64_t size);
+		void parseOffsetTable(PlistHelperData& d, const unsigned char* offsetTableBytes, int64_t size);
+		int32_t getCount(const PlistHelperData& d, int bytePosition, unsigned char headerByte, int& startOffset);
+		int32_t getOffset(const PlistHelperData& d, int objRef);
+		const unsigned char* getObjectBytes(const PlistHelperData& d, int64_t index, int64_t size);
+
+		// building a Document, in PlistDocument.cpp.  The document's block
+		// and the builder's scratch come from resource, or new when it is 0.
+
+		struct DocumentMessage
+		{
+			DocumentMessage(Document& target, memory_resource* blockResource,
+					const DecodeLimits& decodeLimits = DecodeLimits())
+				: document(target), resource(blockResource), limits(decodeLimits) { }
+
+			Document& document;
+			memory_resource* resource;
+			DecodeLimits limits;
+		};
+
+		void parseBinaryPlist(const PlistHelperData& d, DocumentMessage& message);
+		void parseXMLPlist(pugi::xml_node& rootNode, DocumentMessage& message);
+
+		// reading a binary plist on several threads, in PlistParallel.cpp.
+		// threadCount 0 is one thread per core.
+
+		struct ParallelMessage
+		{
+			ParallelMessage(boost::any& value, unsigned threads)
+				: message(value), threadCount(threads) { }
+
+			boost::any& message;
+			unsigned threadCount;
+		};
+
+		void parseBinaryPlist(const PlistHelperData& d, ParallelMessage& message);
+		void parseXMLPlist(pugi::xml_node& rootNode, ParallelMessage& message);
+
+		// splits a path of keys separated by '/' into its components, an
+		// empty path has none
+		void splitPath(const std::string& path, std::vector<std::string>& components);
+
+		// Decodes a plist into something other than a tree, e.g. a
+		// PLIST_FIELDS struct.  decodePlist detects the format and hands
+		// the decoder the binary plist or the xml root.
+
+		class PlistDecoder
+		{
+			public:
+
+				virtual ~PlistDecoder() { }
+
+				virtual void decodeBinary(const PlistHelperData& d) = 0;
+				virtual void decodeXML(pugi::xml_node& rootNode) = 0;
+		};
+
+		void decodePlist(const char* byteArray, int64_t size, PlistDecoder& decoder);
+		void decodePlist(std::istream& stream, PlistDecoder& decoder);
+		void decodePlist(const char* filename, PlistDecoder& decoder);
+
+		// Decoding a value in place, for decoders with boost::any or Value
+		// members.  Policy is MapDictionaryPolicy, the one instantiated.
+		// Without a budget the value is read with the default limits.
+
+		template<typename Policy>
+		void parse(pugi::xml_node& node, boost::any& value);
+		template<typename Policy>
+		void parseBinary(const PlistHelperData& d, int objRef, boost::any& value);
+		void parse(pugi::xml_node& node, Value& value);
+		void parseBinary(const PlistHelperData& d, int objRef, Value& value);
+
+		template<typename Policy>
+		void parse(pugi::xml_node& node, boost::any& value, DecodeBudget& budget);
+		template<typename Policy>
+		void parseBinary(const PlistHelperData& d, int objRef, boost::any& value, DecodeBudget& budget);
+		void parse(pugi::xml_node& node, Value& value, DecodeBudget& budget);
+		void parseBinary(const PlistHelperData& d, int objRef, Value& value, DecodeBudget& budget);
+
+		// binary writing
+
+		// Node is boost::any or Value, both are instantiated in Plist.cpp
+
+		template<typename Node>
+		void planBinaryPlist(
+				PlistHelperData& d,
+				const Node& message);
+		template<typename Node>
+		void writePlistBinary(
+				PlistHelperData& d,
+				const Node& message);
+
+		// The steps of the two above, for writers of other nodes.  A plan
+		// starts with the root's ref and ends with finishBinaryPlan, the
+		// output is written between beginBinaryOutput and
+		// finishBinaryOutput.
+
+		void finishBinaryPlan(PlistHelperData& d);
+		void beginBinaryOutput(PlistHelperData& d);
+		void finishBinaryOutput(PlistHelperData& d);
+
+		template<typename Node>
+		void planBinary(PlistHelperData& d, const Node& obj);
+		template<typename Node>
+		void writeBinary(PlistHelperData& d, const Node& obj, int32_t objRef);
+		template<typename Node>
+		int32_t binaryRef(PlistHelperData& d, const Node& obj);
+
+		int32_t uniqueRef(PlistHelperData& d, const UniqueKey& key);
+		int64_t binaryScalarSize(const UniqueKey& key);
+		int64_t binaryHeaderSize(uint64_t count);
+		int32_t byteCount(uint64_t value);
+		void writeBinaryHeader(PlistHelperData& d, unsigned char marker, uint64_t count);
+		void writeBinaryRefs(PlistHelperData& d, size_t first, size_t count);
+		void writeBinaryScalar(PlistHelperData& d, const UniqueKey& key);
+
+		// Output sinks for the direct xml writer.  The writer only needs
+		// write() and put(), so it is templated on the sink rather than
+		// going through a virtual interface.
+
+		// buffers writes to a stream
+
+		class XMLStreamSink
+		{
+			public:
+
+				XMLStreamSink(std::ostream& stream)
+					: _stream(stream), _used(0) { }
+
+				void write(const char* bytes, size_t size)
+				{
+					if(_used + size > sizeof(_buffer))
+					{
+						flush();
+						if(size > sizeof(_buffer))
+						{
+							_stream.write(bytes, size);
+							return;
+						}
+					}
+					memcpy(_buffer + _used, bytes, size);
+					_used += size;
+				}
+
+				void put(char c)
+				{
+					if(_used == sizeof(_buffer))
+						flush();
+					_buffer[_used++] = c;
+				}
+
+				void flush()
+				{
+					_stream.write(_buffer, _used);
+					_used = 0;
+				}
+
+			private:
+
+				std::ostream& _stream;
+				char _buffer[16384];
+				size_t _used;
+		};
+
+		// writes into memory already sized with XMLCountingSink
+
+		class XMLBufferSink
+		{
+			public:
+
+				XMLBufferSink(char* output)
+					: _output(output), _used(0) { }
+
+				void write(const char* bytes, size_t size)
+				{
+					memcpy(_output + _used, bytes, size);
+					_used += size;
+				}
+
+				void put(char c)
+				{
+					_output[_used++] = c;
+				}
+
+				// size bytes for the caller to fill
+				char* reserve(size_t size)
+				{
+					char* bytes = _output + _used;
+					_used += size;
+					return bytes;
+				}
+
+				size_t used() const
+				{
+					return _used;
+				}
+
+			private:
+
+				char* _output;
+				size_t _used;
+		};
+
+		// counts the bytes that would be written
+
+		class XMLCountingSink
+		{
+			public:
+
+				XMLCountingSink()
+					: _size(0) { }
+
+				void write(const char*, size_t size)
+				{
+					_size += size;
+				}
+
+				void put(char)
+				{
+					++_size;
+				}
+
+				int64_t size() const
+				{
+					return _size;
+				}
+
+			private:
+
+				int64_t _size;
+		};
+
+		// Pieces of the direct xml writer, instantiated in Plist.cpp for
+		// the three sinks above.  Each value is written on its own line at
+		// depth tabs of indent.
+
+		template<typename Sink>
+		void writeXMLPrologue(Sink& sink);
+		template<typename Sink>
+		void writeXMLEpilogue(Sink& sink);
+		template<typename Sink>
+		void writeXMLIndent(Sink& sink, int depth);
+		template<typename Sink>
+		void writeXMLKey(Sink& sink, const char* key, size_t size, int depth);
+		template<typename Sink>
+		void writeXMLStringValue(Sink& sink, const char* text, size_t size, int depth);
+		template<typename Sink>
+		void writeXMLInteger(Sink& sink, int64_t value, int depth);
+		// Real is double or float
+		template<typename Sink, typename Real>
+		void writeXMLReal(Sink& sink, Real value, int depth);
+		template<typename Sink>
+		void writeXMLBoolean(Sink& sink, bool value, int depth);
+		template<typename Sink>
+		void writeXMLDate(Sink& sink, const Date& value, int depth);
+		template<typename Sink>
+		void writeXMLData(Sink& sink, const char* bytes, size_t size, int depth);
+		template<>
+		void writeXMLData(XMLCountingSink& sink, const char* bytes, size_t size, int depth);
+		template<>
+		void writeXMLData(XMLBufferSink& sink, const char* bytes, size_t size, int depth);
+		template<typename Sink>
+		void emitXMLNode(Sink& sink, const boost::any& obj, int depth);
+		template<typename Sink>
+		void emitXMLNode(Sink& sink, const Value& obj, int depth);
+
+		// xml writing through a pugixml document, the way writePlistXML
+		// worked before it wrote the text directly.  Kept as the reference
+		// the direct writer's output is checked against.
+
+		void writePlistXMLDocument(
+				std::ostream& stream,
+				const boost::any& message);
+
+} // namespace Plist
+
+#endif
@@ -0,0 +1,343 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+
+#include "PlistHelpers.hpp"
+#include "pugixml.hpp"
+
+#if __cplusplus >= 201103L
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace Plist {
+
+#if __cplusplus >= 201103L
+
+// A binary plist can be decoded from any ref, so the values of a large
+// array or dictionary are decoded on whichever thread gets to them.  Each
+// thread has a deque of tasks, takes its newest and steals the oldest of
+// another thread's when it runs out.  Every container's slots are made
+// before its values are decoded, so threads fill them in place and the
+// tree needs no stitching afterwards.
+
+namespace
+{
+	// containers referring to at least this many objects are shared out,
+	// smaller ones are decoded by the thread that finds them
+	const int32_t SplitRefCount = 64;
+
+	// a task decodes at most this many values, halving its range and
+	// leaving the other half to be stolen until it is this small
+	const int32_t TaskRefCount = 64;
+
+	// the values of one container, waiting for their slots to be filled.
+	// A slot is 0 for a dictionary value whose key appears again later,
+	// readPlist keeps the later value.
+	struct ContainerJob
+	{
+		std::vector<int32_t> refs;
+		std::vector<boost::any*> slots;
+		int32_t depth;
+	};
+
+	struct Task
+	{
+		ContainerJob* job;
+		int32_t first;
+		int32_t last;
+	};
+
+	// jobs are only added by the owning thread, a deque never moves them
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+		std::deque<ContainerJob> jobs;
+	};
+
+	// marks the decode failed unless dismissed, so an exception thrown on
+	// one thread stops the others
+	class FailureGuard
+	{
+		public:
+
+			explicit FailureGuard(std::atomic<bool>& failed)
+				: _failed(failed), _dismissed(false) { }
+
+			~FailureGuard()
+			{
+				if(!_dismissed)
+					_failed = true;
+			}
+
+			void dismiss()
+			{
+				_dismissed = true;
+			}
+
+		private:
+
+			std::atomic<bool>& _failed;
+			bool _dismissed;
+	};
+
+	class ParallelDecoder
+	{
+		public:
+
+			ParallelDecoder(const PlistHelperData& d, unsigned threadCount)
+				: _d(d), _queues(threadCount), _pending(0), _failed(false) { }
+
+			void decode(boost::any& message);
+
+		private:
+
+			void run(size_t index);
+			bool pop(size_t index, Task& task);
+			bool steal(size_t index, Task& task);
+			void push(size_t index, const Task& task);
+			void runTask(size_t index, Task task);
+			void decodeValue(size_t index, int objRef, boost::any& value, DecodeBudget& budget);
+			void beginContainer(int objRef, unsigned char type, boost::any& value,
+					std::vector<int32_t>& refs, std::vector<boost::any*>& slots);
+
+			const PlistHelperData& _d;
+			std::deque<WorkQueue> _queues;
+
+			// tasks pushed and not yet finished
+			std::atomic<int64_t> _pending;
+			std::atomic<bool> _failed;
+	};
+
+	void ParallelDecoder::decode(boost::any& message)
+	{
+		DecodeBudget budget;
+		decodeValue(0, 0, message, budget);
+		if(_pending == 0)
+			return;
+
+		std::vector<std::future<void> > workers;
+		for(size_t i = 1; i < _queues.size(); ++i)
+			workers.push_back(std::async(std::launch::async, &ParallelDecoder::run, this, i));
+		run(0);
+
+		// rethrows what a worker threw
+		for(size_t i = 0; i < workers.size(); ++i)
+			workers[i].get();
+	}
+
+	void ParallelDecoder::run(size_t index)
+	{
+		FailureGuard guard(_failed);
+		Task task;
+		while(!_failed)
+		{
+			if(pop(index, task) || steal(index, task))
+			{
+				runTask(index, task);
+				--_pending;
+			}
+			else if(_pending == 0)
+				break;
+			else
+				std::this_thread::yield();
+		}
+		guard.dismiss();
+	}
+
+	bool ParallelDecoder::pop(size_t index, Task& task)
+	{
+		WorkQueue& queue = _queues[index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if(queue.tasks.empty())
+			return false;
+		task = queue.tasks.back();
+		queue.tasks.pop_back();
+		return true;
+	}
+
+	bool ParallelDecoder::steal(size_t index, Task& task)
+	{
+		for(size_t i = 1; i < _queues.size(); ++i)
+		{
+			WorkQueue& queue = _queues[(index + i) % _queues.size()];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if(!queue.tasks.empty())
+			{
+				task = queue.tasks.front();
+				queue.tasks.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void ParallelDecoder::push(size_t index, const Task& task)
+	{
+		++_pending;
+		WorkQueue& queue = _queues[index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(task);
+	}
+
+	void ParallelDecoder::runTask(size_t index, Task task)
+	{
+		while(task.last - task.first > TaskRefCount)
+		{
+			int32_t middle = task.first + (task.last - task.first) / 2;
+			Task rest = { task.job, middle, task.last };
+			push(index, rest);
+			task.last = middle;
+		}
+
+		ContainerJob& job = *task.job;
+		DecodeBudget budget(DecodeLimits(), job.depth);
+		for(int32_t i = task.first; i < task.last; ++i)
+		{
+			if(job.slots[i])
+				decodeValue(index, job.refs[i], *job.slots[i], budget);
+			else
+			{
+				// decoded only to fail as readPlist would
+				boost::any overwritten;
+				parseBinary<MapDictionaryPolicy>(_d, job.refs[i], overwritten, budget);
+			}
+		}
+	}
+
+	void ParallelDecoder::decodeValue(size_t index, int objRef, boost::any& value, DecodeBudget& budget)
+	{
+		unsigned char type = *getObjectBytes(_d, getOffset(_d, objRef), 1) & 0xF0;
+		if((type != 0xA0) && (type != 0xD0))
+		{
+			parseBinary<MapDictionaryPolicy>(_d, objRef, value, budget);
+			return;
+		}
+
+		budget.addObject();
+		budget.enter();
+
+		std::vector<int32_t> refs;
+		std::vector<boost::any*> slots;
+		beginContainer(objRef, type, value, refs, slots);
+
+		int32_t count = (int32_t) slots.size();
+		if(refs.size() >= (size_t) SplitRefCount)
+		{
+			WorkQueue& queue = _queues[index];
+			queue.jobs.push_back(ContainerJob());
+			ContainerJob& job = queue.jobs.back();
+			job.refs.swap(refs);
+			job.slots.swap(slots);
+			job.depth = budget.depth();
+
+			Task task = { &job, 0, count };
+			push(index, task);
+		}
+		else
+		{
+			for(int32_t i = 0; i < count; ++i)
+			{
+				if(slots[i])
+					decodeValue(index, refs[i], *slots[i], budget);
+				else
+				{
+					boost::any overwritten;
+					parseBinary<MapDictionaryPolicy>(_d, refs[i], overwritten, budget);
+				}
+			}
+		}
+
+		budget.leave();
+	}
+
+	// makes the container at objRef in value with a slot for each of its
+	// values, refs are left holding the refs of the values
+	void ParallelDecoder::beginContainer(int objRef, unsigned char type, boost::any& value,
+			std::vector<int32_t>& refs, std::vector<boost::any*>& slots)
+	{
+		refs = getRefsForContainers(_d, objRef);
+
+		if(type == 0xA0)
+		{
+			value = array_type();
+			array_type& array = *boost::any_cast<array_type>(&value);
+			array.resize(refs.size());
+			slots.resize(refs.size());
+			for(size_t i = 0; i < refs.size(); ++i)
+				slots[i] = &array[i];
+			return;
+		}
+
+		size_t count = refs.size() / 2;
+		value = dictionary_type();
+		dictionary_type& dict = *boost::any_cast<dictionary_type>(&value);
+		slots.resize(count);
+		for(size_t i = 0; i < count; ++i)
+		{
+			size_t size = dict.size();
+			boost::any& slot = MapDictionaryPolicy::insert(dict, parseBinaryKey(_d, refs[i]));
+			if(dict.size() == size)
+			{
+				for(size_t j = 0; j < i; ++j)
+					if(slots[j] == &slot)
+						slots[j] = 0;
+			}
+			slots[i] = &slot;
+		}
+		refs.erase(refs.begin(), refs.begin() + count);
+	}
+}
+
+void parseBinaryPlist(const PlistHelperData& d, ParallelMessage& message)
+{
+	unsigned threadCount = message.threadCount;
+	if(threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	ParallelDecoder decoder(d, threadCount);
+	decoder.decode(message.message);
+}
+
+#else
+
+void parseBinaryPlist(const PlistHelperData& d, ParallelMessage& message)
+{
+	parseBinary<MapDictionaryPolicy>(d, 0, message.message);
+}
+
+#endif
+
+void parseXMLPlist(pugi::xml_node& rootNode, ParallelMessage& message)
+{
+	parse<MapDictionaryPolicy>(rootNode, message.message);
+}
+
+} // namespace Plist
@@ -0,0 +1,385 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+
+#include "Plist.hpp"
+#include "PlistEndian.hpp"
+#include "PlistHelpers.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if !defined(_WIN32) && !defined(_WIN64)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Plist {
+
+namespace
+{
+	// boost::any holder and container slot of a decoded object, roughly
+	const int64_t ApproximateNodeSize = 48;
+
+	// xml is read in growing prefixes until the root tag turns up
+	const int64_t XMLPrefixSize = 4096;
+
+	// the plist bytes, handing out size bytes at offset.  The bytes stay
+	// valid until the next read.
+
+	class MemorySource
+	{
+		public:
+
+			MemorySource(const char* byteArray, int64_t size)
+				: _data((const unsigned char*) byteArray), _size(size) { }
+
+			int64_t size() const
+			{
+				return _size;
+			}
+
+			const unsigned char* read(int64_t offset, int64_t size)
+			{
+				if((offset < 0) || (size < 0) || (offset > _size - size))
+					throw Error("Plist: probePlist read past the end of the plist");
+				return _data + offset;
+			}
+
+		private:
+
+			const unsigned char* _data;
+			int64_t _size;
+	};
+
+	// reads just the ranges asked for, with pread where there is one
+
+	class FileSource
+	{
+		public:
+
+			explicit FileSource(const char* filename)
+			{
+#if !defined(_WIN32) && !defined(_WIN64)
+				_fd = open(filename, O_RDONLY);
+				if(_fd < 0)
+					throw Error("Can't open file.");
+
+				struct stat st;
+				if(fstat(_fd, &st) != 0)
+				{
+					close(_fd);
+					throw Error("Can't open file.");
+				}
+				_size = (int64_t) st.st_size;
+#else
+				_stream.open(filename, std::ios::binary);
+				if(!_stream)
+					throw Error("Can't open file.");
+				_stream.seekg(0, std::ios::end);
+				_size = (int64_t) _stream.tellg();
+#endif
+				if(_size == 0)
+				{
+#if !defined(_WIN32) && !defined(_WIN64)
+					close(_fd);
+#endif
+					throw Error("Can't read zero length data");
+				}
+			}
+
+			~FileSource()
+			{
+#if !defined(_WIN32) && !defined(_WIN64)
+				close(_fd);
+#endif
+			}
+
+			int64_t size() const
+			{
+				return _size;
+			}
+
+			const unsigned char* read(int64_t offset, int64_t size)
+			{
+				if((offset < 0) || (size < 0) || (offset > _size - size))
+					throw Error("Plist: probePlist read past the end of the plist");
+
+				_buffer.resize((size_t) size + 1);
+				unsigned char* bytes = &_buffer[0];
+#if !defined(_WIN32) && !defined(_WIN64)
+				for(int64_t done = 0; done < size; )
+				{
+					ssize_t count = pread(_fd, bytes + done, (size_t) (size - done), (off_t) (offset + done));
+					if(count <= 0)
+						throw Error("Plist: probePlist can't read the file");
+					done += count;
+				}
+#else
+				_stream.seekg(offset);
+				_stream.read((char*) bytes, size);
+				if(_stream.gcount() != size)
+					throw Error("Plist: probePlist can't read the file");
+#endif
+				return bytes;
+			}
+
+		private:
+
+			FileSource(const FileSource&);
+			FileSource& operator=(const FileSource&);
+
+#if !defined(_WIN32) && !defined(_WIN64)
+			int _fd;
+#else
+			std::ifstream _stream;
+#endif
+			int64_t _size;
+			std::vector<unsigned char> _buffer;
+	};
+
+	template<typename Source>
+	void probeBinary(Source& source, PlistInfo& info)
+	{
+		int64_t size = source.size();
+		if(size < 8 + 32)
+			throw Error("Plist: binary plist too short to hold a trailer");
+
+		PlistHelperData d;
+		parseTrailer(d, source.read(size - 32, 32));
+		checkBinaryTrailer(d, size);
+
+		info.format = BinaryFormat;
+		info.objectCount = d._refCount;
+		info.offsetByteSize = d._offsetByteSize;
+		info.objRefSize = d._objRefSize;
+		info.approximateSize = (d._offsetTableOffset - 8) + (int64_t) d._refCount * ApproximateNodeSize;
+
+		// readPlist decodes from ref 0, whatever the trailer's top object
+
+		uint64_t offset = loadBigEndian(source.read(d._offsetTableOffset, d._offsetByteSize), d._offsetByteSize);
+		if((offset < 8) || (offset >= (uint64_t) d._offsetTableOffset))
+			throw Error("Plist: binary plist object offset out of bounds");
+
+		// a marker and at most a 9 byte count
+		int64_t headerSize = std::min((int64_t) 10, d._offsetTableOffset - (int64_t) offset);
+		const unsigned char* header = source.read((int64_t) offset, headerSize);
+		unsigned char marker = header[0];
+
+		switch(marker & 0xF0)
+		{
+			case 0x00:
+				if((marker != 0x08) && (marker != 0x09))
+					throw Error("This type is not supported");
+				info.rootType = PlistInfo::BooleanType;
+				return;
+			case 0x10:
+				info.rootType = PlistInfo::IntegerType;
+				return;
+			case 0x20:
+				info.rootType = PlistInfo::RealType;
+				return;
+			case 0x30:
+				info.rootType = PlistInfo::DateType;
+				return;
+			case 0x40:
+				info.rootType = PlistInfo::DataType;
+				break;
+			case 0x50:
+			case 0x60:
+				info.rootType = PlistInfo::StringType;
+				break;
+			case 0xA0:
+				info.rootType = PlistInfo::ArrayType;
+				break;
+			case 0xD0:
+				info.rootType = PlistInfo::DictionaryType;
+				break;
+			default:
+				throw Error("This type is not supported");
+		}
+
+		if((marker & 0x0F) != 0x0F)
+		{
+			info.rootCount = marker & 0x0F;
+			return;
+		}
+
+		int32_t countSize = (headerSize >= 2) ? 1 << (header[1] & 0x0F) : 0;
+		if((headerSize < 2) || ((header[1] & 0xF0) != 0x10) || (countSize > 8) || (2 + countSize > headerSize))
+			throw Error("Plist: binary plist object count out of bounds");
+		info.rootCount = (int64_t) loadBigEndian(header + 2, countSize);
+	}
+
+	bool isXMLSpace(unsigned char c)
+	{
+		return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+	}
+
+	bool startsWith(const char* text, const char* end, const char* prefix)
+	{
+		size_t size = strlen(prefix);
+		return ((size_t) (end - text) >= size) && (memcmp(text, prefix, size) == 0);
+	}
+
+	// Finds the name of the element in plist, skipping the declaration,
+	// doctype, comments and processing instructions before it.  False if
+	// the text ends first.
+	bool findXMLRoot(const char* text, const char* end, std::string& name)
+	{
+		const char* c = text;
+		if(startsWith(c, end, "\xEF\xBB\xBF"))
+			c += 3;
+
+		bool inPlist = false;
+		for(;;)
+		{
+			while((c < end) && isXMLSpace(*c))
+				++c;
+			if(c == end)
+				return false;
+			if(*c != '<')
+				throw Error("Plist: probePlist found neither a binary nor an xml plist");
+
+			const char* close;
+			if(startsWith(c, end, "<?"))
+				close = std::search(c, end, "?>", "?>" + 2);
+			else if(startsWith(c, end, "<!--"))
+				close = std::search(c, end, "-->", "-->" + 3);
+			else if(startsWith(c, end, "<!"))
+			{
+				// a doctype may hold an internal subset in brackets
+				int brackets = 0;
+				for(close = c; close < end; ++close)
+				{
+					if(*close == '[')
+						++brackets;
+					else if(*close == ']')
+						--brackets;
+					else if((*close == '>') && (brackets <= 0))
+						break;
+				}
+			}
+			else
+			{
+				const char* nameEnd = c + 1;
+				while((nameEnd < end) && !isXMLSpace(*nameEnd) && (*nameEnd != '>') && (*nameEnd != '/'))
+					++nameEnd;
+				if(nameEnd == end)
+					return false;
+
+				std::string tag(c + 1, nameEnd);
+				if(inPlist)
+				{
+					name = tag;
+					return true;
+				}
+				if(tag != "plist")
+					throw Error("Plist: probePlist found no plist element");
+
+				close = std::find(nameEnd, end, '>');
+				if((close < end) && (close[-1] == '/'))
+					throw Error("Plist: probePlist found an empty plist element");
+				inPlist = true;
+			}
+
+			if(close >= end)
+				return false;
+			c = std::find(close, end, '>') + 1;
+		}
+	}
+
+	template<typename Source>
+	void probeXML(Source& source, PlistInfo& info)
+	{
+		int64_t size = source.size();
+		std::string name;
+		for(int64_t prefixSize = std::min(XMLPrefixSize, size); ; prefixSize = std::min(prefixSize * 2, size))
+		{
+			const char* text = (const char*) source.read(0, prefixSize);
+			if(findXMLRoot(text, text + prefixSize, name))
+				break;
+			if(prefixSize == size)
+				throw Error("Plist: probePlist found no root element");
+		}
+
+		info.format = XMLFormat;
+		info.approximateSize = size;
+		if(name == "dict")
+			info.rootType = PlistInfo::DictionaryType;
+		else if(name == "array")
+			info.rootType = PlistInfo::ArrayType;
+		else if(name == "string")
+			info.rootType = PlistInfo::StringType;
+		else if(name == "integer")
+			info.rootType = PlistInfo::IntegerType;
+		else if(name == "real")
+			info.rootType = PlistInfo::RealType;
+		else if(name == "date")
+			info.rootType = PlistInfo::DateType;
+		else if(name == "data")
+			info.rootType = PlistInfo::DataType;
+		else if((name == "true") || (name == "false"))
+			info.rootType = PlistInfo::BooleanType;
+		else
+			throw Error("Plist: probePlist found unknown root element " + name);
+	}
+
+	template<typename Source>
+	PlistInfo probe(Source& source)
+	{
+		PlistInfo info;
+		if(source.size() <= 0)
+			throw Error("Plist: Empty plist data");
+
+		if((source.size() >= 8) && (memcmp(source.read(0, 8), "bplist00", 8) == 0))
+			probeBinary(source, info);
+		else
+			probeXML(source, info);
+		return info;
+	}
+}
+
+PlistInfo::PlistInfo()
+	: format(XMLFormat), rootType(DictionaryType), rootCount(-1),
+	objectCount(-1), offsetByteSize(-1), objRefSize(-1), approximateSize(0)
+{
+}
+
+PlistInfo probePlist(const char* byteArray, int64_t size)
+{
+	if(!byteArray)
+		throw Error("Plist: Empty plist data");
+	MemorySource source(byteArray, size);
+	return probe(source);
+}
+
+PlistInfo probePlist(const char* filename)
+{
+	FileSource source(filename);
+	return probe(source);
+}
+
+} // namespace Plist
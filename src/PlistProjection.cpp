@@ -0,0 +1,184 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+
+#include "PlistProjection.hpp"
+#include "PlistHelpers.hpp"
+#include <algorithm>
+
+namespace Plist {
+
+namespace
+{
+	struct EdgeKeyLess
+	{
+		template<typename Edge>
+		bool operator()(const Edge& edge, const std::string& key) const
+		{
+			return edge.key < key;
+		}
+	};
+}
+
+KeyPathSet::KeyPathSet()
+	: _nodes(1)
+{
+	_nodes[0].elements = -1;
+	_nodes[0].whole = false;
+}
+
+void KeyPathSet::add(const std::string& path)
+{
+	std::vector<std::string> components;
+	splitPath(path, components);
+	add(components);
+}
+
+void KeyPathSet::add(const std::vector<std::string>& path)
+{
+	int32_t node = 0;
+	for(size_t i = 0; (i < path.size()) && !_nodes[node].whole; ++i)
+	{
+		int32_t next;
+		if(path[i] == "*")
+			next = _nodes[node].elements;
+		else
+		{
+			std::vector<Edge>& keys = _nodes[node].keys;
+			std::vector<Edge>::iterator it = std::lower_bound(keys.begin(), keys.end(), path[i], EdgeKeyLess());
+			next = ((it != keys.end()) && (it->key == path[i])) ? it->node : -1;
+		}
+
+		if(next < 0)
+		{
+			next = (int32_t) _nodes.size();
+			_nodes.push_back(Node());
+			_nodes.back().elements = -1;
+			_nodes.back().whole = false;
+
+			if(path[i] == "*")
+				_nodes[node].elements = next;
+			else
+			{
+				std::vector<Edge>& keys = _nodes[node].keys;
+				Edge edge;
+				edge.key = path[i];
+				edge.node = next;
+				keys.insert(std::lower_bound(keys.begin(), keys.end(), path[i], EdgeKeyLess()), edge);
+			}
+		}
+		node = next;
+	}
+
+	// a path ending here takes the whole value, paths below it are moot
+	Node& end = _nodes[node];
+	end.whole = true;
+	end.keys.clear();
+	end.elements = -1;
+}
+
+// decodes what node selects of objRef into value, false if node doesn't
+// apply to it
+
+bool KeyPathSet::project(const PlistHelperData& d, int32_t node, int32_t objRef, boost::any& value, DecodeBudget& budget) const
+{
+	const Node& paths = _nodes[node];
+	if(paths.whole)
+	{
+		parseBinary<MapDictionaryPolicy>(d, objRef, value, budget);
+		return true;
+	}
+
+	unsigned char type = *getObjectBytes(d, getOffset(d, objRef), 1) & 0xF0;
+	if((type == 0xD0) && !paths.keys.empty())
+	{
+		int64_t refStartPosition;
+		int32_t entryCount = getContainerRefs(d, objRef, refStartPosition) / 2;
+
+		budget.addObject();
+		budget.enter();
+		value = dictionary_type();
+		dictionary_type& dict = *boost::any_cast<dictionary_type>(&value);
+		BinaryKeyOrder order = BinaryKeysUnchecked;
+		for(size_t i = 0; i < paths.keys.size(); ++i)
+		{
+			const Edge& edge = paths.keys[i];
+			int32_t index = findBinaryKey(d, refStartPosition, entryCount, edge.key.data(), edge.key.size(), order);
+			if(index < 0)
+				continue;
+
+			boost::any entry;
+			if(project(d, edge.node, getRef(d, refStartPosition, index + entryCount), entry, budget))
+			{
+				budget.addBytes(edge.key.size());
+				MapDictionaryPolicy::insert(dict, edge.key).swap(entry);
+			}
+		}
+		budget.leave();
+		return true;
+	}
+
+	if((type == 0xA0) && (paths.elements >= 0))
+	{
+		std::vector<int32_t> refs = getRefsForContainers(d, objRef);
+
+		budget.addObject();
+		budget.enter();
+		value = array_type();
+		array_type& array = *boost::any_cast<array_type>(&value);
+		array.reserve(refs.size());
+		for(size_t i = 0; i < refs.size(); ++i)
+		{
+			boost::any element;
+			if(project(d, paths.elements, refs[i], element, budget))
+			{
+				array.push_back(boost::any());
+				array.back().swap(element);
+			}
+		}
+		budget.leave();
+		return true;
+	}
+
+	return false;
+}
+
+void projectPlist(const char* byteArray, int64_t size, const KeyPathSet& paths, boost::any& message)
+{
+	const unsigned char* bytes = (const unsigned char*) byteArray;
+	if(!bytes || (size < 8) || (std::string((const char*) bytes, 8) != "bplist00"))
+		throw Error("Plist: projectPlist requires a binary plist");
+
+	// only the trailer is read, offsets are looked up as refs are followed
+
+	PlistHelperData d;
+	initBinaryPlist(d, bytes, size);
+
+	DecodeBudget budget;
+	message = boost::any();
+	paths.project(d, 0, 0, message, budget);
+}
+
+} // namespace Plist
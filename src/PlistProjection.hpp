@@ -0,0 +1,94 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+
+#ifndef __PLIST_PROJECTION_H__
+#define __PLIST_PROJECTION_H__
+
+#include "Plist.hpp"
+
+namespace Plist
+{
+		struct PlistHelperData;
+		class DecodeBudget;
+
+		// Key paths to pull out of binary plists, compiled once into a tree
+		// of keys and used for any number of reads.  Paths are dictionary
+		// keys separated by '/', "*" stands for every element of an array:
+		//
+		//		Plist::KeyPathSet paths;
+		//		paths.add("CFBundleIdentifier");
+		//		paths.add("Items/*/id");
+		//		paths.add("Meta/version");
+		//
+		//		boost::any message;
+		//		Plist::projectPlist(&plist[0], plist.size(), paths, message);
+
+		class KeyPathSet
+		{
+			public:
+
+				KeyPathSet();
+
+				void add(const std::string& path);
+
+				// one component each, for keys holding a '/'
+				void add(const std::vector<std::string>& path);
+
+			private:
+
+				friend void projectPlist(const char* byteArray, int64_t size, const KeyPathSet& paths, boost::any& message);
+
+				struct Edge
+				{
+					std::string key;
+					int32_t node;
+				};
+
+				// keys are sorted, elements is the node "*" leads to or -1,
+				// and a whole node ends a path, its value is decoded entirely
+				struct Node
+				{
+					std::vector<Edge> keys;
+					int32_t elements;
+					bool whole;
+				};
+
+				bool project(const PlistHelperData& d, int32_t node, int32_t objRef, boost::any& value, DecodeBudget& budget) const;
+
+				std::vector<Node> _nodes;
+		};
+
+		// Decodes the values paths lead to from a binary plist, along with
+		// the dictionaries and arrays holding them.  Only the keys of those
+		// dictionaries are read; the values of other keys are never
+		// decoded and keys are compared without building strings.  A path
+		// through a missing key or a value that isn't the dictionary or
+		// array it needs stops there.  message is left empty if no path
+		// applies to the root.
+		void projectPlist(const char* byteArray, int64_t size, const KeyPathSet& paths, boost::any& message);
+};
+
+#endif
@@ -0,0 +1,284 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+
+#include "PlistUnicode.hpp"
+#include "PlistBase64.hpp"
+#include <boost/cstdint.hpp>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define PLIST_UNICODE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace Plist
+{
+
+#if defined(__GNUC__)
+#define PLIST_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PLIST_TARGET(isa)
+#endif
+
+// units the scalar code takes at a time when a vector has to be left to it
+static const size_t unicodeScalarUnits = 64;
+
+// Block codecs transcode whole vectors of units that are all ASCII or all
+// three byte characters, advance output past what they wrote and return
+// how many units they consumed.  They stop at the first vector holding
+// anything else, which is left to the scalar code.
+
+typedef size_t (*UnicodeBlocks)(unsigned char*& output, const unsigned char* units, size_t count);
+
+static uint32_t loadUnit(const unsigned char* units, size_t position)
+{
+	return ((uint32_t) units[2 * position] << 8) | units[2 * position + 1];
+}
+
+// transcodes units from position up to end, or one past it when a pair
+// straddles end.  Returns false at a surrogate without its partner.
+
+static bool transcodeUnits(unsigned char*& output, const unsigned char* units,
+		size_t& position, size_t end, size_t count)
+{
+	unsigned char* out = output;
+	while(position < end)
+	{
+		uint32_t unit = loadUnit(units, position++);
+		if(unit < 0x80)
+			*out++ = (unsigned char) unit;
+		else if(unit < 0x800)
+		{
+			out[0] = (unsigned char) (0xC0 | (unit >> 6));
+			out[1] = (unsigned char) (0x80 | (unit & 0x3F));
+			out += 2;
+		}
+		else if((unit & 0xF800) != 0xD800)
+		{
+			out[0] = (unsigned char) (0xE0 | (unit >> 12));
+			out[1] = (unsigned char) (0x80 | ((unit >> 6) & 0x3F));
+			out[2] = (unsigned char) (0x80 | (unit & 0x3F));
+			out += 3;
+		}
+		else
+		{
+			// a high surrogate followed by a low one
+			if((unit >= 0xDC00) || (position == count))
+				return false;
+			uint32_t low = loadUnit(units, position);
+			if((low & 0xFC00) != 0xDC00)
+				return false;
+			++position;
+
+			uint32_t codePoint = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+			out[0] = (unsigned char) (0xF0 | (codePoint >> 18));
+			out[1] = (unsigned char) (0x80 | ((codePoint >> 12) & 0x3F));
+			out[2] = (unsigned char) (0x80 | ((codePoint >> 6) & 0x3F));
+			out[3] = (unsigned char) (0x80 | (codePoint & 0x3F));
+			out += 4;
+		}
+	}
+	output = out;
+	return true;
+}
+
+#if defined(PLIST_UNICODE_X86)
+
+// Both vector codecs swap the units to native order with a byte shuffle.
+// ASCII vectors narrow with a saturating pack.  Three byte vectors build
+// the lead and middle bytes as 16 bit pairs and the last bytes with a
+// pack, then interleave them into 24 bytes with two shuffles.  Surrogates
+// and one or two byte characters send the vector to the scalar code.
+
+PLIST_TARGET("ssse3")
+static size_t transcodeBlocksSSSE3(unsigned char*& output, const unsigned char* units, size_t count)
+{
+	const __m128i swap = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	const __m128i firstPairs = _mm_setr_epi8(0, 1, -1, 2, 3, -1, 4, 5, -1, 6, 7, -1, 8, 9, -1, 10);
+	const __m128i firstLasts = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+	const __m128i secondPairs = _mm_setr_epi8(11, -1, 12, 13, -1, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i secondLasts = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m128i zero = _mm_setzero_si128();
+
+	unsigned char* out = output;
+	size_t consumed = 0;
+	for(; consumed + 8 <= count; consumed += 8)
+	{
+		__m128i in = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (units + 2 * consumed)), swap);
+
+		__m128i ascii = _mm_cmpeq_epi16(_mm_and_si128(in, _mm_set1_epi16((short) 0xFF80)), zero);
+		if(_mm_movemask_epi8(ascii) == 0xFFFF)
+		{
+			_mm_storel_epi64((__m128i*) out, _mm_packus_epi16(in, in));
+			out += 8;
+			continue;
+		}
+
+		__m128i top = _mm_and_si128(in, _mm_set1_epi16((short) 0xF800));
+		__m128i shorter = _mm_or_si128(_mm_cmpeq_epi16(top, zero),
+				_mm_cmpeq_epi16(top, _mm_set1_epi16((short) 0xD800)));
+		if(_mm_movemask_epi8(shorter) != 0)
+			break;
+
+		__m128i lead = _mm_or_si128(_mm_srli_epi16(in, 12), _mm_set1_epi16(0xE0));
+		__m128i middle = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(in, 6), _mm_set1_epi16(0x3F)), _mm_set1_epi16(0x80));
+		__m128i last = _mm_or_si128(_mm_and_si128(in, _mm_set1_epi16(0x3F)), _mm_set1_epi16(0x80));
+		__m128i pairs = _mm_or_si128(lead, _mm_slli_epi16(middle, 8));
+		__m128i lasts = _mm_packus_epi16(last, last);
+
+		_mm_storeu_si128((__m128i*) out,
+				_mm_or_si128(_mm_shuffle_epi8(pairs, firstPairs), _mm_shuffle_epi8(lasts, firstLasts)));
+		_mm_storel_epi64((__m128i*) (out + 16),
+				_mm_or_si128(_mm_shuffle_epi8(pairs, secondPairs), _mm_shuffle_epi8(lasts, secondLasts)));
+		out += 24;
+	}
+	output = out;
+	return consumed;
+}
+
+// the same on 16 units, each 128 bit lane transcoding 8 of them
+
+PLIST_TARGET("avx2")
+static size_t transcodeBlocksAVX2(unsigned char*& output, const unsigned char* units, size_t count)
+{
+	const __m256i swap = _mm256_setr_epi8(
+			1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+			1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	const __m256i firstPairs = _mm256_setr_epi8(
+			0, 1, -1, 2, 3, -1, 4, 5, -1, 6, 7, -1, 8, 9, -1, 10,
+			0, 1, -1, 2, 3, -1, 4, 5, -1, 6, 7, -1, 8, 9, -1, 10);
+	const __m256i firstLasts = _mm256_setr_epi8(
+			-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1,
+			-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+	const __m256i secondPairs = _mm256_setr_epi8(
+			11, -1, 12, 13, -1, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+			11, -1, 12, 13, -1, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m256i secondLasts = _mm256_setr_epi8(
+			-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, -1, -1, -1, -1, -1, -1,
+			-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+	const __m256i zero = _mm256_setzero_si256();
+
+	unsigned char* out = output;
+	size_t consumed = 0;
+	for(; consumed + 16 <= count; consumed += 16)
+	{
+		__m256i in = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*) (units + 2 * consumed)), swap);
+
+		__m256i ascii = _mm256_cmpeq_epi16(_mm256_and_si256(in, _mm256_set1_epi16((short) 0xFF80)), zero);
+		if(_mm256_movemask_epi8(ascii) == -1)
+		{
+			// the pack works per lane, gather its two low halves
+			__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(in, in), 0xD8);
+			_mm_storeu_si128((__m128i*) out, _mm256_castsi256_si128(packed));
+			out += 16;
+			continue;
+		}
+
+		__m256i top = _mm256_and_si256(in, _mm256_set1_epi16((short) 0xF800));
+		__m256i shorter = _mm256_or_si256(_mm256_cmpeq_epi16(top, zero),
+				_mm256_cmpeq_epi16(top, _mm256_set1_epi16((short) 0xD800)));
+		if(_mm256_movemask_epi8(shorter) != 0)
+			break;
+
+		__m256i lead = _mm256_or_si256(_mm256_srli_epi16(in, 12), _mm256_set1_epi16(0xE0));
+		__m256i middle = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(in, 6), _mm256_set1_epi16(0x3F)), _mm256_set1_epi16(0x80));
+		__m256i last = _mm256_or_si256(_mm256_and_si256(in, _mm256_set1_epi16(0x3F)), _mm256_set1_epi16(0x80));
+		__m256i pairs = _mm256_or_si256(lead, _mm256_slli_epi16(middle, 8));
+		__m256i lasts = _mm256_packus_epi16(last, last);
+
+		__m256i first = _mm256_or_si256(_mm256_shuffle_epi8(pairs, firstPairs), _mm256_shuffle_epi8(lasts, firstLasts));
+		__m256i second = _mm256_or_si256(_mm256_shuffle_epi8(pairs, secondPairs), _mm256_shuffle_epi8(lasts, secondLasts));
+		_mm_storeu_si128((__m128i*) out, _mm256_castsi256_si128(first));
+		_mm_storel_epi64((__m128i*) (out + 16), _mm256_castsi256_si128(second));
+		_mm_storeu_si128((__m128i*) (out + 24), _mm256_extracti128_si256(first, 1));
+		_mm_storel_epi64((__m128i*) (out + 40), _mm256_extracti128_si256(second, 1));
+		out += 48;
+	}
+	output = out;
+	return consumed;
+}
+
+#endif // PLIST_UNICODE_X86
+
+// the vector codecs need the same instruction sets as base64's, so its
+// detection is shared
+
+UnicodeCodec unicodeBestCodec()
+{
+	switch(base64BestCodec())
+	{
+		case Base64AVX2:
+			return UnicodeAVX2;
+		case Base64SSSE3:
+			return UnicodeSSSE3;
+		default:
+			return UnicodeScalar;
+	}
+}
+
+size_t utf16ToUTF8Capacity(size_t count)
+{
+	return count * 3;
+}
+
+bool utf16ToUTF8(char* output, const unsigned char* units, size_t count, size_t& size, UnicodeCodec codec)
+{
+	UnicodeBlocks blocks = 0;
+#if defined(PLIST_UNICODE_X86)
+	UnicodeCodec best = unicodeBestCodec();
+	switch((codec > best) ? best : codec)
+	{
+		case UnicodeAVX2:
+			blocks = transcodeBlocksAVX2;
+			break;
+		case UnicodeSSSE3:
+			blocks = transcodeBlocksSSSE3;
+			break;
+		default:
+			break;
+	}
+#endif
+
+	unsigned char* out = (unsigned char*) output;
+	size_t position = 0;
+	while(position < count)
+	{
+		size_t end = count;
+		if(blocks)
+		{
+			position += blocks(out, units + 2 * position, count - position);
+			if(count - position > unicodeScalarUnits)
+				end = position + unicodeScalarUnits;
+		}
+
+		if(!transcodeUnits(out, units, position, end, count))
+			return false;
+	}
+
+	size = out - (unsigned char*) output;
+	return true;
+}
+
+} // namespace Plist
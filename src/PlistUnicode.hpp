@@ -0,0 +1,65 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+
+// UTF-16 to UTF-8 for binary plist strings.  Internal, not part of the
+// public interface.
+//
+// Binary plists store non-ASCII strings as big endian UTF-16.  These are
+// transcoded straight from the object table into caller supplied memory;
+// on x86 runs of ASCII or of three byte characters go 8 or 16 units at a
+// time with SSSE3 or AVX2, picked at runtime, with a scalar codec
+// everywhere else.
+
+#ifndef __PLIST_UNICODE_H__
+#define __PLIST_UNICODE_H__
+
+#include <cstddef>
+
+namespace Plist
+{
+		enum UnicodeCodec
+		{
+			UnicodeScalar,
+			UnicodeSSSE3,
+			UnicodeAVX2
+		};
+
+		// fastest codec the cpu running this supports
+		UnicodeCodec unicodeBestCodec();
+
+		// room utf16ToUTF8 needs for count units, the UTF-8 is never
+		// longer than 3 bytes a unit
+		size_t utf16ToUTF8Capacity(size_t count);
+
+		// transcodes count big endian UTF-16 units into output, which must
+		// hold utf16ToUTF8Capacity(count) bytes, and sets size to the UTF-8
+		// length.  Returns false if a surrogate is missing its partner.
+		bool utf16ToUTF8(char* output, const unsigned char* units, size_t count, size_t& size,
+				UnicodeCodec codec = unicodeBestCodec());
+
+} // namespace Plist
+
+#endif
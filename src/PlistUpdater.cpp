@@ -0,0 +1,916 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+
+#include "PlistUpdater.hpp"
+#include "PlistEndian.hpp"
+#include "PlistHelpers.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <set>
+
+namespace Plist {
+
+namespace
+{
+	bool isContainer(unsigned char type)
+	{
+		return (type == 0xA0) || (type == 0xC0) || (type == 0xD0);
+	}
+
+	// entries of a container with refs, counting a key and value once
+	size_t entryCount(unsigned char type, const std::vector<int32_t>& refs)
+	{
+		return (type == 0xD0) ? refs.size() / 2 : refs.size();
+	}
+
+	// An edit encodes into a PlistHelperData holding the updater's offset
+	// table.  The table is handed back when the edit is done, and put back
+	// as it was if the edit throws part way.
+
+	class EditTable
+	{
+		public:
+
+			EditTable(ScratchVector<int32_t>::type& table, PlistHelperData& encoder, int32_t containerRef)
+				: _table(table), _encoder(encoder), _size(table.size()),
+				_rootOffset(table[0]), _containerRef(containerRef),
+				_containerOffset((containerRef >= 0) ? table[containerRef] : 0), _done(false)
+			{
+				_encoder._offsetTable.swap(_table);
+			}
+
+			~EditTable()
+			{
+				if(!_done)
+					cancel();
+			}
+
+			// hands the table back as it was
+			void cancel()
+			{
+				_encoder._offsetTable.swap(_table);
+				_table.resize(_size);
+				_table[0] = _rootOffset;
+				if(_containerRef >= 0)
+					_table[_containerRef] = _containerOffset;
+				_done = true;
+			}
+
+			// hands the table back with the edit
+			void done()
+			{
+				_encoder._offsetTable.swap(_table);
+				_done = true;
+			}
+
+		private:
+
+			ScratchVector<int32_t>::type& _table;
+			PlistHelperData& _encoder;
+			size_t _size;
+			int32_t _rootOffset;
+			int32_t _containerRef;
+			int32_t _containerOffset;
+			bool _done;
+	};
+}
+
+BinaryPlistUpdater::HelperData::HelperData()
+	: _data(new PlistHelperData())
+{
+}
+
+BinaryPlistUpdater::HelperData::~HelperData()
+{
+	delete _data;
+}
+
+BinaryPlistUpdater::BinaryPlistUpdater(std::vector<char>& plist)
+	: _plist(&plist), _bytes(0), _edited(false), _deadBytes(0), _compactionThreshold(0.5)
+{
+	load((const unsigned char*) (plist.empty() ? 0 : &plist[0]), plist.size());
+}
+
+BinaryPlistUpdater::BinaryPlistUpdater(const char* filename)
+	: _plist(0), _filename(filename), _bytes(0), _edited(false), _deadBytes(0), _compactionThreshold(0.5)
+{
+	loadFile();
+}
+
+void BinaryPlistUpdater::load(const unsigned char* bytes, int64_t size)
+{
+	if(!bytes || (size < 8) || (memcmp(bytes, "bplist00", 8) != 0))
+		throw Error("Plist: BinaryPlistUpdater requires a binary plist");
+
+	_d->_offsetTable.clear();
+	initBinaryPlist(*_d, bytes, size);
+	parseOffsetTable(*_d, bytes + _d->_offsetTableOffset, (int64_t) _d->_refCount * _d->_offsetByteSize);
+
+	_bytes = bytes;
+	_appended.clear();
+	_keyOrders.clear();
+	_edited = false;
+}
+
+// only the trailer and offset table are read, objects are read as edits
+// reach them
+
+void BinaryPlistUpdater::loadFile()
+{
+	_file.close();
+	_file.clear();
+	_file.open(_filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+	if(!_file)
+		throw Error("Plist: BinaryPlistUpdater can't open " + _filename);
+
+	_file.seekg(0, std::ios::end);
+	int64_t size = (int64_t) _file.tellg();
+
+	unsigned char header[8];
+	unsigned char trailer[32];
+	if(size < 8 + 32)
+		throw Error("Plist: binary plist too short to hold a trailer");
+	readFile(0, 8, header);
+	if(memcmp(header, "bplist00", 8) != 0)
+		throw Error("Plist: BinaryPlistUpdater requires a binary plist");
+	readFile(size - 32, 32, trailer);
+
+	_d->_offsetTable.clear();
+	parseTrailer(*_d, trailer);
+	checkBinaryTrailer(*_d, size);
+
+	std::vector<unsigned char> offsetTable((size_t) _d->_refCount * _d->_offsetByteSize);
+	readFile(_d->_offsetTableOffset, offsetTable.size(), &offsetTable[0]);
+	parseOffsetTable(*_d, &offsetTable[0], offsetTable.size());
+
+	_bytes = 0;
+	std::vector<char>().swap(_fileBytes);
+	_appended.clear();
+	_keyOrders.clear();
+	_edited = false;
+}
+
+void BinaryPlistUpdater::readFile(int64_t offset, int64_t size, unsigned char* bytes)
+{
+	_file.seekg(offset);
+	_file.read((char*) bytes, size);
+	if(!_file || (_file.gcount() != size))
+		throw Error("Plist: BinaryPlistUpdater can't read " + _filename);
+}
+
+// size bytes at offset, from the plist or the objects appended since.  The
+// bytes are only good until the next call.
+
+const unsigned char* BinaryPlistUpdater::objectBytes(int64_t offset, int64_t size)
+{
+	int64_t appendStart = _d->_offsetTableOffset;
+	if((offset < 8) || (size < 1) || (offset + size > appendStart + (int64_t) _appended.size()))
+		throw Error("Plist: binary plist object out of bounds");
+
+	if(offset >= appendStart)
+		return &_appended[(size_t) (offset - appendStart)];
+	else if(offset + size > appendStart)
+		throw Error("Plist: binary plist object out of bounds");
+
+	if(_bytes)
+		return _bytes + offset;
+
+	_scratch.resize((size_t) size);
+	readFile(offset, size, &_scratch[0]);
+	return &_scratch[0];
+}
+
+int32_t BinaryPlistUpdater::objectOffset(int32_t objRef) const
+{
+	if((objRef < 0) || (objRef >= (int64_t) _d->_offsetTable.size()))
+		throw Error("Plist: binary plist object ref out of bounds");
+	return _d->_offsetTable[objRef];
+}
+
+// count of a data, string or container object, and where what it counts
+// begins
+
+int64_t BinaryPlistUpdater::objectCount(int64_t offset, unsigned char marker, int64_t& contentOffset)
+{
+	if((marker & 0x0F) != 0x0F)
+	{
+		contentOffset = offset + 1;
+		return marker & 0x0F;
+	}
+
+	unsigned char countMarker = *objectBytes(offset + 1, 1);
+	if(((countMarker & 0xF0) != 0x10) || ((countMarker & 0x0F) > 3))
+		throw Error("Plist: binary plist object count isn't an integer");
+
+	int32_t width = 1 << (countMarker & 0x0F);
+	uint64_t count = loadBigEndian(objectBytes(offset + 2, width), width);
+	if(count > (uint64_t) std::numeric_limits<int32_t>::max())
+		throw Error("Plist: binary plist object count out of bounds");
+
+	contentOffset = offset + 2 + width;
+	return (int64_t) count;
+}
+
+int64_t BinaryPlistUpdater::objectSize(int32_t objRef)
+{
+	int32_t offset = objectOffset(objRef);
+	unsigned char marker = *objectBytes(offset, 1);
+	int64_t unit = 1;
+
+	switch(marker & 0xF0)
+	{
+		case 0x00:
+			return 1;
+		case 0x10:
+		case 0x20:
+			if((marker & 0x0F) > 4)
+				throw Error("Plist: binary plist number too wide");
+			return 1 + (1 << (marker & 0x0F));
+		case 0x30:
+			return 9;
+		case 0x80:
+			return 2 + (marker & 0x0F);
+		case 0x40:
+		case 0x50:
+			break;
+		case 0x60:
+			unit = 2;
+			break;
+		case 0xA0:
+		case 0xC0:
+			unit = _d->_objRefSize;
+			break;
+		case 0xD0:
+			unit = 2 * _d->_objRefSize;
+			break;
+		default:
+			throw Error("This type is not supported");
+	}
+
+	int64_t contentOffset;
+	int64_t count = objectCount(offset, marker, contentOffset);
+	return contentOffset - offset + count * unit;
+}
+
+// refs of a container, keys then values for a dictionary.  Returns the
+// object's type marker, refs is left empty if it isn't a container.
+
+unsigned char BinaryPlistUpdater::readContainer(int32_t objRef, std::vector<int32_t>& refs)
+{
+	int32_t offset = objectOffset(objRef);
+	unsigned char marker = *objectBytes(offset, 1);
+	unsigned char type = marker & 0xF0;
+
+	refs.clear();
+	if(!isContainer(type))
+		return type;
+
+	int64_t contentOffset;
+	int64_t count = objectCount(offset, marker, contentOffset);
+	if(type == 0xD0)
+		count *= 2;
+	if(count == 0)
+		return type;
+
+	const unsigned char* refBytes = objectBytes(contentOffset, count * _d->_objRefSize);
+	refs.resize((size_t) count);
+	if(!loadBigEndianArray((uint32_t*) &refs[0], refBytes, (size_t) count, _d->_objRefSize))
+		throw Error("Plist: binary plist object ref out of bounds");
+
+	for(size_t i = 0; i < refs.size(); ++i)
+		if((refs[i] < 0) || (refs[i] >= (int64_t) _d->_offsetTable.size()))
+			throw Error("Plist: binary plist object ref out of bounds");
+	return type;
+}
+
+// text of a dictionary key
+
+void BinaryPlistUpdater::readKey(int32_t keyRef, std::string& key)
+{
+	int32_t offset = objectOffset(keyRef);
+	unsigned char marker = *objectBytes(offset, 1);
+
+	if((marker & 0xF0) == 0x50)
+	{
+		int64_t contentOffset;
+		size_t length = (size_t) objectCount(offset, marker, contentOffset);
+		key.assign(length ? (const char*) objectBytes(contentOffset, length) : "", length);
+	}
+	else if((marker & 0xF0) == 0x60)
+	{
+		// unicode keys are decoded from a copy of the object
+
+		int64_t size = objectSize(keyRef);
+		const unsigned char* bytes = objectBytes(offset, size);
+		std::vector<unsigned char> object(bytes, bytes + size);
+
+		PlistHelperData d;
+		d._data = &object[0];
+		d._dataSize = size;
+		d._offsetTableOffset = size;
+		key = parseBinaryUnicode(d, 0);
+	}
+	else
+		throw Error("Error parsing dictionary.  Key can't be parsed as a string");
+}
+
+int BinaryPlistUpdater::compareKey(int32_t keyRef, const std::string& key)
+{
+	int32_t offset = objectOffset(keyRef);
+	unsigned char marker = *objectBytes(offset, 1);
+
+	if((marker & 0xF0) == 0x50)
+	{
+		// ascii keys are compared in place
+
+		int64_t contentOffset;
+		size_t length = (size_t) objectCount(offset, marker, contentOffset);
+		size_t common = std::min(length, key.size());
+		int result = common ? memcmp(objectBytes(contentOffset, common), key.data(), common) : 0;
+		if(result != 0)
+			return result;
+		if(length == key.size())
+			return 0;
+		return (length < key.size()) ? -1 : 1;
+	}
+
+	std::string text;
+	readKey(keyRef, text);
+	return text.compare(key);
+}
+
+// true if every key of a dictionary's refs sorts after the one before it,
+// reading each key once
+
+bool BinaryPlistUpdater::keysSorted(const std::vector<int32_t>& refs)
+{
+	size_t count = refs.size() / 2;
+	std::string previous;
+	std::string current;
+	for(size_t i = 0; i < count; ++i)
+	{
+		readKey(refs[i], current);
+		if((i > 0) && (current.compare(previous) <= 0))
+			return false;
+		previous.swap(current);
+	}
+	return true;
+}
+
+// Index of key's entry in the refs of the dictionary containerRef, or -1.
+// Binary search as dictionaries written by this library are in key order.
+// A miss checks once whether the keys really are sorted, and only scans
+// dictionaries whose keys aren't.  position is where key sorts.
+
+int32_t BinaryPlistUpdater::findKey(int32_t containerRef, const std::vector<int32_t>& refs, const std::string& key, size_t& position)
+{
+	int32_t count = (int32_t) refs.size() / 2;
+
+	int32_t low = 0;
+	int32_t high = count - 1;
+	while(low <= high)
+	{
+		int32_t middle = low + (high - low) / 2;
+		int result = compareKey(refs[middle], key);
+		if(result == 0)
+			return middle;
+		else if(result < 0)
+			low = middle + 1;
+		else
+			high = middle - 1;
+	}
+	position = low;
+
+	int32_t containerOffset = objectOffset(containerRef);
+	std::map<int32_t, int32_t>::iterator order = _keyOrders.find(containerOffset);
+	if(order == _keyOrders.end())
+	{
+		int32_t checked = keysSorted(refs) ? BinaryKeysSorted : BinaryKeysUnsorted;
+		order = _keyOrders.insert(std::make_pair(containerOffset, checked)).first;
+	}
+	if(order->second == BinaryKeysSorted)
+		return -1;
+
+	for(int32_t i = 0; i < count; ++i)
+		if(compareKey(refs[i], key) == 0)
+			return i;
+	return -1;
+}
+
+int32_t BinaryPlistUpdater::arrayIndex(const std::string& component, size_t count, bool allowEnd)
+{
+	char* end = 0;
+	unsigned long index = strtoul(component.c_str(), &end, 10);
+	if(component.empty() || (component.find_first_not_of("0123456789") != std::string::npos) ||
+			(index > count) || ((index == count) && !allowEnd))
+		throw Error("Plist: BinaryPlistUpdater array index " + component + " out of bounds");
+	return (int32_t) index;
+}
+
+// ref of the object the first depth components of path lead to
+
+int32_t BinaryPlistUpdater::resolve(const std::vector<std::string>& path, size_t depth)
+{
+	int32_t objRef = 0;
+	std::vector<int32_t> refs;
+	for(size_t i = 0; i < depth; ++i)
+	{
+		unsigned char type = readContainer(objRef, refs);
+		if(type == 0xD0)
+		{
+			size_t position;
+			int32_t index = findKey(objRef, refs, path[i], position);
+			if(index < 0)
+				throw Error("Plist: BinaryPlistUpdater dictionary has no key " + path[i]);
+			objRef = refs[index + refs.size() / 2];
+		}
+		else if(type == 0xA0)
+			objRef = refs[arrayIndex(path[i], refs.size(), false)];
+		else
+			throw Error("Plist: BinaryPlistUpdater path " + path[i] + " isn't in a dictionary or array");
+	}
+	return objRef;
+}
+
+// bytes of objRef and everything below it
+
+int64_t BinaryPlistUpdater::subtreeSize(int32_t objRef)
+{
+	std::set<int32_t> seen;
+	std::vector<int32_t> pending(1, objRef);
+	std::vector<int32_t> refs;
+	int64_t size = 0;
+	while(!pending.empty())
+	{
+		int32_t ref = pending.back();
+		pending.pop_back();
+		if(!seen.insert(ref).second)
+			continue;
+
+		size += objectSize(ref);
+		readContainer(ref, refs);
+		pending.insert(pending.end(), refs.begin(), refs.end());
+	}
+	return size;
+}
+
+bool BinaryPlistUpdater::fitsRefSize(size_t refCount) const
+{
+	return (_d->_objRefSize >= 8) || ((uint64_t) (refCount - 1) >> (8 * _d->_objRefSize)) == 0;
+}
+
+void BinaryPlistUpdater::set(const std::string& path, const boost::any& value)
+{
+	std::vector<std::string> components;
+	splitPath(path, components);
+	update(components, &value);
+}
+
+void BinaryPlistUpdater::set(const std::vector<std::string>& path, const boost::any& value)
+{
+	update(path, &value);
+}
+
+void BinaryPlistUpdater::erase(const std::string& path)
+{
+	std::vector<std::string> components;
+	splitPath(path, components);
+	update(components, 0);
+}
+
+void BinaryPlistUpdater::erase(const std::vector<std::string>& path)
+{
+	update(path, 0);
+}
+
+// Sets path to value, or erases it when value is 0.  The value's objects
+// are appended with fresh refs, followed by the key of a new dictionary
+// entry, then the container holding them rewritten under its old ref.
+
+void BinaryPlistUpdater::update(const std::vector<std::string>& path, const boost::any* value)
+{
+	if(path.empty() && !value)
+		throw Error("Plist: BinaryPlistUpdater can't erase the root");
+
+	int32_t containerRef = -1;
+	unsigned char type = 0;
+	std::vector<int32_t> refs;
+	size_t count = 0;
+	size_t index = 0;
+	bool added = false;
+
+	if(!path.empty())
+	{
+		const std::string& last = path.back();
+		containerRef = resolve(path, path.size() - 1);
+		type = readContainer(containerRef, refs);
+		count = entryCount(type, refs);
+
+		if(type == 0xD0)
+		{
+			size_t position;
+			int32_t key = findKey(containerRef, refs, last, position);
+			if((key < 0) && !value)
+				throw Error("Plist: BinaryPlistUpdater dictionary has no key " + last);
+			added = (key < 0);
+			index = added ? position : (size_t) key;
+		}
+		else if(type == 0xA0)
+		{
+			index = arrayIndex(last, count, value != 0);
+			added = (index == count);
+		}
+		else
+			throw Error("Plist: BinaryPlistUpdater path " + last + " isn't in a dictionary or array");
+	}
+
+	// what the edit orphans: the old value, an erased key and the old
+	// container
+
+	int64_t dead = 0;
+	if(path.empty())
+		dead += subtreeSize(0);
+	else if(!added)
+		dead += subtreeSize(refs[(type == 0xD0) ? count + index : index]);
+	if((type == 0xD0) && !value)
+		dead += objectSize(refs[index]);
+	if(containerRef >= 0)
+		dead += objectSize(containerRef);
+
+	int32_t containerOffset = (containerRef >= 0) ? _d->_offsetTable[containerRef] : 0;
+	size_t tableSize = _d->_offsetTable.size();
+	PlistHelperData encoder;
+	encoder._objRefSize = _d->_objRefSize;
+	EditTable table(_d->_offsetTable, encoder, containerRef);
+
+	// the root keeps ref 0, anything else gets a fresh ref
+
+	int32_t valueRef = 0;
+	if(value)
+	{
+		if(!path.empty())
+		{
+			encoder._offsetTable.push_back(0);
+			valueRef = (int32_t) tableSize;
+		}
+		planBinary(encoder, *value);
+	}
+
+	int32_t keyRef = -1;
+	if(added && (type == 0xD0))
+	{
+		encoder._offsetTable.push_back(0);
+		keyRef = (int32_t) encoder._offsetTable.size() - 1;
+	}
+
+	if(type == 0xD0)
+	{
+		if(!value)
+		{
+			refs.erase(refs.begin() + count + index);
+			refs.erase(refs.begin() + index);
+		}
+		else if(added)
+		{
+			refs.insert(refs.begin() + count + index, valueRef);
+			refs.insert(refs.begin() + index, keyRef);
+		}
+		else
+			refs[count + index] = valueRef;
+	}
+	else if(type == 0xA0)
+	{
+		if(!value)
+			refs.erase(refs.begin() + index);
+		else if(added)
+			refs.push_back(valueRef);
+		else
+			refs[index] = valueRef;
+	}
+
+	if(!fitsRefSize(encoder._offsetTable.size()))
+	{
+		// the new refs don't fit the plist's ref size, so compact to a
+		// wider one with room to spare and edit that
+		size_t spareRefs = encoder._offsetTable.size();
+		table.cancel();
+		compact(spareRefs);
+		update(path, value);
+		return;
+	}
+
+	std::string key = (keyRef >= 0) ? path.back() : std::string();
+	int64_t size = value ? encoder._plannedBytes + encoder._plannedRefs * _d->_objRefSize : 0;
+	if(keyRef >= 0)
+		size += binaryHeaderSize(key.size()) + key.size();
+	if(containerRef >= 0)
+		size += binaryHeaderSize(entryCount(type, refs)) + (int64_t) refs.size() * _d->_objRefSize;
+
+	int64_t start = _appended.size();
+	int64_t base = _d->_offsetTableOffset;
+	if(base + start + size > std::numeric_limits<int32_t>::max())
+		throw Error("Plist: binary plists over 2GB are not supported");
+
+	_appended.resize((size_t) (start + size));
+	encoder._output = &_appended[0];
+	encoder._outputPosition = start;
+	encoder._outputSize = start + size;
+
+	if(value)
+	{
+		encoder._planPosition = 0;
+		encoder._nextRef = (int32_t) tableSize + (path.empty() ? 0 : 1);
+		writeBinary(encoder, *value, valueRef);
+	}
+
+	if(keyRef >= 0)
+	{
+		encoder._offsetTable[keyRef] = (int32_t) encoder._outputPosition;
+		UniqueKey keyString = { 0x50, 0, key.data(), key.size() };
+		writeBinaryScalar(encoder, keyString);
+	}
+
+	if(containerRef >= 0)
+	{
+		encoder._offsetTable[containerRef] = (int32_t) encoder._outputPosition;
+		writeBinaryHeader(encoder, type, entryCount(type, refs));
+
+		size_t first = encoder._plan.size();
+		encoder._plan.insert(encoder._plan.end(), refs.begin(), refs.end());
+		encoder._nextRef = -1;
+		writeBinaryRefs(encoder, first, refs.size());
+	}
+
+	if(encoder._outputPosition != encoder._outputSize)
+		throw Error("Plist: binary plist size doesn't match its plan");
+
+	// offsets were written relative to the appended objects
+
+	for(size_t ref = tableSize; ref < encoder._offsetTable.size(); ++ref)
+		encoder._offsetTable[ref] += (int32_t) base;
+	if(path.empty())
+		encoder._offsetTable[0] += (int32_t) base;
+	else
+		encoder._offsetTable[containerRef] += (int32_t) base;
+
+	// a sorted dictionary stays sorted: keys are added where they sort,
+	// and erasing or replacing a value doesn't move the others
+
+	if((containerRef >= 0) && (type == 0xD0))
+	{
+		std::map<int32_t, int32_t>::iterator order = _keyOrders.find(containerOffset);
+		if((order != _keyOrders.end()) && (order->second == BinaryKeysSorted))
+			_keyOrders[encoder._offsetTable[containerRef]] = BinaryKeysSorted;
+	}
+
+	table.done();
+	_deadBytes += dead;
+	_edited = true;
+}
+
+// The appended objects take the place of the old offset table, followed
+// by the new one and the trailer.  Offsets are at least as wide as before,
+// so the plist never gets shorter and a file needs no truncating.
+
+void BinaryPlistUpdater::commit()
+{
+	if(!_edited)
+		return;
+
+	int64_t tableOffset = _d->_offsetTableOffset + (int64_t) _appended.size();
+	if((_compactionThreshold < 1) && (_deadBytes > _compactionThreshold * (tableOffset - 8)))
+	{
+		compact();
+		return;
+	}
+
+	const ScratchVector<int32_t>::type& offsets = _d->_offsetTable;
+	int32_t lastOffset = *std::max_element(offsets.begin(), offsets.end());
+	int32_t offsetByteSize = std::max(_d->_offsetByteSize, byteCount(lastOffset));
+
+	std::vector<unsigned char> tail(_appended.size() + offsets.size() * offsetByteSize + 32);
+	if(!_appended.empty())
+		memcpy(&tail[0], &_appended[0], _appended.size());
+
+	unsigned char* output = &tail[_appended.size()];
+	for(size_t i = 0; i < offsets.size(); ++i, output += offsetByteSize)
+		storeBigEndian(output, offsets[i], offsetByteSize);
+
+	memset(output, 0, 6);
+	output[6] = (unsigned char) offsetByteSize;
+	output[7] = (unsigned char) _d->_objRefSize;
+	storeBigEndian(output + 8, offsets.size(), 8);
+	storeBigEndian(output + 16, 0, 8);
+	storeBigEndian(output + 24, tableOffset, 8);
+
+	int64_t start = _d->_offsetTableOffset;
+	if(_plist)
+	{
+		_plist->resize((size_t) start + tail.size());
+		memcpy(&(*_plist)[(size_t) start], &tail[0], tail.size());
+		_bytes = (const unsigned char*) &(*_plist)[0];
+	}
+	else
+	{
+		_file.seekp(start);
+		_file.write((const char*) &tail[0], tail.size());
+		_file.flush();
+		if(!_file)
+			throw Error("Plist: BinaryPlistUpdater can't write " + _filename);
+	}
+
+	_d->_offsetTableOffset = tableOffset;
+	_d->_offsetByteSize = offsetByteSize;
+	_d->_refCount = (int32_t) offsets.size();
+	_appended.clear();
+	_edited = false;
+}
+
+void BinaryPlistUpdater::compact()
+{
+	compact(0);
+}
+
+// Copies every object reachable from the root into a fresh plist, refs
+// handed out in the order objects are first reached.  Scalars are copied
+// as they are, containers rewritten with the new refs.
+
+void BinaryPlistUpdater::compact(size_t spareRefs)
+{
+	// a file is read whole, compacting touches most of it anyway
+	if(!_bytes)
+	{
+		_fileBytes.resize((size_t) _d->_offsetTableOffset);
+		readFile(0, _fileBytes.size(), (unsigned char*) &_fileBytes[0]);
+		_bytes = (const unsigned char*) &_fileBytes[0];
+	}
+
+	std::vector<int32_t> newRefs(_d->_offsetTable.size(), -1);
+	std::vector<int32_t> order(1, 0);
+	std::vector<int32_t> refs;
+	int64_t scalarBytes = 0;
+	int64_t headerBytes = 0;
+	int64_t refCount = 0;
+	newRefs[0] = 0;
+
+	for(size_t i = 0; i < order.size(); ++i)
+	{
+		unsigned char type = readContainer(order[i], refs);
+		if(!isContainer(type))
+		{
+			scalarBytes += objectSize(order[i]);
+			continue;
+		}
+
+		headerBytes += binaryHeaderSize(entryCount(type, refs));
+		refCount += refs.size();
+		for(size_t child = 0; child < refs.size(); ++child)
+			if(newRefs[refs[child]] < 0)
+			{
+				newRefs[refs[child]] = (int32_t) order.size();
+				order.push_back(refs[child]);
+			}
+	}
+
+	PlistHelperData encoder;
+	encoder._objRefSize = byteCount(order.size() - 1 + spareRefs);
+	int64_t tableOffset = 8 + scalarBytes + headerBytes + refCount * encoder._objRefSize;
+	if(tableOffset > std::numeric_limits<int32_t>::max())
+		throw Error("Plist: binary plists over 2GB are not supported");
+
+	std::vector<char> image((size_t) tableOffset);
+	memcpy(&image[0], "bplist00", 8);
+	encoder._output = (unsigned char*) &image[0];
+	encoder._outputPosition = 8;
+	encoder._outputSize = tableOffset;
+	encoder._nextRef = -1;
+
+	std::vector<int32_t> offsets(order.size());
+	for(size_t i = 0; i < order.size(); ++i)
+	{
+		offsets[i] = (int32_t) encoder._outputPosition;
+		unsigned char type = readContainer(order[i], refs);
+		if(isContainer(type))
+		{
+			writeBinaryHeader(encoder, type, entryCount(type, refs));
+			encoder._plan.clear();
+			for(size_t child = 0; child < refs.size(); ++child)
+				encoder._plan.push_back(newRefs[refs[child]]);
+			writeBinaryRefs(encoder, 0, refs.size());
+		}
+		else
+		{
+			int64_t size = objectSize(order[i]);
+			if(encoder._outputPosition + size > encoder._outputSize)
+				throw Error("Plist: binary plist size doesn't match its plan");
+			memcpy(encoder._output + encoder._outputPosition, objectBytes(_d->_offsetTable[order[i]], size), (size_t) size);
+			encoder._outputPosition += size;
+		}
+	}
+
+	if(encoder._outputPosition != encoder._outputSize)
+		throw Error("Plist: binary plist size doesn't match its plan");
+
+	int32_t offsetByteSize = byteCount(offsets.back());
+	image.resize((size_t) tableOffset + offsets.size() * offsetByteSize + 32);
+	unsigned char* output = (unsigned char*) &image[(size_t) tableOffset];
+	for(size_t i = 0; i < offsets.size(); ++i, output += offsetByteSize)
+		storeBigEndian(output, offsets[i], offsetByteSize);
+
+	memset(output, 0, 6);
+	output[6] = (unsigned char) offsetByteSize;
+	output[7] = (unsigned char) encoder._objRefSize;
+	storeBigEndian(output + 8, offsets.size(), 8);
+	storeBigEndian(output + 16, 0, 8);
+	storeBigEndian(output + 24, tableOffset, 8);
+
+	if(_plist)
+	{
+		_plist->swap(image);
+		load((const unsigned char*) &(*_plist)[0], _plist->size());
+	}
+	else
+	{
+		// written beside the file and renamed over it, so the file is
+		// never left half compacted
+		std::string compacted = _filename + ".compact";
+		std::ofstream stream(compacted.c_str(), std::ios::binary);
+		stream.write(&image[0], image.size());
+		stream.close();
+		if(!stream)
+			throw Error("Plist: BinaryPlistUpdater can't write " + compacted);
+
+		_file.close();
+#if defined(_WIN32) || defined(_WIN64)
+		remove(_filename.c_str());
+#endif
+		if(rename(compacted.c_str(), _filename.c_str()) != 0)
+			throw Error("Plist: BinaryPlistUpdater can't replace " + _filename);
+		loadFile();
+	}
+
+	_deadBytes = 0;
+}
+
+int64_t BinaryPlistUpdater::deadBytes() const
+{
+	return _deadBytes;
+}
+
+int64_t BinaryPlistUpdater::measureDeadBytes()
+{
+	std::vector<char> seen(_d->_offsetTable.size(), 0);
+	std::vector<int32_t> pending(1, 0);
+	std::vector<int32_t> refs;
+	int64_t liveBytes = 0;
+	seen[0] = 1;
+	while(!pending.empty())
+	{
+		int32_t ref = pending.back();
+		pending.pop_back();
+		liveBytes += objectSize(ref);
+		readContainer(ref, refs);
+		for(size_t i = 0; i < refs.size(); ++i)
+			if(!seen[refs[i]])
+			{
+				seen[refs[i]] = 1;
+				pending.push_back(refs[i]);
+			}
+	}
+
+	_deadBytes = _d->_offsetTableOffset + (int64_t) _appended.size() - 8 - liveBytes;
+	return _deadBytes;
+}
+
+void BinaryPlistUpdater::setCompactionThreshold(double fraction)
+{
+	_compactionThreshold = fraction;
+}
+
+} // namespace Plist
@@ -0,0 +1,179 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+
+#ifndef __PLIST_UPDATER_H__
+#define __PLIST_UPDATER_H__
+
+#include "Plist.hpp"
+#include <fstream>
+
+namespace Plist
+{
+		struct PlistHelperData;
+
+		// Edits a binary plist in place.  Objects are addressed through the
+		// offset table, so a changed value is appended as new objects and
+		// only the container holding it is rewritten, keeping its ref.
+		// Everything else stays where it is; commit() writes the new objects
+		// over the old offset table and ends the plist with a new table and
+		// trailer.  An edit costs O(depth + size of the value and its
+		// container) plus rewriting the offset table, not O(plist).
+		//
+		//		Plist::BinaryPlistUpdater updater("state.plist");
+		//		updater.set("tracks/3/name", std::string("renamed"));
+		//		updater.erase("cache");
+		//		updater.commit();
+		//
+		// Paths are keys and array indices separated by '/'.  The vector
+		// overloads take one component each, for keys holding a '/'.
+		//
+		// The objects left behind are dead space.  Once it passes the
+		// compaction threshold, commit() compacts instead: every object still
+		// reachable from the root is copied into a fresh plist and the rest
+		// dropped.
+		//
+		// A container referenced from more than one place, which this
+		// library never writes, shows an edit in each of them.
+
+		class BinaryPlistUpdater
+		{
+			public:
+
+				// edits the binary plist in plist, which must outlive the
+				// updater.  plist holds a valid plist again after commit().
+				explicit BinaryPlistUpdater(std::vector<char>& plist);
+
+				// edits the binary plist in filename, reading only the trailer,
+				// the offset table and the objects edits touch.  Compacting
+				// writes a new file and renames it over filename.
+				explicit BinaryPlistUpdater(const char* filename);
+
+				// Sets the value at path.  An array index one past the end
+				// appends, a key that isn't there is added.  The containers
+				// leading to it must exist.  An empty path replaces the root.
+				void set(const std::string& path, const boost::any& value);
+				void set(const std::vector<std::string>& path, const boost::any& value);
+
+				// Removes the dictionary entry or array element at path,
+				// throws Plist::Error if there's none.
+				void erase(const std::string& path);
+				void erase(const std::vector<std::string>& path);
+
+				// writes the edits out, or compacts once dead space passes the
+				// threshold
+				void commit();
+
+				// writes the edits and the live objects to a fresh plist
+				void compact();
+
+				// Bytes of dead objects, counted as edits orphan them.  Counts
+				// start at zero for each updater and may include scalars still
+				// shared with other values.
+				int64_t deadBytes() const;
+
+				// walks the plist to count dead bytes exactly and resets the
+				// running count to that
+				int64_t measureDeadBytes();
+
+				// fraction of the object table that may be dead before
+				// commit() compacts, 0.5 by default.  1 never compacts.
+				void setCompactionThreshold(double fraction);
+
+			private:
+
+				BinaryPlistUpdater(const BinaryPlistUpdater&);
+				BinaryPlistUpdater& operator=(const BinaryPlistUpdater&);
+
+				// Owns the reader's offset table and trailer, which are kept
+				// out of this header.  A member rather than a bare pointer so
+				// it's freed when a constructor throws.
+				class HelperData
+				{
+					public:
+
+						HelperData();
+						~HelperData();
+
+						PlistHelperData* operator->() const { return _data; }
+						PlistHelperData& operator*() const { return *_data; }
+
+					private:
+
+						HelperData(const HelperData&);
+						HelperData& operator=(const HelperData&);
+
+						PlistHelperData* _data;
+				};
+
+				void load(const unsigned char* bytes, int64_t size);
+				void loadFile();
+				void readFile(int64_t offset, int64_t size, unsigned char* bytes);
+
+				const unsigned char* objectBytes(int64_t offset, int64_t size);
+				int32_t objectOffset(int32_t objRef) const;
+				int64_t objectCount(int64_t offset, unsigned char marker, int64_t& contentOffset);
+				int64_t objectSize(int32_t objRef);
+				unsigned char readContainer(int32_t objRef, std::vector<int32_t>& refs);
+				void readKey(int32_t keyRef, std::string& key);
+				int compareKey(int32_t keyRef, const std::string& key);
+				bool keysSorted(const std::vector<int32_t>& refs);
+				int32_t findKey(int32_t containerRef, const std::vector<int32_t>& refs, const std::string& key, size_t& position);
+				int32_t arrayIndex(const std::string& component, size_t count, bool allowEnd);
+				int32_t resolve(const std::vector<std::string>& path, size_t depth);
+				int64_t subtreeSize(int32_t objRef);
+
+				void update(const std::vector<std::string>& path, const boost::any* value);
+				bool fitsRefSize(size_t refCount) const;
+				void compact(size_t spareRefs);
+
+				// source, either _plist or the file.  _bytes points at the plist
+				// bytes when they are in memory.
+				std::vector<char>* _plist;
+				std::string _filename;
+				std::fstream _file;
+				std::vector<char> _fileBytes;
+				const unsigned char* _bytes;
+				std::vector<unsigned char> _scratch;
+
+				// offset table and trailer.  _d->_offsetTableOffset is where
+				// objects appended by edits begin.
+				HelperData _d;
+
+				// objects appended since the last commit
+				std::vector<unsigned char> _appended;
+
+				// BinaryKeyOrder of the dictionaries a lookup has missed in, by
+				// offset.  An edited dictionary moves to a new offset, so an
+				// entry never outlives what it describes.
+				std::map<int32_t, int32_t> _keyOrders;
+
+				bool _edited;
+				int64_t _deadBytes;
+				double _compactionThreshold;
+		};
+};
+
+#endif
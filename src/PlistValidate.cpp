@@ -0,0 +1,481 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+
+#include "Plist.hpp"
+#include "PlistEndian.hpp"
+#include "PlistHelpers.hpp"
+#include "pugixml.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace Plist {
+
+namespace
+{
+	const char* const outOfBounds = "Plist: binary plist object runs past the object table";
+
+	// what the pass over the offset table learns about each object
+	enum ObjectKind
+	{
+		ScalarObject,
+		StringObject,
+		ArrayObject,
+		DictionaryObject
+	};
+
+	// heights of containers being walked, not yet known
+	const uint16_t Visiting = 0xFFFF;
+
+	// a binary plist as described by its trailer
+	struct BinaryLayout
+	{
+		const unsigned char* data;
+		int64_t tableOffset;
+		int32_t offsetByteSize;
+		int32_t refSize;
+		int64_t objectCount;
+	};
+
+	// count of the string, data or container at offset and where its
+	// contents start, as getCount reads them.  False if the count doesn't
+	// fit before the offset table.
+	bool readCount(const BinaryLayout& plist, int64_t offset, int64_t& count, int64_t& start)
+	{
+		unsigned char marker = plist.data[offset];
+		if((marker & 0x0F) != 0x0F)
+		{
+			count = marker & 0x0F;
+			start = offset + 1;
+			return true;
+		}
+
+		if(offset + 2 > plist.tableOffset)
+			return false;
+		unsigned char countMarker = plist.data[offset + 1];
+		if(((countMarker & 0xF0) != 0x10) || ((countMarker & 0x0F) > 3))
+			return false;
+
+		int32_t width = 1 << (countMarker & 0x0F);
+		start = offset + 2 + width;
+		if(start > plist.tableOffset)
+			return false;
+
+		// a negative 8 byte count is larger than any table
+		uint64_t value = loadBigEndian(plist.data + offset + 2, width);
+		if(value > (uint64_t) plist.tableOffset)
+			return false;
+		count = (int64_t) value;
+		return true;
+	}
+
+	// surrogates come in pairs, as utf16ToUTF8 requires
+	bool validUTF16(const unsigned char* bytes, int64_t count)
+	{
+		for(int64_t i = 0; i < count; ++i)
+		{
+			uint16_t unit = loadBigEndian16(bytes + 2 * i);
+			if((unit >= 0xD800) && (unit < 0xDC00))
+			{
+				if(++i == count)
+					return false;
+				uint16_t low = loadBigEndian16(bytes + 2 * i);
+				if((low < 0xDC00) || (low >= 0xE000))
+					return false;
+			}
+			else if((unit >= 0xDC00) && (unit < 0xE000))
+				return false;
+		}
+		return true;
+	}
+
+	// Checks the object at offset lies before the offset table, is a type
+	// readPlist decodes, and refers only to objects in the table.  Returns
+	// the problem, or 0.
+	const char* checkObject(const BinaryLayout& plist, int64_t offset, unsigned char& kind)
+	{
+		unsigned char marker = plist.data[offset];
+		int64_t count;
+		int64_t start;
+
+		kind = ScalarObject;
+		switch(marker & 0xF0)
+		{
+			case 0x00:
+				if((marker != 0x08) && (marker != 0x09))
+					return "Plist: binary plist has a null, fill or unknown object";
+				return 0;
+			case 0x10:
+				if((marker & 0x0F) > 3)
+					return "Plist: binary plist integer wider than 8 bytes";
+				return (offset + 1 + (1 << (marker & 0x0F)) > plist.tableOffset) ? outOfBounds : 0;
+			case 0x20:
+				if((marker != 0x22) && (marker != 0x23))
+					return "Plist: binary plist real must be 4 or 8 bytes";
+				return (offset + 1 + (1 << (marker & 0x0F)) > plist.tableOffset) ? outOfBounds : 0;
+			case 0x30:
+				if(marker != 0x33)
+					return "Plist: binary plist date must be 8 bytes";
+				return (offset + 9 > plist.tableOffset) ? outOfBounds : 0;
+			case 0x40:
+			case 0x50:
+				if(!readCount(plist, offset, count, start) || (start + count > plist.tableOffset))
+					return outOfBounds;
+				if((marker & 0xF0) == 0x50)
+					kind = StringObject;
+				return 0;
+			case 0x60:
+				if(!readCount(plist, offset, count, start) || (start + 2 * count > plist.tableOffset))
+					return outOfBounds;
+				if(!validUTF16(plist.data + start, count))
+					return "Plist: binary plist string isn't valid UTF-16";
+				kind = StringObject;
+				return 0;
+			case 0xA0:
+			case 0xD0:
+				{
+					if(!readCount(plist, offset, count, start))
+						return outOfBounds;
+					int64_t refCount = ((marker & 0xF0) == 0xD0) ? 2 * count : count;
+					if(start + refCount * plist.refSize > plist.tableOffset)
+						return outOfBounds;
+
+					for(int64_t i = 0; i < refCount; ++i)
+						if(loadBigEndian(plist.data + start + i * plist.refSize, plist.refSize) >= (uint64_t) plist.objectCount)
+							return "Plist: binary plist object ref out of bounds";
+
+					kind = ((marker & 0xF0) == 0xD0) ? DictionaryObject : ArrayObject;
+					return 0;
+				}
+		}
+		return "Plist: binary plist object type not supported";
+	}
+
+	// a container being walked, its refs start at refStart
+	struct BinaryFrame
+	{
+		int32_t ref;
+		int64_t refStart;
+		int64_t keyCount;
+		int64_t refCount;
+		int64_t next;
+		int32_t height;
+	};
+
+	// Walks the containers reachable from the root, which readPlist
+	// decodes, without recursing.  A container's height is the most
+	// containers nested on a path down from it, itself included.
+	const char* checkBinaryGraph(const BinaryLayout& plist, const std::vector<unsigned char>& kinds)
+	{
+		if((kinds[0] != ArrayObject) && (kinds[0] != DictionaryObject))
+			return 0;
+
+		std::vector<uint16_t> heights(kinds.size(), 0);
+		std::vector<BinaryFrame> frames;
+		frames.reserve(16);
+
+		int32_t ref = 0;
+		for(;;)
+		{
+			if(ref >= 0)
+			{
+				// descend into ref
+				if((int32_t) frames.size() + 1 > DecodeLimits::DefaultMaxDepth)
+					return "Plist: plist nested deeper than allowed";
+
+				BinaryFrame frame;
+				int64_t offset = (int64_t) loadBigEndian(plist.data + plist.tableOffset + (int64_t) ref * plist.offsetByteSize, plist.offsetByteSize);
+				int64_t count;
+				readCount(plist, offset, count, frame.refStart);
+				frame.ref = ref;
+				frame.keyCount = (kinds[ref] == DictionaryObject) ? count : 0;
+				frame.refCount = frame.keyCount + count;
+				frame.next = 0;
+				frame.height = 1;
+				frames.push_back(frame);
+				heights[ref] = Visiting;
+				ref = -1;
+			}
+
+			BinaryFrame& frame = frames.back();
+			if(frame.next == frame.refCount)
+			{
+				int32_t height = frame.height;
+				heights[frame.ref] = (uint16_t) height;
+				frames.pop_back();
+				if(frames.empty())
+					return 0;
+				if(height + 1 > frames.back().height)
+					frames.back().height = height + 1;
+				continue;
+			}
+
+			int64_t index = frame.next++;
+			int32_t child = (int32_t) loadBigEndian(plist.data + frame.refStart + index * plist.refSize, plist.refSize);
+			unsigned char kind = kinds[child];
+
+			if(index < frame.keyCount)
+			{
+				if(kind != StringObject)
+					return "Plist: binary plist dictionary key isn't a string";
+				continue;
+			}
+			if((kind != ArrayObject) && (kind != DictionaryObject))
+				continue;
+
+			uint16_t height = heights[child];
+			if(height == Visiting)
+				return "Plist: binary plist object contains itself";
+			if(height == 0)
+			{
+				ref = child;
+				continue;
+			}
+
+			// built already, nesting it here mustn't go too deep
+			if((int32_t) frames.size() + height > DecodeLimits::DefaultMaxDepth)
+				return "Plist: plist nested deeper than allowed";
+			if(height + 1 > frame.height)
+				frame.height = height + 1;
+		}
+	}
+
+	const char* validateBinary(const unsigned char* data, int64_t size)
+	{
+		if(size < 8 + 32)
+			return "Plist: binary plist too short to hold a trailer";
+
+		const unsigned char* trailer = data + size - 32;
+		BinaryLayout plist;
+		plist.data = data;
+		plist.offsetByteSize = trailer[6];
+		plist.refSize = trailer[7];
+		uint64_t objectCount = loadBigEndian64(trailer + 8);
+		uint64_t topObject = loadBigEndian64(trailer + 16);
+		uint64_t tableOffset = loadBigEndian64(trailer + 24);
+
+		if((plist.offsetByteSize < 1) || (plist.offsetByteSize > 8) || (plist.refSize < 1) || (plist.refSize > 8))
+			return "Plist: binary plist trailer has unsupported offset or ref size";
+		if((tableOffset < 8) || (tableOffset > (uint64_t) (size - 32)))
+			return "Plist: binary plist offset table out of bounds";
+		if(tableOffset > (uint64_t) std::numeric_limits<int32_t>::max())
+			return "Plist: binary plist object table larger than 2GB not supported";
+		if((objectCount < 1) || (objectCount > (uint64_t) (size - 32 - (int64_t) tableOffset) / plist.offsetByteSize))
+			return "Plist: binary plist object count doesn't fit the offset table";
+		if(topObject >= objectCount)
+			return "Plist: binary plist top object out of bounds";
+
+		plist.tableOffset = (int64_t) tableOffset;
+		plist.objectCount = (int64_t) objectCount;
+
+		// one pass over the offset table checks every object in place
+		std::vector<unsigned char> kinds((size_t) objectCount);
+		const unsigned char* offsets = data + plist.tableOffset;
+		for(int64_t ref = 0; ref < plist.objectCount; ++ref)
+		{
+			uint64_t offset = loadBigEndian(offsets + ref * plist.offsetByteSize, plist.offsetByteSize);
+			if((offset < 8) || (offset >= tableOffset))
+				return "Plist: binary plist object offset out of bounds";
+
+			const char* problem = checkObject(plist, (int64_t) offset, kinds[ref]);
+			if(problem)
+				return problem;
+		}
+
+		return checkBinaryGraph(plist, kinds);
+	}
+
+	// the text forms of xml scalars
+
+	bool isXMLInteger(const char* text)
+	{
+		char* end;
+		errno = 0;
+		strtoll(text, &end, 10);
+		return (end != text) && (*end == 0) && (errno != ERANGE);
+	}
+
+	bool isXMLReal(const char* text)
+	{
+		char* end;
+		strtod(text, &end);
+		return (end != text) && (*end == 0);
+	}
+
+	// 2011-09-25T02:31:04Z
+	bool isXMLDate(const char* text)
+	{
+		static const char pattern[] = "0000-00-00T00:00:00Z";
+		for(size_t i = 0; i < sizeof(pattern) - 1; ++i)
+		{
+			if(pattern[i] == '0' ? ((text[i] < '0') || (text[i] > '9')) : (text[i] != pattern[i]))
+				return false;
+		}
+		return text[sizeof(pattern) - 1] == 0;
+	}
+
+	bool isXMLData(const char* text)
+	{
+		for(; *text; ++text)
+		{
+			char c = *text;
+			if(!(((c >= 'A') && (c <= 'Z')) || ((c >= 'a') && (c <= 'z')) || ((c >= '0') && (c <= '9'))
+					|| (c == '+') || (c == '/') || (c == '=') || (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r')))
+				return false;
+		}
+		return true;
+	}
+
+	// a key or scalar holds only text
+	bool holdsText(const pugi::xml_node& node)
+	{
+		for(pugi::xml_node child = node.first_child(); child; child = child.next_sibling())
+			if((child.type() != pugi::node_pcdata) && (child.type() != pugi::node_cdata))
+				return false;
+		return true;
+	}
+
+	const char* checkXMLScalar(const pugi::xml_node& node, const char* name)
+	{
+		if(!holdsText(node))
+			return "Plist: XML element found inside a value";
+
+		std::string buffer;
+		const char* text = xmlNodeText(node, buffer);
+		if((strcmp("string", name) == 0) || (strcmp("true", name) == 0) || (strcmp("false", name) == 0))
+			return 0;
+		else if(strcmp("key", name) == 0)
+			return (strcmp("dict", node.parent().name()) == 0) ? 0 : "Plist: XML key found outside a dictionary";
+		else if(strcmp("integer", name) == 0)
+			return isXMLInteger(text) ? 0 : "Plist: XML integer isn't a decimal integer";
+		else if(strcmp("real", name) == 0)
+			return isXMLReal(text) ? 0 : "Plist: XML real isn't a number";
+		else if(strcmp("date", name) == 0)
+			return isXMLDate(text) ? 0 : "Plist: XML date isn't in the form 2011-09-25T02:31:04Z";
+		else if(strcmp("data", name) == 0)
+			return isXMLData(text) ? 0 : "Plist: XML data isn't base64";
+		return "Plist: XML unknown node type";
+	}
+
+	// keys and values alternate, as parseDictionary reads them
+	const char* checkXMLDictionary(const pugi::xml_node& node)
+	{
+		for(pugi::xml_node child = node.first_child(); child; child = child.next_sibling())
+		{
+			if(strcmp("key", child.name()) != 0)
+				return "Plist: XML dictionary key expected but not found";
+			child = child.next_sibling();
+			if(!child)
+				return "Plist: XML dictionary value expected but not found";
+			if(strcmp("key", child.name()) == 0)
+				return "Plist: XML dictionary value expected but found another key node";
+		}
+		return 0;
+	}
+
+	// Walks the elements under the root in document order, without
+	// recursing.  Every node below the root has only containers above it.
+	const char* checkXMLPlist(const pugi::xml_node& root)
+	{
+		if(!root)
+			return "Plist: XML plist is empty";
+
+		pugi::xml_node node = root;
+		int32_t depth = 1;
+		for(;;)
+		{
+			const char* name = node.name();
+			bool dictionary = (strcmp("dict", name) == 0);
+			if(dictionary || (strcmp("array", name) == 0))
+			{
+				if(depth > DecodeLimits::DefaultMaxDepth)
+					return "Plist: plist nested deeper than allowed";
+
+				const char* problem = dictionary ? checkXMLDictionary(node) : 0;
+				if(problem)
+					return problem;
+
+				if(node.first_child())
+				{
+					node = node.first_child();
+					++depth;
+					continue;
+				}
+			}
+			else
+			{
+				const char* problem = checkXMLScalar(node, name);
+				if(problem)
+					return problem;
+			}
+
+			while((node != root) && !node.next_sibling())
+			{
+				node = node.parent();
+				--depth;
+			}
+			if(node == root)
+				return 0;
+			node = node.next_sibling();
+		}
+	}
+
+	const char* validateXML(const char* byteArray, int64_t size)
+	{
+		// parsed with the same parser and options as readPlist, the check
+		// only skips building the tree
+		pugi::xml_document doc;
+		pugi::xml_parse_result result = doc.load_buffer(byteArray, (size_t) size);
+		if(!result)
+			return "Plist: XML parsed with error";
+
+		return checkXMLPlist(doc.child("plist").first_child());
+	}
+
+	const char* validate(const char* byteArray, int64_t size)
+	{
+		if(!byteArray || (size <= 0))
+			return "Plist: Empty plist data";
+		if((size >= 8) && (memcmp(byteArray, "bplist00", 8) == 0))
+			return validateBinary((const unsigned char*) byteArray, size);
+		return validateXML(byteArray, size);
+	}
+}
+
+bool validatePlist(const char* byteArray, int64_t size)
+{
+	return validate(byteArray, size) == 0;
+}
+
+bool validatePlist(const char* byteArray, int64_t size, std::string& problem)
+{
+	const char* found = validate(byteArray, size);
+	problem = found ? found : "";
+	return found == 0;
+}
+
+} // namespace Plist
@@ -0,0 +1,510 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+
+#include "PlistValue.hpp"
+#include "PlistDictionary.hpp"
+#include <cstring>
+
+namespace Plist
+{
+
+Value::Value()
+	: _type(BooleanType), _inlineSize(0)
+{
+	_boolean = false;
+}
+
+Value::Value(Type type)
+	: _type(type), _inlineSize(0)
+{
+	switch(type)
+	{
+		case BooleanType:
+			_boolean = false;
+			break;
+		case IntegerType:
+		case DateType:
+			_integer = 0;
+			break;
+		case RealType:
+			_real = 0;
+			break;
+		case DataType:
+		case StringType:
+			break;
+		case ArrayType:
+			_array = new array_type;
+			break;
+		case DictionaryType:
+			_dictionary = new dictionary_type;
+			break;
+		default:
+			throw Error("Plist::Value unknown type");
+	}
+}
+
+Value::Value(bool value)
+	: _type(BooleanType), _inlineSize(0)
+{
+	_boolean = value;
+}
+
+Value::Value(int value)
+	: _type(IntegerType), _inlineSize(0)
+{
+	_integer = value;
+}
+
+Value::Value(long value)
+	: _type(IntegerType), _inlineSize(0)
+{
+	_integer = value;
+}
+
+Value::Value(long long value)
+	: _type(IntegerType), _inlineSize(0)
+{
+	_integer = value;
+}
+
+Value::Value(double value)
+	: _type(RealType), _inlineSize(0)
+{
+	_real = value;
+}
+
+Value::Value(const Date& value)
+	: _type(DateType), _inlineSize(0)
+{
+	_date = value.timeAsEpoch();
+}
+
+Value::Value(const char* value)
+	: _type(StringType), _inlineSize(0)
+{
+	setBytes(StringType, value, strlen(value));
+}
+
+Value::Value(const std::string& value)
+	: _type(StringType), _inlineSize(0)
+{
+	setBytes(StringType, value.data(), value.size());
+}
+
+Value::Value(const data_type& value)
+	: _type(DataType), _inlineSize(0)
+{
+	setBytes(DataType, value.empty() ? 0 : &value[0], value.size());
+}
+
+Value::Value(const array_type& value)
+	: _type(ArrayType), _inlineSize(0)
+{
+	_array = new array_type(value);
+}
+
+Value::Value(const dictionary_type& value)
+	: _type(DictionaryType), _inlineSize(0)
+{
+	_dictionary = new dictionary_type(value);
+}
+
+Value::Value(const Value& other)
+	: _type(BooleanType), _inlineSize(0)
+{
+	copyFrom(other);
+}
+
+Value& Value::operator=(const Value& other)
+{
+	if(this != &other)
+	{
+		// copy first so assigning a value's own element works
+		Value copy(other);
+		swap(copy);
+	}
+	return *this;
+}
+
+#if __cplusplus >= 201103L
+Value::Value(Value&& other)
+	: _type(BooleanType), _inlineSize(0)
+{
+	_boolean = false;
+	swap(other);
+}
+
+Value& Value::operator=(Value&& other)
+{
+	if(this != &other)
+	{
+		Value moved(std::move(other));
+		swap(moved);
+	}
+	return *this;
+}
+#endif
+
+Value::~Value()
+{
+	destroy();
+}
+
+// every member is plain data or a pointer, so swapping the bytes swaps
+// the values
+
+void Value::swap(Value& other)
+{
+	char bytes[sizeof(Value)];
+	memcpy(bytes, (void*) this, sizeof(Value));
+	memcpy((void*) this, (void*) &other, sizeof(Value));
+	memcpy((void*) &other, bytes, sizeof(Value));
+}
+
+Value::Type Value::type() const
+{
+	return (Type) _type;
+}
+
+bool Value::operator==(const Value& other) const
+{
+	if(_type != other._type)
+		return false;
+
+	switch(_type)
+	{
+		case BooleanType:
+			return _boolean == other._boolean;
+		case IntegerType:
+		case DateType:
+			return _integer == other._integer;
+		case RealType:
+			return _real == other._real;
+		case DataType:
+		case StringType:
+			return (byteCount() == other.byteCount()) && (memcmp(bytes(), other.bytes(), byteCount()) == 0);
+		case ArrayType:
+			return *_array == *other._array;
+		case DictionaryType:
+			return *_dictionary == *other._dictionary;
+	}
+	return false;
+}
+
+bool Value::operator!=(const Value& other) const
+{
+	return !(*this == other);
+}
+
+boolean_type Value::asBoolean() const
+{
+	checkType(BooleanType);
+	return _boolean;
+}
+
+integer_type Value::asInteger() const
+{
+	checkType(IntegerType);
+	return _integer;
+}
+
+real_type Value::asReal() const
+{
+	checkType(RealType);
+	return _real;
+}
+
+date_type Value::asDate() const
+{
+	checkType(DateType);
+	Date date(Date::uninitialized);
+	date.setTimeFromAppleEpoch((double) (_date - 978307200));
+	return date;
+}
+
+string_type Value::asString() const
+{
+	checkType(StringType);
+	return string_type(bytes(), byteCount());
+}
+
+data_type Value::asData() const
+{
+	checkType(DataType);
+	return data_type(bytes(), bytes() + byteCount());
+}
+
+const char* Value::bytes() const
+{
+	if((_type != StringType) && (_type != DataType))
+		throw Error("Plist::Value holds neither a string nor data");
+	return onHeap() ? _heap.bytes : _inline;
+}
+
+size_t Value::byteCount() const
+{
+	if((_type != StringType) && (_type != DataType))
+		throw Error("Plist::Value holds neither a string nor data");
+	return onHeap() ? _heap.size : _inlineSize;
+}
+
+void Value::setString(const char* bytes, size_t size)
+{
+	Value value;
+	value.setBytes(StringType, bytes, size);
+	swap(value);
+}
+
+void Value::setData(const char* bytes, size_t size)
+{
+	Value value;
+	value.setBytes(DataType, bytes, size);
+	swap(value);
+}
+
+Value::array_type& Value::asArray()
+{
+	checkType(ArrayType);
+	return *_array;
+}
+
+const Value::array_type& Value::asArray() const
+{
+	checkType(ArrayType);
+	return *_array;
+}
+
+Value::dictionary_type& Value::asDictionary()
+{
+	checkType(DictionaryType);
+	return *_dictionary;
+}
+
+const Value::dictionary_type& Value::asDictionary() const
+{
+	checkType(DictionaryType);
+	return *_dictionary;
+}
+
+Value& Value::operator[](int32_t index)
+{
+	array_type& array = asArray();
+	if((index < 0) || ((size_t) index >= array.size()))
+		throw Error("Plist::Value array index out of range");
+	return array[index];
+}
+
+const Value& Value::operator[](int32_t index) const
+{
+	const array_type& array = asArray();
+	if((index < 0) || ((size_t) index >= array.size()))
+		throw Error("Plist::Value array index out of range");
+	return array[index];
+}
+
+Value& Value::operator[](const std::string& key)
+{
+	return asDictionary()[key];
+}
+
+Value& Value::operator[](const char* key)
+{
+	return asDictionary()[key];
+}
+
+// Plist::array_type and Plist::dictionary_type below are the boost::any
+// containers, array_type and dictionary_type are Value's own.
+
+// any of the policies' dictionaries; the keys of the map and flat ones
+// come in order, so inserting at the end doesn't search
+
+template<typename Dictionary>
+static Value fromAnyDictionary(const Dictionary& dictionary)
+{
+	Value result(Value::DictionaryType);
+	Value::dictionary_type& entries = result.asDictionary();
+	for(typename Dictionary::const_iterator it = dictionary.begin();
+			it != dictionary.end();
+			++it)
+		Value::fromAny(it->second).swap(entries.insert(entries.end(), std::make_pair(it->first, Value()))->second);
+	return result;
+}
+
+Value Value::fromAny(const boost::any& value)
+{
+	const std::type_info& valueType = value.type();
+
+	if(valueType == typeid(Plist::dictionary_type))
+		return fromAnyDictionary(boost::any_cast<const Plist::dictionary_type&>(value));
+	else if(valueType == typeid(HashDictionary<boost::any>))
+		return fromAnyDictionary(boost::any_cast<const HashDictionary<boost::any>&>(value));
+	else if(valueType == typeid(OrderedDictionary<boost::any>))
+		return fromAnyDictionary(boost::any_cast<const OrderedDictionary<boost::any>&>(value));
+	else if(valueType == typeid(FlatDictionary<boost::any>))
+		return fromAnyDictionary(boost::any_cast<const FlatDictionary<boost::any>&>(value));
+	else if(valueType == typeid(Plist::array_type))
+	{
+		const Plist::array_type& array = boost::any_cast<const Plist::array_type&>(value);
+		Value result(ArrayType);
+		result._array->resize(array.size());
+		for(size_t i = 0; i < array.size(); ++i)
+			fromAny(array[i]).swap((*result._array)[i]);
+		return result;
+	}
+	else if(valueType == typeid(string_type))
+		return Value(boost::any_cast<const string_type&>(value));
+	else if(valueType == typeid(int64_t))
+		return Value((long long) boost::any_cast<const int64_t&>(value));
+	else if(valueType == typeid(int32_t))
+		return Value((long long) boost::any_cast<const int32_t&>(value));
+	else if(valueType == typeid(long))
+		return Value((long long) boost::any_cast<const long&>(value));
+	else if(valueType == typeid(short))
+		return Value((long long) boost::any_cast<const short&>(value));
+	else if(valueType == typeid(double))
+		return Value(boost::any_cast<const double&>(value));
+	else if(valueType == typeid(float))
+		return Value((double) boost::any_cast<const float&>(value));
+	else if(valueType == typeid(bool))
+		return Value(boost::any_cast<const bool&>(value));
+	else if(valueType == typeid(Date))
+		return Value(boost::any_cast<const Date&>(value));
+	else if(valueType == typeid(data_type))
+		return Value(boost::any_cast<const data_type&>(value));
+	else
+		throw Error((std::string("Plist Error: Can't convert type ") + valueType.name() + " to a Plist::Value").c_str());
+}
+
+boost::any Value::toAny() const
+{
+	switch(_type)
+	{
+		case BooleanType:
+			return _boolean;
+		case IntegerType:
+			return (int64_t) _integer;
+		case RealType:
+			return _real;
+		case DateType:
+			return asDate();
+		case DataType:
+			return asData();
+		case StringType:
+			return asString();
+		case ArrayType:
+			{
+				boost::any result = Plist::array_type(_array->size());
+				Plist::array_type& array = boost::any_cast<Plist::array_type&>(result);
+				for(size_t i = 0; i < array.size(); ++i)
+					(*_array)[i].toAny().swap(array[i]);
+				return result;
+			}
+		case DictionaryType:
+			{
+				boost::any result = Plist::dictionary_type();
+				Plist::dictionary_type& dictionary = boost::any_cast<Plist::dictionary_type&>(result);
+				for(dictionary_type::const_iterator it = _dictionary->begin();
+						it != _dictionary->end();
+						++it)
+					it->second.toAny().swap(dictionary.insert(dictionary.end(), std::make_pair(it->first, boost::any()))->second);
+				return result;
+			}
+	}
+	throw Error("Plist::Value unknown type");
+}
+
+void Value::setBytes(Type type, const char* bytes, size_t size)
+{
+	// only called on a value holding no bytes or containers
+	_type = type;
+	if(size <= (size_t) InlineCapacity)
+	{
+		if(size > 0)
+			memcpy(_inline, bytes, size);
+		_inlineSize = (unsigned char) size;
+	}
+	else
+	{
+		_heap.bytes = new char[size];
+		memcpy(_heap.bytes, bytes, size);
+		_heap.size = size;
+		_inlineSize = InlineCapacity + 1;
+	}
+}
+
+void Value::copyFrom(const Value& other)
+{
+	switch(other._type)
+	{
+		case DataType:
+		case StringType:
+			setBytes(other.type(), other.bytes(), other.byteCount());
+			break;
+		case ArrayType:
+			_array = new array_type(*other._array);
+			_type = ArrayType;
+			break;
+		case DictionaryType:
+			_dictionary = new dictionary_type(*other._dictionary);
+			_type = DictionaryType;
+			break;
+		default:
+			memcpy((void*) this, (const void*) &other, sizeof(Value));
+			break;
+	}
+}
+
+void Value::destroy()
+{
+	switch(_type)
+	{
+		case DataType:
+		case StringType:
+			if(onHeap())
+				delete[] _heap.bytes;
+			break;
+		case ArrayType:
+			delete _array;
+			break;
+		case DictionaryType:
+			delete _dictionary;
+			break;
+	}
+}
+
+void Value::checkType(Type type) const
+{
+	static const char* names[] = { "boolean", "integer", "real", "date", "data", "string", "array", "dictionary" };
+	if(_type != type)
+		throw Error(std::string("Plist::Value doesn't hold ") + (type == IntegerType ? "an " : "a ") + names[type]);
+}
+
+bool Value::onHeap() const
+{
+	return _inlineSize > InlineCapacity;
+}
+
+} // namespace Plist
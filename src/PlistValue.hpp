@@ -0,0 +1,194 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+
+#ifndef __PLIST_VALUE_H__
+#define __PLIST_VALUE_H__
+
+#include "Plist.hpp"
+
+namespace Plist
+{
+		// A plist value held directly instead of in a boost::any.  The type
+		// is a tag, so dispatching on it is a switch rather than a chain of
+		// typeid compares.  Scalars, and strings and data up to
+		// InlineCapacity bytes, are stored in the value itself; containers
+		// hold their elements by value.
+		//
+		//		Plist::Value root(Plist::Value::DictionaryType);
+		//		root["name"] = "PlistCpp";
+		//		root["count"] = 3;
+		//		Plist::writePlistBinary("out.plist", root);
+		//
+		// Accessors throw Plist::Error if the value holds another type.
+
+		class Value
+		{
+			public:
+
+				enum Type
+				{
+					BooleanType,
+					IntegerType,
+					RealType,
+					DateType,
+					DataType,
+					StringType,
+					ArrayType,
+					DictionaryType
+				};
+
+				typedef std::vector<Value>                   array_type;
+				typedef std::map<std::string, Value>         dictionary_type;
+
+				enum { InlineCapacity = 22 };
+
+				// false
+				Value();
+
+				// empty value of type: false, zero, the unix epoch, an empty
+				// string, data, array or dictionary
+				explicit Value(Type type);
+
+				Value(bool value);
+				Value(int value);
+				Value(long value);
+				Value(long long value);
+				Value(double value);
+				Value(const Date& value);
+				Value(const char* value);
+				Value(const std::string& value);
+				Value(const data_type& value);
+				Value(const array_type& value);
+				Value(const dictionary_type& value);
+
+				Value(const Value& other);
+				Value& operator=(const Value& other);
+#if __cplusplus >= 201103L
+				Value(Value&& other);
+				Value& operator=(Value&& other);
+#endif
+				~Value();
+
+				void swap(Value& other);
+
+				Type type() const;
+
+				bool operator==(const Value& other) const;
+				bool operator!=(const Value& other) const;
+
+				boolean_type asBoolean() const;
+				integer_type asInteger() const;
+				real_type asReal() const;
+				date_type asDate() const;
+				string_type asString() const;
+				data_type asData() const;
+
+				// string or data bytes in place, not nul terminated
+				const char* bytes() const;
+				size_t byteCount() const;
+
+				void setString(const char* bytes, size_t size);
+				void setData(const char* bytes, size_t size);
+
+				array_type& asArray();
+				const array_type& asArray() const;
+				dictionary_type& asDictionary();
+				const dictionary_type& asDictionary() const;
+
+				// array element.  The index is an int32_t, as in Document and
+				// BinaryPlistView, so value[0] matches it exactly rather than
+				// being ambiguous with a null key.
+				Value& operator[](int32_t index);
+				const Value& operator[](int32_t index) const;
+
+				// dictionary value for key, added if missing
+				Value& operator[](const std::string& key);
+				Value& operator[](const char* key);
+
+				// Conversion from and to the boost::any trees the rest of the
+				// interface uses.  Both copy the whole tree.  fromAny takes
+				// the dictionaries of every dictionary policy; toAny builds
+				// the default ones.
+				static Value fromAny(const boost::any& value);
+				boost::any toAny() const;
+
+			private:
+
+				struct HeapBytes
+				{
+					char* bytes;
+					size_t size;
+				};
+
+				void setBytes(Type type, const char* bytes, size_t size);
+				void copyFrom(const Value& other);
+				void destroy();
+				void checkType(Type type) const;
+				bool onHeap() const;
+
+				union
+				{
+					boolean_type _boolean;
+					integer_type _integer;
+					real_type _real;
+					int64_t _date;					// seconds since 01-01-1970
+					char _inline[InlineCapacity];
+					HeapBytes _heap;
+					array_type* _array;
+					dictionary_type* _dictionary;
+				};
+
+				unsigned char _type;
+
+				// string or data size when inline, InlineCapacity + 1 when
+				// the bytes are on the heap
+				unsigned char _inlineSize;
+		};
+
+		// Read and write methods for Value, the same as their boost::any
+		// counterparts in Plist.hpp.
+
+		void readPlist(const char* byteArray, int64_t size, Value& message);
+		void readPlist(std::istream& stream, Value& message);
+		void readPlist(const char* filename, Value& message);
+
+		void writePlistBinary(std::ostream& stream, const Value& message);
+		void writePlistBinary(std::vector<char>& plist, const Value& message);
+		void writePlistBinary(const char* filename, const Value& message);
+
+		void writePlistXML(std::ostream& stream, const Value& message);
+		void writePlistXML(std::vector<char>& plist, const Value& message);
+		void writePlistXML(const char* filename, const Value& message);
+
+#if defined(PLIST_HAS_PMR)
+		void writePlistBinary(pmr::data_type& plist, const Value& message);
+		void writePlistXML(pmr::data_type& plist, const Value& message);
+#endif
+
+		int64_t serializedSize(const Value& message, Format format);
+};
+
+#endif
@@ -0,0 +1,749 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+#include "PlistXMLReader.hpp"
+#include "PlistHelpers.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace Plist {
+
+bool XMLPlistTreeBuilder::add(XMLPlistReader::Event event, XMLPlistReader& reader)
+{
+	switch(event)
+	{
+		case XMLPlistReader::BeginDictionary:
+			_frames.push_back(Frame());
+			_frames.back().container = dictionary_type();
+			return false;
+		case XMLPlistReader::BeginArray:
+			_frames.push_back(Frame());
+			_frames.back().container = array_type();
+			return false;
+		case XMLPlistReader::Key:
+			_frames.back().key = reader.key();
+			return false;
+		case XMLPlistReader::Value:
+			insert(reader.value());
+			return _complete;
+		case XMLPlistReader::EndDictionary:
+		case XMLPlistReader::EndArray:
+			{
+				boost::any container;
+				container.swap(_frames.back().container);
+				_frames.pop_back();
+				insert(container);
+				return _complete;
+			}
+		default:
+			throw Error("Plist: XML ended inside a value");
+	}
+}
+
+void XMLPlistTreeBuilder::insert(boost::any& value)
+{
+	if(_frames.empty())
+	{
+		_result.swap(value);
+		_complete = true;
+		return;
+	}
+
+	Frame& frame = _frames.back();
+	if(frame.container.type() == typeid(array_type))
+	{
+		array_type& array = boost::any_cast<array_type&>(frame.container);
+		array.push_back(boost::any());
+		array.back().swap(value);
+	}
+	else
+		boost::any_cast<dictionary_type&>(frame.container)[frame.key].swap(value);
+}
+
+static const size_t readChunkSize = 64 * 1024;
+
+static bool isSpace(char c)
+{
+	return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+// 1 if data starts with literal, 0 if it doesn't, -1 if there isn't enough
+// data yet to tell
+
+static int matchLiteral(const char* data, size_t available, const char* literal)
+{
+	size_t length = strlen(literal);
+	size_t compared = std::min(length, available);
+	if(memcmp(data, literal, compared) != 0)
+		return 0;
+	return (compared == length) ? 1 : -1;
+}
+
+static const char* findLiteral(const char* begin, const char* end, const char* literal)
+{
+	const char* found = std::search(begin, end, literal, literal + strlen(literal));
+	return (found == end) ? 0 : found;
+}
+
+static void appendUTF8(std::string& text, uint32_t codePoint)
+{
+	if(codePoint < 0x80)
+		text += (char) codePoint;
+	else if(codePoint < 0x800)
+	{
+		text += (char) (0xC0 | (codePoint >> 6));
+		text += (char) (0x80 | (codePoint & 0x3F));
+	}
+	else if(codePoint < 0x10000)
+	{
+		text += (char) (0xE0 | (codePoint >> 12));
+		text += (char) (0x80 | ((codePoint >> 6) & 0x3F));
+		text += (char) (0x80 | (codePoint & 0x3F));
+	}
+	else
+	{
+		text += (char) (0xF0 | (codePoint >> 18));
+		text += (char) (0x80 | ((codePoint >> 12) & 0x3F));
+		text += (char) (0x80 | ((codePoint >> 6) & 0x3F));
+		text += (char) (0x80 | (codePoint & 0x3F));
+	}
+}
+
+// Decodes the entity at begin, which points at '&'.  Returns the position
+// after it, or begin if it isn't one we know, in which case the '&' is
+// kept as text.
+
+static const char* decodeEntity(const char* begin, const char* end, std::string& text)
+{
+	const char* semicolon = (const char*) memchr(begin, ';', std::min((size_t) (end - begin), (size_t) 12));
+	if(!semicolon)
+		return begin;
+
+	std::string name(begin + 1, semicolon);
+	if(name == "lt")
+		text += '<';
+	else if(name == "gt")
+		text += '>';
+	else if(name == "amp")
+		text += '&';
+	else if(name == "apos")
+		text += '\'';
+	else if(name == "quot")
+		text += '"';
+	else if((name.size() > 1) && (name[0] == '#'))
+	{
+		bool hex = (name[1] == 'x');
+		const char* digits = name.c_str() + (hex ? 2 : 1);
+		if(!*digits)
+			return begin;
+
+		char* digitsEnd;
+		unsigned long codePoint = strtoul(digits, &digitsEnd, hex ? 16 : 10);
+		if(*digitsEnd || (codePoint > 0x10FFFF))
+			return begin;
+		appendUTF8(text, (uint32_t) codePoint);
+	}
+	else
+		return begin;
+
+	return semicolon + 1;
+}
+
+XMLPlistReader::XMLPlistReader(std::istream& stream)
+	: _stream(&stream),
+	_data(0),
+	_size(0),
+	_position(0),
+	_finished(false),
+	_fed(false),
+	_scanned(0),
+	_state(BeforePlist),
+	_pendingEnd(false),
+	_lastEvent(NeedMoreData)
+{
+}
+
+XMLPlistReader::XMLPlistReader(const char* byteArray, int64_t size)
+	: _stream(0),
+	_data(byteArray),
+	_size((size_t) size),
+	_position(0),
+	_finished(true),
+	_fed(false),
+	_scanned(0),
+	_state(BeforePlist),
+	_pendingEnd(false),
+	_lastEvent(NeedMoreData)
+{
+	if(!byteArray || (size <= 0))
+		throw Error("Plist: Empty plist data");
+}
+
+XMLPlistReader::XMLPlistReader()
+	: _stream(0),
+	_data(0),
+	_size(0),
+	_position(0),
+	_finished(false),
+	_fed(true),
+	_scanned(0),
+	_state(BeforePlist),
+	_pendingEnd(false),
+	_lastEvent(NeedMoreData)
+{
+}
+
+void XMLPlistReader::feed(const char* bytes, size_t size)
+{
+	if(!_fed)
+		throw Error("Plist: XMLPlistReader reading a stream or buffer can't be fed");
+	if(_finished)
+		throw Error("Plist: XMLPlistReader fed after finish()");
+
+	// drop what has been consumed, keep any partial token
+	_buffer.erase(0, _position);
+	_position = 0;
+
+	_buffer.append(bytes, size);
+	_data = _buffer.data();
+	_size = _buffer.size();
+}
+
+void XMLPlistReader::finish()
+{
+	if(!_fed)
+		throw Error("Plist: XMLPlistReader reading a stream or buffer can't be fed");
+	_finished = true;
+}
+
+// reads the next chunk of the stream.  Returns false if there is no more
+// input to wait for here, i.e. it's up to the caller to feed().
+
+bool XMLPlistReader::refill()
+{
+	if(!_stream || _finished)
+		return false;
+
+	_buffer.erase(0, _position);
+	_position = 0;
+
+	size_t used = _buffer.size();
+	_buffer.resize(used + readChunkSize);
+	_stream->read(&_buffer[used], readChunkSize);
+	size_t count = (size_t) _stream->gcount();
+	_buffer.resize(used + count);
+	if(count == 0)
+		_finished = true;
+
+	_data = _buffer.data();
+	_size = _buffer.size();
+	return true;
+}
+
+XMLPlistReader::Event XMLPlistReader::next()
+{
+	Event event;
+	if(_pendingEnd)
+	{
+		_pendingEnd = false;
+		event = endContainer();
+	}
+	else if(_state == AfterPlist)
+		event = EndDocument;
+	else
+	{
+		while(!step(event))
+		{
+			if(!refill())
+			{
+				event = NeedMoreData;
+				break;
+			}
+		}
+	}
+
+	_lastEvent = event;
+	return event;
+}
+
+// Reads markup from _position until it produces an event.  Returns false,
+// having consumed nothing of the incomplete token, if more data is needed.
+// Throws if the input ends there.
+
+bool XMLPlistReader::step(Event& event)
+{
+	for(;;)
+	{
+		while((_position < _size) && isSpace(_data[_position]))
+			++_position;
+
+		const char* p = _data + _position;
+		size_t available = _size - _position;
+
+		if(available == 0)
+		{
+			if(!_finished)
+				return false;
+			throw Error("Plist: XML ended before the plist was complete");
+		}
+
+		int match;
+		if(_state == BeforePlist)
+		{
+			// utf-8 byte order mark
+			match = matchLiteral(p, available, "\xEF\xBB\xBF");
+			if((match < 0) && !_finished)
+				return false;
+			if(match > 0)
+			{
+				_position += 3;
+				continue;
+			}
+		}
+
+		if(*p != '<')
+			throw Error("Plist: XML text found outside a value");
+
+		match = matchLiteral(p, available, "<!--");
+		if(match == 0)
+			match = matchLiteral(p, available, "<?");
+		if(match != 0)
+		{
+			if((match > 0) && skipPast((p[1] == '?') ? "?>" : "-->"))
+				continue;
+		}
+		else if((match = matchLiteral(p, available, "<!")) != 0)
+		{
+			if((match > 0) && skipDoctype())
+				continue;
+		}
+		else
+		{
+			size_t tagEnd;
+			if(findTagEnd(tagEnd))
+			{
+				bool endingTag = (p[1] == '/');
+				size_t nameStart = _position + (endingTag ? 2 : 1);
+				size_t nameEnd = nameStart;
+				while((nameEnd < tagEnd) && !isSpace(_data[nameEnd]) && (_data[nameEnd] != '/'))
+					++nameEnd;
+				std::string name(_data + nameStart, nameEnd - nameStart);
+
+				bool complete = true;
+				Event tagEvent;
+				if(endingTag)
+				{
+					_position = tagEnd + 1;
+					tagEvent = endTag(name);
+				}
+				else
+					tagEvent = startTag(name, tagEnd, _data[tagEnd - 1] == '/', complete);
+
+				if(complete)
+				{
+					// NeedMoreData here means the tag produced no event
+					if(tagEvent == NeedMoreData)
+						continue;
+					event = tagEvent;
+					return true;
+				}
+			}
+		}
+
+		if(_finished)
+			throw Error("Plist: XML ended before the plist was complete");
+		return false;
+	}
+}
+
+bool XMLPlistReader::skipPast(const char* terminator)
+{
+	const char* end = findLiteral(_data + _position, _data + _size, terminator);
+	if(!end)
+		return false;
+	_position = (end - _data) + strlen(terminator);
+	return true;
+}
+
+// skips <!DOCTYPE ...>, including an internal subset in brackets
+
+bool XMLPlistReader::skipDoctype()
+{
+	int brackets = 0;
+	char quote = 0;
+	for(size_t i = _position + 2; i < _size; ++i)
+	{
+		char c = _data[i];
+		if(quote)
+		{
+			if(c == quote)
+				quote = 0;
+		}
+		else if((c == '"') || (c == '\''))
+			quote = c;
+		else if(c == '[')
+			++brackets;
+		else if(c == ']')
+			--brackets;
+		else if((c == '>') && (brackets <= 0))
+		{
+			_position = i + 1;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool XMLPlistReader::findTagEnd(size_t& tagEnd) const
+{
+	char quote = 0;
+	for(size_t i = _position + 1; i < _size; ++i)
+	{
+		char c = _data[i];
+		if(quote)
+		{
+			if(c == quote)
+				quote = 0;
+		}
+		else if((c == '"') || (c == '\''))
+			quote = c;
+		else if(c == '>')
+		{
+			tagEnd = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Finds the end tag closing the value whose content starts at contentStart.
+// Picks up where the last incomplete scan stopped, so a large value arriving
+// in many chunks is only scanned once.
+
+bool XMLPlistReader::scanContent(size_t contentStart, size_t& contentEnd, size_t& endTagEnd)
+{
+	size_t position = std::max(contentStart, _position + _scanned);
+	for(;;)
+	{
+		const char* lt = (const char*) memchr(_data + position, '<', _size - position);
+		if(!lt)
+		{
+			_scanned = _size - _position;
+			return false;
+		}
+
+		position = lt - _data;
+		size_t available = _size - position;
+
+		const char* terminator = 0;
+		int match = matchLiteral(lt, available, "<![CDATA[");
+		if(match != 0)
+			terminator = "]]>";
+		else if((match = matchLiteral(lt, available, "<!--")) != 0)
+			terminator = "-->";
+		else if((match = matchLiteral(lt, available, "<?")) != 0)
+			terminator = "?>";
+		else if((match = matchLiteral(lt, available, "</")) != 0)
+			terminator = ">";
+		else
+			throw Error("Plist: XML element found inside a value");
+
+		const char* end = (match > 0) ? findLiteral(lt + 2, _data + _size, terminator) : 0;
+		if(!end)
+		{
+			_scanned = position - _position;
+			return false;
+		}
+
+		if(terminator[0] == '>')
+		{
+			contentEnd = position;
+			endTagEnd = end - _data;
+			return true;
+		}
+		position = (end - _data) + strlen(terminator);
+	}
+}
+
+// Text of a value, with entities decoded and line ends normalized to \n.
+// As pugixml does, each run of text between CDATA sections, comments and
+// processing instructions is dropped if it's only whitespace, and the rest
+// are joined with the CDATA.
+
+void XMLPlistReader::decodeContent(size_t contentStart, size_t contentEnd, std::string& text) const
+{
+	const char* p = _data + contentStart;
+	const char* end = _data + contentEnd;
+	size_t runStart = text.size();
+	bool onlySpace = true;
+
+	while(p < end)
+	{
+		const char* run = p;
+		while((p < end) && (*p != '<') && (*p != '&') && (*p != '\r'))
+		{
+			if(onlySpace && !isSpace(*p))
+				onlySpace = false;
+			++p;
+		}
+		text.append(run, p);
+		if(p == end)
+			break;
+
+		if(*p == '\r')
+		{
+			text += '\n';
+			p += ((p + 1 < end) && (p[1] == '\n')) ? 2 : 1;
+		}
+		else if(*p == '&')
+		{
+			onlySpace = false;
+			const char* next = decodeEntity(p, end, text);
+			if(next == p)
+			{
+				text += '&';
+				++p;
+			}
+			else
+				p = next;
+		}
+		else if(matchLiteral(p, end - p, "<![CDATA[") > 0)
+		{
+			if(onlySpace)
+				text.resize(runStart);
+			const char* cdataEnd = findLiteral(p + 9, end, "]]>");
+			for(const char* c = p + 9; c < cdataEnd; ++c)
+			{
+				if(*c != '\r')
+					text += *c;
+				else if((c + 1 == cdataEnd) || (c[1] != '\n'))
+					text += '\n';
+			}
+			p = cdataEnd + 3;
+			runStart = text.size();
+			onlySpace = true;
+		}
+		else
+		{
+			if(onlySpace)
+				text.resize(runStart);
+			p = findLiteral(p, end, (p[1] == '?') ? "?>" : "-->") + ((p[1] == '?') ? 2 : 3);
+			runStart = text.size();
+			onlySpace = true;
+		}
+	}
+
+	if(onlySpace)
+		text.resize(runStart);
+}
+
+// checks a value may start here
+
+void XMLPlistReader::beginValue()
+{
+	if(!_levels.empty() && (_levels.back() == DictionaryKeyLevel))
+		throw Error("Plist: XML dictionary key expected but not found");
+}
+
+void XMLPlistReader::endValue()
+{
+	if(_levels.empty())
+		_state = AfterRoot;
+	else if(_levels.back() == DictionaryValueLevel)
+		_levels.back() = DictionaryKeyLevel;
+}
+
+XMLPlistReader::Event XMLPlistReader::endContainer()
+{
+	Level level = _levels.back();
+	if(level == DictionaryValueLevel)
+		throw Error("Plist: XML dictionary value expected for key " + _key + " but not found");
+
+	_levels.pop_back();
+	endValue();
+	return (level == ArrayLevel) ? EndArray : EndDictionary;
+}
+
+XMLPlistReader::Event XMLPlistReader::startTag(const std::string& name, size_t tagEnd, bool selfClosing, bool& complete)
+{
+	complete = true;
+
+	if(name == "plist")
+	{
+		if(_state != BeforePlist)
+			throw Error("Plist: XML unexpected plist element");
+		if(selfClosing)
+			throw Error("Plist: XML plist is empty");
+		_position = tagEnd + 1;
+		_state = InPlist;
+		return NeedMoreData;
+	}
+	else if(_state == BeforePlist)
+		throw Error("Plist: XML plist element expected but not found");
+	else if(_state != InPlist)
+		throw Error("Plist: XML plist has more than one root value");
+
+	if((name == "dict") || (name == "array"))
+	{
+		beginValue();
+		_position = tagEnd + 1;
+		_levels.push_back((name == "dict") ? DictionaryKeyLevel : ArrayLevel);
+		_pendingEnd = selfClosing;
+		return (name == "dict") ? BeginDictionary : BeginArray;
+	}
+
+	// keys and scalars are read whole, through their end tag
+
+	size_t contentStart = tagEnd + 1;
+	size_t contentEnd = contentStart;
+	size_t endTagEnd = tagEnd;
+	std::string text;
+	if(!selfClosing)
+	{
+		if(!scanContent(contentStart, contentEnd, endTagEnd))
+		{
+			complete = false;
+			return NeedMoreData;
+		}
+
+		size_t nameEnd = contentEnd + 2;
+		while((nameEnd < endTagEnd) && !isSpace(_data[nameEnd]))
+			++nameEnd;
+		if(name.compare(0, std::string::npos, _data + contentEnd + 2, nameEnd - contentEnd - 2) != 0)
+			throw Error("Plist: XML end tag doesn't match <" + name + ">");
+
+		decodeContent(contentStart, contentEnd, text);
+	}
+
+	_position = endTagEnd + 1;
+	_scanned = 0;
+
+	if(name == "key")
+	{
+		if(_levels.empty() || (_levels.back() == ArrayLevel))
+			throw Error("Plist: XML key found outside a dictionary");
+		if(_levels.back() == DictionaryValueLevel)
+			throw Error("Plist: XML dictionary value expected for key " + _key + " but found another key node");
+
+		_levels.back() = DictionaryValueLevel;
+		_key.swap(text);
+		return Key;
+	}
+
+	beginValue();
+	parseXMLValue(name.c_str(), text, _value);
+	endValue();
+	return Value;
+}
+
+XMLPlistReader::Event XMLPlistReader::endTag(const std::string& name)
+{
+	if(name == "plist")
+	{
+		if(_state == InPlist)
+			throw Error(_levels.empty() ? "Plist: XML plist is empty" : "Plist: XML end tag doesn't match its element");
+		if(_state != AfterRoot)
+			throw Error("Plist: XML unexpected end tag");
+		_state = AfterPlist;
+		return EndDocument;
+	}
+
+	if(_levels.empty())
+		throw Error("Plist: XML unexpected end tag");
+	if(!(((name == "array") && (_levels.back() == ArrayLevel)) || ((name == "dict") && (_levels.back() != ArrayLevel))))
+		throw Error("Plist: XML end tag doesn't match its element");
+
+	return endContainer();
+}
+
+const std::string& XMLPlistReader::key() const
+{
+	return _key;
+}
+
+boost::any& XMLPlistReader::value()
+{
+	return _value;
+}
+
+int32_t XMLPlistReader::depth() const
+{
+	return (int32_t) _levels.size();
+}
+
+boost::any XMLPlistReader::readValue()
+{
+	boost::any value;
+	if(_lastEvent == Value)
+	{
+		value.swap(_value);
+		return value;
+	}
+	else if((_lastEvent != BeginDictionary) && (_lastEvent != BeginArray))
+		throw Error("Plist: XMLPlistReader::readValue called outside a value");
+
+	// data that has been fed must hold the whole value
+	XMLPlistTreeBuilder builder;
+	builder.add(_lastEvent, *this);
+	for(;;)
+	{
+		Event event = next();
+		if(event == NeedMoreData)
+			throw Error("Plist: XMLPlistReader needs more data to read the value");
+		if(builder.add(event, *this))
+			break;
+	}
+
+	value.swap(builder.result());
+	return value;
+}
+
+XMLPlistArrayIterator::XMLPlistArrayIterator(XMLPlistReader& reader)
+	: _reader(reader),
+	_done(false)
+{
+	if(reader.next() != XMLPlistReader::BeginArray)
+		throw Error("Plist: XML plist root is not an array");
+}
+
+bool XMLPlistArrayIterator::next(boost::any& element)
+{
+	if(_done)
+		return false;
+
+	XMLPlistReader::Event event = _reader.next();
+	if(event == XMLPlistReader::EndArray)
+	{
+		_done = true;
+		return false;
+	}
+	else if(event == XMLPlistReader::NeedMoreData)
+		throw Error("Plist: XMLPlistReader needs more data to read the value");
+
+	element = _reader.readValue();
+	return true;
+}
+
+} // namespace Plist
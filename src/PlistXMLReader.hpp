@@ -0,0 +1,169 @@
+//
+//   PlistCpp Property List (plist) serialization and parsing library.
+//
+//   https://github.com/animetrics/PlistCpp
+//
+//   Copyright (c) 2011 Animetrics Inc. (marc@animetrics.com)
+//
+//   Permission is hereby granted, free of charge, to any person obtaining a copy
+//   of this software and associated documentation files (the "Software"), to deal
+//   in the Software without restriction, including without limitation the rights
+//   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//   copies of the Software, and to permit persons to whom the Software is
+//   furnished to do so, subject to the following conditions:
+//
+//   The above copyright notice and this permission notice shall be included in
+//   all copies or substantial portions of the Software.
+//
+//   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//   THE SOFTWARE.
+
+#ifndef __PLIST_XML_READER_H__
+#define __PLIST_XML_READER_H__
+
+#include "Plist.hpp"
+
+namespace Plist
+{
+		// Pull parser for XML plists.  Events are read one at a time straight
+		// from the XML text, no DOM is built, so memory use is bounded by the
+		// largest single value rather than the whole document.
+		//
+		// Input is UTF-8.  Comments, processing instructions and the doctype
+		// are skipped; values decode exactly as readPlist decodes them.
+
+		class XMLPlistReader
+		{
+			public:
+
+				enum Event
+				{
+					// only returned when data is supplied with feed()
+					NeedMoreData,
+					BeginDictionary,
+					EndDictionary,
+					BeginArray,
+					EndArray,
+					// dictionary key, see key()
+					Key,
+					// scalar value, see value()
+					Value,
+					// </plist> has been read
+					EndDocument
+				};
+
+				// reads stream in chunks as events are pulled
+				explicit XMLPlistReader(std::istream& stream);
+
+				// reads a buffer, which must outlive the reader
+				XMLPlistReader(const char* byteArray, int64_t size);
+
+				// reads data handed over with feed(), call finish() once all
+				// of it has been fed.
+				XMLPlistReader();
+
+				void feed(const char* bytes, size_t size);
+				void finish();
+
+				Event next();
+
+				// key of the last Key event
+				const std::string& key() const;
+
+				// value of the last Value event
+				boost::any& value();
+
+				// number of dictionaries and arrays currently open
+				int32_t depth() const;
+
+				// Decodes the whole value begun by the last BeginDictionary,
+				// BeginArray or Value event, reading through its end.
+				boost::any readValue();
+
+			private:
+
+				enum State
+				{
+					BeforePlist,
+					InPlist,
+					AfterRoot,
+					AfterPlist
+				};
+
+				enum Level
+				{
+					ArrayLevel,
+					DictionaryKeyLevel,
+					DictionaryValueLevel
+				};
+
+				// copying would leave _data pointing into the other reader
+				XMLPlistReader(const XMLPlistReader&);
+				XMLPlistReader& operator=(const XMLPlistReader&);
+
+				bool refill();
+				bool step(Event& event);
+				bool skipPast(const char* terminator);
+				bool skipDoctype();
+				bool findTagEnd(size_t& tagEnd) const;
+				bool scanContent(size_t contentStart, size_t& contentEnd, size_t& endTagEnd);
+				void decodeContent(size_t contentStart, size_t contentEnd, std::string& text) const;
+				void beginValue();
+				void endValue();
+				Event endContainer();
+				Event startTag(const std::string& name, size_t tagEnd, bool selfClosing, bool& complete);
+				Event endTag(const std::string& name);
+
+				std::istream* _stream;
+				std::string _buffer;
+				const char* _data;
+				size_t _size;
+				size_t _position;
+				bool _finished;
+				bool _fed;
+
+				// value content already scanned for its end tag, from _position
+				size_t _scanned;
+
+				State _state;
+				std::vector<Level> _levels;
+				bool _pendingEnd;
+				Event _lastEvent;
+
+				std::string _key;
+				boost::any _value;
+		};
+
+		// Reads the elements of a plist whose root is an array one at a time,
+		// for working through large exports without holding them in memory.
+		//
+		//		Plist::XMLPlistReader reader(stream);
+		//		Plist::XMLPlistArrayIterator it(reader);
+		//		boost::any element;
+		//		while(it.next(element))
+		//			...
+
+		class XMLPlistArrayIterator
+		{
+			public:
+
+				// reads up to the root array, throws Plist::Error if the root
+				// isn't an array
+				explicit XMLPlistArrayIterator(XMLPlistReader& reader);
+
+				// next element, false once the array has ended
+				bool next(boost::any& element);
+
+			private:
+
+				XMLPlistReader& _reader;
+				bool _done;
+		};
+};
+
+#endif
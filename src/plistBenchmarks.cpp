@@ -0,0 +1,908 @@
+#include "Plist.hpp"
+#include "PlistBase64.hpp"
+#include "PlistDictionary.hpp"
+#include "PlistDocument.hpp"
+#include "PlistFields.hpp"
+#include "PlistHelpers.hpp"
+#include "PlistProjection.hpp"
+#include "PlistUnicode.hpp"
+#include "PlistUpdater.hpp"
+#include "PlistValue.hpp"
+#include <boost/locale/encoding_utf.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+// Throughput benchmarks.  Run all of them with no arguments or pass the
+// names of the ones to run, e.g.
+//
+//     runBenchmarks writeBinary
+
+using namespace std;
+
+typedef chrono::steady_clock bench_clock;
+
+static double millisecondsSince(bench_clock::time_point start)
+{
+	return chrono::duration<double, milli>(bench_clock::now() - start).count();
+}
+
+// array of count records, each a small dictionary like a typical exported
+// table row.
+
+static void createRecords(vector<boost::any>& records, int count)
+{
+	records.resize(count);
+	for(int i = 0; i < count; ++i)
+	{
+		stringstream name;
+		name<<"record "<<i;
+
+		vector<boost::any> tags(3);
+		tags[0] = string("alpha");
+		tags[1] = string("beta");
+		tags[2] = int64_t(i % 7);
+
+		map<string, boost::any> record;
+		record["id"] = int64_t(i);
+		record["name"] = name.str();
+		record["score"] = i * 0.25;
+		record["enabled"] = (i % 2) == 0;
+		record["tags"] = tags;
+		records[i] = record;
+	}
+}
+
+static void benchWriteBinary()
+{
+	cout<<"writePlistBinary, array of records"<<endl;
+	cout<<setw(10)<<"records"<<setw(14)<<"bytes"<<setw(12)<<"ms"<<setw(16)<<"ns/record"<<endl;
+
+	for(int count = 2000; count <= 256000; count *= 2)
+	{
+		vector<boost::any> records;
+		createRecords(records, count);
+
+		vector<char> plist;
+		bench_clock::time_point start = bench_clock::now();
+		Plist::writePlistBinary(plist, records);
+		double ms = millisecondsSince(start);
+
+		cout<<setw(10)<<count<<setw(14)<<plist.size()<<setw(12)<<fixed<<setprecision(2)<<ms
+			<<setw(16)<<setprecision(1)<<(ms * 1e6 / count)<<endl;
+	}
+	cout<<endl;
+}
+
+// direct writer against the pugixml document it replaced, both to a stream
+
+static void benchWriteXML()
+{
+	cout<<"writePlistXML, array of records, direct and through pugixml"<<endl;
+	cout<<setw(10)<<"records"<<setw(14)<<"bytes"<<setw(12)<<"direct ms"<<setw(12)<<"pugi ms"<<setw(16)<<"ns/record"<<endl;
+
+	for(int count = 2000; count <= 256000; count *= 2)
+	{
+		vector<boost::any> records;
+		createRecords(records, count);
+
+		stringstream direct;
+		bench_clock::time_point start = bench_clock::now();
+		Plist::writePlistXML(direct, records);
+		double directMs = millisecondsSince(start);
+
+		stringstream document;
+		start = bench_clock::now();
+		Plist::writePlistXMLDocument(document, records);
+		double documentMs = millisecondsSince(start);
+
+		cout<<setw(10)<<count<<setw(14)<<direct.str().size()<<setw(12)<<fixed<<setprecision(2)<<directMs
+			<<setw(12)<<documentMs<<setw(16)<<setprecision(1)<<(directMs * 1e6 / count)<<endl;
+	}
+	cout<<endl;
+}
+
+// array of count dates, written and read back in both formats
+
+static void benchDates()
+{
+	cout<<"dates, array of count, write and read"<<endl;
+	cout<<setw(10)<<"dates"<<setw(14)<<"xml write"<<setw(14)<<"xml read"<<setw(14)<<"bin write"<<setw(14)<<"bin read"<<"   (ns/date)"<<endl;
+
+	for(int count = 10000; count <= 640000; count *= 4)
+	{
+		vector<boost::any> dates(count);
+		for(int i = 0; i < count; ++i)
+		{
+			Plist::Date date(Plist::Date::uninitialized);
+			date.setTimeFromAppleEpoch(i * 86413.0);
+			dates[i] = date;
+		}
+
+		cout<<setw(10)<<count<<fixed<<setprecision(1);
+
+		Plist::Format formats[] = { Plist::XMLFormat, Plist::BinaryFormat };
+		for(int f = 0; f < 2; ++f)
+		{
+			vector<char> plist;
+			bench_clock::time_point start = bench_clock::now();
+			if(formats[f] == Plist::XMLFormat)
+				Plist::writePlistXML(plist, dates);
+			else
+				Plist::writePlistBinary(plist, dates);
+			double writeMs = millisecondsSince(start);
+
+			boost::any message;
+			start = bench_clock::now();
+			Plist::readPlist(&plist[0], plist.size(), message);
+			double readMs = millisecondsSince(start);
+
+			cout<<setw(14)<<(writeMs * 1e6 / count)<<setw(14)<<(readMs * 1e6 / count);
+		}
+		cout<<endl;
+	}
+	cout<<endl;
+}
+
+// base64 of a 16MB buffer with each codec the cpu supports
+
+static void benchBase64()
+{
+	static const char* codecNames[] = { "scalar", "ssse3", "avx2" };
+
+	cout<<"base64, 16MB"<<endl;
+	cout<<setw(10)<<"codec"<<setw(16)<<"encode MB/s"<<setw(16)<<"decode MB/s"<<endl;
+
+	const size_t size = 16 << 20;
+	vector<unsigned char> data(size);
+	for(size_t i = 0; i < size; ++i)
+		data[i] = (unsigned char) (i * 2654435761u >> 13);
+
+	vector<char> encoded(Plist::base64EncodedSize(size));
+	vector<unsigned char> decoded(Plist::base64DecodeCapacity(encoded.size()));
+
+	for(int codec = Plist::Base64Scalar; codec <= Plist::base64BestCodec(); ++codec)
+	{
+		bench_clock::time_point start = bench_clock::now();
+		Plist::base64Encode(&encoded[0], &data[0], size, (Plist::Base64Codec) codec);
+		double encodeMs = millisecondsSince(start);
+
+		start = bench_clock::now();
+		size_t decodedSize = Plist::base64Decode(&decoded[0], &encoded[0], encoded.size(), (Plist::Base64Codec) codec);
+		double decodeMs = millisecondsSince(start);
+
+		if(decodedSize != size || !equal(data.begin(), data.end(), decoded.begin()))
+			cout<<"base64 round trip failed"<<endl;
+
+		// MB/s of binary data
+		cout<<setw(10)<<codecNames[codec]<<fixed<<setprecision(0)
+			<<setw(16)<<(size / 1048576.0 / (encodeMs / 1000))
+			<<setw(16)<<(size / 1048576.0 / (decodeMs / 1000))<<endl;
+	}
+	cout<<endl;
+}
+
+// UTF-16 to UTF-8 of 8M units with each codec the cpu supports, against
+// the swap and utf_to_utf binary strings used to go through
+
+static void benchUnicode()
+{
+	static const char* codecNames[] = { "scalar", "ssse3", "avx2" };
+	static const char* textNames[] = { "ascii", "cjk", "mixed" };
+
+	cout<<"utf-16 to utf-8, 8M units"<<endl;
+	cout<<setw(12)<<"codec";
+	for(int text = 0; text < 3; ++text)
+		cout<<setw(12)<<textNames[text]<<" MB/s";
+	cout<<endl;
+
+	const size_t count = 8 << 20;
+	vector<vector<unsigned char> > texts(3, vector<unsigned char>(2 * count));
+	for(size_t i = 0; i < count; ++i)
+	{
+		uint16_t units[3] = {
+			(uint16_t) ('a' + i % 26),
+			(uint16_t) (0x4E00 + i % 0x5000),
+			(uint16_t) ((i % 7 == 0) ? 0xE9 : ((i % 3 == 0) ? 0x4E00 + i % 0x5000 : 'a' + i % 26)) };
+		for(int text = 0; text < 3; ++text)
+		{
+			texts[text][2 * i] = (unsigned char) (units[text] >> 8);
+			texts[text][2 * i + 1] = (unsigned char) units[text];
+		}
+	}
+
+	// MB/s of UTF-16
+	double megabytes = 2.0 * count / 1048576.0;
+	vector<char> output(Plist::utf16ToUTF8Capacity(count));
+
+	cout<<setw(12)<<"utf_to_utf";
+	for(int text = 0; text < 3; ++text)
+	{
+		bench_clock::time_point start = bench_clock::now();
+		vector<int16_t> characters(count);
+		for(size_t i = 0; i < count; ++i)
+			characters[i] = (int16_t) ((texts[text][2 * i] << 8) | texts[text][2 * i + 1]);
+		string result = boost::locale::conv::utf_to_utf<char, int16_t>(&characters[0], &characters[0] + count, boost::locale::conv::stop);
+		cout<<fixed<<setprecision(0)<<setw(17)<<(megabytes / (millisecondsSince(start) / 1000));
+	}
+	cout<<endl;
+
+	for(int codec = Plist::UnicodeScalar; codec <= Plist::unicodeBestCodec(); ++codec)
+	{
+		cout<<setw(12)<<codecNames[codec];
+		for(int text = 0; text < 3; ++text)
+		{
+			size_t size = 0;
+			bench_clock::time_point start = bench_clock::now();
+			if(!Plist::utf16ToUTF8(&output[0], &texts[text][0], count, size, (Plist::UnicodeCodec) codec))
+				cout<<"transcoding failed"<<endl;
+			cout<<fixed<<setprecision(0)<<setw(17)<<(megabytes / (millisecondsSince(start) / 1000));
+		}
+		cout<<endl;
+	}
+	cout<<endl;
+}
+
+// reading and writing the same records as boost::any and as Value trees
+
+static void benchValue()
+{
+	cout<<"boost::any against Value, array of records, binary and xml"<<endl;
+	cout<<setw(10)<<"records"<<setw(8)<<"format"<<setw(14)<<"read any"<<setw(14)<<"read value"
+		<<setw(14)<<"write any"<<setw(14)<<"write value"<<"  (ms)"<<endl;
+
+	for(int count = 2000; count <= 256000; count *= 4)
+	{
+		vector<boost::any> records;
+		createRecords(records, count);
+		Plist::Value recordValues = Plist::Value::fromAny(records);
+
+		for(int xml = 0; xml < 2; ++xml)
+		{
+			vector<char> plist;
+			bench_clock::time_point start = bench_clock::now();
+			if(xml)
+				Plist::writePlistXML(plist, records);
+			else
+				Plist::writePlistBinary(plist, records);
+			double writeAnyMs = millisecondsSince(start);
+
+			vector<char> valuePlist;
+			start = bench_clock::now();
+			if(xml)
+				Plist::writePlistXML(valuePlist, recordValues);
+			else
+				Plist::writePlistBinary(valuePlist, recordValues);
+			double writeValueMs = millisecondsSince(start);
+
+			// each tree is freed before the next read, so both reads start
+			// from the same heap
+			double readAnyMs;
+			{
+				boost::any readAny;
+				start = bench_clock::now();
+				Plist::readPlist(&plist[0], plist.size(), readAny);
+				readAnyMs = millisecondsSince(start);
+			}
+
+			double readValueMs;
+			{
+				Plist::Value readValue;
+				start = bench_clock::now();
+				Plist::readPlist(&plist[0], plist.size(), readValue);
+				readValueMs = millisecondsSince(start);
+			}
+
+			cout<<setw(10)<<count<<setw(8)<<(xml ? "xml" : "binary")<<fixed<<setprecision(2)
+				<<setw(14)<<readAnyMs<<setw(14)<<readValueMs<<setw(14)<<writeAnyMs<<setw(14)<<writeValueMs<<endl;
+		}
+	}
+	cout<<endl;
+}
+
+// reading a binary plist into a boost::any tree and into a Document, and
+// freeing each
+
+static void benchDocument()
+{
+	cout<<"readPlist into boost::any and Document, array of records, binary"<<endl;
+	cout<<setw(10)<<"records"<<setw(14)<<"any read"<<setw(14)<<"any free"
+		<<setw(14)<<"doc read"<<setw(14)<<"doc free"<<setw(14)<<"doc bytes"<<"  (ms)"<<endl;
+
+	for(int count = 2000; count <= 256000; count *= 4)
+	{
+		vector<boost::any> records;
+		createRecords(records, count);
+		vector<char> plist;
+		Plist::writePlistBinary(plist, records);
+
+		boost::any* message = new boost::any;
+		bench_clock::time_point start = bench_clock::now();
+		Plist::readPlist(&plist[0], plist.size(), *message);
+		double anyReadMs = millisecondsSince(start);
+
+		start = bench_clock::now();
+		delete message;
+		double anyFreeMs = millisecondsSince(start);
+
+		Plist::Document* document = new Plist::Document;
+		start = bench_clock::now();
+		Plist::readPlist(&plist[0], plist.size(), *document);
+		double documentReadMs = millisecondsSince(start);
+		size_t documentBytes = document->memoryUsed();
+
+		start = bench_clock::now();
+		delete document;
+		double documentFreeMs = millisecondsSince(start);
+
+		cout<<setw(10)<<count<<fixed<<setprecision(2)<<setw(14)<<anyReadMs<<setw(14)<<anyFreeMs
+			<<setw(14)<<documentReadMs<<setw(14)<<documentFreeMs<<setw(14)<<documentBytes<<endl;
+	}
+	cout<<endl;
+}
+
+// A binary plist of levels arrays, each holding the next one twice, the
+// last holding one string twice, 2^levels strings when decoded as a tree.
+
+static void createSharedPlist(vector<char>& plist, int levels)
+{
+	const char header[] = "bplist00";
+	plist.assign(header, header + 8);
+	for(int i = 0; i < levels; ++i)
+	{
+		plist.push_back((char) 0xA2);
+		plist.push_back((char) (i + 1));
+		plist.push_back((char) (i + 1));
+	}
+	plist.push_back((char) 0x51);
+	plist.push_back('x');
+
+	int tableOffset = (int) plist.size();
+	for(int i = 0; i <= levels; ++i)
+		plist.push_back((char) (8 + 3 * i));
+
+	const char trailer[] = { 0, 0, 0, 0, 0, 0, 1, 1 };
+	plist.insert(plist.end(), trailer, trailer + 8);
+	plist.insert(plist.end(), 7, 0);
+	plist.push_back((char) (levels + 1));
+	plist.insert(plist.end(), 15, 0);
+	plist.push_back((char) tableOffset);
+}
+
+static void benchShared()
+{
+	cout<<"readPlist of a plist sharing each array twice, into boost::any and Document"<<endl;
+	cout<<setw(10)<<"levels"<<setw(14)<<"bytes"<<setw(14)<<"any ms"<<setw(14)<<"doc ms"
+		<<setw(14)<<"doc bytes"<<endl;
+
+	for(int levels = 8; levels <= 20; levels += 4)
+	{
+		vector<char> plist;
+		createSharedPlist(plist, levels);
+
+		boost::any* message = new boost::any;
+		bench_clock::time_point start = bench_clock::now();
+		Plist::readPlist(&plist[0], plist.size(), *message);
+		double anyMs = millisecondsSince(start);
+		delete message;
+
+		Plist::Document document;
+		start = bench_clock::now();
+		Plist::readPlist(&plist[0], plist.size(), document);
+		double documentMs = millisecondsSince(start);
+
+		cout<<setw(10)<<levels<<setw(14)<<plist.size()<<fixed<<setprecision(2)<<setw(14)<<anyMs
+			<<setw(14)<<documentMs<<setw(14)<<document.memoryUsed()<<endl;
+	}
+	cout<<endl;
+}
+
+// routing a file by its header, against reading it
+
+static void benchProbe()
+{
+	cout<<"readPlist against probePlist of a file, array of records"<<endl;
+	cout<<setw(10)<<"records"<<setw(8)<<"format"<<setw(14)<<"bytes"<<setw(14)<<"read ms"
+		<<setw(14)<<"probe us"<<endl;
+
+	const char* filename = "probeBenchmark.plist";
+	const int probeCount = 1000;
+	for(int count = 2000; count <= 128000; count *= 8)
+	{
+		vector<boost::any> records;
+		createRecords(records, count);
+
+		for(int format = 0; format < 2; ++format)
+		{
+			if(format == 0)
+				Plist::writePlistBinary(filename, records);
+			else
+				Plist::writePlistXML(filename, records);
+
+			boost::any* message = new boost::any;
+			bench_clock::time_point start = bench_clock::now();
+			Plist::readPlist(filename, *message);
+			double readMs = millisecondsSince(start);
+			delete message;
+
+			int64_t rootCount = 0;
+			start = bench_clock::now();
+			for(int i = 0; i < probeCount; ++i)
+				rootCount += Plist::probePlist(filename).rootCount;
+			double probeUs = millisecondsSince(start) * 1000 / probeCount;
+
+			ifstream file(filename, ios::binary | ios::ate);
+			cout<<setw(10)<<count<<setw(8)<<(format == 0 ? "binary" : "xml")<<setw(14)<<file.tellg()
+				<<fixed<<setprecision(2)<<setw(14)<<readMs<<setw(14)<<probeUs<<endl;
+		}
+	}
+	remove(filename);
+	cout<<endl;
+}
+
+// pulling one key out of every record, against reading them all
+
+static void benchProjection()
+{
+	cout<<"readPlist against projectPlist of \"*/id\", array of records, binary"<<endl;
+	cout<<setw(10)<<"records"<<setw(14)<<"read ms"<<setw(14)<<"project ms"<<endl;
+
+	Plist::KeyPathSet paths;
+	paths.add("*/id");
+
+	for(int count = 2000; count <= 256000; count *= 4)
+	{
+		vector<boost::any> records;
+		createRecords(records, count);
+		vector<char> plist;
+		Plist::writePlistBinary(plist, records);
+
+		boost::any* message = new boost::any;
+		bench_clock::time_point start = bench_clock::now();
+		Plist::readPlist(&plist[0], plist.size(), *message);
+		double readMs = millisecondsSince(start);
+		delete message;
+
+		message = new boost::any;
+		start = bench_clock::now();
+		Plist::projectPlist(&plist[0], plist.size(), paths, *message);
+		double projectMs = millisecondsSince(start);
+		delete message;
+
+		cout<<setw(10)<<count<<fixed<<setprecision(2)<<setw(14)<<readMs<<setw(14)<<projectMs<<endl;
+	}
+	cout<<endl;
+}
+
+// a large binary plist read on one thread and on several
+
+static void benchParallel()
+{
+	cout<<"readPlist against readPlistParallel, 256000 records, binary"<<endl;
+	cout<<setw(10)<<"threads"<<setw(14)<<"ms"<<endl;
+
+	vector<boost::any> records;
+	createRecords(records, 256000);
+	vector<char> plist;
+	Plist::writePlistBinary(plist, records);
+
+	boost::any* message = new boost::any;
+	bench_clock::time_point start = bench_clock::now();
+	Plist::readPlist(&plist[0], plist.size(), *message);
+	cout<<setw(10)<<"readPlist"<<fixed<<setprecision(2)<<setw(14)<<millisecondsSince(start)<<endl;
+	delete message;
+
+	unsigned maxThreads = std::max(1u, thread::hardware_concurrency());
+	for(unsigned threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+	{
+		message = new boost::any;
+		start = bench_clock::now();
+		Plist::readPlistParallel(&plist[0], plist.size(), *message, threadCount);
+		cout<<setw(10)<<threadCount<<fixed<<setprecision(2)<<setw(14)<<millisecondsSince(start)<<endl;
+		delete message;
+	}
+	cout<<endl;
+}
+
+// checking a plist before accepting it, against reading it
+
+static void benchValidate()
+{
+	cout<<"validatePlist against readPlist into boost::any, array of records"<<endl;
+	cout<<setw(10)<<"records"<<setw(8)<<"format"<<setw(14)<<"bytes"<<setw(14)<<"read ms"
+		<<setw(14)<<"validate ms"<<endl;
+
+	for(int count = 2000; count <= 128000; count *= 4)
+	{
+		vector<boost::any> records;
+		createRecords(records, count);
+
+		for(int format = 0; format < 2; ++format)
+		{
+			vector<char> plist;
+			if(format == 0)
+				Plist::writePlistBinary(plist, records);
+			else
+				Plist::writePlistXML(plist, records);
+
+			boost::any* message = new boost::any;
+			bench_clock::time_point start = bench_clock::now();
+			Plist::readPlist(&plist[0], plist.size(), *message);
+			double readMs = millisecondsSince(start);
+			delete message;
+
+			start = bench_clock::now();
+			bool valid = Plist::validatePlist(&plist[0], plist.size());
+			double validateMs = millisecondsSince(start);
+			if(!valid)
+				cout<<"validatePlist rejected a written plist"<<endl;
+
+			cout<<setw(10)<<count<<setw(8)<<(format == 0 ? "binary" : "xml")<<setw(14)<<plist.size()
+				<<fixed<<setprecision(2)<<setw(14)<<readMs<<setw(14)<<validateMs<<endl;
+		}
+	}
+	cout<<endl;
+}
+
+// reads plist with Policy and looks every key up in the root and in each
+// record, prints the times in ms
+
+template<typename Policy>
+static void benchDictionaryPolicy(const char* name, const vector<char>& plist, const vector<string>& keys)
+{
+	typedef typename Policy::dictionary_type dictionary;
+
+	boost::any* message = new boost::any;
+	bench_clock::time_point start = bench_clock::now();
+	Plist::readPlist<Policy>(&plist[0], plist.size(), *message);
+	double readMs = millisecondsSince(start);
+
+	const dictionary& root = boost::any_cast<const dictionary&>(*message);
+	static const char* fields[] = { "id", "name", "score", "enabled", "tags", "missing" };
+	size_t found = 0;
+	start = bench_clock::now();
+	for(size_t i = 0; i < keys.size(); ++i)
+	{
+		const dictionary& record = boost::any_cast<const dictionary&>(root.find(keys[i])->second);
+		for(int field = 0; field < 6; ++field)
+			found += record.count(fields[field]);
+	}
+	double lookupMs = millisecondsSince(start);
+
+	vector<char> written;
+	start = bench_clock::now();
+	Plist::writePlistBinary(written, *message);
+	double writeMs = millisecondsSince(start);
+
+	start = bench_clock::now();
+	delete message;
+	double freeMs = millisecondsSince(start);
+
+	if(found != 5 * keys.size())
+		cout<<"lookup mismatch"<<endl;
+
+	cout<<setw(10)<<name<<fixed<<setprecision(2)<<setw(14)<<readMs<<setw(14)<<lookupMs
+		<<setw(14)<<writeMs<<setw(14)<<freeMs<<endl;
+}
+
+static void benchDictionaries()
+{
+	cout<<"readPlist with each dictionary policy, dictionary of records, binary"<<endl;
+
+	for(int count = 4000; count <= 256000; count *= 8)
+	{
+		vector<boost::any> records;
+		createRecords(records, count);
+
+		map<string, boost::any> table;
+		vector<string> keys(count);
+		for(int i = 0; i < count; ++i)
+		{
+			stringstream key;
+			key<<"row"<<(i * 7919) % count;
+			keys[i] = key.str();
+			table[keys[i]].swap(records[i]);
+		}
+		vector<char> plist;
+		Plist::writePlistBinary(plist, table);
+
+		cout<<count<<" records"<<endl;
+		cout<<setw(10)<<"policy"<<setw(14)<<"read"<<setw(14)<<"lookup"
+			<<setw(14)<<"write"<<setw(14)<<"free"<<"  (ms)"<<endl;
+		benchDictionaryPolicy<Plist::MapDictionaryPolicy>("map", plist, keys);
+		benchDictionaryPolicy<Plist::HashDictionaryPolicy>("hash", plist, keys);
+		benchDictionaryPolicy<Plist::OrderedDictionaryPolicy>("ordered", plist, keys);
+		benchDictionaryPolicy<Plist::FlatDictionaryPolicy>("flat", plist, keys);
+	}
+	cout<<endl;
+}
+
+// a record of createRecords as a struct, members in the order a map keeps
+// them
+
+struct Record
+{
+	bool enabled;
+	int64_t id;
+	string name;
+	double score;
+	vector<boost::any> tags;
+};
+PLIST_FIELDS(Record, enabled, id, name, score, tags)
+
+// reading an array of records into structs by walking a boost::any tree,
+// and straight through PLIST_FIELDS, then writing them back
+
+static void readRecords(const boost::any& message, vector<Record>& records)
+{
+	const vector<boost::any>& array = boost::any_cast<const vector<boost::any>&>(message);
+	records.resize(array.size());
+	for(size_t i = 0; i < array.size(); ++i)
+	{
+		const map<string, boost::any>& record = boost::any_cast<const map<string, boost::any>&>(array[i]);
+		records[i].enabled = boost::any_cast<bool>(record.find("enabled")->second);
+		records[i].id = boost::any_cast<int64_t>(record.find("id")->second);
+		records[i].name = boost::any_cast<const string&>(record.find("name")->second);
+		records[i].score = boost::any_cast<double>(record.find("score")->second);
+		records[i].tags = boost::any_cast<const vector<boost::any>&>(record.find("tags")->second);
+	}
+}
+
+static void benchFields()
+{
+	cout<<"records read into structs and written back, binary"<<endl;
+	cout<<setw(10)<<"records"<<setw(14)<<"any read"<<setw(14)<<"fields read"
+		<<setw(14)<<"any write"<<setw(14)<<"fields write"<<"  (ms)"<<endl;
+
+	for(int count = 2000; count <= 256000; count *= 4)
+	{
+		vector<boost::any> source;
+		createRecords(source, count);
+		vector<char> plist;
+		Plist::writePlistBinary(plist, source);
+
+		vector<Record> anyRecords;
+		bench_clock::time_point start = bench_clock::now();
+		{
+			boost::any message;
+			Plist::readPlist(&plist[0], plist.size(), message);
+			readRecords(message, anyRecords);
+		}
+		double anyReadMs = millisecondsSince(start);
+
+		vector<Record> records;
+		start = bench_clock::now();
+		Plist::readPlist(&plist[0], plist.size(), records);
+		double fieldsReadMs = millisecondsSince(start);
+
+		vector<char> written;
+		start = bench_clock::now();
+		{
+			vector<boost::any> array(anyRecords.size());
+			for(size_t i = 0; i < anyRecords.size(); ++i)
+			{
+				map<string, boost::any> record;
+				record["enabled"] = anyRecords[i].enabled;
+				record["id"] = anyRecords[i].id;
+				record["name"] = anyRecords[i].name;
+				record["score"] = anyRecords[i].score;
+				record["tags"] = anyRecords[i].tags;
+				array[i] = record;
+			}
+			Plist::writePlistBinary(written, array);
+		}
+		double anyWriteMs = millisecondsSince(start);
+
+		vector<char> fieldsWritten;
+		start = bench_clock::now();
+		Plist::writePlistBinary(fieldsWritten, records);
+		double fieldsWriteMs = millisecondsSince(start);
+
+		if(written != plist || fieldsWritten != plist)
+			cout<<"write mismatch"<<endl;
+
+		cout<<setw(10)<<count<<fixed<<setprecision(2)<<setw(14)<<anyReadMs<<setw(14)<<fieldsReadMs
+			<<setw(14)<<anyWriteMs<<setw(14)<<fieldsWriteMs<<endl;
+	}
+	cout<<endl;
+}
+
+// changing one value in a file, by reading and rewriting all of it and with
+// BinaryPlistUpdater
+
+static void benchUpdater()
+{
+	const char* filename = "updaterBenchmark.plist";
+
+	cout<<"one value changed in a file, dictionary of records, binary"<<endl;
+	cout<<setw(10)<<"records"<<setw(14)<<"bytes"<<setw(14)<<"rewrite"<<setw(14)<<"updater"<<"  (ms)"<<endl;
+
+	for(int count = 4000; count <= 256000; count *= 4)
+	{
+		vector<boost::any> records;
+		createRecords(records, count);
+
+		map<string, boost::any> table;
+		for(int i = 0; i < count; ++i)
+		{
+			stringstream key;
+			key<<"row"<<i;
+			table[key.str()].swap(records[i]);
+		}
+		Plist::writePlistBinary(filename, table);
+
+		// read once untimed, so neither is timed reading a file just written
+		Plist::readPlist(filename, table);
+
+		bench_clock::time_point start = bench_clock::now();
+		{
+			map<string, boost::any> message;
+			Plist::readPlist(filename, message);
+			boost::any_cast<map<string, boost::any>&>(message["row7"])["name"] = string("renamed");
+			Plist::writePlistBinary(filename, message);
+		}
+		double rewriteMs = millisecondsSince(start);
+
+		Plist::readPlist(filename, table);
+		table.clear();
+
+		start = bench_clock::now();
+		{
+			Plist::BinaryPlistUpdater updater(filename);
+			updater.set("row7/name", string("renamed again"));
+			updater.commit();
+		}
+		double updaterMs = millisecondsSince(start);
+
+		ifstream stream(filename, ios::binary | ios::ate);
+		cout<<setw(10)<<count<<setw(14)<<stream.tellg()<<fixed<<setprecision(2)
+			<<setw(14)<<rewriteMs<<setw(14)<<updaterMs<<endl;
+	}
+	remove(filename);
+	cout<<endl;
+}
+
+#if defined(PLIST_HAS_PMR)
+// One request: read a small binary plist into a Document, look a field up
+// in every record and write a response.  With resource 0 everything comes
+// from new.
+
+static size_t serveRequest(const vector<char>& request, const boost::any& response, Plist::memory_resource* resource)
+{
+	Plist::Document document;
+	if(resource)
+		Plist::readPlist(&request[0], request.size(), document, resource);
+	else
+		Plist::readPlist(&request[0], request.size(), document);
+
+	Plist::Document::Node root = document.root();
+	size_t found = 0;
+	for(int32_t i = 0; i < root.count(); ++i)
+		found += (size_t) root[i]["id"].asInteger();
+
+	if(resource)
+	{
+		Plist::pmr::data_type output(resource);
+		Plist::writePlistBinary(output, response);
+		return found + output.size();
+	}
+
+	vector<char> output;
+	Plist::writePlistBinary(output, response);
+	return found + output.size();
+}
+
+enum AllocatorMode
+{
+	NewDeleteMode,
+	MonotonicMode,
+	PoolMode
+};
+
+static void serveRequests(const vector<char>& request, const boost::any& response, AllocatorMode mode, int requestCount, size_t& result)
+{
+	static const size_t bufferSize = 1 << 20;
+	vector<char> buffer(mode == MonotonicMode ? bufferSize : 0);
+	std::pmr::unsynchronized_pool_resource pool;
+
+	size_t total = 0;
+	for(int i = 0; i < requestCount; ++i)
+	{
+		if(mode == MonotonicMode)
+		{
+			// released all at once when the request is done
+			std::pmr::monotonic_buffer_resource requestResource(&buffer[0], buffer.size());
+			total += serveRequest(request, response, &requestResource);
+		}
+		else
+			total += serveRequest(request, response, mode == PoolMode ? &pool : 0);
+	}
+	result = total;
+}
+
+// requests served per second on several threads at once, each thread
+// with its own resource so none of them take a lock
+
+static void benchAllocators()
+{
+	cout<<"requests of 64 records read into a Document and a response written, binary"<<endl;
+	cout<<setw(10)<<"threads"<<setw(16)<<"new/delete"<<setw(16)<<"monotonic"<<setw(16)<<"pool"<<"  (requests/s)"<<endl;
+
+	vector<boost::any> records;
+	createRecords(records, 64);
+	vector<char> request;
+	Plist::writePlistBinary(request, records);
+	boost::any response = records;
+
+	const int requestCount = 4000;
+	int maxThreads = std::max(1, (int) std::thread::hardware_concurrency());
+	for(int threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+	{
+		cout<<setw(10)<<threadCount;
+		for(int mode = NewDeleteMode; mode <= PoolMode; ++mode)
+		{
+			vector<thread> threads;
+			vector<size_t> results(threadCount);
+			bench_clock::time_point start = bench_clock::now();
+			for(int t = 0; t < threadCount; ++t)
+				threads.push_back(thread(serveRequests, cref(request), cref(response), (AllocatorMode) mode, requestCount, ref(results[t])));
+			for(int t = 0; t < threadCount; ++t)
+				threads[t].join();
+			double ms = millisecondsSince(start);
+
+			cout<<setw(16)<<fixed<<setprecision(0)<<(threadCount * requestCount * 1000.0 / ms);
+		}
+		cout<<endl;
+	}
+	cout<<endl;
+}
+#endif
+
+struct Benchmark
+{
+	const char* name;
+	void (*run)();
+};
+
+static const Benchmark benchmarks[] =
+{
+	{ "writeBinary", benchWriteBinary },
+	{ "writeXML", benchWriteXML },
+	{ "dates", benchDates },
+	{ "base64", benchBase64 },
+	{ "unicode", benchUnicode },
+	{ "value", benchValue },
+	{ "document", benchDocument },
+	{ "shared", benchShared },
+	{ "validate", benchValidate },
+	{ "parallel", benchParallel },
+	{ "projection", benchProjection },
+	{ "probe", benchProbe },
+	{ "dictionaries", benchDictionaries },
+	{ "fields", benchFields },
+	{ "updater", benchUpdater },
+#if defined(PLIST_HAS_PMR)
+	{ "allocators", benchAllocators },
+#endif
+};
+
+int main(int argc, char** argv)
+{
+	int benchmarkCount = sizeof(benchmarks) / sizeof(benchmarks[0]);
+	for(int i = 0; i < benchmarkCount; ++i)
+	{
+		bool selected = (argc < 2);
+		for(int arg = 1; arg < argc; ++arg)
+			if(strcmp(argv[arg], benchmarks[i].name) == 0)
+				selected = true;
+
+		if(selected)
+			benchmarks[i].run();
+	}
+	return 0;
+}
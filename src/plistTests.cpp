@@ -1,11 +1,123 @@
 #include "Plist.hpp"
+#include "PlistBase64.hpp"
+#include "PlistBinaryView.hpp"
+#include "PlistDictionary.hpp"
+#include "PlistDocument.hpp"
+#include "PlistFeedParser.hpp"
+#include "PlistFields.hpp"
+#include "PlistHelpers.hpp"
+#include "PlistProjection.hpp"
+#include "PlistUnicode.hpp"
+#include "PlistUpdater.hpp"
+#include "PlistValue.hpp"
+#include "PlistXMLReader.hpp"
 #include <UnitTest++/UnitTest++.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <iterator>
+#include <limits>
+#include <new>
+#include <sstream>
+#if __cplusplus >= 201103L
+#include <thread>
+#endif
 
 using namespace std;
 
+// heap allocations made while countAllocations is set, for checking the
+// readers don't copy what they build.  Kept out of line, gcc flags malloc
+// and free inlined into code pairing new with delete.
+
+static bool countAllocations = false;
+static size_t allocationCount = 0;
+
+#if defined(__GNUC__)
+#define PLIST_TEST_NOINLINE __attribute__((noinline))
+#else
+#define PLIST_TEST_NOINLINE
+#endif
+
+#if __cplusplus >= 201103L
+PLIST_TEST_NOINLINE void* operator new(size_t size)
+#else
+PLIST_TEST_NOINLINE void* operator new(size_t size) throw(std::bad_alloc)
+#endif
+{
+	if(countAllocations)
+		++allocationCount;
+	void* memory = malloc(size ? size : 1);
+	if(!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+PLIST_TEST_NOINLINE void* operator new(size_t size, const std::nothrow_t&) throw()
+{
+	if(countAllocations)
+		++allocationCount;
+	return malloc(size ? size : 1);
+}
+
+PLIST_TEST_NOINLINE void operator delete(void* memory) throw()
+{
+	free(memory);
+}
+
+#if defined(__cpp_sized_deallocation)
+PLIST_TEST_NOINLINE void operator delete(void* memory, size_t) throw()
+{
+	free(memory);
+}
+#endif
+
+static void startCountingAllocations()
+{
+	allocationCount = 0;
+	countAllocations = true;
+}
+
+static size_t stopCountingAllocations()
+{
+	countAllocations = false;
+	return allocationCount;
+}
+
+// allocations a copy of value can skip but reading it can't: building each
+// key and string (a copy may share them) and a ref list per container
+
+static size_t stringAllocations(const string& text)
+{
+	startCountingAllocations();
+	string built(text.data(), text.size());
+	return stopCountingAllocations();
+}
+
+static size_t readOnlyAllocations(const boost::any& value)
+{
+	if(value.type() == typeid(string))
+		return stringAllocations(boost::any_cast<const string&>(value));
+
+	size_t count = 1;
+	if(value.type() == typeid(map<string, boost::any>))
+	{
+		const map<string, boost::any>& dict = boost::any_cast<const map<string, boost::any>&>(value);
+		for(map<string, boost::any>::const_iterator it = dict.begin(); it != dict.end(); ++it)
+			count += stringAllocations(it->first) + readOnlyAllocations(it->second);
+	}
+	else if(value.type() == typeid(vector<boost::any>))
+	{
+		const vector<boost::any>& array = boost::any_cast<const vector<boost::any>&>(value);
+		for(size_t i = 0; i < array.size(); ++i)
+			count += readOnlyAllocations(array[i]);
+	}
+	else
+		count = 0;
+	return count;
+}
+
 static void createMessage(map<string, boost::any>& dict)
 {
 		Plist::Date date;
@@ -264,6 +376,158 @@ static void checkDictionary(const map<string, boost::any>& dict)
 
 }
 
+// reads both examples into Dictionary and checks they write back unchanged
+
+template<typename Dictionary>
+static void checkPolicyDictionary()
+{
+		const char* files[] = { "XMLExample1.plist", "binaryExample1.plist" };
+		for(int f = 0; f < 2; ++f)
+		{
+			Dictionary dict;
+			Plist::readPlist(files[f], dict);
+			CHECK_EQUAL(string("hello there"), boost::any_cast<const string&>(dict["testString"]));
+			CHECK_EQUAL(1u, dict.count("testDictLarge"));
+			CHECK(dict.find("missing") == dict.end());
+
+			const Dictionary& large = boost::any_cast<const Dictionary&>(dict["testDictLarge"]);
+			CHECK_EQUAL(256u, large.size());
+			for(int i = 0; i < 256; ++i)
+			{
+				char key[4] = { (char) ('0' + i / 100), (char) ('0' + i / 10 % 10), (char) ('0' + i % 10), 0 };
+				CHECK_EQUAL(i, boost::any_cast<const int64_t&>(large.find(key)->second));
+			}
+
+			vector<char> binary, xml;
+			Plist::writePlistBinary(binary, dict);
+			Plist::writePlistXML(xml, dict);
+			CHECK_EQUAL((int64_t) binary.size(), Plist::serializedSize(dict, Plist::BinaryFormat));
+
+			// Value takes the policy's tree like the default one
+			Plist::Value value = Plist::Value::fromAny(dict);
+			CHECK_EQUAL(string("hello there"), value["testString"].asString());
+			checkDictionary(boost::any_cast<const map<string, boost::any>&>(value.toAny()));
+
+			map<string, boost::any> reread;
+			Plist::readPlist(&binary[0], binary.size(), reread);
+			checkDictionary(reread);
+			Plist::readPlist(&xml[0], xml.size(), reread);
+			checkDictionary(reread);
+		}
+}
+
+// structs read and written through PLIST_FIELDS
+
+struct TestTrack
+{
+	string name;
+	int64_t count;
+	double score;
+	bool enabled;
+	vector<string> tags;
+	Plist::data_type data;
+	Plist::Date date;
+};
+PLIST_FIELDS(TestTrack, name, count, score, enabled, tags, data, date)
+
+struct TestNarrow
+{
+	short small;
+	unsigned int count;
+};
+PLIST_FIELDS(TestNarrow, small, count)
+
+struct TestLibrary
+{
+	string title;
+	vector<TestTrack> tracks;
+	map<string, TestTrack> byName;
+	boost::any extra;
+	int32_t version;
+};
+PLIST_FIELDS(TestLibrary, title, tracks, byName, extra, version)
+
+// some of the entries of the example plists
+struct TestExample
+{
+	string testString;
+	int testInt;
+	float testFloat;
+	bool testBoolTrue;
+	Plist::Date testDate;
+	Plist::data_type testImage;
+	vector<boost::any> testArray;
+	map<string, string> testDict;
+	map<string, int64_t> testDictLarge;
+};
+PLIST_FIELDS(TestExample, testString, testInt, testFloat, testBoolTrue, testDate, testImage, testArray, testDict, testDictLarge)
+
+static void createTrack(TestTrack& track, Plist::OrderedDictionary<boost::any>& dict, int i)
+{
+		stringstream ss;
+		ss<<"track "<<i;
+		track.name = ss.str();
+		track.count = i * 1000003;
+		track.score = i / 3.0;
+		track.enabled = (i % 2) == 0;
+		track.tags.assign(i % 3, string("tag"));
+		track.data.assign(i * 7, (char) i);
+		track.date.setTimeFromAppleEpoch(338610664 + i);
+
+		vector<boost::any> tags(track.tags.begin(), track.tags.end());
+		dict["name"] = track.name;
+		dict["count"] = track.count;
+		dict["score"] = track.score;
+		dict["enabled"] = track.enabled;
+		dict["tags"] = tags;
+		dict["data"] = track.data;
+		dict["date"] = track.date;
+}
+
+static void checkTrack(const TestTrack& expected, const TestTrack& track)
+{
+		CHECK_EQUAL(expected.name, track.name);
+		CHECK_EQUAL(expected.count, track.count);
+		// xml reals keep six significant digits
+		CHECK_CLOSE(expected.score, track.score, 1E-4);
+		CHECK_EQUAL(expected.enabled, track.enabled);
+		CHECK(expected.tags == track.tags);
+		CHECK(expected.data == track.data);
+		CHECK(expected.date == track.date);
+}
+
+// A binary plist of levels arrays, each holding the next one twice, the
+// last holding the string "x" twice.  Decoded as a tree it has 2^levels
+// strings.  With cycle set the last array holds the first instead.
+
+static vector<char> createSharedPlist(int levels, bool cycle)
+{
+		const char header[] = "bplist00";
+		vector<char> plist(header, header + 8);
+		for(int i = 0; i < levels; ++i)
+		{
+			char next = (char) ((cycle && (i + 1 == levels)) ? 0 : i + 1);
+			plist.push_back((char) 0xA2);
+			plist.push_back(next);
+			plist.push_back(next);
+		}
+		plist.push_back((char) 0x51);
+		plist.push_back('x');
+
+		// offsets and refs are one byte
+		int tableOffset = (int) plist.size();
+		for(int i = 0; i <= levels; ++i)
+			plist.push_back((char) (8 + 3 * i));
+
+		const char trailer[] = { 0, 0, 0, 0, 0, 0, 1, 1 };
+		plist.insert(plist.end(), trailer, trailer + 8);
+		plist.insert(plist.end(), 7, 0);
+		plist.push_back((char) (levels + 1));
+		plist.insert(plist.end(), 15, 0);
+		plist.push_back((char) tableOffset);
+		return plist;
+}
+
 SUITE(PLIST_TESTS)
 {
 
@@ -401,6 +665,1424 @@ SUITE(PLIST_TESTS)
 		CHECK_EQUAL(100, seconds);
 	}
 
+	TEST(DATE_XML_CONVENTION)
+	{
+		Plist::Date date(Plist::Date::uninitialized);
+
+		date.setTimeFromXMLConvention("2011-09-25T02:31:04Z");
+		CHECK_EQUAL(1316917864, (int64_t) date.timeAsEpoch());
+		CHECK_EQUAL(string("2011-09-25T02:31:04Z"), date.timeAsXMLConvention());
+
+		// leap days, century years and times before the unix epoch
+		const char* dates[] =
+		{
+			"1970-01-01T00:00:00Z",
+			"1969-12-31T23:59:59Z",
+			"1900-03-01T12:00:00Z",
+			"2000-02-29T23:59:59Z",
+			"2001-01-01T00:00:00Z",
+			"2100-02-28T00:00:01Z",
+			"2400-02-29T06:07:08Z",
+		};
+		for(size_t i = 0; i < sizeof(dates) / sizeof(dates[0]); ++i)
+		{
+			date.setTimeFromXMLConvention(dates[i]);
+			CHECK_EQUAL(string(dates[i]), date.timeAsXMLConvention());
+		}
+
+		date.setTimeFromXMLConvention("2001-01-01T00:00:00Z");
+		CHECK_EQUAL(0, date.timeAsAppleEpoch());
+
+		// out of range fields roll over like mktime
+		Plist::Date rolled(13, 32, 2011, 24, 0, 0, true);
+		CHECK_EQUAL(string("2012-02-02T00:00:00Z"), rolled.timeAsXMLConvention());
+	}
+
+	TEST(READ_FILE_TO_ANY)
+	{
+		// reading by file name maps the file rather than copying it
+		boost::any message;
+		Plist::readPlist("binaryExample1.plist", message);
+		checkDictionary(boost::any_cast<const map<string, boost::any>&>(message));
+
+		Plist::readPlist("XMLExample1.plist", message);
+		checkDictionary(boost::any_cast<const map<string, boost::any>&>(message));
+
+		std::ofstream("emptyWritten.plist").close();
+		CHECK_THROW(Plist::readPlist("emptyWritten.plist", message), Plist::Error);
+		CHECK_THROW(Plist::readPlist("noSuchFile.plist", message), Plist::Error);
+	}
+
+	TEST(READ_BINARY_OUT_OF_BOUNDS)
+	{
+		// the binary reader decodes in place from the caller's buffer, so a
+		// damaged plist must be rejected rather than read past the end.
+
+		vector<char> data;
+		map<string, boost::any> dict;
+		createMessage(dict);
+		Plist::writePlistBinary(data, dict);
+
+		map<string, boost::any> dictCheck;
+		CHECK_THROW(Plist::readPlist(&data[0], 20, dictCheck), Plist::Error);
+
+		vector<char> corrupt(data);
+		corrupt[corrupt.size() - 2] = (char) 0xff;
+		CHECK_THROW(Plist::readPlist(&corrupt[0], corrupt.size(), dictCheck), Plist::Error);
+
+		corrupt = data;
+		corrupt[corrupt.size() - 32 + 7] = 9;
+		CHECK_THROW(Plist::readPlist(&corrupt[0], corrupt.size(), dictCheck), Plist::Error);
+	}
+
+	TEST(READ_BINARY_FLOAT)
+	{
+		// single precision reals (0x22) as written by CoreFoundation
+		const unsigned char plist[] = {
+			'b', 'p', 'l', 'i', 's', 't', '0', '0',
+			0x22, 0xbf, 0xc0, 0x00, 0x00,
+			0x08,
+			0, 0, 0, 0, 0, 0, 1, 1,
+			0, 0, 0, 0, 0, 0, 0, 1,
+			0, 0, 0, 0, 0, 0, 0, 0,
+			0, 0, 0, 0, 0, 0, 0, 13 };
+
+		double value;
+		Plist::readPlist((const char*) plist, sizeof(plist), value);
+		CHECK_EQUAL(-1.5, value);
+	}
+
+	TEST(WRITE_BINARY_UNIQUED)
+	{
+		// repeated keys and scalar values are written once and shared
+		vector<boost::any> records(1000);
+		for(int i = 0; i < 1000; ++i)
+		{
+			map<string, boost::any> record;
+			record["name"] = string("same");
+			record["id"] = int64_t(i % 10);
+			record["enabled"] = true;
+			records[i] = record;
+		}
+
+		vector<char> data;
+		Plist::writePlistBinary(data, records);
+
+		// 1 array + 1000 dictionaries + 3 keys + 1 string + 10 integers + 1 bool
+		const unsigned char* trailer = (const unsigned char*) &data[data.size() - 32];
+		int64_t objectCount = 0;
+		for(int n = 8; n < 16; ++n)
+			objectCount = (objectCount << 8) | trailer[n];
+		CHECK_EQUAL(1016, objectCount);
+
+		vector<boost::any> recordsCheck;
+		Plist::readPlist(&data[0], data.size(), recordsCheck);
+		CHECK_EQUAL(1000u, recordsCheck.size());
+		for(int i = 0; i < 1000; ++i)
+		{
+			const map<string, boost::any>& record = boost::any_cast<const map<string, boost::any>&>(recordsCheck[i]);
+			CHECK_EQUAL(string("same"), boost::any_cast<const string&>(record.find("name")->second));
+			CHECK_EQUAL(i % 10, boost::any_cast<const int64_t&>(record.find("id")->second));
+			CHECK_EQUAL(true, boost::any_cast<const bool&>(record.find("enabled")->second));
+		}
+	}
+
+	TEST(BINARY_VIEW)
+	{
+		vector<char> data;
+		map<string, boost::any> dict;
+		createMessage(dict);
+		Plist::writePlistBinary(data, dict);
+
+		Plist::BinaryPlistView root(&data[0], data.size());
+		CHECK_EQUAL(Plist::BinaryPlistView::DictionaryType, root.type());
+		CHECK_EQUAL((int32_t) dict.size(), root.count());
+		CHECK_EQUAL(string("testArray"), root.keyAt(0));
+
+		CHECK_EQUAL(string("hello there"), root["testString"].asString());
+		CHECK_EQUAL(-3455, root["testInt"].asInteger());
+		CHECK_CLOSE(1.34223, root["testDouble"].asReal(), 1E-5);
+		CHECK_EQUAL(true, root["testBoolTrue"].asBoolean());
+		CHECK_EQUAL(338610664, (int) root["testDate"].asDate().timeAsAppleEpoch());
+		CHECK_EQUAL(boost::any_cast<const vector<char>&>(dict["testImage"]).size(), root["testImage"].asData().size());
+
+		Plist::BinaryPlistView arrayLarge = root["testArrayLarge"];
+		CHECK_EQUAL(Plist::BinaryPlistView::ArrayType, arrayLarge.type());
+		CHECK_EQUAL(256, arrayLarge.count());
+		CHECK_EQUAL(200, arrayLarge[200].asInteger());
+		CHECK_THROW(arrayLarge[256], Plist::Error);
+
+		Plist::BinaryPlistView dictLarge = root["testDictLarge"];
+		CHECK_EQUAL(123, dictLarge["123"].asInteger());
+		CHECK_EQUAL(0, dictLarge["000"].asInteger());
+		CHECK_EQUAL(255, dictLarge["255"].asInteger());
+
+		Plist::BinaryPlistView missing(root);
+		CHECK(!root.find("noSuchKey", missing));
+		CHECK_THROW(root["noSuchKey"], Plist::Error);
+
+		// misses on a sorted dictionary, before, between and after its
+		// keys, stop at the binary search; hits still work after them
+		CHECK(!dictLarge.find("", missing));
+		CHECK(!dictLarge.find("1234", missing));
+		CHECK(!dictLarge.find("999", missing));
+		CHECK(dictLarge.find("128", missing));
+		CHECK_EQUAL(128, missing.asInteger());
+
+		// {"b" = 1, "a" = 2} with its keys out of order, as other writers
+		// may leave them
+		const unsigned char unsorted[] = {
+			'b', 'p', 'l', 'i', 's', 't', '0', '0',
+			0xD2, 0x01, 0x02, 0x03, 0x04,
+			0x51, 'b', 0x51, 'a',
+			0x10, 0x01, 0x10, 0x02,
+			0x08, 0x0D, 0x0F, 0x11, 0x13,
+			0, 0, 0, 0, 0, 0, 1, 1,
+			0, 0, 0, 0, 0, 0, 0, 5,
+			0, 0, 0, 0, 0, 0, 0, 0,
+			0, 0, 0, 0, 0, 0, 0, 21 };
+		Plist::BinaryPlistView unsortedRoot((const char*) unsorted, sizeof(unsorted));
+		CHECK(!unsortedRoot.find("c", missing));
+		CHECK(unsortedRoot.find("a", missing));
+		CHECK_EQUAL(2, missing.asInteger());
+		CHECK_EQUAL(1, unsortedRoot["b"].asInteger());
+
+#if __cplusplus >= 201103L
+		// threads sharing a const view can all miss on it at once
+		const Plist::BinaryPlistView sharedLarge = root["testDictLarge"];
+		bool found[4] = { false, false, false, false };
+		vector<std::thread> threads;
+		for(int t = 0; t < 4; ++t)
+			threads.push_back(std::thread([&sharedLarge, &found, t]()
+			{
+				Plist::BinaryPlistView value(sharedLarge);
+				for(int i = 0; i < 100; ++i)
+					if(sharedLarge.find("noSuchKey", value))
+						found[t] = true;
+			}));
+		for(size_t t = 0; t < threads.size(); ++t)
+			threads[t].join();
+		for(int t = 0; t < 4; ++t)
+			CHECK(!found[t]);
+#endif
+		CHECK_THROW(root["testString"].count(), Plist::Error);
+
+		map<string, boost::any> inner = boost::any_cast<map<string, boost::any> >(root["testDict"].decode());
+		CHECK_EQUAL(string("inner dict item"), boost::any_cast<const string&>(inner["test string"]));
+	}
+
+	TEST(SERIALIZED_SIZE)
+	{
+		map<string, boost::any> dict;
+		createMessage(dict);
+
+		// escaped and control characters, empty values, long counts
+		dict["testEscapes"] = string("a<b>&c\x01\td\0e", 11);
+		dict["a&key"] = string();
+		dict["testEmptyArray"] = vector<boost::any>();
+		dict["testEmptyDict"] = map<string, boost::any>();
+		dict["testLongString"] = string(300, 'x');
+		dict["testLargeInt"] = int64_t(1) << 40;
+		dict["testFloat"] = 0.5f;
+
+		vector<boost::any> messages;
+		messages.push_back(dict);
+		messages.push_back(string("scalar root"));
+		messages.push_back(vector<char>(1000, 'z'));
+		messages.push_back(vector<boost::any>(20, int32_t(-1)));
+
+		for(size_t i = 0; i < messages.size(); ++i)
+		{
+			vector<char> data;
+			Plist::writePlistBinary(data, messages[i]);
+			CHECK_EQUAL((int64_t) data.size(), Plist::serializedSize(messages[i], Plist::BinaryFormat));
+
+			Plist::writePlistXML(data, messages[i]);
+			CHECK_EQUAL((int64_t) data.size(), Plist::serializedSize(messages[i], Plist::XMLFormat));
+		}
+	}
+
+	TEST(WRITE_XML_MATCHES_DOCUMENT)
+	{
+		// the direct xml writer must write what pugixml wrote
+		map<string, boost::any> dict;
+		createMessage(dict);
+		dict["testEscapes"] = string("a<b>&c\x01\td\r\n\x1f\0e", 15);
+		dict["a&key<>"] = string();
+		dict["testEmptyArray"] = vector<boost::any>();
+		dict["testEmptyDict"] = map<string, boost::any>();
+		dict["testMinInt"] = std::numeric_limits<int64_t>::min();
+		dict["testShort"] = short(-3455);
+		dict["testFloat"] = 0.1f;
+		dict["testLongData"] = vector<char>(1000, 'z');
+
+		boost::any nested = string("deep");
+		for(int i = 0; i < 40; ++i)
+			nested = vector<boost::any>(1, nested);
+		dict["testNested"] = nested;
+
+		vector<boost::any> messages;
+		messages.push_back(dict);
+		messages.push_back(string("scalar root"));
+		messages.push_back(false);
+		messages.push_back(vector<boost::any>());
+
+		for(size_t i = 0; i < messages.size(); ++i)
+		{
+			std::stringstream document;
+			Plist::writePlistXMLDocument(document, messages[i]);
+
+			std::stringstream direct;
+			Plist::writePlistXML(direct, messages[i]);
+			CHECK(document.str() == direct.str());
+
+			vector<char> data;
+			Plist::writePlistXML(data, messages[i]);
+			CHECK(document.str() == string(data.begin(), data.end()));
+		}
+	}
+
+	TEST(BASE64)
+	{
+		const char* text = "TWFu\n TWE= ignored";
+		vector<unsigned char> decoded(Plist::base64DecodeCapacity(strlen(text)));
+		CHECK_EQUAL(5u, Plist::base64Decode(&decoded[0], text, strlen(text), Plist::Base64Scalar));
+		CHECK(memcmp(&decoded[0], "ManMa", 5) == 0);
+
+		// every codec the cpu has must agree with the scalar one, across
+		// line breaks and tails of every length
+		for(int codec = Plist::Base64Scalar; codec <= Plist::base64BestCodec(); ++codec)
+		{
+			for(size_t size = 0; size < 400; size += 7)
+			{
+				vector<unsigned char> data(size);
+				for(size_t i = 0; i < size; ++i)
+					data[i] = (unsigned char) (i * 37 + size);
+
+				string encoded(Plist::base64EncodedSize(size), ' ');
+				string expected(encoded);
+				if(size > 0)
+				{
+					Plist::base64Encode(&encoded[0], &data[0], size, (Plist::Base64Codec) codec);
+					Plist::base64Encode(&expected[0], &data[0], size, Plist::Base64Scalar);
+				}
+				CHECK(encoded == expected);
+				if(size >= 54)
+					CHECK_EQUAL('\n', encoded[72 + (encoded[72] == '\r')]);
+
+				decoded.resize(Plist::base64DecodeCapacity(encoded.size()));
+				size_t decodedSize = Plist::base64Decode(&decoded[0], encoded.data(), encoded.size(), (Plist::Base64Codec) codec);
+				CHECK_EQUAL(size, decodedSize);
+				CHECK(equal(data.begin(), data.end(), decoded.begin()));
+			}
+		}
+	}
+
+	TEST(UNICODE_STRINGS)
+	{
+		// every codec the cpu has must match a plain encoder on ASCII, two
+		// and three byte characters and pairs, uniform and mixed, with
+		// pairs straddling the 8 and 16 unit vectors
+		for(int codec = Plist::UnicodeScalar; codec <= Plist::unicodeBestCodec(); ++codec)
+		{
+			for(int pattern = 0; pattern < 6; ++pattern)
+			{
+				for(size_t length = 0; length < 70; ++length)
+				{
+					vector<unsigned char> units;
+					string expected;
+					for(size_t i = 0; units.size() < 2 * length; ++i)
+					{
+						uint32_t codePoint = 'a' + i % 26;
+						if(pattern == 1 || (pattern == 3 && i % 4 == 1) || (pattern == 5 && i % 16 != 15))
+							codePoint = 0x4E00 + (uint32_t) i;
+						else if(pattern == 2 || (pattern == 3 && i % 4 == 2))
+							codePoint = 0xE9;
+						else if((pattern == 3 && i % 4 == 3) || (pattern == 4 && i % 8 == 7) || pattern == 5)
+							codePoint = 0x1F600 + (uint32_t) i;
+
+						if(codePoint < 0x80)
+							expected += (char) codePoint;
+						else if(codePoint < 0x800)
+						{
+							expected += (char) (0xC0 | (codePoint >> 6));
+							expected += (char) (0x80 | (codePoint & 0x3F));
+						}
+						else if(codePoint < 0x10000)
+						{
+							expected += (char) (0xE0 | (codePoint >> 12));
+							expected += (char) (0x80 | ((codePoint >> 6) & 0x3F));
+							expected += (char) (0x80 | (codePoint & 0x3F));
+						}
+						else
+						{
+							expected += (char) (0xF0 | (codePoint >> 18));
+							expected += (char) (0x80 | ((codePoint >> 12) & 0x3F));
+							expected += (char) (0x80 | ((codePoint >> 6) & 0x3F));
+							expected += (char) (0x80 | (codePoint & 0x3F));
+						}
+
+						if(codePoint < 0x10000)
+						{
+							units.push_back((unsigned char) (codePoint >> 8));
+							units.push_back((unsigned char) codePoint);
+						}
+						else
+						{
+							uint32_t high = 0xD800 + ((codePoint - 0x10000) >> 10);
+							uint32_t low = 0xDC00 + ((codePoint - 0x10000) & 0x3FF);
+							units.push_back((unsigned char) (high >> 8));
+							units.push_back((unsigned char) high);
+							units.push_back((unsigned char) (low >> 8));
+							units.push_back((unsigned char) low);
+						}
+					}
+
+					size_t count = units.size() / 2;
+					string output(Plist::utf16ToUTF8Capacity(count) + 1, ' ');
+					size_t size = 0;
+					CHECK(Plist::utf16ToUTF8(&output[0], units.empty() ? 0 : &units[0], count, size, (Plist::UnicodeCodec) codec));
+					CHECK(output.substr(0, size) == expected);
+
+					// a lone high surrogate, a lone low one and a high one
+					// followed by something else all fail
+					if(count >= 18)
+					{
+						vector<unsigned char> broken(units);
+						broken[2 * 17] = 0xD8;
+						broken[2 * 17 + 1] = 0x3D;
+						broken.resize(2 * 18);
+						CHECK(!Plist::utf16ToUTF8(&output[0], &broken[0], 18, size, (Plist::UnicodeCodec) codec));
+						broken[2 * 16] = 0x00;
+						broken[2 * 16 + 1] = 'a';
+						broken[2 * 17] = 0xDE;
+						CHECK(!Plist::utf16ToUTF8(&output[0], &broken[0], 18, size, (Plist::UnicodeCodec) codec));
+						broken[2 * 16] = 0xD8;
+						broken[2 * 16 + 1] = 0x00;
+						broken[2 * 17] = 0x00;
+						broken[2 * 17 + 1] = 'a';
+						CHECK(!Plist::utf16ToUTF8(&output[0], &broken[0], 18, size, (Plist::UnicodeCodec) codec));
+					}
+				}
+			}
+		}
+
+		// "caf\u00E9 \U0001F600" read from a binary plist, and a lone surrogate
+		// rejected
+		const unsigned char emoji[] = {
+			'b', 'p', 'l', 'i', 's', 't', '0', '0',
+			0x67, 0x00, 'c', 0x00, 'a', 0x00, 'f', 0x00, 0xE9, 0x00, ' ', 0xD8, 0x3D, 0xDE, 0x00,
+			0x08,
+			0, 0, 0, 0, 0, 0, 1, 1,
+			0, 0, 0, 0, 0, 0, 0, 1,
+			0, 0, 0, 0, 0, 0, 0, 0,
+			0, 0, 0, 0, 0, 0, 0, 23 };
+		boost::any value;
+		Plist::readPlist((const char*) emoji, sizeof(emoji), value);
+		CHECK(boost::any_cast<const string&>(value) == "caf\xC3\xA9 \xF0\x9F\x98\x80");
+
+		const unsigned char loneSurrogate[] = {
+			'b', 'p', 'l', 'i', 's', 't', '0', '0',
+			0x61, 0xD8, 0x00,
+			0x08,
+			0, 0, 0, 0, 0, 0, 1, 1,
+			0, 0, 0, 0, 0, 0, 0, 1,
+			0, 0, 0, 0, 0, 0, 0, 0,
+			0, 0, 0, 0, 0, 0, 0, 11 };
+		CHECK_THROW(Plist::readPlist((const char*) loneSurrogate, sizeof(loneSurrogate), value), Plist::Error);
+	}
+
+	TEST(XML_READER)
+	{
+		std::ifstream stream("XMLExample1.plist", std::ios::binary);
+		Plist::XMLPlistReader reader(stream);
+		CHECK_EQUAL(Plist::XMLPlistReader::BeginDictionary, reader.next());
+		CHECK_EQUAL(1, reader.depth());
+		CHECK_EQUAL(Plist::XMLPlistReader::Key, reader.next());
+		CHECK_EQUAL(string("testArray"), reader.key());
+		CHECK_EQUAL(Plist::XMLPlistReader::BeginArray, reader.next());
+		CHECK_EQUAL(Plist::XMLPlistReader::Value, reader.next());
+		CHECK_EQUAL(34, boost::any_cast<int64_t>(reader.value()));
+
+		// whole document through readValue matches readPlist
+		stream.clear();
+		stream.seekg(0);
+		Plist::XMLPlistReader documentReader(stream);
+		documentReader.next();
+		map<string, boost::any> dict = boost::any_cast<map<string, boost::any> >(documentReader.readValue());
+		checkDictionary(dict);
+		CHECK_EQUAL(Plist::XMLPlistReader::EndDocument, documentReader.next());
+
+		const char* xml =
+			"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+			"<plist version=\"1.0\">\n"
+			"<array>\n"
+			"\t<string>a &lt;b&gt; &amp; &#233;<!-- note --><![CDATA[<c>]]></string>\n"
+			"\t<dict/>\n"
+			"\t<true/>\n"
+			"\t<array><integer>-7</integer></array>\n"
+			"</array>\n"
+			"</plist>\n";
+
+		Plist::XMLPlistReader arrayReader(xml, strlen(xml));
+		Plist::XMLPlistArrayIterator it(arrayReader);
+		vector<boost::any> elements;
+		boost::any element;
+		while(it.next(element))
+			elements.push_back(element);
+
+		CHECK_EQUAL(4u, elements.size());
+		CHECK_EQUAL(string("a <b> & \xC3\xA9<c>"), boost::any_cast<const string&>(elements[0]));
+		const map<string, boost::any>& emptyDict = boost::any_cast<const map<string, boost::any>&>(elements[1]);
+		CHECK(emptyDict.empty());
+		CHECK_EQUAL(true, boost::any_cast<bool>(elements[2]));
+		CHECK_EQUAL(-7, boost::any_cast<int64_t>(boost::any_cast<const vector<boost::any>&>(elements[3])[0]));
+
+		// readPlist joins text and CDATA the way the reader does, dropping
+		// runs of only whitespace between them
+		const char* mixed =
+			"<plist version=\"1.0\"><dict>"
+			"<key>k<![CDATA[ey]]></key>"
+			"<string>a&amp;b<![CDATA[<c>]]> <!-- x --> d</string>"
+			"</dict></plist>";
+		boost::any read;
+		Plist::readPlist(mixed, strlen(mixed), read);
+		Plist::XMLPlistReader mixedReader(mixed, strlen(mixed));
+		mixedReader.next();
+		boost::any streamed = mixedReader.readValue();
+		const map<string, boost::any>& readDict = boost::any_cast<const map<string, boost::any>&>(read);
+		const map<string, boost::any>& streamedDict = boost::any_cast<const map<string, boost::any>&>(streamed);
+		CHECK(readDict.count("key") == 1);
+		CHECK(streamedDict.count("key") == 1);
+		CHECK_EQUAL(string("a&b<c> d"), boost::any_cast<const string&>(readDict.find("key")->second));
+		CHECK_EQUAL(string("a&b<c> d"), boost::any_cast<const string&>(streamedDict.find("key")->second));
+
+		const char* badXML = "<plist><dict><string>no key</string></dict></plist>";
+		Plist::XMLPlistReader badReader(badXML, strlen(badXML));
+		badReader.next();
+		CHECK_THROW(badReader.next(), Plist::Error);
+	}
+
+	TEST(FEED_PARSER)
+	{
+		const char* files[] = { "XMLExample1.plist", "binaryExample1.plist" };
+		for(int f = 0; f < 2; ++f)
+		{
+			std::ifstream stream(files[f], std::ios::binary);
+			vector<char> bytes((istreambuf_iterator<char>(stream)), istreambuf_iterator<char>());
+
+			// uneven chunks, so tokens and the binary header are split
+			Plist::PlistFeedParser parser;
+			size_t position = 0;
+			for(size_t chunk = 1; position < bytes.size(); chunk = chunk * 3 + 1)
+			{
+				size_t size = min(chunk % 5000, bytes.size() - position);
+				parser.feed(&bytes[position], size);
+				position += size;
+			}
+
+			map<string, boost::any> dict;
+			parser.finish(dict);
+			checkDictionary(dict);
+		}
+
+		Plist::PlistFeedParser truncated;
+		truncated.feed("<plist><dict><key>a</key>", 25);
+		boost::any message;
+		CHECK_THROW(truncated.finish(message), Plist::Error);
+	}
+
+	TEST(VALUE)
+	{
+		map<string, boost::any> dict;
+		createMessage(dict);
+
+		// writing a Value gives the same bytes as writing the boost::any tree
+		Plist::Value value = Plist::Value::fromAny(dict);
+		vector<char> anyBinary, valueBinary, anyXML, valueXML;
+		Plist::writePlistBinary(anyBinary, dict);
+		Plist::writePlistBinary(valueBinary, value);
+		CHECK(anyBinary == valueBinary);
+		Plist::writePlistXML(anyXML, dict);
+		Plist::writePlistXML(valueXML, value);
+		CHECK(anyXML == valueXML);
+		CHECK_EQUAL((int64_t) valueXML.size(), Plist::serializedSize(value, Plist::XMLFormat));
+
+		Plist::Value reread;
+		Plist::readPlist(&valueBinary[0], valueBinary.size(), reread);
+		CHECK(reread == value);
+
+		const char* files[] = { "XMLExample1.plist", "binaryExample1.plist" };
+		for(int f = 0; f < 2; ++f)
+		{
+			Plist::Value read;
+			Plist::readPlist(files[f], read);
+			CHECK_EQUAL(Plist::Value::DictionaryType, read.type());
+
+			boost::any message = read.toAny();
+			checkDictionary(boost::any_cast<const map<string, boost::any>&>(message));
+		}
+
+		Plist::Value small("short");
+		Plist::Value large(string(100, 'x'));
+		CHECK_EQUAL(string("short"), small.asString());
+		CHECK_EQUAL(100u, large.byteCount());
+		Plist::Value copy = large;
+		CHECK(copy == large);
+		copy.swap(small);
+		CHECK_EQUAL(string("short"), copy.asString());
+		CHECK(small == large);
+		CHECK_THROW(small.asInteger(), Plist::Error);
+
+		value["testDict"]["added"] = 3;
+		CHECK_EQUAL(3, value["testDict"]["added"].asInteger());
+
+		// a literal 0 indexes the array rather than being taken as a key
+		Plist::Value array(Plist::Value::ArrayType);
+		array.asArray().push_back(Plist::Value("first"));
+		CHECK_EQUAL(string("first"), array[0].asString());
+		const Plist::Value& constArray = array;
+		CHECK_EQUAL(string("first"), constArray[0].asString());
+		CHECK_THROW(array[1], Plist::Error);
+		CHECK_THROW(array[-1], Plist::Error);
+	}
+
+	TEST(DOCUMENT)
+	{
+		const char* files[] = { "XMLExample1.plist", "binaryExample1.plist" };
+		for(int f = 0; f < 2; ++f)
+		{
+			Plist::Document document;
+			Plist::readPlist(files[f], document);
+
+			boost::any message = document.root().decode();
+			checkDictionary(boost::any_cast<const map<string, boost::any>&>(message));
+
+			Plist::Document::Node root = document.root();
+			CHECK_EQUAL(Plist::Document::DictionaryType, root.type());
+			CHECK_EQUAL(string("hello there"), root["testString"].asString());
+			CHECK_EQUAL(34, root["testArray"][0].asInteger());
+			CHECK_EQUAL(-3455, root["testInt"].asInteger());
+			CHECK_EQUAL(255, root["testDictLarge"]["255"].asInteger());
+
+			Plist::Document::Node missing = root;
+			CHECK(!root.find("missing", missing));
+			CHECK_THROW(root["missing"], Plist::Error);
+			CHECK_THROW(root["testString"].asInteger(), Plist::Error);
+
+			for(int32_t i = 1; i < root.count(); ++i)
+				CHECK(root.keyAt(i - 1) < root.keyAt(i));
+
+			// a copy owns its own block
+			Plist::Document copy(document);
+			document = Plist::Document();
+			CHECK(document.empty());
+			CHECK_EQUAL(string("hello there"), copy.root()["testString"].asString());
+			CHECK(copy.memoryUsed() > 0);
+		}
+
+		// keys out of order are sorted, a repeated key keeps its last value
+		const char* xml =
+			"<plist><dict>"
+			"<key>b</key><integer>1</integer>"
+			"<key>a</key><string>first</string>"
+			"<key>b</key><integer>2</integer>"
+			"</dict></plist>";
+		Plist::Document unsorted(xml, strlen(xml));
+		CHECK_EQUAL(2, unsorted.root().count());
+		CHECK_EQUAL(string("a"), unsorted.root().keyAt(0));
+		CHECK_EQUAL(2, unsorted.root()["b"].asInteger());
+	}
+
+	TEST(DICTIONARY_POLICIES)
+	{
+		checkPolicyDictionary<Plist::HashDictionary<boost::any> >();
+		checkPolicyDictionary<Plist::OrderedDictionary<boost::any> >();
+		checkPolicyDictionary<Plist::FlatDictionary<boost::any> >();
+
+		// the ordered dictionary keeps file order, the flat one sorts, both
+		// keep the last value of a repeated key
+		const char* xml =
+			"<plist><dict>"
+			"<key>b</key><integer>1</integer>"
+			"<key>a</key><string>first</string>"
+			"<key>b</key><integer>2</integer>"
+			"</dict></plist>";
+		boost::any ordered, flat;
+		Plist::readPlist<Plist::OrderedDictionaryPolicy>(xml, strlen(xml), ordered);
+		Plist::readPlist<Plist::FlatDictionaryPolicy>(xml, strlen(xml), flat);
+		const Plist::OrderedDictionary<boost::any>& orderedDict = boost::any_cast<const Plist::OrderedDictionary<boost::any>&>(ordered);
+		const Plist::FlatDictionary<boost::any>& flatDict = boost::any_cast<const Plist::FlatDictionary<boost::any>&>(flat);
+		CHECK_EQUAL(2u, orderedDict.size());
+		CHECK_EQUAL(string("b"), orderedDict.begin()->first);
+		CHECK_EQUAL(2, boost::any_cast<const int64_t&>(orderedDict.find("b")->second));
+		CHECK_EQUAL(2u, flatDict.size());
+		CHECK_EQUAL(string("a"), flatDict.begin()->first);
+		CHECK_EQUAL(2, boost::any_cast<const int64_t&>(flatDict.find("b")->second));
+
+		// erasing from the hash dictionary leaves every other key reachable
+		vector<string> keys(1000);
+		Plist::HashDictionary<boost::any> hash;
+		for(int i = 0; i < 1000; ++i)
+		{
+			stringstream ss;
+			ss<<"key"<<i;
+			keys[i] = ss.str();
+			hash[keys[i]] = i;
+		}
+		CHECK_EQUAL(1000u, hash.size());
+		for(int i = 0; i < 1000; i += 2)
+			CHECK_EQUAL(1u, hash.erase(keys[i]));
+		CHECK_EQUAL(500u, hash.size());
+		for(int i = 1; i < 1000; i += 2)
+			CHECK_EQUAL(i, boost::any_cast<int>(hash[keys[i]]));
+		CHECK_EQUAL(500u, hash.size());
+		CHECK_EQUAL(0u, hash.erase("missing"));
+	}
+
+	TEST(READ_ALLOCATIONS)
+	{
+		map<string, boost::any> dict;
+		createMessage(dict);
+		vector<char> plists[2];
+		Plist::writePlistBinary(plists[0], dict);
+		Plist::writePlistXML(plists[1], dict);
+
+		for(int f = 0; f < 2; ++f)
+		{
+			const char* bytes = &plists[f][0];
+			int64_t size = plists[f].size();
+
+			startCountingAllocations();
+			boost::any message;
+			Plist::readPlist(bytes, size, message);
+			size_t readAllocations = stopCountingAllocations();
+
+			startCountingAllocations();
+			boost::any copy = message;
+			size_t copyAllocations = stopCountingAllocations();
+
+			// reading into a typed result moves the tree out, a copy would
+			// cost copyAllocations more
+			startCountingAllocations();
+			map<string, boost::any> typed;
+			Plist::readPlist(bytes, size, typed);
+			size_t typedAllocations = stopCountingAllocations();
+
+			startCountingAllocations();
+			map<string, boost::any> returned = Plist::readPlist<map<string, boost::any> >(bytes, size);
+			size_t returnedAllocations = stopCountingAllocations();
+
+			CHECK_EQUAL(readAllocations, typedAllocations);
+			CHECK_EQUAL(readAllocations, returnedAllocations);
+			checkDictionary(typed);
+			checkDictionary(returned);
+
+			// the binary reader builds every value in place, so reading costs
+			// what a copy of the tree costs, plus the strings a copy can share
+			// and scratch space.  Copying testArrayLarge or testDictLarge
+			// anywhere would cost 256 more.  The xml reader also goes through
+			// pugixml's document, so it isn't held to this.
+			if(f == 0)
+				CHECK(readAllocations <= copyAllocations + readOnlyAllocations(message) + 4);
+
+			startCountingAllocations();
+			boost::any hashMessage;
+			Plist::readPlist<Plist::HashDictionaryPolicy>(bytes, size, hashMessage);
+			size_t hashReadAllocations = stopCountingAllocations();
+
+			startCountingAllocations();
+			Plist::HashDictionary<boost::any> hash;
+			Plist::readPlist(bytes, size, hash);
+			size_t hashTypedAllocations = stopCountingAllocations();
+
+			CHECK_EQUAL(hashReadAllocations, hashTypedAllocations);
+		}
+	}
+
+#if defined(PLIST_HAS_PMR)
+	TEST(MEMORY_RESOURCE)
+	{
+		// everything the document allocates comes from the buffer, the
+		// null upstream throws if anything spills over
+		static char buffer[1 << 22];
+		Plist::Document document;
+		{
+			std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+			Plist::readPlist("binaryExample1.plist", document, &resource);
+			checkDictionary(boost::any_cast<const map<string, boost::any>&>(document.root().decode()));
+
+			// a copy owns a block from new, so it outlives the resource
+			Plist::Document copy(document);
+			document.swap(copy);
+		}
+		CHECK_EQUAL(string("hello there"), document.root()["testString"].asString());
+
+		map<string, boost::any> dict;
+		createMessage(dict);
+		Plist::Value value = Plist::Value::fromAny(dict);
+		vector<char> binary, xml;
+		Plist::writePlistBinary(binary, dict);
+		Plist::writePlistXML(xml, dict);
+
+		std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+		Plist::pmr::data_type pmrBinary(&resource), pmrXML(&resource);
+		Plist::writePlistBinary(pmrBinary, dict);
+		Plist::writePlistXML(pmrXML, dict);
+		CHECK(binary.size() == pmrBinary.size() && equal(binary.begin(), binary.end(), pmrBinary.begin()));
+		CHECK(xml.size() == pmrXML.size() && equal(xml.begin(), xml.end(), pmrXML.begin()));
+
+		pmrBinary.clear();
+		pmrXML.clear();
+		Plist::writePlistBinary(pmrBinary, value);
+		Plist::writePlistXML(pmrXML, value);
+		CHECK(binary.size() == pmrBinary.size() && equal(binary.begin(), binary.end(), pmrBinary.begin()));
+		CHECK(xml.size() == pmrXML.size() && equal(xml.begin(), xml.end(), pmrXML.begin()));
+	}
+#endif
+
+	TEST(FIELDS)
+	{
+		// a library and the same values as a tree, whose dictionaries keep
+		// member order
+		TestLibrary library;
+		Plist::OrderedDictionary<boost::any> tree;
+		library.title = "library";
+		library.version = 3;
+		library.tracks.resize(40);
+		vector<boost::any> tracks(library.tracks.size());
+		map<string, boost::any> byName;
+		for(int i = 0; i < (int) library.tracks.size(); ++i)
+		{
+			Plist::OrderedDictionary<boost::any> track;
+			createTrack(library.tracks[i], track, i);
+			tracks[i] = track;
+			if(i % 4 == 0)
+			{
+				library.byName[library.tracks[i].name] = library.tracks[i];
+				byName[library.tracks[i].name] = track;
+			}
+		}
+		map<string, boost::any> extra;
+		createMessage(extra);
+		library.extra = extra;
+		tree["title"] = library.title;
+		tree["tracks"] = tracks;
+		tree["byName"] = byName;
+		tree["extra"] = extra;
+		tree["version"] = library.version;
+
+		// written byte for byte as the tree is
+		vector<char> binary, xml, treeBinary, treeXML;
+		Plist::writePlistBinary(binary, library);
+		Plist::writePlistXML(xml, library);
+		Plist::writePlistBinary(treeBinary, tree);
+		Plist::writePlistXML(treeXML, tree);
+		CHECK(binary == treeBinary);
+		CHECK(xml == treeXML);
+
+		stringstream stream;
+		Plist::writePlistXML(stream, library);
+		CHECK_EQUAL(string(xml.begin(), xml.end()), stream.str());
+
+		const vector<char>* written[] = { &binary, &xml };
+		for(int f = 0; f < 2; ++f)
+		{
+			TestLibrary reread;
+			Plist::readPlist(&(*written[f])[0], written[f]->size(), reread);
+			CHECK_EQUAL(library.title, reread.title);
+			CHECK_EQUAL(library.version, reread.version);
+			CHECK_EQUAL(library.tracks.size(), reread.tracks.size());
+			for(size_t i = 0; i < library.tracks.size() && i < reread.tracks.size(); ++i)
+				checkTrack(library.tracks[i], reread.tracks[i]);
+			CHECK_EQUAL(library.byName.size(), reread.byName.size());
+			for(map<string, TestTrack>::const_iterator it = library.byName.begin(); it != library.byName.end(); ++it)
+				checkTrack(it->second, reread.byName[it->first]);
+			checkDictionary(boost::any_cast<const map<string, boost::any>&>(reread.extra));
+		}
+
+		// entries in any order, unknown ones skipped and missing members
+		// left alone
+		const char* shuffled =
+			"<plist><dict>"
+			"<key>enabled</key><true />"
+			"<key>unknown</key><dict><key>a</key><integer>1</integer></dict>"
+			"<key>count</key><integer>-42</integer>"
+			"<key>name</key><string>shuf<![CDATA[fled]]></string>"
+			"</dict></plist>";
+		TestTrack track;
+		track.score = 2.5;
+		track.enabled = false;
+		Plist::readPlist(shuffled, strlen(shuffled), track);
+		CHECK_EQUAL(string("shuffled"), track.name);
+		CHECK_EQUAL(-42, track.count);
+		CHECK_EQUAL(2.5, track.score);
+		CHECK(track.enabled);
+
+		vector<char> shuffledBinary;
+		Plist::writePlistBinary(shuffledBinary, Plist::readPlist<map<string, boost::any> >(shuffled, strlen(shuffled)));
+		TestTrack binaryTrack;
+		Plist::readPlist(&shuffledBinary[0], shuffledBinary.size(), binaryTrack);
+		CHECK_EQUAL(string("shuffled"), binaryTrack.name);
+		CHECK_EQUAL(-42, binaryTrack.count);
+
+		// a value of the wrong type throws
+		const char* mismatched = "<plist><dict><key>count</key><string>many</string></dict></plist>";
+		CHECK_THROW(Plist::readPlist(mismatched, strlen(mismatched), track), Plist::Error);
+		map<string, boost::any> wrong;
+		wrong["name"] = int64_t(1);
+		vector<char> wrongBinary;
+		Plist::writePlistBinary(wrongBinary, wrong);
+		CHECK_THROW(Plist::readPlist(&wrongBinary[0], wrongBinary.size(), track), Plist::Error);
+
+		// integers must fit their members, and xml ones must be numbers
+		TestNarrow narrow;
+		const char* limits = "<plist><dict><key>small</key><integer>-32768</integer><key>count</key><integer>4294967295</integer></dict></plist>";
+		Plist::readPlist(limits, strlen(limits), narrow);
+		CHECK_EQUAL(-32768, narrow.small);
+		CHECK_EQUAL(4294967295u, narrow.count);
+		const char* badIntegers[] = {
+			"<plist><dict><key>small</key><integer>70000</integer></dict></plist>",
+			"<plist><dict><key>count</key><integer>-1</integer></dict></plist>",
+			"<plist><dict><key>count</key><integer>12a</integer></dict></plist>",
+			"<plist><dict><key>count</key><integer>many</integer></dict></plist>" };
+		for(size_t i = 0; i < sizeof(badIntegers) / sizeof(badIntegers[0]); ++i)
+			CHECK_THROW(Plist::readPlist(badIntegers[i], strlen(badIntegers[i]), narrow), Plist::Error);
+
+		const char* members[] = { "small", "count" };
+		int64_t outOfRange[] = { 70000, -1 };
+		for(int i = 0; i < 2; ++i)
+		{
+			map<string, boost::any> wide;
+			wide[members[i]] = outOfRange[i];
+			vector<char> wideBinary;
+			Plist::writePlistBinary(wideBinary, wide);
+			CHECK_THROW(Plist::readPlist(&wideBinary[0], wideBinary.size(), narrow), Plist::Error);
+		}
+
+		// part of the example plists
+		map<string, boost::any> dict;
+		Plist::readPlist("binaryExample1.plist", dict);
+		const char* files[] = { "XMLExample1.plist", "binaryExample1.plist" };
+		for(int f = 0; f < 2; ++f)
+		{
+			TestExample example;
+			Plist::readPlist(files[f], example);
+			CHECK_EQUAL(string("hello there"), example.testString);
+			CHECK_EQUAL(-3455, example.testInt);
+			CHECK_CLOSE(1.34223f, example.testFloat, 1E-5);
+			CHECK(example.testBoolTrue);
+			CHECK_EQUAL(338610664, example.testDate.timeAsAppleEpoch());
+			CHECK(boost::any_cast<const vector<char>&>(dict["testImage"]) == example.testImage);
+			CHECK_EQUAL(2u, example.testArray.size());
+			CHECK_EQUAL(34, boost::any_cast<const int64_t&>(example.testArray[0]));
+			CHECK_EQUAL(string("inner dict item"), example.testDict["test string"]);
+			CHECK_EQUAL(256u, example.testDictLarge.size());
+			CHECK_EQUAL(255, example.testDictLarge["255"]);
+		}
+	}
+
+	TEST(UPDATER)
+	{
+		map<string, boost::any> dict;
+		createMessage(dict);
+		vector<char> plist;
+		Plist::writePlistBinary(plist, dict);
+		size_t writtenSize = plist.size();
+
+		Plist::BinaryPlistUpdater updater(plist);
+		updater.setCompactionThreshold(1);
+		updater.set("testString", string("changed"));
+		updater.set("testDict/test string", string("inner changed"));
+		updater.set("testArray/2", int64_t(7));
+		updater.set("testArrayLarge/5", string("five"));
+		updater.set("testDict/added", dict["testArray"]);
+		updater.erase("testBoolFalse");
+		updater.erase("testArray/0");
+		CHECK_THROW(updater.erase("missing"), Plist::Error);
+		CHECK_THROW(updater.set("testString/inner", 1), Plist::Error);
+		CHECK_THROW(updater.set("testArray/5", 1), Plist::Error);
+		CHECK_THROW(updater.set("missing/inner", 1), Plist::Error);
+		CHECK(updater.deadBytes() > 0);
+		updater.commit();
+
+		// only the edited containers and the offset table were rewritten
+		CHECK(plist.size() < writtenSize + 1024);
+
+		map<string, boost::any> updated;
+		Plist::readPlist(&plist[0], plist.size(), updated);
+		CHECK_EQUAL(string("changed"), boost::any_cast<const string&>(updated["testString"]));
+		CHECK_EQUAL(0u, updated.count("testBoolFalse"));
+		CHECK(boost::any_cast<bool>(updated["testBoolTrue"]));
+		const vector<boost::any>& array = boost::any_cast<const vector<boost::any>&>(updated["testArray"]);
+		CHECK_EQUAL(2u, array.size());
+		CHECK_EQUAL(string("string item in array"), boost::any_cast<const string&>(array[0]));
+		CHECK_EQUAL(7, boost::any_cast<const int64_t&>(array[1]));
+		const vector<boost::any>& large = boost::any_cast<const vector<boost::any>&>(updated["testArrayLarge"]);
+		CHECK_EQUAL(string("five"), boost::any_cast<const string&>(large[5]));
+		CHECK_EQUAL(255, boost::any_cast<const int64_t&>(large[255]));
+		const map<string, boost::any>& inner = boost::any_cast<const map<string, boost::any>&>(updated["testDict"]);
+		CHECK_EQUAL(string("inner changed"), boost::any_cast<const string&>(inner.find("test string")->second));
+		CHECK_EQUAL(2u, boost::any_cast<const vector<boost::any>&>(inner.find("added")->second).size());
+		CHECK(boost::any_cast<const vector<char>&>(dict["testImage"]) == boost::any_cast<const vector<char>&>(updated["testImage"]));
+
+		// added keys keep dictionaries in order for the view's lookups
+		Plist::BinaryPlistView view(&plist[0], plist.size());
+		CHECK_EQUAL(string("inner changed"), view["testDict"]["test string"].asString());
+		CHECK_EQUAL(2, view["testDict"]["added"].count());
+
+		// compacting drops the dead objects and leaves the same values
+		int64_t dead = updater.measureDeadBytes();
+		size_t committedSize = plist.size();
+		CHECK(dead > 0);
+		updater.compact();
+		CHECK_EQUAL(0, updater.deadBytes());
+		CHECK_EQUAL(0, updater.measureDeadBytes());
+		CHECK(plist.size() <= committedSize - dead);
+		map<string, boost::any> compacted;
+		Plist::readPlist(&plist[0], plist.size(), compacted);
+		vector<char> expected, actual;
+		Plist::writePlistBinary(expected, updated);
+		Plist::writePlistBinary(actual, compacted);
+		CHECK(expected == actual);
+
+		// a file, edited until its one byte refs overflow and it compacts
+		map<string, boost::any> small;
+		small["name"] = string("small");
+		Plist::writePlistBinary("updaterWritten.plist", small);
+		{
+			Plist::BinaryPlistUpdater fileUpdater("updaterWritten.plist");
+			fileUpdater.setCompactionThreshold(1);
+			fileUpdater.set("items", vector<boost::any>());
+			for(int i = 0; i < 300; ++i)
+			{
+				stringstream ss;
+				ss<<"item "<<i;
+				fileUpdater.set("items/" + ss.str().substr(5), ss.str());
+			}
+			fileUpdater.set("", boost::any(small));
+			fileUpdater.set("items", int64_t(300));
+			fileUpdater.commit();
+		}
+		map<string, boost::any> file;
+		Plist::readPlist("updaterWritten.plist", file);
+		CHECK_EQUAL(2u, file.size());
+		CHECK_EQUAL(300, boost::any_cast<const int64_t&>(file["items"]));
+
+		{
+			Plist::BinaryPlistUpdater fileUpdater("updaterWritten.plist");
+			fileUpdater.setCompactionThreshold(0);
+			fileUpdater.set("name", string("compacted"));
+			fileUpdater.commit();
+			CHECK_EQUAL(0, fileUpdater.measureDeadBytes());
+		}
+		file.clear();
+		Plist::readPlist("updaterWritten.plist", file);
+		CHECK_EQUAL(string("compacted"), boost::any_cast<const string&>(file["name"]));
+
+		// keys added to a large sorted dictionary in a file, which checks
+		// its order once rather than scanning it for every missing key
+		map<string, boost::any> keyed;
+		for(int i = 0; i < 4000; ++i)
+		{
+			stringstream ss;
+			ss<<"key"<<(10000 + i * 2);
+			keyed[ss.str()] = int64_t(i);
+		}
+		Plist::writePlistBinary("updaterWritten.plist", keyed);
+		{
+			Plist::BinaryPlistUpdater fileUpdater("updaterWritten.plist");
+			for(int i = 0; i < 200; ++i)
+			{
+				stringstream ss;
+				ss<<"key"<<(10001 + i * 20);
+				fileUpdater.set(ss.str(), int64_t(-i));
+			}
+			fileUpdater.set("key10000", int64_t(-1));
+			fileUpdater.erase("key10002");
+			CHECK_THROW(fileUpdater.erase("key10002"), Plist::Error);
+			fileUpdater.commit();
+		}
+		file.clear();
+		Plist::readPlist("updaterWritten.plist", file);
+		CHECK_EQUAL(4199u, file.size());
+		CHECK_EQUAL(-199, boost::any_cast<const int64_t&>(file["key13981"]));
+		CHECK_EQUAL(-1, boost::any_cast<const int64_t&>(file["key10000"]));
+		CHECK_EQUAL(0u, file.count("key10002"));
+
+		// keys out of order still replace their entry rather than adding one
+		const unsigned char unsorted[] = {
+			'b', 'p', 'l', 'i', 's', 't', '0', '0',
+			0xD2, 0x01, 0x02, 0x03, 0x04,
+			0x51, 'b', 0x51, 'a',
+			0x10, 0x01, 0x10, 0x02,
+			0x08, 0x0D, 0x0F, 0x11, 0x13,
+			0, 0, 0, 0, 0, 0, 1, 1,
+			0, 0, 0, 0, 0, 0, 0, 5,
+			0, 0, 0, 0, 0, 0, 0, 0,
+			0, 0, 0, 0, 0, 0, 0, 21 };
+		vector<char> unsortedPlist(unsorted, unsorted + sizeof(unsorted));
+		Plist::BinaryPlistUpdater unsortedUpdater(unsortedPlist);
+		unsortedUpdater.set("a", int64_t(3));
+		unsortedUpdater.commit();
+		map<string, boost::any> unsortedDict;
+		Plist::readPlist(&unsortedPlist[0], unsortedPlist.size(), unsortedDict);
+		CHECK_EQUAL(2u, unsortedDict.size());
+		CHECK_EQUAL(3, boost::any_cast<const int64_t&>(unsortedDict["a"]));
+	}
+
+	TEST(DECODE_LIMITS)
+	{
+		vector<char> shared = createSharedPlist(40, false);
+		boost::any message;
+		Plist::DecodeLimits limits;
+		limits.maxObjects = 100000;
+		CHECK_THROW(Plist::readPlist(&shared[0], shared.size(), message, limits), Plist::Error);
+
+		// a document builds each shared object once
+		Plist::Document document;
+		Plist::readPlist(&shared[0], shared.size(), document, limits);
+		CHECK(document.memoryUsed() < 2048);
+		Plist::Document::Node node = document.root();
+		for(int i = 0; i < 40; ++i)
+		{
+			CHECK_EQUAL(2, node.count());
+			node = node[i % 2];
+		}
+		CHECK_EQUAL(string("x"), node.asString());
+
+		limits.maxObjects = 40;
+		CHECK_THROW(Plist::readPlist(&shared[0], shared.size(), document, limits), Plist::Error);
+
+		// plists that contain themselves, or nest too deep, fail with the
+		// default limits rather than running out of stack
+		vector<char> cycle = createSharedPlist(3, true);
+		Plist::Value value;
+		CHECK_THROW(Plist::readPlist(&cycle[0], cycle.size(), message), Plist::Error);
+		CHECK_THROW(Plist::readPlist(&cycle[0], cycle.size(), value), Plist::Error);
+		CHECK_THROW(Plist::readPlist(&cycle[0], cycle.size(), document), Plist::Error);
+
+		string deep = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<plist version=\"1.0\">\n";
+		for(int i = 0; i < 600; ++i)
+			deep += "<array>";
+		for(int i = 0; i < 600; ++i)
+			deep += "</array>";
+		deep += "</plist>\n";
+		CHECK_THROW(Plist::readPlist(deep.data(), deep.size(), message), Plist::Error);
+		CHECK_THROW(Plist::readPlist(deep.data(), deep.size(), document), Plist::Error);
+
+		limits = Plist::DecodeLimits();
+		limits.maxDepth = 1000;
+		Plist::readPlist(deep.data(), deep.size(), message, limits);
+		Plist::readPlist(deep.data(), deep.size(), document, limits);
+		CHECK_EQUAL(1, document.root().count());
+
+		map<string, boost::any> dict;
+		createMessage(dict);
+		vector<char> plist;
+		Plist::writePlistBinary(plist, dict);
+		limits = Plist::DecodeLimits();
+		limits.maxBytes = 1000;
+		CHECK_THROW(Plist::readPlist(&plist[0], plist.size(), message, limits), Plist::Error);
+		limits.maxBytes = 1000000;
+		Plist::readPlist(&plist[0], plist.size(), message, limits);
+		checkDictionary(boost::any_cast<const map<string, boost::any>&>(message));
+	}
+
+	TEST(VALIDATE)
+	{
+		map<string, boost::any> dict;
+		createMessage(dict);
+		vector<char> binary;
+		vector<char> xml;
+		Plist::writePlistBinary(binary, dict);
+		Plist::writePlistXML(xml, dict);
+		CHECK(Plist::validatePlist(&binary[0], binary.size()));
+		CHECK(Plist::validatePlist(&xml[0], xml.size()));
+
+		const char* files[] = { "binaryExample1.plist", "XMLExample1.plist" };
+		for(int i = 0; i < 2; ++i)
+		{
+			ifstream stream(files[i], ios::binary);
+			vector<char> plist((istreambuf_iterator<char>(stream)), istreambuf_iterator<char>());
+			CHECK(Plist::validatePlist(&plist[0], plist.size()));
+		}
+
+		// shared objects are fine, a plist containing itself isn't
+		vector<char> shared = createSharedPlist(40, false);
+		CHECK(Plist::validatePlist(&shared[0], shared.size()));
+		vector<char> cycle = createSharedPlist(3, true);
+		string problem;
+		CHECK(!Plist::validatePlist(&cycle[0], cycle.size(), problem));
+		CHECK_EQUAL(string("Plist: binary plist object contains itself"), problem);
+
+		// a damaged plist is either rejected or reads without error
+		dict.erase("testImage");
+		Plist::writePlistBinary(binary, dict);
+		size_t rejected = 0;
+		for(size_t i = 0; i < binary.size(); ++i)
+		{
+			const char values[] = { 0, (char) 0x80, (char) 0xFF };
+			for(int value = 0; value < 3; ++value)
+			{
+				vector<char> damaged(binary);
+				damaged[i] = values[value];
+				if(Plist::validatePlist(&damaged[0], damaged.size()))
+				{
+					boost::any message;
+					Plist::readPlist(&damaged[0], damaged.size(), message);
+				}
+				else
+					++rejected;
+			}
+		}
+		CHECK(rejected > 0);
+
+		// {1 = 1}, and a lone utf-16 surrogate
+		const unsigned char integerKey[] = {
+			'b', 'p', 'l', 'i', 's', 't', '0', '0',
+			0xD1, 0x01, 0x01, 0x10, 0x01,
+			0x08, 0x0B,
+			0, 0, 0, 0, 0, 0, 1, 1,
+			0, 0, 0, 0, 0, 0, 0, 2,
+			0, 0, 0, 0, 0, 0, 0, 0,
+			0, 0, 0, 0, 0, 0, 0, 13 };
+		CHECK(!Plist::validatePlist((const char*) integerKey, sizeof(integerKey)));
+		const unsigned char loneSurrogate[] = {
+			'b', 'p', 'l', 'i', 's', 't', '0', '0',
+			0x61, 0xD8, 0x00,
+			0x08,
+			0, 0, 0, 0, 0, 0, 1, 1,
+			0, 0, 0, 0, 0, 0, 0, 1,
+			0, 0, 0, 0, 0, 0, 0, 0,
+			0, 0, 0, 0, 0, 0, 0, 11 };
+		CHECK(!Plist::validatePlist((const char*) loneSurrogate, sizeof(loneSurrogate)));
+
+		const char* badXML[] = {
+			"<plist version=\"1.0\"><integer>12a</integer></plist>",
+			"<plist version=\"1.0\"><date>yesterday</date></plist>",
+			"<plist version=\"1.0\"><array><key>a</key></array></plist>",
+			"<plist version=\"1.0\"><dict><key>a</key></dict></plist>",
+			"<plist version=\"1.0\"><dict><key>a</key><data>*</data></dict></plist>",
+			"<plist version=\"1.0\"><set /></plist>",
+			"<plist version=\"1.0\"><array></plist>",
+			"<plist version=\"1.0\"></plist>" };
+		for(size_t i = 0; i < sizeof(badXML) / sizeof(badXML[0]); ++i)
+			CHECK(!Plist::validatePlist(badXML[i], strlen(badXML[i])));
+
+		string deep = "<plist version=\"1.0\">";
+		for(int i = 0; i < 600; ++i)
+			deep += "<array>";
+		for(int i = 0; i < 600; ++i)
+			deep += "</array>";
+		deep += "</plist>";
+		CHECK(!Plist::validatePlist(deep.data(), deep.size()));
+	}
+
+	TEST(PARALLEL_READ)
+	{
+		map<string, boost::any> dict;
+		createMessage(dict);
+		vector<boost::any> records(500);
+		for(int i = 0; i < 500; ++i)
+		{
+			vector<boost::any> values(70 + i % 3);
+			for(size_t j = 0; j < values.size(); ++j)
+				values[j] = int64_t(i * j);
+			map<string, boost::any> record;
+			record["id"] = int64_t(i);
+			record["values"] = values;
+			records[i] = record;
+		}
+		dict["records"] = records;
+
+		vector<char> plist;
+		Plist::writePlistBinary(plist, dict);
+		boost::any expected;
+		Plist::readPlist(&plist[0], plist.size(), expected);
+		vector<char> expectedPlist;
+		Plist::writePlistBinary(expectedPlist, expected);
+
+		unsigned threadCounts[] = { 0, 1, 2, 7 };
+		for(int i = 0; i < 4; ++i)
+		{
+			boost::any message;
+			Plist::readPlistParallel(&plist[0], plist.size(), message, threadCounts[i]);
+			checkDictionary(boost::any_cast<const map<string, boost::any>&>(message));
+			vector<char> messagePlist;
+			Plist::writePlistBinary(messagePlist, message);
+			CHECK(messagePlist == expectedPlist);
+		}
+
+		boost::any message;
+		Plist::readPlistParallel("XMLExample1.plist", message, 2);
+		checkDictionary(boost::any_cast<const map<string, boost::any>&>(message));
+
+		// too deep to read, on whichever thread gets there
+		boost::any deep = vector<boost::any>();
+		for(int i = 0; i < 600; ++i)
+		{
+			vector<boost::any> level(100, int64_t(i));
+			level[0] = deep;
+			deep = level;
+		}
+		Plist::writePlistBinary(plist, deep);
+		CHECK_THROW(Plist::readPlistParallel(&plist[0], plist.size(), message, 4), Plist::Error);
+
+		vector<char> cycle = createSharedPlist(3, true);
+		CHECK_THROW(Plist::readPlistParallel(&cycle[0], cycle.size(), message, 4), Plist::Error);
+	}
+
+	TEST(PROJECTION)
+	{
+		map<string, boost::any> dict;
+		dict["CFBundleIdentifier"] = string("com.example.app");
+		dict["skipped"] = string("never decoded");
+		vector<boost::any> items(3);
+		for(int i = 0; i < 3; ++i)
+		{
+			map<string, boost::any> item;
+			item["id"] = int64_t(i);
+			item["name"] = string("item");
+			items[i] = item;
+		}
+		items[2] = string("not a dictionary");
+		dict["Items"] = items;
+		map<string, boost::any> meta;
+		meta["version"] = int64_t(3);
+		meta["build"] = string("1a2");
+		dict["Meta"] = meta;
+
+		vector<char> plist;
+		Plist::writePlistBinary(plist, dict);
+
+		// an object readPlist can't decode, under a key that isn't asked for
+		string skipped = "never decoded";
+		vector<char>::iterator found = search(plist.begin(), plist.end(), skipped.begin(), skipped.end());
+		CHECK(found != plist.end());
+		*(found - 1) = (char) 0x70;
+		boost::any message;
+		CHECK_THROW(Plist::readPlist(&plist[0], plist.size(), message), Plist::Error);
+
+		Plist::KeyPathSet paths;
+		paths.add("CFBundleIdentifier");
+		paths.add("Items/*/id");
+		paths.add("Meta/version");
+		paths.add("Missing/key");
+		Plist::projectPlist(&plist[0], plist.size(), paths, message);
+
+		const map<string, boost::any>& root = boost::any_cast<const map<string, boost::any>&>(message);
+		CHECK_EQUAL(3u, root.size());
+		CHECK_EQUAL(string("com.example.app"), boost::any_cast<const string&>(root.find("CFBundleIdentifier")->second));
+		const vector<boost::any>& projectedItems = boost::any_cast<const vector<boost::any>&>(root.find("Items")->second);
+		CHECK_EQUAL(2u, projectedItems.size());
+		for(int i = 0; i < 2; ++i)
+		{
+			const map<string, boost::any>& item = boost::any_cast<const map<string, boost::any>&>(projectedItems[i]);
+			CHECK_EQUAL(1u, item.size());
+			CHECK_EQUAL(i, boost::any_cast<const int64_t&>(item.find("id")->second));
+		}
+		const map<string, boost::any>& projectedMeta = boost::any_cast<const map<string, boost::any>&>(root.find("Meta")->second);
+		CHECK_EQUAL(1u, projectedMeta.size());
+		CHECK_EQUAL(3, boost::any_cast<const int64_t&>(projectedMeta.find("version")->second));
+
+		// a path ending at a container takes all of it
+		Plist::KeyPathSet whole;
+		whole.add("Meta/version");
+		whole.add("Meta");
+		Plist::projectPlist(&plist[0], plist.size(), whole, message);
+		map<string, boost::any>& wholeRoot = boost::any_cast<map<string, boost::any>&>(message);
+		const map<string, boost::any>& wholeMeta = boost::any_cast<const map<string, boost::any>&>(wholeRoot["Meta"]);
+		CHECK_EQUAL(2u, wholeMeta.size());
+
+		// {"caf\xc3\xa9" = 1} with the key in utf-16, as CoreFoundation writes it
+		const unsigned char unicodeKey[] = {
+			'b', 'p', 'l', 'i', 's', 't', '0', '0',
+			0xD1, 0x01, 0x02,
+			0x64, 0x00, 'c', 0x00, 'a', 0x00, 'f', 0x00, 0xE9,
+			0x10, 0x01,
+			0x08, 0x0B, 0x14,
+			0, 0, 0, 0, 0, 0, 1, 1,
+			0, 0, 0, 0, 0, 0, 0, 3,
+			0, 0, 0, 0, 0, 0, 0, 0,
+			0, 0, 0, 0, 0, 0, 0, 22 };
+		Plist::KeyPathSet unicodePaths;
+		unicodePaths.add("caf");
+		unicodePaths.add("caf\xc3\xa9");
+		Plist::projectPlist((const char*) unicodeKey, sizeof(unicodeKey), unicodePaths, message);
+		map<string, boost::any>& unicodeRoot = boost::any_cast<map<string, boost::any>&>(message);
+		CHECK_EQUAL(1u, unicodeRoot.size());
+		CHECK_EQUAL(1, boost::any_cast<const int64_t&>(unicodeRoot["caf\xc3\xa9"]));
+
+		// from another writer
+		ifstream stream("binaryExample1.plist", ios::binary);
+		vector<char> example((istreambuf_iterator<char>(stream)), istreambuf_iterator<char>());
+		Plist::KeyPathSet examplePaths;
+		examplePaths.add("testString");
+		examplePaths.add("testDict/test string");
+		Plist::projectPlist(&example[0], example.size(), examplePaths, message);
+		map<string, boost::any>& exampleRoot = boost::any_cast<map<string, boost::any>&>(message);
+		CHECK_EQUAL(2u, exampleRoot.size());
+		CHECK_EQUAL(string("hello there"), boost::any_cast<const string&>(exampleRoot["testString"]));
+		CHECK_EQUAL(string("inner dict item"), boost::any_cast<const string&>(
+					boost::any_cast<map<string, boost::any>&>(exampleRoot["testDict"])["test string"]));
+	}
+
+	TEST(PROBE)
+	{
+		map<string, boost::any> dict;
+		createMessage(dict);
+		vector<char> binary;
+		Plist::writePlistBinary(binary, dict);
+
+		Plist::PlistInfo info = Plist::probePlist(&binary[0], binary.size());
+		CHECK_EQUAL(Plist::BinaryFormat, info.format);
+		CHECK_EQUAL(Plist::PlistInfo::DictionaryType, info.rootType);
+		CHECK_EQUAL((int64_t) dict.size(), info.rootCount);
+		CHECK(info.objectCount > 256);
+		CHECK_EQUAL(4, info.offsetByteSize);
+		CHECK_EQUAL(2, info.objRefSize);
+		CHECK(info.approximateSize > (int64_t) binary.size());
+
+		vector<char> xml;
+		Plist::writePlistXML(xml, dict);
+		info = Plist::probePlist(&xml[0], xml.size());
+		CHECK_EQUAL(Plist::XMLFormat, info.format);
+		CHECK_EQUAL(Plist::PlistInfo::DictionaryType, info.rootType);
+		CHECK_EQUAL(-1, info.rootCount);
+		CHECK_EQUAL(-1, info.objectCount);
+
+		// counts that don't fit in the marker
+		vector<boost::any> array(300, string("item"));
+		Plist::writePlistBinary(binary, array);
+		info = Plist::probePlist(&binary[0], binary.size());
+		CHECK_EQUAL(Plist::PlistInfo::ArrayType, info.rootType);
+		CHECK_EQUAL(300, info.rootCount);
+		boost::any text = string(20, 'x');
+		Plist::writePlistBinary(binary, text);
+		info = Plist::probePlist(&binary[0], binary.size());
+		CHECK_EQUAL(Plist::PlistInfo::StringType, info.rootType);
+		CHECK_EQUAL(20, info.rootCount);
+
+		info = Plist::probePlist("binaryExample1.plist");
+		CHECK_EQUAL(Plist::BinaryFormat, info.format);
+		CHECK_EQUAL(Plist::PlistInfo::DictionaryType, info.rootType);
+		info = Plist::probePlist("XMLExample1.plist");
+		CHECK_EQUAL(Plist::XMLFormat, info.format);
+		CHECK_EQUAL(Plist::PlistInfo::DictionaryType, info.rootType);
+
+		const char* xmlRoots[] = {
+			"<?xml version=\"1.0\"?>\n<!-- <dict> -->\n<!DOCTYPE plist [ <!ENTITY a \"b\"> ]>\n<plist version=\"1.0\">\n\t<array/>\n</plist>",
+			"<plist><true/></plist>" };
+		CHECK_EQUAL(Plist::PlistInfo::ArrayType, Plist::probePlist(xmlRoots[0], strlen(xmlRoots[0])).rootType);
+		CHECK_EQUAL(Plist::PlistInfo::BooleanType, Plist::probePlist(xmlRoots[1], strlen(xmlRoots[1])).rootType);
+
+		const char* bad[] = { "bplist00", "hello", "<plist/>", "<plist><set/></plist>", "<dict></dict>" };
+		for(size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i)
+			CHECK_THROW(Plist::probePlist(bad[i], strlen(bad[i])), Plist::Error);
+		CHECK_THROW(Plist::probePlist("missing.plist"), Plist::Error);
+	}
+
 //	TEST(UNICODE)
 //	{
 //		map<string, boost::any> dict;